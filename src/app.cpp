@@ -1,20 +1,33 @@
 #include "app.h"
 #include "tui_bindings.h"
 #include "security.h"
+#include "html_export.h"
+#include "utf8_util.h"
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
 #include <ftxui/dom/elements.hpp>
 #include <ftxui/screen/string.hpp>
+#include <ftxui/screen/terminal.hpp>
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <functional>
+#include <iomanip>
 
 using namespace ftxui;
 
 namespace ShinoEditor {
 
 namespace {
+// バイト数を "12.3 MB" の形に
+std::string FormatMegabytes(size_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB";
+    return out.str();
+}
+
 // UTF-8の末尾1コードポイントを安全に削除
 void Utf8PopBack(std::string& s) {
     if (s.empty()) return;
@@ -34,12 +47,177 @@ void Utf8PopBack(std::string& s) {
     // 念のため全消去（異常なバイト列）
     s.clear();
 }
+
+Decorator HighlightDecorator(HighlightStyle style) {
+    switch (style) {
+        case HighlightStyle::HEADER: return color(Color::Cyan) | bold;
+        case HighlightStyle::EMPHASIS: return color(Color::Yellow);
+        case HighlightStyle::STRONG: return color(Color::Yellow) | bold;
+        case HighlightStyle::INLINE_CODE: return color(Color::Green);
+        case HighlightStyle::LINK: return color(Color::BlueLight) | underlined;
+        case HighlightStyle::FENCE_MARKER: return color(Color::Magenta);
+        case HighlightStyle::FENCE_BODY: return color(Color::Green);
+        case HighlightStyle::QUOTE: return color(Color::GrayLight) | dim;
+        case HighlightStyle::LIST_MARKER: return color(Color::Yellow) | bold;
+        // カーソル行の背景色に消されないよう反転で示す
+        case HighlightStyle::SEARCH_MATCH: return inverted;
+        case HighlightStyle::SEARCH_CURRENT: return Decorator(inverted) | bold | underlined;
+    }
+    return nothing;
+}
+
+// [begin, end) の範囲をハイライト範囲で分割して1段分の要素にする
+Element HighlightedRow(const std::string& line, size_t begin, size_t end,
+                       const std::vector<HighlightSpan>* spans) {
+    if (!spans || spans->empty()) {
+        return text(to_wstring(line.substr(begin, end - begin)));
+    }
+    Elements parts;
+    size_t pos = begin;
+    for (const auto& span : *spans) {
+        if (span.end <= begin) continue;
+        if (span.begin >= end) break;
+        const size_t s = std::max(span.begin, begin);
+        const size_t e = std::min(span.end, end);
+        if (s > pos) parts.push_back(text(to_wstring(line.substr(pos, s - pos))));
+        parts.push_back(text(to_wstring(line.substr(s, e - s))) | HighlightDecorator(span.style));
+        pos = e;
+    }
+    if (pos < end) parts.push_back(text(to_wstring(line.substr(pos, end - pos))));
+    return hbox(std::move(parts));
+}
+
+// 折り返し済みの行を from_row 段目から最大 max_rows 段まで出力
+void AppendWrappedRows(Elements& out, const std::string& line,
+                       const std::vector<size_t>& row_starts, int from_row, int max_rows,
+                       const std::vector<HighlightSpan>* spans, const Decorator& style) {
+    for (int r = from_row; r < static_cast<int>(row_starts.size()); ++r) {
+        if (static_cast<int>(out.size()) >= max_rows) return;
+        const size_t begin = row_starts[r];
+        const size_t end = r + 1 < static_cast<int>(row_starts.size()) ? row_starts[r + 1] : line.size();
+        auto row = HighlightedRow(line, begin, end, spans);
+        out.push_back(style ? row | style : row);
+    }
+}
+
+Decorator PreviewRunDecorator(uint8_t style) {
+    Decorator decorator = nothing;
+    if (style & PREVIEW_STRONG) decorator = decorator | bold;
+    if (style & PREVIEW_EMPHASIS) decorator = decorator | color(Color::Yellow);
+    if (style & PREVIEW_CODE) decorator = decorator | color(Color::Green);
+    if (style & PREVIEW_LINK) decorator = decorator | color(Color::BlueLight) | underlined;
+    if (style & PREVIEW_STRIKE) decorator = decorator | dim;
+    return decorator;
+}
+
+// プレビューの 1 論理行を幅 width で折り返し、最大 max_rows 段まで出力
+void AppendPreviewLine(Elements& out, const PreviewLine& line, int width, int max_rows) {
+    if (static_cast<int>(out.size()) >= max_rows) return;
+    std::string bar;
+    for (int d = 0; d < line.quote_depth; ++d) bar += "│ ";
+    const int bar_cols = 2 * line.quote_depth;
+
+    if (line.kind == PreviewLineKind::BLANK) {
+        out.push_back(text(bar) | dim);
+        return;
+    }
+    if (line.kind == PreviewLineKind::RULE) {
+        std::string rule;
+        for (int c = std::max(1, width - bar_cols); c > 0; --c) rule += "─";
+        out.push_back(hbox({text(bar), text(rule)}) | dim);
+        return;
+    }
+
+    const int prefix_cols = utf8::DisplayWidth(line.prefix);
+    const std::string body = line.PlainText();
+    const auto row_starts = WrapLayout::ComputeRowStarts(body, std::max(1, width - bar_cols - prefix_cols));
+    const Decorator kind_style = line.kind == PreviewLineKind::HEADER ? bold | color(Color::Cyan) : nothing;
+
+    size_t run_index = 0;
+    size_t run_begin = 0; // runs[run_index] の body 内の開始位置
+    for (size_t r = 0; r < row_starts.size(); ++r) {
+        if (static_cast<int>(out.size()) >= max_rows) return;
+        const size_t begin = row_starts[r];
+        const size_t end = r + 1 < row_starts.size() ? row_starts[r + 1] : body.size();
+
+        Elements parts;
+        if (bar_cols > 0) parts.push_back(text(bar) | dim);
+        if (prefix_cols > 0) {
+            parts.push_back(r == 0 ? text(line.prefix) | color(Color::Yellow) | bold
+                                   : text(std::string(prefix_cols, ' ')));
+        }
+        while (run_index < line.runs.size()) {
+            const PreviewRun& run = line.runs[run_index];
+            const size_t run_end = run_begin + run.text.size();
+            const size_t s = std::max(begin, run_begin);
+            const size_t e = std::min(end, run_end);
+            if (s < e) {
+                parts.push_back(text(to_wstring(body.substr(s, e - s))) | PreviewRunDecorator(run.style));
+            }
+            if (run_end > end) break;
+            run_begin = run_end;
+            ++run_index;
+        }
+        out.push_back(hbox(std::move(parts)) | kind_style);
+    }
+}
 }
 
 App::App() : screen_(ScreenInteractive::Fullscreen()) {
+    // DOCX の入出力のたびに pandoc を起動して確かめないよう、起動時に一度だけ調べておく
+    PandocIO::StartCapabilityProbe();
     block_model_ = std::make_unique<BlockModel>(lines_);
     renderer_ = std::make_unique<MarkdownRenderer>();
+    render_cache_ = std::make_unique<BlockRenderCache>(*renderer_);
+    // プレビューのワーカースレッド自身も処理に加わるので 1 本少なくする
+    render_pool_ = std::make_unique<ThreadPool>(std::max<size_t>(1, ThreadPool::DefaultThreadCount() - 1));
+    wrap_layout_ = std::make_unique<WrapLayout>(lines_);
+    highlighter_ = std::make_unique<SyntaxHighlighter>(lines_);
+    column_cache_ = std::make_unique<ColumnIndexCache>(lines_);
+    // UI スレッドも走査に加わるので 1 本少なくする（1 コアならプールなし）
+    if (ThreadPool::DefaultThreadCount() > 1) {
+        search_pool_ = std::make_unique<ThreadPool>(ThreadPool::DefaultThreadCount() - 1);
+    }
+    incremental_search_ = std::make_unique<IncrementalSearch>(lines_, search_pool_.get());
+    search_index_ = std::make_unique<TrigramIndex>(lines_);
+    incremental_search_->SetIndex(search_index_.get());
+    folded_lines_ = std::make_unique<FoldedLines>(lines_);
+    folded_search_ = std::make_unique<IncrementalSearch>(folded_lines_->Lines(), search_pool_.get());
     main_component_ = CreateMainComponent();
+
+    // ディレクトリ検索の結果は UI ループで取り出す（取り出し待ちがあれば投げ直さない）
+    dir_search_ = std::make_unique<DirectorySearch>([this] {
+        if (dir_poll_pending_.exchange(true)) return;
+        screen_.Post([this] {
+            dir_poll_pending_ = false;
+            PollDirectorySearch();
+        });
+        screen_.PostEvent(Event::Custom);
+    });
+
+    // DOCX の入出力のジョブ: 実行中はステータスの経過時間を進め、終わったら結果を UI ループで反映する
+    docx_job_ = std::make_unique<BackgroundJob>(
+        [this] { screen_.PostEvent(Event::Custom); },
+        [this] {
+            screen_.Post([this] { FinishDocxJob(); });
+            screen_.PostEvent(Event::Custom);
+        });
+
+    // レンダリングはワーカースレッドで行い、結果は UI ループに渡して反映する
+    preview_worker_ = std::make_unique<PreviewWorker>(
+        [this](const PreviewSnapshot& units, const std::atomic<bool>& cancel) {
+            std::string html = render_cache_->Render(units, &cancel, render_pool_.get());
+            if (cancel || !html.empty()) return html;
+            std::string markdown;
+            for (const auto& unit : units) markdown += unit;
+            return renderer_->RenderToText(markdown, &cancel);
+        },
+        [this](uint64_t revision, std::string content) {
+            screen_.Post([this, revision, content = std::move(content)]() mutable {
+                OnPreviewRendered(revision, std::move(content));
+            });
+            screen_.PostEvent(Event::Custom);
+        });
 }
 
 App::~App() = default;
@@ -74,6 +252,7 @@ bool App::LoadFile(const std::string& filename) {
         
         filename_ = filename;
         modified_ = false;
+        NotifyDocumentReplaced();
         UpdateBlockModel();
         return true;
     } catch (const security::SecurityError& e) {
@@ -141,7 +320,7 @@ void App::ToggleBlockFold() {
             if (header_vi >= 0) current_line_ = header_vi;
         }
         // 最終クランプ
-        auto vis = GetVisibleEditorLines();
+        const auto& vis = GetVisibleEditorLines();
         if (vis.empty()) {
             current_line_ = 0;
         } else if (current_line_ >= static_cast<int>(vis.size())) {
@@ -155,6 +334,7 @@ void App::MoveBlockUp() {
     int real = VisibleToRealIndex(current_line_);
     if (real >= 0 && block_model_->MoveBlockUp(real)) {
         modified_ = true;
+        NotifyDocumentReplaced();
         SetStatusMessage("Block moved up");
     } else {
         SetStatusMessage("Cannot move block up");
@@ -165,6 +345,7 @@ void App::MoveBlockDown() {
     int real = VisibleToRealIndex(current_line_);
     if (real >= 0 && block_model_->MoveBlockDown(real)) {
         modified_ = true;
+        NotifyDocumentReplaced();
         SetStatusMessage("Block moved down");
     } else {
         SetStatusMessage("Cannot move block down");
@@ -176,6 +357,22 @@ void App::TogglePreview() {
     SetStatusMessage(show_preview_ ? "Preview enabled" : "Preview disabled");
 }
 
+void App::TogglePreviewMode() {
+    preview_mode_ = preview_mode_ == PreviewMode::NATIVE ? PreviewMode::HTML : PreviewMode::NATIVE;
+    SetStatusMessage(preview_mode_ == PreviewMode::NATIVE ? "Preview mode: native" : "Preview mode: HTML");
+}
+
+void App::ToggleSoftWrap() {
+    soft_wrap_ = !soft_wrap_;
+    h_scroll_ = 0;
+    scroll_offset_ = 0; // 描画時にカーソル位置へ補正される
+    SetStatusMessage(soft_wrap_ ? "Soft wrap enabled" : "Soft wrap disabled (←/→ to scroll)");
+}
+
+void App::ScrollHorizontal(int delta_cols) {
+    h_scroll_ = std::max(0, h_scroll_ + delta_cols);
+}
+
 void App::ToggleHelp() {
     show_help_ = !show_help_;
     help_tab_index_ = show_help_ ? 1 : 0;
@@ -183,10 +380,16 @@ void App::ToggleHelp() {
 
 void App::ShowSearch() {
     show_search_ = true;
+    search_tab_index_ = 1;
     search_query_.clear();
+    search_replace_field_ = false;
     search_matches_.clear();
     current_match_ = -1;
-    SetStatusMessage("Enter search text (Enter to search, Esc to cancel)");
+    // 前の検索の走査が残っていれば止める（積んだ結果は文書が変わるまで使い直せる）
+    ActiveSearch().SetQuery("", doc_revision_);
+    StopRegexSearch();
+    SetStatusMessage(search_regex_ ? "Enter regex (Enter to search, ^R: literal, Esc to cancel)"
+                                   : "Enter search text (Enter to confirm, ^R: regex, Esc to cancel)");
 }
 
 void App::FindMatches(const std::string& query) {
@@ -200,36 +403,350 @@ void App::FindMatches(const std::string& query) {
     }
 
     // Find all matches
-    for (int i = 0; i < static_cast<int>(lines_.size()); i++) {
-        if (lines_[i].find(query) != std::string::npos) {
-            search_matches_.push_back(i);
-        }
-    }
+    StartSearch(query);
+    while (!ActiveSearch().Step()) {}
+    AppendFoundMatches();
+    search_revision_ = doc_revision_;
 
     if (search_matches_.empty()) {
         SetStatusMessage("No matches found");
     } else {
         current_match_ = 0;
         // Move to first match
-        int visible_idx = RealToVisibleIndex(search_matches_[current_match_]);
-        if (visible_idx >= 0) {
-            current_line_ = visible_idx;
+        JumpToCurrentMatch();
+        ReportSearchStatus();
+    }
+}
+
+void App::FindRegexMatches(const std::string& pattern) {
+    search_matches_.clear();
+    current_match_ = -1;
+    ActiveSearch().SetQuery("", doc_revision_);
+    StopRegexSearch();
+    if (pattern.empty()) {
+        SetStatusMessage("Search cancelled");
+        return;
+    }
+    try {
+        regex_search_ = std::make_unique<RegexSearcher>(pattern);
+    } catch (const ShinoError& e) {
+        SetStatusMessage(e.message());
+        return;
+    }
+    regex_next_line_ = 0;
+    regex_revision_ = doc_revision_;
+    search_revision_ = doc_revision_;
+    StepRegexSearch();
+}
+
+void App::StepRegexSearch() {
+    // 編集されたら走査をやめる（一致位置がずれている）
+    if (!regex_search_ || regex_revision_ != doc_revision_) {
+        StopRegexSearch();
+        return;
+    }
+    size_t bytes = 0;
+    while (regex_next_line_ < lines_.size() && bytes < kRegexStepBytes) {
+        const std::string& line = lines_[regex_next_line_];
+        regex_search_->FindInLine(line, static_cast<int>(regex_next_line_), search_matches_);
+        bytes += line.size() + 1;
+        ++regex_next_line_;
+    }
+    if (current_match_ < 0 && !search_matches_.empty()) {
+        // 最初の一致が見つかった時点で移動する
+        current_match_ = 0;
+        JumpToCurrentMatch();
+    }
+    const std::string count = std::to_string(search_matches_.size());
+    if (regex_next_line_ < lines_.size()) {
+        SetStatusMessage("Searching... " + count + " regex matches so far (line " + std::to_string(regex_next_line_) +
+                         "/" + std::to_string(lines_.size()) + ")");
+        if (!regex_step_pending_) {
+            regex_step_pending_ = true;
+            screen_.Post([this] {
+                regex_step_pending_ = false;
+                StepRegexSearch();
+            });
+            screen_.PostEvent(Event::Custom);
         }
-        SetStatusMessage("Found " + std::to_string(search_matches_.size()) + " matches (n: next, p: prev)");
+        return;
     }
+    StopRegexSearch();
+    SetStatusMessage(search_matches_.empty() ? "No matches found"
+                                             : "Found " + count + " regex matches (^N: next, ^R: prev)");
 }
 
-void App::GotoNextMatch() {
-    if (search_matches_.empty() || current_match_ < 0) {
+void App::UpdateIncrementalSearch() {
+    // 伸ばしたときは前の一致の位置で確かめるだけ、縮めたときは積んである結果をそのまま使う
+    StartSearch(search_query_);
+    search_matches_.clear();
+    AppendFoundMatches();
+    search_revision_ = doc_revision_;
+    current_match_ = -1;
+    StepIncrementalSearch();
+}
+
+void App::StepIncrementalSearch() {
+    // 編集されたら走査をやめる（一致位置がずれている）
+    IncrementalSearch& search = ActiveSearch();
+    if (search.Revision() != doc_revision_) return;
+    search.Step();
+    // 一致は後ろに増えるだけなので、新しく見つかった分を足す
+    AppendFoundMatches();
+    if (current_match_ < 0 && !search_matches_.empty()) {
+        // 最初の一致が見つかった時点で移動する
+        current_match_ = 0;
+        JumpToCurrentMatch();
+    }
+    ReportSearchStatus();
+
+    if (!search.Done() && !search_step_pending_) {
+        search_step_pending_ = true;
+        screen_.Post([this] {
+            search_step_pending_ = false;
+            StepIncrementalSearch();
+        });
+        screen_.PostEvent(Event::Custom);
+    }
+}
+
+void App::ScheduleSearchIndexBuild() {
+    if (search_index_->GetState() != TrigramIndex::State::BUILDING || search_index_step_pending_) return;
+    search_index_step_pending_ = true;
+    screen_.Post([this] {
+        search_index_step_pending_ = false;
+        search_index_->Step();
+        ScheduleSearchIndexBuild();
+    });
+    screen_.PostEvent(Event::Custom);
+}
+
+IncrementalSearch& App::ActiveSearch() {
+    return search_fold_.Any() ? *folded_search_ : *incremental_search_;
+}
+
+void App::StartSearch(const std::string& query) {
+    if (!search_fold_.Any()) {
+        incremental_search_->SetQuery(query, doc_revision_);
         return;
     }
-    current_match_ = (current_match_ + 1) % search_matches_.size();
-    int visible_idx = RealToVisibleIndex(search_matches_[current_match_]);
+    // 影は最初の検索で作り、そのあとは編集された行だけ正規化し直す
+    if (!query.empty()) folded_lines_->Sync(search_fold_);
+    std::string folded;
+    FoldText(query, search_fold_, folded);
+    folded_search_->SetQuery(folded, doc_revision_);
+}
+
+void App::AppendFoundMatches() {
+    const auto& found = ActiveSearch().Matches();
+    // 影の一致を直しても順序は変わらない
+    for (size_t i = search_matches_.size(); i < found.size(); ++i) {
+        search_matches_.push_back(search_fold_.Any() ? folded_lines_->ToOriginal(found[i]) : found[i]);
+    }
+}
+
+void App::CycleSearchFold() {
+    // 前の方の走査を止める
+    ActiveSearch().SetQuery("", doc_revision_);
+    if (!search_fold_.Any()) {
+        search_fold_ = {true, true, false};
+    } else if (!search_fold_.kana_fold) {
+        search_fold_.kana_fold = true;
+    } else {
+        search_fold_ = {};
+        // 区別するなら影は要らない
+        folded_lines_->Clear();
+    }
+    // 積んだ結果は前の正規化の影のものなので使えない
+    folded_search_->Clear();
+    SetStatusMessage(!search_fold_.Any()        ? "Exact match"
+                     : !search_fold_.kana_fold ? "Ignoring case and width"
+                                               : "Ignoring case, width and kana");
+    if (!search_regex_) UpdateIncrementalSearch();
+}
+
+bool App::FindReplaceTargets(int line, std::vector<SearchMatch>& out) {
+    out.clear();
+    auto find = [&](auto& searcher, const std::vector<std::string>& lines) {
+        if (line < 0) {
+            searcher.FindInLines(lines, out);
+        } else if (line < static_cast<int>(lines.size())) {
+            searcher.FindInLine(lines[line], line, out);
+        }
+    };
+    if (search_regex_) {
+        try {
+            RegexSearcher searcher(search_query_);
+            find(searcher, lines_);
+        } catch (const ShinoError& e) {
+            SetStatusMessage(e.message());
+            return false;
+        }
+        return true;
+    }
+    if (!search_fold_.Any()) {
+        SubstringSearcher searcher(search_query_);
+        find(searcher, lines_);
+        return true;
+    }
+    folded_lines_->Sync(search_fold_);
+    std::string folded;
+    FoldText(search_query_, search_fold_, folded);
+    SubstringSearcher searcher(folded);
+    find(searcher, folded_lines_->Lines());
+    for (auto& match : out) match = folded_lines_->ToOriginal(match);
+    return true;
+}
+
+void App::ReplaceCurrentMatch() {
+    if (search_query_.empty()) {
+        SetStatusMessage("Nothing to replace");
+        return;
+    }
+    IncrementalSearch& search = ActiveSearch();
+    if (!search_regex_ && search_revision_ == doc_revision_ && search.Revision() == doc_revision_ && !search.Done()) {
+        // 次の一致へ進むのにすべての一致が要るので、走査の残りを済ませる
+        while (!search.Step()) {}
+        AppendFoundMatches();
+    }
+    while (search_regex_ && regex_search_ && regex_revision_ == doc_revision_) StepRegexSearch();
+    if (search_revision_ != doc_revision_ || current_match_ < 0 ||
+        current_match_ >= static_cast<int>(search_matches_.size()) || (!search_regex_ && search.Truncated())) {
+        // まだ探していない（正規表現は Enter まで探さない）か、編集で位置がずれた: カーソル行から探し直す
+        search.SetQuery("", doc_revision_);
+        if (!FindReplaceTargets(-1, search_matches_)) return;
+        search_revision_ = doc_revision_;
+        if (search_matches_.empty()) {
+            current_match_ = -1;
+            SetStatusMessage("No matches found");
+            return;
+        }
+        const SearchMatch from{std::max(0, VisibleToRealIndex(current_line_)), 0, 0};
+        const auto it = std::lower_bound(search_matches_.begin(), search_matches_.end(), from);
+        current_match_ = it == search_matches_.end() ? 0 : static_cast<int>(it - search_matches_.begin());
+    }
+
+    const SearchMatch target = search_matches_[current_match_];
+    std::vector<LineEdit> edits = BuildLineEdits(lines_, {target}, replace_text_);
+    ApplyLineEdits(edits);
+    if (!edits.empty()) {
+        replace_undo_ = std::move(edits);
+        replace_undo_revision_ = doc_revision_;
+    }
+
+    // 置き換えた行だけ探し直す（ほかの行の一致の位置は変わらない）
+    std::vector<SearchMatch> refound;
+    FindReplaceTargets(target.line, refound);
+    auto by_line = [](const SearchMatch& a, const SearchMatch& b) { return a.line < b.line; };
+    const auto range = std::equal_range(search_matches_.begin(), search_matches_.end(), target, by_line);
+    const auto at = search_matches_.erase(range.first, range.second);
+    search_matches_.insert(at, refound.begin(), refound.end());
+    search_revision_ = doc_revision_;
+
+    // 置き換えた文字列の後ろの一致へ
+    const SearchMatch after{target.line, target.offset + replace_text_.size(), 0};
+    const auto next = std::lower_bound(search_matches_.begin(), search_matches_.end(), after);
+    if (search_matches_.empty()) {
+        current_match_ = -1;
+    } else {
+        current_match_ = next == search_matches_.end() ? 0 : static_cast<int>(next - search_matches_.begin());
+        JumpToCurrentMatch();
+    }
+    SetStatusMessage("Replaced 1 match (" + std::to_string(search_matches_.size()) + " left, ^U: undo)");
+}
+
+void App::ReplaceAllMatches() {
+    if (search_query_.empty()) {
+        SetStatusMessage("Nothing to replace");
+        return;
+    }
+    // 入力中の検索の走査は止め、置換の対象は上限なしで探し直す
+    ActiveSearch().SetQuery("", doc_revision_);
+    std::vector<SearchMatch> targets;
+    if (!FindReplaceTargets(-1, targets)) return;
+    size_t replaced = 0;
+    std::vector<LineEdit> edits = BuildLineEdits(lines_, targets, replace_text_, &replaced);
+    std::vector<SearchMatch>().swap(targets);
+    const size_t changed_lines = edits.size();
+    ApplyLineEdits(edits);
+    if (!edits.empty()) {
+        replace_undo_ = std::move(edits);
+        replace_undo_revision_ = doc_revision_;
+    }
+    search_matches_.clear();
+    current_match_ = -1;
+    SetStatusMessage("Replaced " + std::to_string(replaced) + " matches in " + std::to_string(changed_lines) +
+                     " lines (^U: undo)");
+}
+
+void App::UndoReplace() {
+    if (replace_undo_.empty() || replace_undo_revision_ != doc_revision_) {
+        SetStatusMessage("Nothing to undo");
+        return;
+    }
+    const size_t count = replace_undo_.size();
+    ApplyLineEdits(replace_undo_);
+    std::vector<LineEdit>().swap(replace_undo_);
+    search_matches_.clear();
+    current_match_ = -1;
+    SetStatusMessage("Undid replacement in " + std::to_string(count) + " lines");
+}
+
+void App::ApplyLineEdits(std::vector<LineEdit>& edits) {
+    if (edits.empty()) return;
+    SwapLineEdits(lines_, edits);
+    NotifyLinesChanged(edits);
+    modified_ = true;
+    // ブロックの解析は行ごとではなく 1 回だけ
+    UpdateBlockModel();
+}
+
+void App::ReportSearchStatus() {
+    IncrementalSearch& search = ActiveSearch();
+    const std::string& query = search.Query();
+    if (query.empty()) {
+        if (!show_search_) SetStatusMessage("Search cancelled");
+        return;
+    }
+    std::string count = std::to_string(search_matches_.size());
+    if (search.Truncated()) count += "+";
+    if (!search.Done()) {
+        SetStatusMessage("Searching... " + count + " matches so far (line " +
+                         std::to_string(search.ScannedLines()) + "/" +
+                         std::to_string(lines_.size()) + ")");
+    } else if (search_matches_.empty()) {
+        SetStatusMessage("No matches found");
+    } else {
+        SetStatusMessage("Found " + count + " matches (^N: next, ^R: prev)");
+    }
+}
+
+void App::JumpToCurrentMatch() {
+    const SearchMatch& match = search_matches_[current_match_];
+    int visible_idx = RealToVisibleIndex(match.line);
     if (visible_idx >= 0) {
         current_line_ = visible_idx;
     }
+    if (soft_wrap_ || match.line >= static_cast<int>(lines_.size())) return;
+    // 一致箇所が画面の外なら、左に少し余白を残して見える位置へ
+    const std::string& line = lines_[match.line];
+    const ColumnIndex& index = column_cache_->Get(match.line);
+    const int begin = index.ColumnOf(line, match.offset);
+    const int end = index.ColumnOf(line, match.offset + match.length);
+    const int width = EditorViewportWidth();
+    if (begin < h_scroll_ || end > h_scroll_ + width) {
+        h_scroll_ = std::max(0, begin - width / 4);
+    }
+}
+
+void App::GotoNextMatch() {
+    if (search_matches_.empty() || current_match_ < 0) {
+        return;
+    }
+    current_match_ = (current_match_ + 1) % search_matches_.size();
+    JumpToCurrentMatch();
     SetStatusMessage("Match " + std::to_string(current_match_ + 1) + "/" + 
-                    std::to_string(search_matches_.size()) + " (n: next, p: prev)");
+                    std::to_string(search_matches_.size()) + " (^N: next, ^R: prev)");
 }
 
 void App::GotoPrevMatch() {
@@ -237,75 +754,241 @@ void App::GotoPrevMatch() {
         return;
     }
     current_match_ = (current_match_ - 1 + search_matches_.size()) % search_matches_.size();
-    int visible_idx = RealToVisibleIndex(search_matches_[current_match_]);
-    if (visible_idx >= 0) {
-        current_line_ = visible_idx;
-    }
+    JumpToCurrentMatch();
     SetStatusMessage("Match " + std::to_string(current_match_ + 1) + "/" + 
-                    std::to_string(search_matches_.size()) + " (n: next, p: prev)");
+                    std::to_string(search_matches_.size()) + " (^N: next, ^R: prev)");
 }
 
 void App::HideSearch() {
     show_search_ = false;
+    search_tab_index_ = 0;
     SetStatusMessage("");
 }
 
+void App::StartDirectorySearch() {
+    if (search_query_.empty()) {
+        SetStatusMessage("Enter search text first");
+        return;
+    }
+    DirectorySearch::Options options;
+    std::error_code ec;
+    options.root = filename_.empty() ? std::filesystem::current_path(ec)
+                                     : std::filesystem::absolute(filename_, ec).parent_path();
+    options.query = search_query_;
+    options.regex = search_regex_;
+    try {
+        dir_search_->Start(options);
+    } catch (const ShinoError& e) {
+        SetStatusMessage(e.message());
+        return;
+    }
+    dir_root_ = options.root;
+    dir_matches_.clear();
+    dir_files_.clear();
+    dir_selected_ = 0;
+    dir_scroll_ = 0;
+    HideSearch();
+    ShowDirectoryResults();
+    SetStatusMessage("Searching " + dir_root_.string() +
+                     (search_fold_.Any() && !search_regex_ ? " (case-sensitive)" : ""));
+}
+
+void App::PollDirectorySearch() {
+    dir_search_->Poll(dir_matches_, dir_files_);
+    const auto progress = dir_search_->GetProgress();
+    if (!progress.done) return;
+    std::string message = "Found " + std::to_string(dir_matches_.size()) + " matches in " +
+                          std::to_string(dir_files_.size()) + " files";
+    if (progress.truncated) message += " (stopped at the limit)";
+    SetStatusMessage(message);
+}
+
+void App::ShowDirectoryResults() {
+    show_dir_results_ = true;
+    dir_results_tab_index_ = 1;
+}
+
+void App::HideDirectoryResults(bool cancel) {
+    if (cancel && dir_search_->Running()) {
+        dir_search_->Cancel();
+        dir_search_->Poll(dir_matches_, dir_files_);
+        SetStatusMessage("Directory search cancelled");
+    }
+    show_dir_results_ = false;
+    dir_results_tab_index_ = 0;
+}
+
+void App::MoveDirectorySelection(int delta) {
+    if (dir_matches_.empty()) return;
+    dir_selected_ = std::clamp(dir_selected_ + delta, 0, static_cast<int>(dir_matches_.size()) - 1);
+}
+
+void App::OpenDirectoryMatch() {
+    if (dir_matches_.empty()) return;
+    if (modified_) {
+        SetStatusMessage("Save changes first (^O)");
+        return;
+    }
+    const DirectorySearch::Match match = dir_matches_[dir_selected_];
+    const std::string& relative = dir_files_[match.file];
+    const std::string path = (dir_root_ / relative).string();
+    if (!LoadFile(path)) {
+        if (status_message_.empty()) SetStatusMessage("Failed to open: " + path);
+        return;
+    }
+    HideDirectoryResults(false);
+    // 開いたファイルの一致だけをハイライトして、その行へ
+    search_matches_ = {SearchMatch{match.line, match.offset, match.length}};
+    current_match_ = 0;
+    search_revision_ = doc_revision_;
+    JumpToCurrentMatch();
+    SetStatusMessage(relative + ":" + std::to_string(match.line + 1));
+}
+
 void App::ImportDocx() {
-    if (!PandocIO::IsPandocAvailable()) {
-        SetStatusMessage("Pandoc not available");
+    if (docx_job_->Running()) {
+        SetStatusMessage("Conversion in progress (Esc to cancel)");
         return;
     }
+    // 終わったジョブの結果がまだ UI ループに渡っていなければ先に反映する
+    FinishDocxJob();
+    // 取り込みは組み込みの変換で読めるので pandoc がなくてもよい（落とした内容があれば pandoc で読み直す）
     ShowFilenamePrompt("Enter DOCX filename to import: ", "", [this](const std::string& docx_path) {
         if (docx_path.empty()) {
             SetStatusMessage("Import cancelled");
             return;
         }
-        try {
-            auto result = PandocIO::ImportDocx(docx_path);
-            if (result) {
-                // Parse the imported markdown into lines
-                lines_.clear();
-                std::istringstream ss(*result);
-                std::string line;
-                while (std::getline(ss, line)) {
-                    lines_.push_back(line);
-                }
-                UpdateBlockModel();
-                modified_ = true;
-                current_line_ = 0;
-                SetStatusMessage("DOCX imported successfully");
-            } else {
-                SetStatusMessage("Failed to import DOCX file");
+        // 取り込みの間も編集を続けられるよう、変換結果は別の行バッファに読み、終わってから入れ替える
+        docx_result_ = DocxJobResult{};
+        docx_result_.import = true;
+        docx_result_.path = docx_path;
+        docx_result_pending_ = true;
+        docx_job_->Start("Importing " + std::filesystem::path(docx_path).filename().string(),
+                         [this](const std::atomic<bool>& cancel) {
+            DocxJobResult& result = docx_result_;
+            try {
+                result.ok = PandocIO::ImportDocx(result.path, result.lines, &cancel);
+            } catch (const ShinoError& e) {
+                result.error = std::string("Import error: ") + e.what();
+            } catch (const std::exception& e) {
+                result.error = std::string("Import failed: ") + e.what();
             }
-        } catch (const ShinoError& e) {
-            SetStatusMessage(std::string("Import error: ") + e.what());
-        } catch (const std::exception& e) {
-            SetStatusMessage(std::string("Import failed: ") + e.what());
-        }
+            // 変換が終わったあとに Esc が届いても成功のまま。中断で止まったときだけ中断として扱う
+            result.cancelled = !result.ok && cancel;
+        });
+        status_message_.clear();
     });
 }
 
 void App::ExportDocx() {
-    if (!PandocIO::IsPandocAvailable()) {
-        SetStatusMessage("Pandoc not available");
+    if (docx_job_->Running()) {
+        SetStatusMessage("Conversion in progress (Esc to cancel)");
         return;
     }
-    ShowFilenamePrompt("Enter DOCX filename to export: ", "", [this](const std::string& docx_path) {
+    // 終わったジョブの結果がまだ UI ループに渡っていなければ先に反映する
+    FinishDocxJob();
+    auto message = [this] {
+        return std::string(docx_engine_ == DocxEngine::PANDOC ? "Enter DOCX filename to export (pandoc, ^P: built-in): "
+                                                              : "Enter DOCX filename to export (built-in, ^P: pandoc): ");
+    };
+    ShowFilenamePrompt(message(), "", [this](const std::string& docx_path) {
         if (docx_path.empty()) {
             SetStatusMessage("Export cancelled");
             return;
         }
-        try {
-            // Convert lines to markdown string
-            std::ostringstream ss;
-            for (const auto& line : lines_) {
-                ss << line << "\n";
-            }
-            if (PandocIO::ExportDocx(ss.str(), docx_path)) {
-                SetStatusMessage("DOCX exported successfully");
-            } else {
-                SetStatusMessage("Failed to export DOCX file");
+        // 書き出すのはこの時点の文書（書き出しの間の編集は含めない）
+        docx_result_ = DocxJobResult{};
+        docx_result_.path = docx_path;
+        docx_result_.engine = docx_engine_;
+        size_t bytes = 0;
+        for (const auto& line : lines_) bytes += line.size() + 1;
+        docx_result_.markdown.reserve(bytes);
+        for (const auto& line : lines_) {
+            docx_result_.markdown += line;
+            docx_result_.markdown += '\n';
+        }
+        docx_result_pending_ = true;
+        docx_job_->Start("Exporting " + std::filesystem::path(docx_path).filename().string(),
+                         [this](const std::atomic<bool>& cancel) {
+            DocxJobResult& result = docx_result_;
+            try {
+                result.ok = PandocIO::ExportDocx(result.markdown, result.path, &cancel, result.engine);
+            } catch (const ShinoError& e) {
+                result.error = std::string("Export error: ") + e.what();
+            } catch (const std::exception& e) {
+                result.error = std::string("Export failed: ") + e.what();
             }
+            // 変換が終わったあとに Esc が届いても成功のまま。中断で止まったときだけ中断として扱う
+            result.cancelled = !result.ok && cancel;
+        });
+        status_message_.clear();
+    });
+    // 忠実さを優先するなら最初から pandoc で書く
+    filename_prompt_toggle_ = [this, message] {
+        if (docx_engine_ == DocxEngine::AUTO && !PandocIO::GetCapabilities().SupportsOutput("docx")) {
+            SetStatusMessage("Pandoc not available");
+            return;
+        }
+        docx_engine_ = docx_engine_ == DocxEngine::AUTO ? DocxEngine::PANDOC : DocxEngine::AUTO;
+        filename_prompt_message_ = message();
+        SetStatusMessage(filename_prompt_message_);
+    };
+}
+
+void App::FinishDocxJob() {
+    if (!docx_result_pending_ || docx_job_->Running()) return;
+    docx_result_pending_ = false;
+    DocxJobResult result = std::move(docx_result_);
+    docx_result_ = DocxJobResult{};
+    std::ostringstream took;
+    took << std::fixed << std::setprecision(1) << docx_job_->Elapsed().count() / 1000.0 << "s";
+
+    // 中断のフラグは work が戻ったあとにも立ちうるので、work が残した結果で決める
+    if (result.cancelled) {
+        SetStatusMessage(result.import ? "Import cancelled" : "Export cancelled");
+        return;
+    }
+    if (!result.error.empty()) {
+        SetStatusMessage(result.error);
+        return;
+    }
+    if (!result.ok) {
+        SetStatusMessage(result.import ? "Failed to import DOCX file" : "Failed to export DOCX file");
+        return;
+    }
+    if (!result.import) {
+        SetStatusMessage("DOCX exported successfully (" + took.str() + ")");
+        return;
+    }
+    // 文書をまるごと入れ替える（編集中の行は取り込んだ文書には持ち込まない）
+    editing_mode_ = false;
+    current_input_.clear();
+    lines_.swap(result.lines);
+    NotifyDocumentReplaced();
+    UpdateBlockModel();
+    modified_ = true;
+    current_line_ = 0;
+    scroll_offset_ = 0;
+    SetStatusMessage("DOCX imported successfully (" + took.str() + ")");
+}
+
+void App::ExportHtml() {
+    ShowFilenamePrompt("Enter HTML filename to export: ", HtmlExport::DefaultOutputPath(filename_),
+                       [this](const std::string& html_path) {
+        if (html_path.empty()) {
+            SetStatusMessage("Export cancelled");
+            return;
+        }
+        try {
+            security::PathValidator::ValidateFileOperation(html_path, true);
+            // 単位ごとにファイルへ流すので、文書全体の HTML は作らない
+            const std::string title = filename_.empty()
+                ? std::string("document")
+                : std::filesystem::path(filename_).stem().string();
+            const auto stats = HtmlExport::ExportLines(*renderer_, lines_, block_model_->GetBlocks(),
+                                                       html_path, title);
+            SetStatusMessage("HTML exported: " + html_path + " (" +
+                             std::to_string(stats.output_bytes) + " bytes)");
         } catch (const ShinoError& e) {
             SetStatusMessage(std::string("Export error: ") + e.what());
         } catch (const std::exception& e) {
@@ -335,7 +1018,7 @@ Component App::CreateMainComponent() {
     
     // Add overlays for help and filename prompt
     help_tab_index_ = show_help_ ? 1 : 0;
-    int filename_tab_index = show_filename_prompt_ ? 1 : 0;
+    filename_tab_index_ = show_filename_prompt_ ? 1 : 0;
     
     auto with_help = Container::Tab({
         main_layout,
@@ -346,39 +1029,30 @@ Component App::CreateMainComponent() {
     auto with_filename_prompt = Container::Tab({
         with_help,
         filename_prompt_component
-    }, &filename_tab_index);
+    }, &filename_tab_index_);
 
     // Add search prompt overlay
-    int search_tab_index = show_search_ ? 1 : 0;
+    search_tab_index_ = show_search_ ? 1 : 0;
     auto with_search = Container::Tab({
         with_filename_prompt,
         search_component
-    }, &search_tab_index);
+    }, &search_tab_index_);
+
+    dir_results_tab_index_ = show_dir_results_ ? 1 : 0;
+    auto with_dir_results = Container::Tab({
+        with_search,
+        CreateDirectoryResultsComponent()
+    }, &dir_results_tab_index_);
     
-    return CatchEvent(with_search, [this](const Event& event) {
+    return CatchEvent(with_dir_results, [this](const Event& event) {
         return HandleKeyPress(event);
     });
 }
 
 Component App::CreateEditorComponent() {
     return Renderer([this] {
-        auto visible_lines = GetVisibleEditorLines();
-        
-        Elements elements;
-        for (int i = 0; i < static_cast<int>(visible_lines.size()); ++i) {
-            std::string line_content;
-            if (editing_mode_ && i == current_line_) {
-                line_content = current_input_ + "_"; // Show cursor
-            } else {
-                line_content = i < static_cast<int>(visible_lines.size()) ? visible_lines[i] : "";
-            }
-            
-            auto line_element = text(to_wstring(line_content));
-            if (i == current_line_) {
-                line_element = line_element | bgcolor(editing_mode_ ? Color::Green : Color::Blue);
-            }
-            elements.push_back(line_element);
-        }
+        const int height = EditorViewportHeight();
+        Elements elements = soft_wrap_ ? BuildWrappedRows(height) : BuildClippedRows(height);
         
         // Add some padding if no lines
         if (elements.empty()) {
@@ -389,17 +1063,123 @@ Component App::CreateEditorComponent() {
     });
 }
 
+Elements App::BuildWrappedRows(int height) {
+    const auto& visible_lines = GetVisibleEditorLines();
+    SyncWrapLayout();
+
+    const int count = static_cast<int>(visible_lines.size());
+    Elements elements;
+    if (count == 0) return elements;
+
+    // カーソル行が画面内に収まるようにスクロール位置（段単位）を補正
+    const int cursor = std::clamp(current_line_, 0, count - 1);
+    const int cursor_row = wrap_layout_->FirstRowOf(cursor);
+    const int cursor_rows = static_cast<int>(wrap_layout_->GetRowStarts(cursor).size());
+    if (cursor_row < scroll_offset_) {
+        scroll_offset_ = cursor_row;
+    } else if (cursor_row + cursor_rows > scroll_offset_ + height) {
+        scroll_offset_ = std::min(cursor_row, cursor_row + cursor_rows - height);
+    }
+    scroll_offset_ = std::clamp(scroll_offset_, 0, std::max(0, wrap_layout_->TotalRows() - 1));
+
+    // 画面に入る段だけを描画
+    int sub_row = 0;
+    for (int i = wrap_layout_->RowToVisible(scroll_offset_, &sub_row);
+         i < count && static_cast<int>(elements.size()) < height; ++i, sub_row = 0) {
+        if (editing_mode_ && i == current_line_) {
+            const std::string live = current_input_ + "_"; // Show cursor
+            AppendWrappedRows(elements, live,
+                              WrapLayout::ComputeRowStarts(live, wrap_layout_->GetWidth()),
+                              sub_row, height, nullptr, bgcolor(Color::Green));
+        } else {
+            // 折り畳み表示の行はハイライトしない
+            AppendWrappedRows(elements, visible_lines[i], wrap_layout_->GetRowStarts(i),
+                              sub_row, height,
+                              IsFoldedPlaceholder(i) ? nullptr
+                                                     : EditorSpans(VisibleToRealIndex(i)),
+                              i == current_line_ ? bgcolor(Color::Blue) : Decorator());
+        }
+    }
+    return elements;
+}
+
+Elements App::BuildClippedRows(int height) {
+    const auto& visible_lines = GetVisibleEditorLines();
+    const int count = static_cast<int>(visible_lines.size());
+    const int width = EditorViewportWidth();
+    Elements elements;
+    if (count == 0) return elements;
+
+    // 折り返さないので 1 行 = 1 段
+    const int cursor = std::clamp(current_line_, 0, count - 1);
+    if (cursor < scroll_offset_) {
+        scroll_offset_ = cursor;
+    } else if (cursor >= scroll_offset_ + height) {
+        scroll_offset_ = cursor - height + 1;
+    }
+    scroll_offset_ = std::clamp(scroll_offset_, 0, count - 1);
+
+    for (int i = scroll_offset_; i < count && static_cast<int>(elements.size()) < height; ++i) {
+        if (editing_mode_ && i == current_line_) {
+            // 編集中は入力末尾（カーソル）が見えるように右端に寄せる
+            const std::string live = current_input_ + "_";
+            const auto slice = ColumnIndex::TailSlice(live, width);
+            elements.push_back(text(to_wstring(live.substr(slice.begin))) | bgcolor(Color::Green));
+            continue;
+        }
+
+        // 画面に入る桁の範囲だけを切り出して変換する
+        const std::string& line = visible_lines[i];
+        const bool placeholder = IsFoldedPlaceholder(i);
+        ColumnIndex local_index;
+        const ColumnIndex* index = nullptr;
+        if (placeholder) {
+            local_index.Build(line);
+            index = &local_index;
+        } else {
+            index = &column_cache_->Get(VisibleToRealIndex(i));
+        }
+        const auto slice = index->ColumnSlice(line, h_scroll_, width);
+        auto row = HighlightedRow(line, slice.begin, slice.end,
+                                  placeholder ? nullptr : EditorSpans(VisibleToRealIndex(i)));
+        if (slice.lead_padding > 0) {
+            row = hbox({text(std::string(slice.lead_padding, ' ')), row});
+        }
+        elements.push_back(i == current_line_ ? row | bgcolor(Color::Blue) : row);
+    }
+    return elements;
+}
+
 Component App::CreatePreviewComponent() {
     return Renderer([this] {
         if (!show_preview_) {
             return text(L"");
         }
         
-        std::string content = GetPreviewContent();
         Elements elems;
-        elems.push_back(text(L"Preview") | bold);
+        if (preview_mode_ == PreviewMode::NATIVE) {
+            // 見出しと区切り線の 2 段と枠線を除いた分だけ組み立てる
+            elems.push_back(text(L"Preview") | bold);
+            elems.push_back(separator());
+            for (auto& row : BuildNativePreviewRows(PreviewViewportWidth(),
+                                                    EditorViewportHeight() - kNativePreviewHeaderRows)) {
+                elems.push_back(std::move(row));
+            }
+            return vbox(elems) | border | flex;
+        }
+
+        const std::string& content = GetPreviewContent();
+        if (IsPreviewStale()) {
+            elems.push_back(hbox({text(L"Preview") | bold, text(L" (stale)") | dim}));
+        } else {
+            elems.push_back(text(L"Preview (HTML)") | bold);
+        }
         elems.push_back(separator());
-        elems.push_back(text(to_wstring(content)));
+        if (preview_valid_) {
+            elems.push_back(text(content));
+        } else {
+            elems.push_back(text(L"Rendering...") | dim);
+        }
         return vbox(elems) | border | flex;
     });
 }
@@ -433,13 +1213,15 @@ Component App::CreateStatusComponent() {
     return Renderer([this] {
         std::string filename_display = filename_.empty() ? "[New File]" : filename_;
         std::string modified_indicator = modified_ ? "*" : "";
+        // DOCX の入出力の実行中は、進み具合（スピナーと経過時間）を出す
+        const std::string status = docx_job_->Running() ? docx_job_->StatusText() : status_message_;
         
         return hbox({
             text(to_wstring(TUIBindings::GetHelpLine())) | flex,
             separator(),
             text(to_wstring(filename_display + modified_indicator)),
             separator(),
-            text(to_wstring(status_message_))
+            text(to_wstring(status))
         }) | border;
     });
 }
@@ -455,6 +1237,10 @@ bool App::HandleKeyPress(const Event& event) {
             HideFilenamePrompt();
             return true;
         }
+        if (event == Event::Character('\x10')) { // Ctrl+P
+            if (filename_prompt_toggle_) filename_prompt_toggle_();
+            return true;
+        }
         if (event.is_character()) {
             filename_prompt_text_ += event.character();
             return true;
@@ -466,29 +1252,106 @@ bool App::HandleKeyPress(const Event& event) {
         return true; // Consume all events when dialog is active
     }
 
+    // ディレクトリ検索の結果の一覧
+    if (show_dir_results_) {
+        const int page = std::max(1, EditorViewportHeight() - kDirResultsChromeRows);
+        if (event == Event::Return) {
+            OpenDirectoryMatch();
+        } else if (event == Event::Escape) {
+            HideDirectoryResults(true);
+        } else if (event == Event::ArrowUp) {
+            MoveDirectorySelection(-1);
+        } else if (event == Event::ArrowDown) {
+            MoveDirectorySelection(1);
+        } else if (event == Event::PageUp) {
+            MoveDirectorySelection(-page);
+        } else if (event == Event::PageDown) {
+            MoveDirectorySelection(page);
+        }
+        return true;
+    }
+
     // Handle search prompt if active
     if (show_search_) {
         if (event == Event::Return) {
-            FindMatches(search_query_);
+            if (search_replace_field_) {
+                ReplaceCurrentMatch();
+                return true;
+            }
             HideSearch();
+            if (search_regex_) {
+                FindRegexMatches(search_query_);
+            } else {
+                // 一致は入力中に探してあるので、プロンプトを閉じるだけ（走査が残っていれば続ける）
+                ReportSearchStatus();
+            }
+            return true;
+        }
+        if (event == Event::Character('\x12')) { // Ctrl+R: 正規表現モードの切り替え
+            search_regex_ = !search_regex_;
+            StopRegexSearch();
+            if (search_regex_) {
+                // 正規表現は入力途中では構文エラーになりやすいので、Enter で検索する
+                ActiveSearch().SetQuery("", doc_revision_);
+                search_matches_.clear();
+                current_match_ = -1;
+                SetStatusMessage("Regex mode (Enter to search)");
+            } else {
+                UpdateIncrementalSearch();
+            }
+            return true;
+        }
+        if (event == Event::Character('\x06')) { // Ctrl+F: 表記ゆれの無視の切り替え
+            if (search_regex_) {
+                SetStatusMessage("Case/width folding applies to literal search only");
+            } else {
+                CycleSearchFold();
+            }
+            return true;
+        }
+        if (event == Event::Tab) { // 検索文字列と置換後の文字列の入力を切り替え
+            search_replace_field_ = !search_replace_field_;
+            SetStatusMessage(search_replace_field_ ? "Replace with (Enter: replace, ^A: replace all, Tab: search text)"
+                                                   : "Enter search text (Tab: replacement)");
+            return true;
+        }
+        if (event == Event::Character('\x01')) { // Ctrl+A: すべて置換
+            ReplaceAllMatches();
+            return true;
+        }
+        if (event == Event::Character('\x15')) { // Ctrl+U: 置換を元に戻す
+            UndoReplace();
+            return true;
+        }
+        if (event == Event::Character('\x04')) { // Ctrl+D: ディレクトリ以下を検索
+            StartDirectorySearch();
             return true;
         }
         if (event == Event::Escape) {
+            ActiveSearch().SetQuery("", doc_revision_);
+            StopRegexSearch();
+            search_matches_.clear();
+            current_match_ = -1;
             HideSearch();
             return true;
         }
-        if (event.is_character()) {
-            if (event.character() == "n") {
-                GotoNextMatch();
-            } else if (event.character() == "p") {
-                GotoPrevMatch();
-            } else {
-                search_query_ += event.character();
+        if (search_replace_field_) {
+            if (event.is_character()) {
+                replace_text_ += event.character();
+            } else if (event == Event::Backspace) {
+                Utf8PopBack(replace_text_);
             }
             return true;
         }
+        if (event.is_character()) {
+            // n/p もそのまま入力する（一致の移動は検索後に ^N/^R で）
+            search_query_ += event.character();
+            if (!search_regex_) UpdateIncrementalSearch();
+            return true;
+        }
         if (event == Event::Backspace && !search_query_.empty()) {
             Utf8PopBack(search_query_);
+            if (!search_regex_) UpdateIncrementalSearch();
             return true;
         }
         return true; // Consume all events when search is active
@@ -510,6 +1373,15 @@ bool App::HandleKeyPress(const Event& event) {
         return true;
     }
     
+    if (event == Event::Character('\x04')) { // Ctrl+D: 最後のディレクトリ検索の結果
+        if (dir_root_.empty()) {
+            SetStatusMessage("No directory search yet (^W, then ^D)");
+        } else {
+            ShowDirectoryResults();
+        }
+        return true;
+    }
+
     if (event == Event::Character('\x07')) { // Ctrl+G
         ToggleHelp();
         return true;
@@ -534,6 +1406,36 @@ bool App::HandleKeyPress(const Event& event) {
         ExportDocx();
         return true;
     }
+
+    if (event == Event::Character('\x0C')) { // Ctrl+L
+        ToggleSoftWrap();
+        return true;
+    }
+
+    if (event == Event::Character('\x14')) { // Ctrl+T
+        TogglePreviewMode();
+        return true;
+    }
+
+    if (event == Event::Character('\x0B')) { // Ctrl+K
+        ExportHtml();
+        return true;
+    }
+
+    if (event == Event::Character('\x0E')) { // Ctrl+N
+        GotoNextMatch();
+        return true;
+    }
+
+    if (event == Event::Character('\x12')) { // Ctrl+R
+        GotoPrevMatch();
+        return true;
+    }
+
+    if (event == Event::Character('\x15')) { // Ctrl+U
+        UndoReplace();
+        return true;
+    }
     
     // Handle text editing keys
     if (event == Event::Return) {
@@ -542,8 +1444,10 @@ bool App::HandleKeyPress(const Event& event) {
             int real = VisibleToRealIndex(current_line_);
             if (real >= 0 && real < static_cast<int>(lines_.size())) {
                 lines_[real] = current_input_;
+                NotifyLineChanged(real);
             } else {
                 lines_.push_back(current_input_);
+                NotifyLinesInserted(static_cast<int>(lines_.size()) - 1, 1);
             }
             modified_ = true;
             UpdateBlockModel();
@@ -563,6 +1467,11 @@ bool App::HandleKeyPress(const Event& event) {
             ExitEditMode();
             return true;
         }
+        // 実行中の DOCX の入出力を止める（pandoc を子プロセスごと止める）
+        if (docx_job_->Running()) {
+            docx_job_->Cancel();
+            return true;
+        }
     }
     
     if (event == Event::Delete || event == Event::Backspace) {
@@ -600,6 +1509,31 @@ bool App::HandleKeyPress(const Event& event) {
         return true;
     }
     
+    // 折り返しオフ時の横スクロール
+    if (!soft_wrap_ && !editing_mode_) {
+        const int step = std::max(1, EditorViewportWidth() / 2);
+        if (event == Event::ArrowLeft) {
+            ScrollHorizontal(-step);
+            return true;
+        }
+        if (event == Event::ArrowRight) {
+            ScrollHorizontal(step);
+            return true;
+        }
+        if (event == Event::Home) {
+            h_scroll_ = 0;
+            return true;
+        }
+        if (event == Event::End) {
+            const int real = VisibleToRealIndex(current_line_);
+            if (real >= 0) {
+                const int cols = column_cache_->Get(real).TotalColumns();
+                h_scroll_ = std::max(0, cols - EditorViewportWidth() + 1);
+            }
+            return true;
+        }
+    }
+
     // Handle basic navigation
     if (event == Event::ArrowUp) {
         if (current_line_ > 0) {
@@ -609,7 +1543,7 @@ bool App::HandleKeyPress(const Event& event) {
     }
     
     if (event == Event::ArrowDown) {
-        auto visible_lines = GetVisibleEditorLines();
+        const auto& visible_lines = GetVisibleEditorLines();
         if (current_line_ < static_cast<int>(visible_lines.size()) - 1) {
             current_line_++;
         }
@@ -623,6 +1557,71 @@ void App::UpdateBlockModel() {
     block_model_->UpdateLines();
 }
 
+void App::NotifyLineChanged(int real_line) {
+    ++doc_revision_;
+    wrap_layout_->InvalidateLine(real_line);
+    highlighter_->InvalidateLine(real_line);
+    column_cache_->InvalidateLine(real_line);
+    search_index_->UpdateLine(real_line);
+    folded_lines_->InvalidateLine(real_line);
+    ScheduleSearchIndexBuild();
+}
+
+void App::NotifyLinesInserted(int pos, int count) {
+    ++doc_revision_;
+    wrap_layout_->InsertLines(pos, count);
+    highlighter_->InsertLines(pos, count);
+    column_cache_->InsertLines(pos, count);
+    search_index_->InsertLines(pos, count);
+    folded_lines_->InsertLines(pos, count);
+    ScheduleSearchIndexBuild();
+}
+
+void App::NotifyLinesErased(int pos, int count) {
+    ++doc_revision_;
+    wrap_layout_->EraseLines(pos, count);
+    highlighter_->EraseLines(pos, count);
+    column_cache_->EraseLines(pos, count);
+    search_index_->EraseLines(pos, count);
+    folded_lines_->EraseLines(pos, count);
+    ScheduleSearchIndexBuild();
+}
+
+void App::NotifyLinesChanged(const std::vector<LineEdit>& edits) {
+    ++doc_revision_;
+    // 文書の大部分が変わったなら、1 行ずつ足すより索引を作り直す方が速い
+    const auto state = search_index_->GetState();
+    const bool rebuild_index = (state == TrigramIndex::State::BUILDING || state == TrigramIndex::State::READY) &&
+                               edits.size() > lines_.size() / 4;
+    for (const auto& edit : edits) {
+        wrap_layout_->InvalidateLine(edit.line);
+        highlighter_->InvalidateLine(edit.line);
+        column_cache_->InvalidateLine(edit.line);
+        if (!rebuild_index) search_index_->UpdateLine(edit.line);
+        folded_lines_->InvalidateLine(edit.line);
+    }
+    if (rebuild_index) search_index_->Build();
+    ScheduleSearchIndexBuild();
+}
+
+void App::NotifyDocumentReplaced() {
+    ++doc_revision_;
+    std::vector<LineEdit>().swap(replace_undo_);
+    wrap_layout_->InvalidateAll();
+    highlighter_->InvalidateAll();
+    column_cache_->InvalidateAll();
+    folded_lines_->InvalidateAll();
+    // 小さな文書は走査で十分速いので索引を作らない
+    size_t bytes = 0;
+    for (const auto& line : lines_) bytes += line.size() + 1;
+    if (bytes >= kSearchIndexMinBytes) {
+        search_index_->Build();
+        ScheduleSearchIndexBuild();
+    } else {
+        search_index_->Clear();
+    }
+}
+
 void App::SetStatusMessage(const std::string& message) {
     status_message_ = message;
 }
@@ -631,8 +1630,10 @@ void App::InsertLine() {
     int real = VisibleToRealIndex(current_line_);
     if (real < 0) {
         lines_.push_back("");
+        NotifyLinesInserted(static_cast<int>(lines_.size()) - 1, 1);
     } else {
         lines_.insert(lines_.begin() + real + 1, "");
+        NotifyLinesInserted(real + 1, 1);
         current_line_++; // 可視上は1つ下へ
     }
     modified_ = true;
@@ -644,10 +1645,11 @@ void App::DeleteLine() {
     int real = VisibleToRealIndex(current_line_);
     if (!lines_.empty() && real >= 0 && real < static_cast<int>(lines_.size())) {
         lines_.erase(lines_.begin() + real);
+        NotifyLinesErased(real, 1);
         modified_ = true;
         UpdateBlockModel();
         // 可視行数に合わせてカーソルをクランプ
-        auto vis = GetVisibleEditorLines();
+        const auto& vis = GetVisibleEditorLines();
         if (current_line_ >= static_cast<int>(vis.size()) && current_line_ > 0) {
             current_line_ = static_cast<int>(vis.size()) - 1;
         }
@@ -675,41 +1677,268 @@ std::string App::PromptForFilename(const std::string& prompt) {
     return "";
 }
 
-std::vector<std::string> App::GetVisibleEditorLines() const {
+const std::vector<std::string>& App::GetVisibleEditorLines() const {
     return block_model_->GetVisibleLines();
 }
 
-std::string App::GetPreviewContent() const {
-    std::stringstream ss;
-    for (const auto& line : lines_) {
-        ss << line << "\n";
+bool App::IsFoldedPlaceholder(int visible_index) const {
+    const int real = VisibleToRealIndex(visible_index);
+    auto blk = block_model_->GetBlockAt(real);
+    return blk && blk->is_folded && blk->start_line == real;
+}
+
+void App::SyncWrapLayout() {
+    wrap_layout_->SetWidth(EditorViewportWidth());
+    // 可視ビューが作り直されたときだけ段数の木を再構築
+    const auto& indices = block_model_->GetVisibleLineIndices();
+    const auto& texts = block_model_->GetVisibleLines();
+    if (layout_view_revision_ != block_model_->GetViewRevision()) {
+        wrap_layout_->SetVisibleLines(indices, texts);
+        layout_view_revision_ = block_model_->GetViewRevision();
     }
-    
-    // Render to HTML first, then display as text (per AGENT.md spec)
-    std::string html = renderer_->RenderToHtml(ss.str());
-    return html.empty() ? renderer_->RenderToText(ss.str()) : html;
+}
+
+int App::EditorViewportWidth() const {
+    // プレビュー表示中は横に二分割、枠線の2桁を除く
+    const int total = Terminal::Size().dimx;
+    const int pane = show_preview_ ? total / 2 : total;
+    return std::max(1, pane - 2);
+}
+
+int App::PreviewViewportWidth() const {
+    // エディタの残り半分から枠線の2桁を除く
+    const int total = Terminal::Size().dimx;
+    return std::max(1, total - total / 2 - 2);
+}
+
+int App::EditorViewportHeight() const {
+    // ステータス行（枠込み3段）とエディタ枠の2段を除く
+    return std::max(1, Terminal::Size().dimy - 5);
+}
+
+PreviewSnapshot App::BuildDocumentSnapshot() const {
+    // ブロック単位に分けておくと、ワーカー側で変更のない単位のレンダリングを省ける
+    PreviewSnapshot snapshot;
+    for (const auto& range : BlockRenderCache::SplitRenderUnits(lines_, block_model_->GetBlocks())) {
+        size_t size = 0;
+        for (int i = range.begin; i < range.end; ++i) size += lines_[i].size() + 1;
+        std::string unit;
+        unit.reserve(size);
+        for (int i = range.begin; i < range.end; ++i) {
+            unit += lines_[i];
+            unit += '\n';
+        }
+        snapshot.push_back(std::move(unit));
+    }
+    return snapshot;
+}
+
+const std::string& App::GetPreviewContent() {
+    // 文書が変わったときだけスナップショットを取ってワーカーに渡す
+    // （カーソル移動などでは何もしない）
+    if ((!preview_valid_ || preview_revision_ != doc_revision_) &&
+        (!preview_requested_ || preview_requested_revision_ != doc_revision_)) {
+        preview_worker_->Request(doc_revision_, BuildDocumentSnapshot());
+        preview_requested_revision_ = doc_revision_;
+        preview_requested_ = true;
+    }
+    return preview_cache_;
+}
+
+bool App::IsPreviewStale() const {
+    return !preview_valid_ || preview_revision_ != doc_revision_;
+}
+
+void App::OnPreviewRendered(uint64_t revision, std::string content) {
+    // 追い越された古い結果は捨てる
+    if (preview_valid_ && revision < preview_revision_) return;
+    preview_cache_ = std::move(content);
+    preview_revision_ = revision;
+    preview_valid_ = true;
+}
+
+const std::vector<PreviewLine>& App::NativePreviewBlock(size_t unit) {
+    const LineRange& range = native_units_[unit];
+    std::string source;
+    uint64_t& hash = native_unit_hashes_[unit];
+    auto build_source = [&] {
+        for (int i = range.begin; i < range.end; ++i) {
+            source += lines_[i];
+            source += '\n';
+        }
+    };
+    if (hash == 0) {
+        build_source();
+        hash = BlockRenderCache::Hash(source);
+    }
+    auto it = native_blocks_.find(hash);
+    if (it != native_blocks_.end()) return it->second;
+
+    if (source.empty()) build_source();
+    // 上限を超えたらまとめて捨てる（画面 1 枚分ならすぐに埋め直せる）
+    if (native_blocks_.size() >= kNativeBlockCacheLimit) native_blocks_.clear();
+    return native_blocks_.emplace(hash, renderer_->RenderToPreview(source)).first->second;
+}
+
+Elements App::BuildNativePreviewRows(int width, int height) {
+    if (!native_units_valid_ || native_units_revision_ != doc_revision_) {
+        native_units_ = BlockRenderCache::SplitRenderUnits(lines_, block_model_->GetBlocks());
+        native_unit_hashes_.assign(native_units_.size(), 0);
+        native_units_revision_ = doc_revision_;
+        native_units_valid_ = true;
+    }
+
+    native_scroll_map_.Clear();
+    Elements rows;
+    if (native_units_.empty() || height <= 0) return rows;
+
+    // カーソル行を含む単位と、その中でカーソル行に当たるプレビュー行（単位の行数との比で割り当てる）
+    const int real = std::max(0, VisibleToRealIndex(current_line_));
+    auto it = std::upper_bound(native_units_.begin(), native_units_.end(), real,
+                               [](int line, const LineRange& r) { return line < r.begin; });
+    const size_t cursor_unit = it == native_units_.begin() ? 0 : static_cast<size_t>(it - native_units_.begin()) - 1;
+    const LineRange& cursor_range = native_units_[cursor_unit];
+    const size_t cursor_unit_lines = NativePreviewBlock(cursor_unit).size();
+    const size_t cursor_index = cursor_unit_lines == 0 ? 0 : std::min(
+        cursor_unit_lines - 1,
+        static_cast<size_t>(std::max(0, real - cursor_range.begin)) * cursor_unit_lines /
+            static_cast<size_t>(std::max(1, cursor_range.end - cursor_range.begin)));
+    // エディタでカーソルがある段（画面上の同じ高さ）に、プレビューでもカーソル行を置く
+    const int cursor_row = std::clamp(EditorCursorScreenRow() - kNativePreviewHeaderRows, 0, height - 1);
+
+    // 目印（ソース行, カーソル行からの段数）。画面上の段は最後に決まる
+    std::vector<std::pair<int, int>> anchors;
+
+    // 1. カーソル行より上: 単位を遡りながら cursor_row 段ぶんだけ組み立てる
+    // NativePreviewBlock はキャッシュを捨てることがあるので、参照は 1 行ごとに取り直す
+    std::vector<Elements> above; // 下から順
+    int above_rows = 0;
+    size_t first_unit = cursor_unit;
+    size_t index = cursor_index;
+    while (true) {
+        if (index == 0) {
+            anchors.emplace_back(native_units_[first_unit].begin, -above_rows);
+            if (above_rows >= cursor_row || first_unit == 0) break;
+            --first_unit;
+            index = NativePreviewBlock(first_unit).size();
+            continue;
+        }
+        if (above_rows >= cursor_row) break;
+        --index;
+        Elements line_rows;
+        AppendPreviewLine(line_rows, NativePreviewBlock(first_unit)[index], width, height);
+        above_rows += static_cast<int>(line_rows.size());
+        above.push_back(std::move(line_rows));
+    }
+    // 文書の先頭で足りなければ、カーソル行は上に組み立てた段数の位置に来る
+    int skip = std::max(0, above_rows - cursor_row);
+    const int cursor_screen_row = above_rows - skip;
+    for (auto line_rows = above.rbegin(); line_rows != above.rend(); ++line_rows) {
+        for (auto& row : *line_rows) {
+            if (skip > 0) {
+                --skip;
+                continue;
+            }
+            rows.push_back(std::move(row));
+        }
+    }
+
+    // 2. カーソル行から下: 画面が埋まるまで
+    anchors.emplace_back(real, 0);
+    size_t unit = cursor_unit;
+    index = cursor_index;
+    int below_rows = 0;
+    while (static_cast<int>(rows.size()) < height && unit < native_units_.size()) {
+        if (index >= NativePreviewBlock(unit).size()) {
+            if (++unit < native_units_.size()) anchors.emplace_back(native_units_[unit].begin, below_rows);
+            index = 0;
+            continue;
+        }
+        const size_t before = rows.size();
+        AppendPreviewLine(rows, NativePreviewBlock(unit)[index++], width, height);
+        below_rows += static_cast<int>(rows.size() - before);
+    }
+    const size_t last_unit = std::min(unit, native_units_.size() - 1);
+
+    for (const auto& [line, offset] : anchors) {
+        native_scroll_map_.AddAnchor(line, kNativePreviewHeaderRows + cursor_screen_row + offset);
+    }
+
+    // 3. スクロールしている方向の先の単位を解析しておく（次の描画でキャッシュに当たる）
+    if (real > native_last_line_) {
+        for (size_t u = last_unit + 1; u < native_units_.size() && u <= last_unit + kNativePrefetchUnits; ++u) {
+            NativePreviewBlock(u);
+        }
+    } else if (real < native_last_line_) {
+        for (size_t k = 1; k <= kNativePrefetchUnits && k <= first_unit; ++k) {
+            NativePreviewBlock(first_unit - k);
+        }
+    }
+    native_last_line_ = real;
+    return rows;
+}
+
+const std::vector<HighlightSpan>* App::EditorSpans(int real_line) {
+    const std::vector<HighlightSpan>& spans = highlighter_->GetSpans(real_line);
+    if (search_matches_.empty() || search_revision_ != doc_revision_) return &spans;
+    auto first = std::lower_bound(search_matches_.begin(), search_matches_.end(), SearchMatch{real_line, 0, 0});
+    auto last = first;
+    while (last != search_matches_.end() && last->line == real_line) ++last;
+    if (first == last) return &spans;
+
+    // 構文のハイライト範囲から一致箇所を切り抜き、一致箇所を差し込む（範囲は重ならない昇順のまま）
+    search_spans_.clear();
+    auto match = first;
+    for (const auto& span : spans) {
+        size_t pos = span.begin;
+        while (pos < span.end) {
+            while (match != last && match->offset + match->length <= pos) ++match;
+            if (match == last || match->offset >= span.end) {
+                search_spans_.push_back({pos, span.end, span.style});
+                break;
+            }
+            if (match->offset > pos) search_spans_.push_back({pos, match->offset, span.style});
+            pos = match->offset + match->length;
+        }
+    }
+    const auto current = current_match_ >= 0 ? search_matches_.begin() + current_match_ : search_matches_.end();
+    for (auto it = first; it != last; ++it) {
+        search_spans_.push_back({it->offset, it->offset + it->length,
+                                 it == current ? HighlightStyle::SEARCH_CURRENT : HighlightStyle::SEARCH_MATCH});
+    }
+    std::sort(search_spans_.begin(), search_spans_.end(),
+              [](const HighlightSpan& a, const HighlightSpan& b) { return a.begin < b.begin; });
+    return &search_spans_;
+}
+
+int App::EditorCursorScreenRow() const {
+    const int count = static_cast<int>(GetVisibleEditorLines().size());
+    if (count == 0) return 0;
+    const int cursor = std::clamp(current_line_, 0, count - 1);
+    const int row = soft_wrap_ ? wrap_layout_->FirstRowOf(cursor) : cursor;
+    return std::max(0, row - scroll_offset_);
 }
 
 int App::VisibleToRealIndex(int visible_index) const {
-    auto indices = block_model_->GetVisibleLineIndices();
+    const auto& indices = block_model_->GetVisibleLineIndices();
     if (visible_index < 0 || visible_index >= static_cast<int>(indices.size())) return -1;
     return indices[visible_index];
 }
 
 int App::RealToVisibleIndex(int real_index) const {
-    auto indices = block_model_->GetVisibleLineIndices();
-    for (int i = 0; i < static_cast<int>(indices.size()); ++i) {
-        if (indices[i] == real_index) return i;
+    // 可視行マップは昇順なので二分探索
+    const auto& indices = block_model_->GetVisibleLineIndices();
+    if (indices.empty()) return -1;
+    auto it = std::lower_bound(indices.begin(), indices.end(), real_index);
+    if (it != indices.end() && *it == real_index) {
+        return static_cast<int>(it - indices.begin());
     }
-    // 折りたたみ内部の場合はブロック先頭へ寄せる
-    auto blk = block_model_->GetBlockAt(real_index);
-    if (blk) {
-        for (int i = 0; i < static_cast<int>(indices.size()); ++i) {
-            if (indices[i] == blk->start_line) return i;
-        }
+    // 折りたたみ内部の場合はブロック先頭（直前の可視行）へ寄せる
+    if (it == indices.end() || it == indices.begin()) {
+        // フォールバック: 最後の可視行 / 先頭
+        return it == indices.begin() ? 0 : static_cast<int>(indices.size()) - 1;
     }
-    // フォールバック: 最後の可視行
-    return indices.empty() ? -1 : static_cast<int>(indices.size()) - 1;
+    return static_cast<int>(it - indices.begin()) - 1;
 }
 
 // Filename prompt dialog implementation
@@ -718,15 +1947,19 @@ void App::ShowFilenamePrompt(const std::string& message, const std::string& defa
     filename_prompt_message_ = message;
     filename_prompt_text_ = default_value;
     filename_prompt_callback_ = callback;
+    filename_prompt_toggle_ = nullptr;
     show_filename_prompt_ = true;
+    filename_tab_index_ = 1;
     SetStatusMessage(message);
 }
 
 void App::HideFilenamePrompt() {
     show_filename_prompt_ = false;
+    filename_tab_index_ = 0;
     filename_prompt_message_.clear();
     filename_prompt_text_.clear();
     filename_prompt_callback_ = nullptr;
+    filename_prompt_toggle_ = nullptr;
     SetStatusMessage("Filename prompt cancelled");
 }
 
@@ -744,26 +1977,128 @@ Component App::CreateSearchPromptComponent() {
         }
 
         Elements elements;
-        elements.push_back(text(L"検索") | bold | center);
+        std::wstring title = L"検索";
+        if (search_regex_) {
+            title += L"（正規表現）";
+        } else if (search_fold_.kana_fold) {
+            title += L"（大文字小文字・全角半角・かなを区別しない）";
+        } else if (search_fold_.Any()) {
+            title += L"（大文字小文字・全角半角を区別しない）";
+        }
+        elements.push_back(text(title) | bold | center);
         elements.push_back(separator());
 
         // Show search input with cursor
-        std::string display_text = search_query_ + "_";
-        if (search_query_.empty()) {
+        std::string display_text = search_query_ + (search_replace_field_ ? "" : "_");
+        if (search_query_.empty() && !search_replace_field_) {
             display_text = "[検索文字列を入力]"; 
         }
         elements.push_back(text(to_wstring(display_text)) | border);
+        if (search_replace_field_ || !replace_text_.empty()) {
+            const std::string replacement = replace_text_ + (search_replace_field_ ? "_" : "");
+            elements.push_back(hbox({text(L"置換後: "), text(to_wstring(replacement))}) | border);
+        }
+        if (!search_query_.empty() && !search_regex_) {
+            std::string count = std::to_string(search_matches_.size()) + " 件";
+            if (!ActiveSearch().Done()) count += "（検索中…）";
+            elements.push_back(text(to_wstring(count)) | center);
+        }
+        // 影は文書と同じくらいの大きさになるので、大きな文書では使っている量を出す
+        if (search_fold_.Any() && folded_lines_->MemoryUsage() >= (1 << 20)) {
+            elements.push_back(text(to_wstring("正規化した行: " + FormatMegabytes(folded_lines_->MemoryUsage()))) |
+                               center);
+        }
+        switch (search_index_->GetState()) {
+            case TrigramIndex::State::BUILDING:
+                elements.push_back(text(to_wstring("索引: 作成中 " +
+                                                   std::to_string(static_cast<int>(search_index_->Progress() * 100)) +
+                                                   "%")) | center);
+                break;
+            case TrigramIndex::State::READY:
+                elements.push_back(text(to_wstring("索引: " + FormatMegabytes(search_index_->MemoryUsage()))) | center);
+                break;
+            case TrigramIndex::State::DISABLED:
+                elements.push_back(text(to_wstring("索引: 無効（上限 " + FormatMegabytes(search_index_->MemoryLimit()) +
+                                                   " を超過）")) | center);
+                break;
+            case TrigramIndex::State::EMPTY:
+                break;
+        }
 
         elements.push_back(separator());
-        elements.push_back(text(L"Enter: 検索実行  Esc: キャンセル") | center);
+        if (search_replace_field_) {
+            elements.push_back(text(L"Enter: 置換して次へ  ^A: すべて置換  ^U: 元に戻す  Tab: 検索文字列へ") | center);
+        } else if (!search_query_.empty()) {
+            elements.push_back(text(search_regex_ ? L"Enter: 検索実行  ^R: 文字列検索へ  ^D: ディレクトリ以下  Tab: 置換  Esc: キャンセル"
+                                                  : L"Enter: 確定  ^R: 正規表現へ  ^F: 表記ゆれ  ^D: ディレクトリ以下  Tab: 置換  Esc: キャンセル") |
+                               center);
+        } else {
+            elements.push_back(text(search_regex_ ? L"Enter: 検索実行  ^R: 文字列検索へ  Tab: 置換  Esc: キャンセル"
+                                                  : L"Enter: 確定  ^R: 正規表現へ  ^F: 表記ゆれ  Tab: 置換  Esc: キャンセル") |
+                               center);
+        }
         if (!search_matches_.empty()) {
-            elements.push_back(text(L"n: 次の一致  p: 前の一致") | center);
+            // プロンプトの中の ^R は正規表現の切り替えなので、一致の移動はプロンプトを閉じてから
+            elements.push_back(text(L"Enter で閉じてから ^N: 次の一致  ^R: 前の一致") | center);
         }
 
         return vbox(elements) | border | center;
     });
 }
 
+Component App::CreateDirectoryResultsComponent() {
+    return Renderer([this] {
+        if (!show_dir_results_) {
+            return text(L"");
+        }
+
+        const auto progress = dir_search_->GetProgress();
+        Elements elements;
+        elements.push_back(text(to_wstring("ディレクトリ検索: " + dir_root_.string())) | bold | center);
+        std::string summary = std::to_string(dir_matches_.size()) + " 件 / " + std::to_string(dir_files_.size()) +
+                              " ファイル（" + std::to_string(progress.files_scanned) + " ファイル " +
+                              FormatMegabytes(progress.bytes_scanned) + " を検索、" +
+                              std::to_string(progress.files_skipped) + " を除外）";
+        if (!progress.done) {
+            summary += " 検索中…";
+        } else if (progress.truncated) {
+            summary += " 上限で打ち切り";
+        }
+        elements.push_back(text(to_wstring(summary)) | center);
+        elements.push_back(separator());
+
+        // 選択行が入るようにずらし、画面に入る行だけ組み立てる
+        const int height = std::max(1, EditorViewportHeight() - kDirResultsChromeRows);
+        const int count = static_cast<int>(dir_matches_.size());
+        dir_selected_ = std::clamp(dir_selected_, 0, std::max(0, count - 1));
+        if (dir_selected_ < dir_scroll_) {
+            dir_scroll_ = dir_selected_;
+        } else if (dir_selected_ >= dir_scroll_ + height) {
+            dir_scroll_ = dir_selected_ - height + 1;
+        }
+        for (int i = dir_scroll_; i < count && i < dir_scroll_ + height; ++i) {
+            const auto& match = dir_matches_[i];
+            const std::string& preview = match.preview;
+            const size_t begin = std::min(match.preview_offset, preview.size());
+            const size_t end = std::min(begin + match.length, preview.size());
+            auto row = hbox({
+                text(to_wstring(dir_files_[match.file] + ":" + std::to_string(match.line + 1) + ": ")) | dim,
+                text(to_wstring(preview.substr(0, begin))),
+                text(to_wstring(preview.substr(begin, end - begin))) | inverted,
+                text(to_wstring(preview.substr(end))),
+            });
+            elements.push_back(i == dir_selected_ ? row | bgcolor(Color::Blue) : row);
+        }
+        if (count == 0) {
+            elements.push_back(text(progress.done ? L"一致なし" : L"検索中…") | dim);
+        }
+
+        elements.push_back(separator());
+        elements.push_back(text(L"↑/↓ PageUp/PageDown: 選択  Enter: 開く  Esc: 閉じる（検索中なら止める）") | center);
+        return vbox(elements) | border | flex;
+    });
+}
+
 Component App::CreateFilenamePromptComponent() {
     if (!show_filename_prompt_) {
         return Renderer([] { return text(L""); });
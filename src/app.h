@@ -1,10 +1,26 @@
 #pragma once
+#include "background_job.h"
 #include "block_model.h"
+#include "block_render_cache.h"
+#include "column_index.h"
+#include "directory_search.h"
+#include "incremental_search.h"
 #include "markdown_renderer.h"
 #include "pandoc_io.h"
+#include "preview_worker.h"
+#include "regex_search.h"
+#include "syntax_highlighter.h"
+#include "text_fold.h"
+#include "text_replace.h"
+#include "text_search.h"
+#include "trigram_index.h"
+#include "wrap_layout.h"
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
+#include <atomic>
+#include <filesystem>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory>
 #include <functional>
@@ -14,6 +30,12 @@ namespace ShinoEditor {
 // Forward declare for friend access
 namespace test { class AppTestHelper; }
 
+// プレビューの表示方式
+enum class PreviewMode {
+    NATIVE, // パーサーのイベントから直接 FTXUI の要素を組み立てる（カーソル周辺のブロックだけ、エディタとスクロール同期）
+    HTML    // ワーカースレッドで文書全体を HTML にレンダリングして表示
+};
+
 class App {
     friend class test::AppTestHelper;
 public:
@@ -29,6 +51,38 @@ private:
     std::vector<std::string> lines_;
     std::unique_ptr<BlockModel> block_model_;
     std::unique_ptr<MarkdownRenderer> renderer_;
+    // プレビューのブロック単位キャッシュ（ワーカースレッドからのみ使用）
+    std::unique_ptr<BlockRenderCache> render_cache_;
+    // キャッシュにないブロックを並列にレンダリングするプール
+    std::unique_ptr<ThreadPool> render_pool_;
+    std::unique_ptr<WrapLayout> wrap_layout_;
+    std::unique_ptr<SyntaxHighlighter> highlighter_;
+    std::unique_ptr<ColumnIndexCache> column_cache_;
+    uint64_t layout_view_revision_ = 0;
+    // lines_ が変わるたびに増える文書リビジョン（Notify* で更新）
+    uint64_t doc_revision_ = 0;
+    // 最後に完了したプレビュー（preview_revision_ の文書のもの）
+    std::string preview_cache_;
+    uint64_t preview_revision_ = 0;
+    bool preview_valid_ = false;
+    // ワーカーへ最後に要求したリビジョン
+    uint64_t preview_requested_revision_ = 0;
+    bool preview_requested_ = false;
+    // ネイティブプレビュー: レンダリング単位（native_units_revision_ の文書のもの）と
+    // 単位テキストのハッシュ -> 解析結果（画面に出た単位だけ解析する）
+    std::vector<LineRange> native_units_;
+    std::vector<uint64_t> native_unit_hashes_; // 0 は未計算
+    uint64_t native_units_revision_ = 0;
+    bool native_units_valid_ = false;
+    std::unordered_map<uint64_t, std::vector<PreviewLine>> native_blocks_;
+    static constexpr size_t kNativeBlockCacheLimit = 512;
+    // 直前の描画でのソース行 ↔ プレビュー段の対応
+    // 段はエディタ枠の内側の先頭を 0 とする（プレビューの本文は見出しと区切り線の下から始まる）
+    PreviewScrollMap native_scroll_map_;
+    static constexpr int kNativePreviewHeaderRows = 2;
+    // スクロール方向の先読み（前回描画時のカーソル行と比べて決める）
+    int native_last_line_ = 0;
+    static constexpr size_t kNativePrefetchUnits = 4;
     
     // UI components
     ftxui::ScreenInteractive screen_;
@@ -38,19 +92,85 @@ private:
     
     // Application state
     bool show_preview_ = false;
+    PreviewMode preview_mode_ = PreviewMode::NATIVE;
     bool show_help_ = false;
     bool modified_ = false;
     int current_line_ = 0;
-    int scroll_offset_ = 0;
+    int scroll_offset_ = 0; // 表示段単位（ソフトラップ後）
+    bool soft_wrap_ = true;
+    int h_scroll_ = 0;      // 折り返しオフ時の横スクロール（表示桁）
     int help_tab_index_ = 0;
+    int filename_tab_index_ = 0;
+    int search_tab_index_ = 0;
     bool editing_mode_ = false;
     std::string current_input_;
 
     // Search state
     bool show_search_ = false;
     std::string search_query_;
-    std::vector<int> search_matches_; // real line indices
+    std::vector<SearchMatch> search_matches_; // (実行行, オフセット) の昇順
     int current_match_ = -1; // index into search_matches_
+    // 検索したときの文書リビジョン（編集後は一致位置がずれるのでハイライトしない）
+    uint64_t search_revision_ = 0;
+    // 一致箇所を重ねたハイライト範囲（描画中の 1 行分の作業領域）
+    std::vector<HighlightSpan> search_spans_;
+    // 検索の走査を並列に行うプール（プレビューのレンダリングと取り合わないように別にする）
+    std::unique_ptr<ThreadPool> search_pool_;
+    // 入力しながらの検索。走査は UI ループに一定量ずつ投げて進める（投げた分が残っていれば true）
+    std::unique_ptr<IncrementalSearch> incremental_search_;
+    bool search_step_pending_ = false;
+    // 検索用の trigram 索引。kSearchIndexMinBytes 以上の文書を開いたら UI ループの合間に作り、
+    // 編集は Notify* で反映する
+    std::unique_ptr<TrigramIndex> search_index_;
+    bool search_index_step_pending_ = false;
+    static constexpr size_t kSearchIndexMinBytes = 16 << 20;
+    // 正規表現モード（プロンプトで ^R で切り替え、Enter で検索）
+    bool search_regex_ = false;
+    // 実行中の正規表現検索。文字列検索と同じく UI ループに kRegexStepBytes ずつ投げて進め、
+    // 編集されたら（regex_revision_ と違えば）やめる
+    std::unique_ptr<RegexSearcher> regex_search_;
+    size_t regex_next_line_ = 0;
+    uint64_t regex_revision_ = 0;
+    bool regex_step_pending_ = false;
+    static constexpr size_t kRegexStepBytes = 1 << 20;
+    // 表記ゆれを無視する文字列検索（プロンプトで ^F で切り替え）。正規化した行の影を作って
+    // その上を検索し、一致は元の行の位置に直す。影は最初の検索で作り、編集は Notify* で反映する
+    FoldOptions search_fold_;
+    std::unique_ptr<FoldedLines> folded_lines_;
+    std::unique_ptr<IncrementalSearch> folded_search_;
+    // 置換（検索プロンプトで Tab で置換後の文字列の入力に切り替え、Enter で 1 件、^A ですべて）
+    bool search_replace_field_ = false;
+    std::string replace_text_;
+    // 直前の置換を元に戻すための元の行（^U）。置換のあとに文書が変わっていれば使わない
+    std::vector<LineEdit> replace_undo_;
+    uint64_t replace_undo_revision_ = 0;
+    // ディレクトリ検索（検索プロンプトで ^D）。結果は一覧のオーバーレイに出し（画面に入る行だけ組み立てる）、
+    // Enter で選んだ一致のファイルを開く。^D で最後の結果をもう一度開く
+    bool show_dir_results_ = false;
+    int dir_results_tab_index_ = 0;
+    std::filesystem::path dir_root_;
+    std::vector<DirectorySearch::Match> dir_matches_;
+    std::vector<std::string> dir_files_; // dir_root_ からの相対パス
+    int dir_selected_ = 0;
+    int dir_scroll_ = 0;
+    // 一覧は画面全体に出るので、エディタの表示段数より見出し・件数・区切り線・操作説明の分が 2 段少ない
+    static constexpr int kDirResultsChromeRows = 2;
+    // ワーカーからの通知を、UI ループには取り出し待ちの間 1 回だけ投げる
+    std::atomic<bool> dir_poll_pending_{false};
+    // DOCX の入出力（pandoc）はバックグラウンドのジョブで行い、実行中はステータスにスピナーと経過時間を出す（Esc で中断）
+    // ジョブは docx_result_ にだけ書き込み、終わったら UI スレッドで FinishDocxJob が反映する
+    struct DocxJobResult {
+        bool import = false;
+        std::string path;
+        std::string markdown;           // 書き出す文書のスナップショット
+        std::vector<std::string> lines; // 取り込んだ文書
+        DocxEngine engine = DocxEngine::AUTO;
+        bool ok = false;
+        bool cancelled = false;         // 中断で止まった（work が自分で決める）
+        std::string error;
+    };
+    DocxJobResult docx_result_;
+    bool docx_result_pending_ = false;
 
     std::string status_message_;
     
@@ -59,6 +179,10 @@ private:
     std::string filename_prompt_message_;
     std::string filename_prompt_text_;
     std::function<void(const std::string&)> filename_prompt_callback_;
+    // プロンプトで ^P を押したときに呼ぶ（DOCX の書き出しで変換方法を切り替える）。なければ ^P は無視
+    std::function<void()> filename_prompt_toggle_;
+    // DOCX の書き出し方（書き出しのプロンプトで ^P で切り替え、次の書き出しでもそのまま使う）
+    DocxEngine docx_engine_ = DocxEngine::AUTO;
     
     // File operations
     bool LoadFile(const std::string& filename);
@@ -70,14 +194,61 @@ private:
     void MoveBlockUp();
     void MoveBlockDown();
     void TogglePreview();
+    void TogglePreviewMode();
+    void ToggleSoftWrap();
+    void ScrollHorizontal(int delta_cols);
     void ToggleHelp();
     void ShowSearch();
     void FindMatches(const std::string& query);
+    void FindRegexMatches(const std::string& pattern);
     void GotoNextMatch();
     void GotoPrevMatch();
+    // current_match_ の行へ移動し、折り返しオフなら一致箇所が見えるよう横スクロールする
+    void JumpToCurrentMatch();
     void HideSearch();
+    // 検索プロンプトの入力が変わった: 一致を絞り込み/使い直して、残りの走査を始める
+    void UpdateIncrementalSearch();
+    // 走査を 1 回分進めて見つかった一致を search_matches_ に足し、続きがあれば UI ループに投げる
+    void StepIncrementalSearch();
+    void ReportSearchStatus();
+    // 正規表現検索を 1 回分進めて見つかった一致を search_matches_ に足し、続きがあれば UI ループに投げる
+    void StepRegexSearch();
+    void StopRegexSearch() { regex_search_.reset(); }
+    // 索引の構築が残っていれば、続きを UI ループに投げる
+    void ScheduleSearchIndexBuild();
+    // 文字列検索に使う方（表記ゆれを無視するなら影の上の検索）
+    IncrementalSearch& ActiveSearch();
+    // query で文字列検索を始める（表記ゆれを無視するなら影を揃え、正規化したクエリで探す）
+    void StartSearch(const std::string& query);
+    // 新しく見つかった一致を元の行の位置に直して search_matches_ に足す
+    void AppendFoundMatches();
+    // ^F: 表記ゆれの無視を 区別する -> 大文字小文字・全角半角 -> さらにかな と切り替える
+    void CycleSearchFold();
+    // 置換する一致を検索と同じ方式（正規表現/表記ゆれ）で探す。line が負なら文書全体
+    // 正規表現の構文エラーはステータスに出して false
+    bool FindReplaceTargets(int line, std::vector<SearchMatch>& out);
+    // 現在の一致を置き換えて次の一致へ進む（置き換えた行だけ探し直す）
+    void ReplaceCurrentMatch();
+    // すべての一致を探してから、変わる行ごとに 1 回だけ組み立て、まとめて書き換える
+    void ReplaceAllMatches();
+    void UndoReplace();
+    // 置換の行をまとめて書き換え、キャッシュとブロックの更新を 1 回で済ませる（edits は元の行になる）
+    void ApplyLineEdits(std::vector<LineEdit>& edits);
+    // 現在の検索文字列（正規表現モードなら正規表現）で、開いているファイルのディレクトリ以下を探す
+    void StartDirectorySearch();
+    // ワーカーが見つけた一致を一覧に足す（UI スレッド）
+    void PollDirectorySearch();
+    void ShowDirectoryResults();
+    // 閉じるだけ（検索が残っていれば続ける）。cancel なら検索を止める
+    void HideDirectoryResults(bool cancel);
+    void MoveDirectorySelection(int delta);
+    // 選んだ一致のファイルを開いて一致の行へ移動する（未保存の変更があれば開かない）
+    void OpenDirectoryMatch();
     void ImportDocx();
     void ExportDocx();
+    // 取り込んだ文書への入れ替えや結果の表示（UI スレッド、ジョブが終わっていなければ何もしない）
+    void FinishDocxJob();
+    void ExportHtml();
     void InsertLine();
     void DeleteLine();
     void EnterEditMode();
@@ -92,6 +263,10 @@ private:
     ftxui::Component CreateStatusComponent();
     ftxui::Component CreateFilenamePromptComponent();
     ftxui::Component CreateSearchPromptComponent();
+    ftxui::Component CreateDirectoryResultsComponent();
+    ftxui::Elements BuildWrappedRows(int height);
+    ftxui::Elements BuildClippedRows(int height);
+    ftxui::Elements BuildNativePreviewRows(int width, int height);
     
     // Filename prompt operations
     void ShowFilenamePrompt(const std::string& message, const std::string& default_value, std::function<void(const std::string&)> callback);
@@ -103,14 +278,41 @@ private:
     
     // Helper methods
     void UpdateBlockModel();
+    // 行バッファ変更の通知（文書リビジョンと折り返し・ハイライト等のキャッシュへ）
+    void NotifyLineChanged(int real_line);
+    void NotifyLinesInserted(int pos, int count);
+    void NotifyLinesErased(int pos, int count);
+    // 行数の変わらない、まとめての書き換え（置換）
+    void NotifyLinesChanged(const std::vector<LineEdit>& edits);
+    void NotifyDocumentReplaced();
     void SetStatusMessage(const std::string& message);
-    std::vector<std::string> GetVisibleEditorLines() const;
-    std::string GetPreviewContent() const;
+    const std::vector<std::string>& GetVisibleEditorLines() const;
+    bool IsFoldedPlaceholder(int visible_index) const;
+    void SyncWrapLayout();
+    int EditorViewportWidth() const;
+    int EditorViewportHeight() const;
+    PreviewSnapshot BuildDocumentSnapshot() const;
+    // 必要ならバックグラウンドのレンダリングを要求し、最後に完了した結果を返す
+    const std::string& GetPreviewContent();
+    bool IsPreviewStale() const;
+    void OnPreviewRendered(uint64_t revision, std::string content);
+    // ネイティブプレビューの単位 unit を解析した結果（キャッシュ付き）
+    const std::vector<PreviewLine>& NativePreviewBlock(size_t unit);
+    int PreviewViewportWidth() const;
+    // エディタに表示する行のハイライト範囲（検索の一致箇所を重ねる）
+    const std::vector<HighlightSpan>* EditorSpans(int real_line);
+    // エディタ画面内でのカーソルの段（0 が先頭）
+    int EditorCursorScreenRow() const;
 
     // 可視行インデックス -> 実行行インデックス 変換
     int VisibleToRealIndex(int visible_index) const;
     // 実行行インデックス -> 可視行インデックス 変換（見つからない場合は折りたたみ先頭などに寄せる）
     int RealToVisibleIndex(int real_index) const;
+
+    // 他のメンバーを参照するので最後に宣言する（最初に破棄してスレッドを止める）
+    std::unique_ptr<BackgroundJob> docx_job_;
+    std::unique_ptr<DirectorySearch> dir_search_;
+    std::unique_ptr<PreviewWorker> preview_worker_;
 };
 
 }
@@ -0,0 +1,77 @@
+#include "background_job.h"
+#include <cstdio>
+
+namespace ShinoEditor {
+
+BackgroundJob::BackgroundJob(std::function<void()> on_tick, std::function<void()> on_finished)
+    : on_tick_(std::move(on_tick)), on_finished_(std::move(on_finished)) {}
+
+BackgroundJob::~BackgroundJob() {
+    Cancel();
+    Join();
+}
+
+bool BackgroundJob::Start(std::string label, Work work) {
+    if (running_) return false;
+    // 前のジョブのスレッドは終わっているので回収だけ
+    Join();
+    label_ = std::move(label);
+    cancel_ = false;
+    elapsed_ms_ = 0;
+    started_ = std::chrono::steady_clock::now();
+    running_ = true;
+    thread_ = std::thread([this, work = std::move(work)] {
+        work(cancel_);
+        elapsed_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::steady_clock::now() - started_).count();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        cv_.notify_all();
+        if (on_finished_) on_finished_();
+    });
+    if (on_tick_) {
+        ticker_ = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!cv_.wait_for(lock, kTickInterval, [this] { return !running_; })) {
+                lock.unlock();
+                on_tick_();
+                lock.lock();
+            }
+        });
+    }
+    return true;
+}
+
+void BackgroundJob::Cancel() {
+    // Running() を見てから立てても work が戻るのとは競合するので、いつでも立てる（次の Start() で戻す）
+    cancel_ = true;
+}
+
+void BackgroundJob::Join() {
+    if (thread_.joinable()) thread_.join();
+    if (ticker_.joinable()) ticker_.join();
+}
+
+std::chrono::milliseconds BackgroundJob::Elapsed() const {
+    if (!running_) return std::chrono::milliseconds(elapsed_ms_);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_);
+}
+
+const char* BackgroundJob::SpinnerFrame(std::chrono::milliseconds elapsed) {
+    static const char* const kFrames[] = {"⠋", "⠙", "⠹", "⠸", "⠼", "⠴", "⠦", "⠧", "⠇", "⠏"};
+    constexpr size_t kCount = sizeof(kFrames) / sizeof(kFrames[0]);
+    return kFrames[static_cast<size_t>(elapsed / kTickInterval) % kCount];
+}
+
+std::string BackgroundJob::StatusText() const {
+    const auto elapsed = Elapsed();
+    char seconds[32];
+    std::snprintf(seconds, sizeof(seconds), "%.1fs", static_cast<double>(elapsed.count()) / 1000.0);
+    std::string out = label_ + " " + SpinnerFrame(elapsed) + " " + seconds;
+    out += cancel_ ? " (cancelling)" : " (Esc to cancel)";
+    return out;
+}
+
+}
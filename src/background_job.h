@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ShinoEditor {
+
+// 時間のかかる処理（pandoc での DOCX の入出力など）を 1 本ずつバックグラウンドで実行するジョブ
+// - Start() はすぐに戻り、work はジョブのスレッドで実行する
+// - 実行中は kTickInterval ごとに on_tick を呼ぶ（ステータス表示の経過時間とスピナーの更新用）
+// - work が戻って Running() が false になってから on_finished を呼ぶ（結果の反映を呼び出し側のループへ渡す）
+// - Cancel() は中断フラグを立てるだけで待たない（work はフラグを見て早めに戻る）
+// - フラグは work が戻る間際にも立ちうる。中断で止まったかどうかは work が自分の結果に残す
+class BackgroundJob {
+public:
+    using Work = std::function<void(const std::atomic<bool>& cancel)>;
+
+    static constexpr std::chrono::milliseconds kTickInterval{100};
+
+    // on_tick / on_finished はジョブのスレッドから呼ぶ
+    explicit BackgroundJob(std::function<void()> on_tick = nullptr, std::function<void()> on_finished = nullptr);
+    // 中断して終わるのを待つ
+    ~BackgroundJob();
+
+    BackgroundJob(const BackgroundJob&) = delete;
+    BackgroundJob& operator=(const BackgroundJob&) = delete;
+
+    // 実行中なら何もせず false
+    bool Start(std::string label, Work work);
+    void Cancel();
+    // work が戻るまで true
+    bool Running() const { return running_; }
+    // 中断を頼まれたか（work が中断で止まったかどうかではない）
+    bool Cancelled() const { return cancel_; }
+    const std::string& Label() const { return label_; }
+    // Start() からの経過時間（終わったあとは実行にかかった時間）
+    std::chrono::milliseconds Elapsed() const;
+    // 経過時間に応じたスピナーの 1 文字
+    static const char* SpinnerFrame(std::chrono::milliseconds elapsed);
+    // "Importing a.docx ⠙ 3.2s (Esc to cancel)" のような表示
+    std::string StatusText() const;
+
+private:
+    std::function<void()> on_tick_;
+    std::function<void()> on_finished_;
+    std::string label_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> cancel_{false};
+    std::chrono::steady_clock::time_point started_;
+    std::atomic<int64_t> elapsed_ms_{0}; // 終わったときに確定する
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+    std::thread ticker_;
+
+    void Join();
+};
+
+}
@@ -0,0 +1,281 @@
+#include "batch_renderer.h"
+#include "block_render_cache.h"
+#include "bounded_queue.h"
+#include "error_handler.h"
+#include "html_export.h"
+#include "mapped_file.h"
+#include "output_file.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ShinoEditor {
+
+namespace fs = std::filesystem;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double MillisSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// 相対パス（"/" 区切り）→ 入力のハッシュ
+using Manifest = std::unordered_map<std::string, uint64_t>;
+
+// レンダラーが変われば出力も変わるので、見出し行に含めて一致しなければ全部変換し直す
+std::string ManifestHeader() {
+    return std::string("shino-render-cache 1 ") + (MarkdownRenderer::IsAvailable() ? "md4c" : "builtin");
+}
+
+Manifest LoadManifest(const fs::path& path) {
+    Manifest manifest;
+    std::ifstream in(path);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != ManifestHeader()) return manifest;
+    while (std::getline(in, line)) {
+        // "<16 桁の 16 進ハッシュ> <相対パス>"
+        if (line.size() < 18 || line[16] != ' ') continue;
+        unsigned long long hash = 0;
+        if (std::sscanf(line.c_str(), "%16llx", &hash) != 1) continue;
+        manifest[line.substr(17)] = static_cast<uint64_t>(hash);
+    }
+    return manifest;
+}
+
+// 一時ファイル（OutputFile）に書いてから置き換える
+bool WriteFileAtomically(const fs::path& path, std::string_view content) {
+    try {
+        OutputFile file(path.string(), "HTML");
+        FdSink sink(file.fd());
+        sink.Write(content);
+        file.Commit(sink);
+        return true;
+    } catch (const ShinoError&) {
+        return false;
+    }
+}
+
+bool SaveManifest(const fs::path& path, const Manifest& manifest) {
+    std::vector<std::pair<std::string, uint64_t>> entries(manifest.begin(), manifest.end());
+    std::sort(entries.begin(), entries.end());
+    std::string text = ManifestHeader() + "\n";
+    char hex[17];
+    for (const auto& [key, hash] : entries) {
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        text += hex;
+        text += ' ';
+        text += key;
+        text += '\n';
+    }
+    return WriteFileAtomically(path, text);
+}
+
+struct RenderJob {
+    fs::path relative;
+    MappedFile file;
+    uint64_t hash = 0;
+    double read_ms = 0;
+};
+
+struct WriteJob {
+    fs::path relative;
+    std::string html;
+    uint64_t hash = 0;
+    size_t input_bytes = 0;
+    double read_ms = 0;
+    double render_ms = 0;
+};
+}
+
+BatchRenderer::BatchRenderer(const MarkdownRenderer& renderer) : renderer_(renderer) {}
+
+bool BatchRenderer::IsMarkdownFile(const fs::path& path) {
+    const std::string ext = path.extension().string();
+    return ext == ".md" || ext == ".markdown";
+}
+
+BatchRenderer::Summary BatchRenderer::Run(const Options& options) {
+    const auto started = Clock::now();
+    std::error_code ec;
+    if (!fs::is_directory(options.input_dir, ec)) {
+        error::ThrowFileNotFound(options.input_dir.string());
+    }
+    fs::create_directories(options.output_dir, ec);
+    if (!fs::is_directory(options.output_dir, ec)) {
+        error::ThrowFileNotWritable(options.output_dir.string());
+    }
+
+    const size_t jobs = options.jobs > 0 ? options.jobs : ThreadPool::DefaultThreadCount();
+    // 読み書きは mmap とページキャッシュへの書き込みが主なので、レンダリングより少なくてよい
+    const size_t io_threads = std::max<size_t>(1, jobs / 4);
+    const fs::path manifest_path = options.output_dir / kManifestName;
+    const Manifest previous = options.force ? Manifest{} : LoadManifest(manifest_path);
+
+    Manifest current;
+    std::mutex manifest_mutex;
+    std::mutex log_mutex;
+    std::atomic<size_t> rendered{0}, skipped{0}, failed{0}, input_bytes{0};
+
+    auto record = [&](const fs::path& relative, uint64_t hash) {
+        std::lock_guard<std::mutex> lock(manifest_mutex);
+        current[relative.generic_string()] = hash;
+    };
+    auto report = [&](const std::string& line) {
+        if (!options.log) return;
+        std::lock_guard<std::mutex> lock(log_mutex);
+        *options.log << line << '\n';
+    };
+    auto fail = [&](const fs::path& relative, const std::string& reason) {
+        ++failed;
+        report("error  " + relative.generic_string() + ": " + reason);
+    };
+    auto output_path = [&](const fs::path& relative) {
+        fs::path out = options.output_dir / relative;
+        out.replace_extension(".html");
+        return out;
+    };
+
+    // 段の間のキューは容量付き。遅い段があれば前の段が待つので、メモリはキューの容量分で頭打ちになる
+    BoundedQueue<fs::path> paths(jobs * 4);
+    BoundedQueue<RenderJob> to_render(jobs * 2);
+    BoundedQueue<WriteJob> to_write(jobs * 2);
+
+    // 1. 読み込み: mmap してハッシュを求め、前回と同じなら飛ばす
+    auto read_stage = [&] {
+        while (auto relative = paths.Pop()) {
+            const auto t = Clock::now();
+            RenderJob job;
+            job.relative = std::move(*relative);
+            if (!job.file.Open((options.input_dir / job.relative).string())) {
+                fail(job.relative, "cannot read");
+                continue;
+            }
+            job.hash = BlockRenderCache::Hash(job.file.View());
+            auto it = previous.find(job.relative.generic_string());
+            std::error_code exists_ec;
+            if (it != previous.end() && it->second == job.hash &&
+                fs::exists(output_path(job.relative), exists_ec)) {
+                ++skipped;
+                record(job.relative, job.hash);
+                continue;
+            }
+            job.read_ms = MillisSince(t);
+            to_render.Push(std::move(job));
+        }
+    };
+
+    // 2. レンダリング: 文書ごとに独立なので jobs 本で並列に
+    auto render_stage = [&] {
+        while (auto job = to_render.Pop()) {
+            const auto t = Clock::now();
+            WriteJob out;
+            out.relative = std::move(job->relative);
+            out.hash = job->hash;
+            out.input_bytes = job->file.Size();
+            out.read_ms = job->read_ms;
+            try {
+                out.html.reserve(out.input_bytes + out.input_bytes / 4 + 256);
+                StringSink sink(out.html);
+                HtmlExport::WriteHeader(sink, out.relative.stem().string());
+                renderer_.RenderHtmlTo(job->file.View(), sink);
+                HtmlExport::WriteFooter(sink);
+            } catch (const std::exception& e) {
+                fail(out.relative, e.what());
+                continue;
+            }
+            job->file.Close();
+            out.render_ms = MillisSince(t);
+            to_write.Push(std::move(out));
+        }
+    };
+
+    // 3. 書き込み
+    auto write_stage = [&] {
+        while (auto job = to_write.Pop()) {
+            const auto t = Clock::now();
+            const fs::path out = output_path(job->relative);
+            std::error_code dir_ec;
+            fs::create_directories(out.parent_path(), dir_ec);
+            if (!WriteFileAtomically(out, job->html)) {
+                fail(job->relative, "cannot write " + out.string());
+                continue;
+            }
+            const double write_ms = MillisSince(t);
+            ++rendered;
+            input_bytes += job->input_bytes;
+            record(job->relative, job->hash);
+
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(2)
+                 << "read " << job->read_ms << " ms  render " << job->render_ms
+                 << " ms  write " << write_ms << " ms  "
+                 << std::setprecision(1) << job->input_bytes / 1024.0 << " KB  "
+                 << job->relative.generic_string();
+            report(line.str());
+        }
+    };
+
+    std::vector<std::thread> readers, renderers, writers;
+    for (size_t i = 0; i < io_threads; ++i) readers.emplace_back(read_stage);
+    for (size_t i = 0; i < jobs; ++i) renderers.emplace_back(render_stage);
+    for (size_t i = 0; i < io_threads; ++i) writers.emplace_back(write_stage);
+
+    // ディレクトリを辿って読み込み段に流す（呼び出しスレッド）
+    size_t files = 0;
+    const auto walk_options = fs::directory_options::skip_permission_denied;
+    for (fs::recursive_directory_iterator it(options.input_dir, walk_options, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_regular_file(entry_ec) || !IsMarkdownFile(it->path())) continue;
+        fs::path relative = fs::relative(it->path(), options.input_dir, entry_ec);
+        if (entry_ec) continue;
+        ++files;
+        // a.md と a.markdown はどちらも a.html になる。並んだ順で勝ち負けが変わらないよう、.md を変換して
+        // .markdown は失敗として報告する
+        if (it->path().extension() == ".markdown") {
+            fs::path sibling = it->path();
+            sibling.replace_extension(".md");
+            if (fs::is_regular_file(sibling, entry_ec)) {
+                fs::path sibling_relative = relative;
+                sibling_relative.replace_extension(".md");
+                fail(relative, "same output as " + sibling_relative.generic_string() + " (" +
+                                   output_path(relative).string() + "), skipped");
+                continue;
+            }
+        }
+        paths.Push(std::move(relative));
+    }
+
+    // 前の段が終わってから次の段のキューを閉じる
+    paths.Close();
+    for (auto& t : readers) t.join();
+    to_render.Close();
+    for (auto& t : renderers) t.join();
+    to_write.Close();
+    for (auto& t : writers) t.join();
+
+    if (!SaveManifest(manifest_path, current)) {
+        report("error  cannot write " + manifest_path.string());
+    }
+
+    Summary summary;
+    summary.files = files;
+    summary.rendered = rendered;
+    summary.skipped = skipped;
+    summary.failed = failed;
+    summary.input_bytes = input_bytes;
+    summary.elapsed_ms = MillisSince(started);
+    return summary;
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "markdown_renderer.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+
+namespace ShinoEditor {
+
+// ディレクトリ以下の Markdown をまとめて HTML に変換する（--render-html 用、画面なし）
+// 読み込み（mmap）→ レンダリング → 書き込みの 3 段を容量付きキューでつないだパイプラインで、
+// レンダリング段を jobs 本のスレッドで並列に動かす
+// 前回から内容のハッシュが変わっていないファイルは飛ばす（出力先のマニフェストに記録）
+// 出力は拡張子を .html にした名前。a.md と a.markdown が並べば a.md を変換し、a.markdown は失敗に数える
+class BatchRenderer {
+public:
+    // 出力ディレクトリに置く、前回の入力ハッシュの記録
+    static constexpr const char* kManifestName = ".shino-render-cache";
+
+    struct Options {
+        std::filesystem::path input_dir;
+        std::filesystem::path output_dir;
+        size_t jobs = 0;              // 0 ならハードウェアスレッド数
+        bool force = false;           // ハッシュが同じでも変換し直す
+        std::ostream* log = nullptr;  // ファイルごとの所要時間を書く（nullptr なら書かない）
+    };
+
+    struct Summary {
+        size_t files = 0;       // 見つかった Markdown ファイル
+        size_t rendered = 0;
+        size_t skipped = 0;     // 変更なし
+        size_t failed = 0;
+        size_t input_bytes = 0; // 変換したファイルの合計
+        double elapsed_ms = 0;
+    };
+
+    explicit BatchRenderer(const MarkdownRenderer& renderer);
+
+    // 入力ディレクトリが読めなければ ShinoError（Category::File）を投げる
+    // 個々のファイルの失敗は log に書いて failed に数える
+    Summary Run(const Options& options);
+
+    // .md / .markdown
+    static bool IsMarkdownFile(const std::filesystem::path& path);
+
+private:
+    const MarkdownRenderer& renderer_;
+};
+
+}
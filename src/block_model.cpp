@@ -1,12 +1,26 @@
 #include "block_model.h"
 #include <algorithm>
-#include <regex>
 
 namespace ShinoEditor {
 
-// 静的メンバの初期化
-const std::regex BlockModel::header_pattern_(R"(^(#{1,6})\s+(.*))" );
-const std::regex BlockModel::header_extract_pattern_(R"(^#{1,6}\s+(.*))" );
+namespace {
+bool IsSpaceChar(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// ^(#{1,6})\s+(.*) に一致すれば見出しテキストの開始位置を返す（一致しなければ npos）
+// 正規表現と同じく、テキスト部分に改行文字（\r, \n）があれば一致しない
+size_t HeaderTextStart(const std::string& line, int& level) {
+    size_t n = 0;
+    while (n < line.size() && line[n] == '#') ++n;
+    if (n == 0 || n > 6 || n == line.size() || !IsSpaceChar(line[n])) return std::string::npos;
+    size_t text = n;
+    while (text < line.size() && IsSpaceChar(line[text])) ++text;
+    if (line.find_first_of("\r\n", text) != std::string::npos) return std::string::npos;
+    level = static_cast<int>(n);
+    return text;
+}
+}
 
 BlockModel::BlockModel(std::vector<std::string>& lines)
     : lines_(lines) {
@@ -172,15 +186,18 @@ bool BlockModel::MoveBlockDown(int line_number) {
 }
 
 std::shared_ptr<Block> BlockModel::GetBlockAt(int line_number) const {
-    for (auto& block : blocks_) {
-        if (line_number >= block->start_line && line_number <= block->end_line) {
-            return block;
-        }
+    // blocks_ は開始行の昇順なので二分探索
+    auto it = std::upper_bound(blocks_.begin(), blocks_.end(), line_number,
+        [](int line, const std::shared_ptr<Block>& block) { return line < block->start_line; });
+    if (it == blocks_.begin()) return nullptr;
+    const auto& block = *(it - 1);
+    if (line_number <= block->end_line) {
+        return block;
     }
     return nullptr;
 }
 
-std::vector<std::string> BlockModel::GetVisibleLines() const {
+const std::vector<std::string>& BlockModel::GetVisibleLines() const {
     if (!cache_valid_) {
         BuildVisibleView(visible_lines_cache_, visible_indices_cache_);
         cache_valid_ = true;
@@ -193,12 +210,7 @@ void BlockModel::UpdateLines() {
 }
 
 bool BlockModel::IsHeaderLine(const std::string& line, int& level) const {
-    std::smatch matches;
-    if (std::regex_match(line, matches, header_pattern_)) {
-        level = static_cast<int>(matches[1].str().length());
-        return true;
-    }
-    return false;
+    return HeaderTextStart(line, level) != std::string::npos;
 }
 
 bool BlockModel::IsCodeFenceStart(const std::string& line) const {
@@ -210,14 +222,12 @@ bool BlockModel::IsQuoteLine(const std::string& line) const {
 }
 
 std::string BlockModel::ExtractHeaderText(const std::string& line) const {
-    std::smatch matches;
-    if (std::regex_match(line, matches, header_extract_pattern_)) {
-        return matches[1].str();
-    }
-    return line;
+    int level = 0;
+    const size_t text = HeaderTextStart(line, level);
+    return text == std::string::npos ? line : line.substr(text);
 }
 
-std::vector<int> BlockModel::GetVisibleLineIndices() const {
+const std::vector<int>& BlockModel::GetVisibleLineIndices() const {
     if (!cache_valid_) {
         BuildVisibleView(visible_lines_cache_, visible_indices_cache_);
         cache_valid_ = true;
@@ -229,6 +239,7 @@ void BlockModel::BuildVisibleView(std::vector<std::string>& out_lines,
                                   std::vector<int>& out_indices) const {
     out_lines.clear();
     out_indices.clear();
+    ++view_revision_;
     
     // Pre-allocate based on lines size
     out_lines.reserve(lines_.size());
@@ -1,8 +1,8 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
-#include <regex>
 
 namespace ShinoEditor {
 
@@ -45,9 +45,11 @@ public:
     const std::vector<std::shared_ptr<Block>>& GetBlocks() const { return blocks_; }
     
     // Get visible lines (considering folding)
-    std::vector<std::string> GetVisibleLines() const;
-    // 可視行インデックス -> 実行行インデックスのマップ
-    std::vector<int> GetVisibleLineIndices() const;
+    const std::vector<std::string>& GetVisibleLines() const;
+    // 可視行インデックス -> 実行行インデックスのマップ（昇順）
+    const std::vector<int>& GetVisibleLineIndices() const;
+    // 可視ビューを再構築するたびに増える番号（参照の有効期限の判定用）
+    uint64_t GetViewRevision() const { return view_revision_; }
     
     // Update with new lines (内容は外部で更新済みなので再解析のみ)
     void UpdateLines();
@@ -61,11 +63,8 @@ private:
     mutable std::vector<std::string> visible_lines_cache_;
     mutable std::vector<int> visible_indices_cache_;
     mutable bool cache_valid_ = false;
+    mutable uint64_t view_revision_ = 0;
     
-    // 正規表現パターンのキャッシュ
-    static const std::regex header_pattern_;
-    static const std::regex header_extract_pattern_;
-
     // Helper methods
     bool IsHeaderLine(const std::string& line, int& level) const;
     bool IsCodeFenceStart(const std::string& line) const;
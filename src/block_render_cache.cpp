@@ -0,0 +1,222 @@
+#include "block_render_cache.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ShinoEditor {
+
+namespace {
+// エントリ 1 個あたりの管理領域の概算（list ノード + map ノード）
+constexpr size_t kEntryOverhead = sizeof(void*) * 8 + 64;
+
+bool IsBlank(const std::string& line) {
+    return line.find_first_not_of(" \t") == std::string::npos;
+}
+
+bool IsIndented(const std::string& line) {
+    return !line.empty() && (line[0] == ' ' || line[0] == '\t');
+}
+
+// 行頭 3 文字までの空白の後に c があるか
+bool StartsWithAfterIndent(const std::string& line, char c) {
+    const size_t i = line.find_first_not_of(' ');
+    return i != std::string::npos && i <= 3 && line[i] == c;
+}
+
+// [from, to) の末尾の段落（最後の空行より後）が c で始まるか
+// '<' なら HTML ブロック、'>' なら引用（続く行は遅延継続行か同じ引用の続き）がまだ閉じていない
+bool EndsInsideRunStartingWith(const std::vector<std::string>& lines, int from, int to, char c) {
+    if (to <= from || IsBlank(lines[to - 1])) return false;
+    int i = to - 1;
+    while (i > from && !IsBlank(lines[i - 1])) --i;
+    return StartsWithAfterIndent(lines[i], c);
+}
+
+// コードフェンスの開き・閉じ（行頭 3 文字までの空白の後に ``` / ~~~ を 3 文字以上）の文字と長さ。
+// 開いているフェンスは同じ文字で同じ長さ以上の、後ろに空白しかない行でだけ閉じる（SyntaxHighlighter と同じ）
+class FenceTracker {
+public:
+    bool open() const { return char_ != 0; }
+
+    void Feed(const std::string& line) {
+        size_t i = 0;
+        while (i < line.size() && i < 3 && line[i] == ' ') ++i;
+        if (i >= line.size() || (line[i] != '`' && line[i] != '~')) return;
+        const char c = line[i];
+        size_t j = i;
+        while (j < line.size() && line[j] == c) ++j;
+        const int len = static_cast<int>(j - i);
+        if (len < 3) return;
+        if (!open()) {
+            // バッククォートのフェンスの情報文字列にはバッククォートを含められない
+            if (c == '`' && line.find('`', j) != std::string::npos) return;
+            char_ = c;
+            len_ = len;
+        } else if (c == char_ && len >= len_ && line.find_first_not_of(" \t", j) == std::string::npos) {
+            char_ = 0;
+        }
+    }
+
+private:
+    char char_ = 0;
+    int len_ = 0;
+};
+
+uint64_t Mix(uint64_t h, uint64_t v) {
+    h ^= v * 0x9E3779B97F4A7C15ULL;
+    h = (h << 31) | (h >> 33);
+    return h * 0xBF58476D1CE4E5B9ULL;
+}
+}
+
+BlockRenderCache::BlockRenderCache(const MarkdownRenderer& renderer, size_t memory_limit)
+    : renderer_(renderer), memory_limit_(memory_limit) {}
+
+uint64_t BlockRenderCache::Hash(std::string_view data) {
+    uint64_t h = 0xCBF29CE484222325ULL ^ data.size();
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t v;
+        std::memcpy(&v, data.data() + i, sizeof(v));
+        h = Mix(h, v);
+    }
+    uint64_t tail = 0;
+    if (i < data.size()) std::memcpy(&tail, data.data() + i, data.size() - i);
+    h = Mix(h, tail);
+    // 最終的な攪拌（splitmix64）
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+std::string BlockRenderCache::Render(const std::vector<std::string>& units,
+                                     const std::atomic<bool>* cancel, ThreadPool* pool) {
+    auto cancelled = [cancel] { return cancel && cancel->load(std::memory_order_relaxed); };
+
+    // 1. ハッシュを求めてキャッシュを引く。未レンダリングの単位は同じ内容ごとに 1 回だけ描画する
+    std::vector<uint64_t> hashes(units.size());
+    std::vector<int> slots(units.size(), -1); // rendered の添字（キャッシュヒットは -1）
+    std::vector<size_t> misses;
+    std::unordered_map<uint64_t, int> miss_slots;
+    for (size_t i = 0; i < units.size(); ++i) {
+        hashes[i] = Hash(units[i]);
+        if (Lookup(units[i], hashes[i])) continue;
+        auto [it, inserted] = miss_slots.emplace(hashes[i], static_cast<int>(misses.size()));
+        if (inserted) misses.push_back(i);
+        slots[i] = it->second;
+    }
+
+    // 2. 未レンダリングの単位を描画（プールがあれば並列に。単位どうしは独立）
+    std::vector<std::string> rendered(misses.size());
+    auto render_one = [&](size_t k) {
+        if (cancelled()) return;
+        rendered[k] = renderer_.RenderToHtml(units[misses[k]], cancel);
+    };
+    if (pool && misses.size() > 1) {
+        pool->ParallelFor(misses.size(), render_one);
+    } else {
+        for (size_t k = 0; k < misses.size(); ++k) render_one(k);
+    }
+    // 中断された断片は不完全なのでキャッシュしない
+    if (cancelled()) return {};
+
+    // 3. 文書順に連結（直列レンダリングと同じ結果）
+    size_t source_size = 0;
+    for (const auto& unit : units) source_size += unit.size();
+    std::string out;
+    out.reserve(source_size + source_size / 4);
+    for (size_t i = 0; i < units.size(); ++i) {
+        if (slots[i] >= 0) {
+            out += rendered[slots[i]];
+        } else {
+            // 挿入は連結の後なので、ここまでに追い出されることはない
+            out += entries_.find(hashes[i])->second->fragment;
+        }
+    }
+
+    // 4. 新しい断片を登録して上限を超えた分を追い出す
+    for (size_t k = 0; k < misses.size(); ++k) {
+        memory_usage_ += rendered[k].size() + kEntryOverhead;
+        lru_.push_front(Entry{hashes[misses[k]], units[misses[k]].size(), std::move(rendered[k])});
+        entries_[hashes[misses[k]]] = lru_.begin();
+        ++stats_.misses;
+    }
+    EvictIfNeeded();
+    return out;
+}
+
+bool BlockRenderCache::Lookup(const std::string& unit, uint64_t hash) {
+    auto it = entries_.find(hash);
+    if (it == entries_.end()) return false;
+
+    if (it->second->source_size != unit.size()) {
+        // ハッシュ衝突（元の長さが違う）: 古い方を捨てる
+        memory_usage_ -= it->second->fragment.size() + kEntryOverhead;
+        lru_.erase(it->second);
+        entries_.erase(it);
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++stats_.hits;
+    return true;
+}
+
+void BlockRenderCache::EvictIfNeeded() {
+    while (memory_usage_ > memory_limit_ && !lru_.empty()) {
+        const Entry& victim = lru_.back();
+        memory_usage_ -= victim.fragment.size() + kEntryOverhead;
+        entries_.erase(victim.hash);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+void BlockRenderCache::Clear() {
+    lru_.clear();
+    entries_.clear();
+    memory_usage_ = 0;
+}
+
+bool BlockRenderCache::IsLinkReferenceDefinition(const std::string& line) {
+    if (!StartsWithAfterIndent(line, '[')) return false;
+    const size_t close = line.find("]:");
+    return close != std::string::npos && close > line.find('[') + 1;
+}
+
+std::vector<LineRange> BlockRenderCache::SplitRenderUnits(
+    const std::vector<std::string>& lines,
+    const std::vector<std::shared_ptr<Block>>& blocks) {
+    const int n = static_cast<int>(lines.size());
+    std::vector<LineRange> units;
+    if (n == 0) return units;
+
+    // 参照定義は文書全体から参照されるので、分割すると結果が変わる
+    if (std::any_of(lines.begin(), lines.end(), IsLinkReferenceDefinition)) {
+        units.push_back({0, n});
+        return units;
+    }
+
+    int unit_begin = 0;
+    // BlockModel はフェンスの文字と長さを見ずに ``` / ~~~ の行でブロックを分けるので、
+    // 開いているフェンスは行を順に読んで追い、その中では分けない
+    FenceTracker fence;
+    int scanned = 0;
+    for (const auto& block : blocks) {
+        const int start = block->start_line;
+        if (start <= unit_begin || start >= n) continue;
+        for (; scanned < start; ++scanned) fence.Feed(lines[scanned]);
+        const bool safe = !fence.open() && !IsIndented(lines[start]) &&
+                          !EndsInsideRunStartingWith(lines, unit_begin, start, '<') &&
+                          !EndsInsideRunStartingWith(lines, unit_begin, start, '>');
+        if (safe) {
+            units.push_back({unit_begin, start});
+            unit_begin = start;
+        }
+    }
+    units.push_back({unit_begin, n});
+    return units;
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "block_model.h"
+#include "markdown_renderer.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ShinoEditor {
+
+// レンダリング単位の行範囲 [begin, end)
+struct LineRange {
+    int begin;
+    int end;
+};
+
+// トップレベルのブロック単位でレンダリング結果をメモ化するキャッシュ
+// - 各単位の Markdown の 64bit ハッシュをキーに HTML 断片を保持し、プレビューは断片の連結で組み立てる
+// - 1 行の編集では、その行を含む単位だけが再レンダリングされる
+// - 断片の合計サイズが上限を超えたら、最も長く使われていないものから捨てる（LRU）
+class BlockRenderCache {
+public:
+    static constexpr size_t kDefaultMemoryLimit = 32 * 1024 * 1024;
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    explicit BlockRenderCache(const MarkdownRenderer& renderer,
+                              size_t memory_limit = kDefaultMemoryLimit);
+
+    // 単位ごとの Markdown を受け取り、プレビュー全体を返す
+    // pool があればキャッシュにない単位を並列にレンダリングする（結果は直列と同じ）
+    // cancel が立つと途中で打ち切る（空文字列を返す）
+    std::string Render(const std::vector<std::string>& units,
+                       const std::atomic<bool>* cancel = nullptr,
+                       ThreadPool* pool = nullptr);
+
+    size_t MemoryUsage() const { return memory_usage_; }
+    size_t EntryCount() const { return entries_.size(); }
+    const Stats& GetStats() const { return stats_; }
+    void Clear();
+
+    // BlockModel のブロック境界から、単独でレンダリングしても結果が変わらない単位に分割する
+    // - 引用の直後の行（遅延継続行）や字下げされた行の前では分割しない
+    // - HTML ブロックの途中では分割しない
+    // - リンク参照定義がある文書は参照が単位をまたぐので分割しない
+    static std::vector<LineRange> SplitRenderUnits(
+        const std::vector<std::string>& lines,
+        const std::vector<std::shared_ptr<Block>>& blocks);
+
+    // [label]: destination 形式のリンク参照定義か
+    static bool IsLinkReferenceDefinition(const std::string& line);
+
+    // 高速な 64bit ハッシュ（8 バイト単位で混ぜる）
+    static uint64_t Hash(std::string_view data);
+
+private:
+    struct Entry {
+        uint64_t hash;
+        size_t source_size; // ハッシュ衝突の簡易チェック用
+        std::string fragment;
+    };
+
+    const MarkdownRenderer& renderer_;
+    const size_t memory_limit_;
+    // 先頭が最近使ったもの
+    std::list<Entry> lru_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> entries_;
+    size_t memory_usage_ = 0;
+    Stats stats_;
+
+    // ヒットしたら LRU の先頭へ移す
+    bool Lookup(const std::string& unit, uint64_t hash);
+    void EvictIfNeeded();
+};
+
+}
@@ -0,0 +1,136 @@
+#include "column_index.h"
+#include "utf8_util.h"
+#include <algorithm>
+
+namespace ShinoEditor {
+
+void ColumnIndex::Build(std::string_view line) {
+    checkpoints_.clear();
+    checkpoints_.reserve(line.size() / kCheckpointInterval + 1);
+    checkpoints_.push_back({0, 0});
+
+    size_t pos = 0;
+    size_t next_checkpoint = kCheckpointInterval;
+    int col = 0;
+    while (pos < line.size()) {
+        col += utf8::CodepointWidth(utf8::Decode(line, pos));
+        if (pos >= next_checkpoint && pos < line.size()) {
+            checkpoints_.push_back({pos, col});
+            next_checkpoint = pos + kCheckpointInterval;
+        }
+    }
+    total_cols_ = col;
+}
+
+ColumnIndex::Slice ColumnIndex::ColumnSlice(std::string_view line, int first_col, int width) const {
+    Slice out;
+    first_col = std::max(0, first_col);
+    if (width <= 0 || first_col >= total_cols_ || checkpoints_.empty()) {
+        out.begin = out.end = line.size();
+        return out;
+    }
+
+    // first_col 以前で最も近いチェックポイントから読み進める
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), first_col,
+        [](int c, const Checkpoint& cp) { return c < cp.col; });
+    --it;
+    size_t pos = it->byte;
+    int col = it->col;
+    while (pos < line.size()) {
+        size_t next = pos;
+        const int w = utf8::CodepointWidth(utf8::Decode(line, next));
+        if (col + w > first_col) {
+            if (col < first_col) {
+                // 全角文字の途中から始まる場合は文字を飛ばして空白で埋める
+                out.lead_padding = col + w - first_col;
+                pos = next;
+            }
+            break;
+        }
+        col += w;
+        pos = next;
+    }
+    out.begin = pos;
+
+    int used = out.lead_padding;
+    while (pos < line.size()) {
+        size_t next = pos;
+        const int w = utf8::CodepointWidth(utf8::Decode(line, next));
+        if (used + w > width) break;
+        used += w;
+        pos = next;
+    }
+    out.end = pos;
+    return out;
+}
+
+int ColumnIndex::ColumnOf(std::string_view line, size_t byte) const {
+    if (checkpoints_.empty()) return 0;
+    byte = std::min(byte, line.size());
+    // byte 以前で最も近いチェックポイントから読み進める
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), byte,
+        [](size_t b, const Checkpoint& cp) { return b < cp.byte; });
+    --it;
+    size_t pos = it->byte;
+    int col = it->col;
+    while (pos < byte) {
+        col += utf8::CodepointWidth(utf8::Decode(line, pos));
+    }
+    return col;
+}
+
+ColumnIndex::Slice ColumnIndex::TailSlice(std::string_view line, int width) {
+    Slice out;
+    size_t pos = line.size();
+    int used = 0;
+    while (pos > 0) {
+        const size_t prev = utf8::PrevBoundary(line, pos);
+        size_t p = prev;
+        const int w = utf8::CodepointWidth(utf8::Decode(line, p));
+        if (used + w > width) break;
+        used += w;
+        pos = prev;
+    }
+    out.begin = pos;
+    out.end = line.size();
+    return out;
+}
+
+ColumnIndexCache::ColumnIndexCache(const std::vector<std::string>& lines)
+    : lines_(lines), entries_(lines.size()) {}
+
+const ColumnIndex& ColumnIndexCache::Get(int real_line) {
+    static const ColumnIndex kEmpty;
+    if (entries_.size() != lines_.size()) InvalidateAll();
+    if (real_line < 0 || real_line >= static_cast<int>(entries_.size())) return kEmpty;
+    Entry& entry = entries_[real_line];
+    if (!entry.valid) {
+        entry.index.Build(lines_[real_line]);
+        entry.valid = true;
+    }
+    return entry.index;
+}
+
+void ColumnIndexCache::InvalidateLine(int real_line) {
+    if (real_line >= 0 && real_line < static_cast<int>(entries_.size())) {
+        entries_[real_line] = Entry{};
+    }
+}
+
+void ColumnIndexCache::InsertLines(int pos, int count) {
+    if (count <= 0) return;
+    pos = std::clamp(pos, 0, static_cast<int>(entries_.size()));
+    entries_.insert(entries_.begin() + pos, count, Entry{});
+}
+
+void ColumnIndexCache::EraseLines(int pos, int count) {
+    const int size = static_cast<int>(entries_.size());
+    if (count <= 0 || pos < 0 || pos >= size) return;
+    entries_.erase(entries_.begin() + pos, entries_.begin() + std::min(size, pos + count));
+}
+
+void ColumnIndexCache::InvalidateAll() {
+    entries_.assign(lines_.size(), Entry{});
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 1行分のバイトオフセット -> 表示桁の疎なチェックポイント索引
+// 長い行（base64 画像や minify された JSON など）でも、画面に入る桁の範囲だけを
+// 索引から O(log n + 間隔 + 幅) で切り出せるようにする
+class ColumnIndex {
+public:
+    // チェックポイントの間隔（バイト）
+    static constexpr size_t kCheckpointInterval = 4096;
+
+    struct Slice {
+        size_t begin = 0;     // 切り出し開始バイト
+        size_t end = 0;       // 切り出し終了バイト
+        int lead_padding = 0; // 左端で全角文字が切れたときに補う空白の桁数
+    };
+
+    void Build(std::string_view line);
+    int TotalColumns() const { return total_cols_; }
+
+    // 表示桁 [first_col, first_col + width) に収まる部分
+    Slice ColumnSlice(std::string_view line, int first_col, int width) const;
+
+    // バイトオフセット byte の文字が始まる表示桁（検索の一致位置へ横スクロールするときに使う）
+    int ColumnOf(std::string_view line, size_t byte) const;
+
+    // 末尾から width 桁に収まる部分（編集中の行の表示用、索引不要）
+    static Slice TailSlice(std::string_view line, int width);
+
+private:
+    struct Checkpoint {
+        size_t byte;
+        int col;
+    };
+    std::vector<Checkpoint> checkpoints_;
+    int total_cols_ = 0;
+};
+
+// 実行行ごとの ColumnIndex キャッシュ（描画された行だけ構築）
+class ColumnIndexCache {
+public:
+    // App::lines_ を参照で保持
+    explicit ColumnIndexCache(const std::vector<std::string>& lines);
+
+    const ColumnIndex& Get(int real_line);
+
+    // 編集通知（実行行インデックス）
+    void InvalidateLine(int real_line);
+    void InsertLines(int pos, int count);
+    void EraseLines(int pos, int count);
+    void InvalidateAll();
+
+private:
+    struct Entry {
+        bool valid = false;
+        ColumnIndex index;
+    };
+    const std::vector<std::string>& lines_;
+    std::vector<Entry> entries_;
+};
+
+}
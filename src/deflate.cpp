@@ -0,0 +1,821 @@
+#include "deflate.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ShinoEditor {
+
+namespace {
+// 長さ/距離の記号ごとの基数と追加ビット数（RFC 1951 3.2.5）
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// 符号長の符号の長さが並ぶ順
+constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+constexpr int kLiteralPrimaryBits = 10;
+constexpr int kDistancePrimaryBits = 8;
+constexpr int kCodeLengthPrimaryBits = 7;
+
+inline uint64_t LoadLE64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint32_t LoadLE32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+// DEFLATE の符号は上位ビットから詰めるので、下位ビットから読み書きするときは反転して使う
+inline uint32_t ReverseBits(uint32_t code, int len) {
+    uint32_t out = 0;
+    for (int i = 0; i < len; ++i) {
+        out = (out << 1) | (code & 1);
+        code >>= 1;
+    }
+    return out;
+}
+
+// 下位ビットから順に読む。末尾を越えた分は 0 で補い、補ったバイト数を overrun に数える
+struct BitReader {
+    const unsigned char* data;
+    size_t size;
+    size_t pos = 0;
+    uint64_t bits = 0;
+    int count = 0;
+    size_t overrun = 0;
+
+    // 少なくとも 56 ビットを持つ
+    void Refill() {
+        if (pos + 8 <= size) {
+            bits |= LoadLE64(data + pos) << count;
+            pos += static_cast<size_t>(63 - count) >> 3;
+            count |= 56;
+            return;
+        }
+        while (count <= 56) {
+            if (pos < size) {
+                bits |= static_cast<uint64_t>(data[pos++]) << count;
+            } else {
+                ++overrun;
+            }
+            count += 8;
+        }
+    }
+    void Consume(int n) {
+        bits >>= n;
+        count -= n;
+    }
+    // n <= 32。Refill 済みで足りることが分かっているとき
+    uint32_t TakeFast(int n) {
+        const auto v = static_cast<uint32_t>(bits & ((uint64_t(1) << n) - 1));
+        Consume(n);
+        return v;
+    }
+    uint32_t Take(int n) {
+        if (count < n) Refill();
+        return TakeFast(n);
+    }
+    // 補った 0 まで読んでしまった
+    bool Overran() const { return static_cast<size_t>(count) < overrun * 8; }
+};
+
+// 正規ハフマン符号の表引き
+// entries の先頭 1 << primary_bits 個が 1 段目（ビット順を反転した符号の下位ビットで引く）
+// 要素は 記号 | 読むビット数 << 16。0 は符号がない位置
+// primary_bits より長い符号は、1 段目の要素が 2 段目の表を指す（kSubtable | 位置 | 2 段目のビット数 << 16）
+class HuffmanTable {
+public:
+    static constexpr uint32_t kSubtable = 0x80000000u;
+
+    // 符号が多すぎる（長さの組が不正な）ときは false。足りないのは DEFLATE では許される
+    bool Build(const uint8_t* lengths, size_t count, int primary_bits) {
+        primary_bits_ = primary_bits;
+        uint16_t length_count[16] = {};
+        for (size_t i = 0; i < count; ++i) {
+            if (lengths[i] > 15) return false;
+            ++length_count[lengths[i]];
+        }
+        length_count[0] = 0;
+        int left = 1;
+        for (int len = 1; len <= 15; ++len) {
+            left = (left << 1) - length_count[len];
+            if (left < 0) return false;
+        }
+        uint16_t next_code[16] = {};
+        uint32_t code = 0;
+        for (int len = 1; len <= 15; ++len) {
+            code = (code + length_count[len - 1]) << 1;
+            next_code[len] = static_cast<uint16_t>(code);
+        }
+
+        const uint32_t primary_size = 1u << primary_bits;
+        const uint32_t primary_mask = primary_size - 1;
+        entries_.assign(primary_size, 0);
+        codes_.resize(count);
+        uint8_t sub_bits[1u << kLiteralPrimaryBits] = {};
+        bool has_long = false;
+        for (size_t s = 0; s < count; ++s) {
+            const int len = lengths[s];
+            if (len == 0) continue;
+            const uint32_t reversed = ReverseBits(next_code[len]++, len);
+            codes_[s] = static_cast<uint16_t>(reversed);
+            if (len <= primary_bits) {
+                for (uint32_t i = reversed; i < primary_size; i += 1u << len) {
+                    entries_[i] = static_cast<uint32_t>(s) | static_cast<uint32_t>(len) << 16;
+                }
+            } else {
+                uint8_t& bits = sub_bits[reversed & primary_mask];
+                bits = std::max<uint8_t>(bits, static_cast<uint8_t>(len - primary_bits));
+                has_long = true;
+            }
+        }
+        if (!has_long) return true;
+
+        for (uint32_t prefix = 0; prefix < primary_size; ++prefix) {
+            if (sub_bits[prefix] == 0) continue;
+            const auto offset = static_cast<uint32_t>(entries_.size());
+            entries_.resize(offset + (1u << sub_bits[prefix]), 0);
+            entries_[prefix] = kSubtable | offset | static_cast<uint32_t>(sub_bits[prefix]) << 16;
+        }
+        for (size_t s = 0; s < count; ++s) {
+            const int len = lengths[s];
+            if (len <= primary_bits) continue;
+            const uint32_t entry = entries_[codes_[s] & primary_mask];
+            const uint32_t offset = entry & 0xFFFF;
+            const uint32_t size = 1u << ((entry >> 16) & 0xFF);
+            const int rest = len - primary_bits;
+            for (uint32_t i = codes_[s] >> primary_bits; i < size; i += 1u << rest) {
+                entries_[offset + i] = static_cast<uint32_t>(s) | static_cast<uint32_t>(rest) << 16;
+            }
+        }
+        return true;
+    }
+
+    // 記号を 1 つ読む（15 ビット以上を持っていること）。符号がなければ -1
+    int Decode(BitReader& in) const {
+        uint32_t entry = entries_[in.bits & ((1u << primary_bits_) - 1)];
+        if (entry & kSubtable) {
+            in.Consume(primary_bits_);
+            const uint32_t mask = (1u << ((entry >> 16) & 0xFF)) - 1;
+            entry = entries_[(entry & 0xFFFF) + (in.bits & mask)];
+        }
+        const int len = static_cast<int>((entry >> 16) & 0xFF);
+        if (len == 0) return -1;
+        in.Consume(len);
+        return static_cast<int>(entry & 0xFFFF);
+    }
+
+private:
+    std::vector<uint32_t> entries_;
+    std::vector<uint16_t> codes_;
+    int primary_bits_ = 0;
+
+};
+
+struct FixedTables {
+    HuffmanTable literal;
+    HuffmanTable distance;
+    FixedTables() {
+        uint8_t lengths[288];
+        std::memset(lengths, 8, 144);
+        std::memset(lengths + 144, 9, 112);
+        std::memset(lengths + 256, 7, 24);
+        std::memset(lengths + 280, 8, 8);
+        literal.Build(lengths, 288, kLiteralPrimaryBits);
+        std::memset(lengths, 5, 30);
+        distance.Build(lengths, 30, kDistancePrimaryBits);
+    }
+};
+
+const FixedTables& GetFixedTables() {
+    static const FixedTables tables;
+    return tables;
+}
+
+// 動的ハフマンのブロックの先頭から、リテラル/長さと距離の表を作る
+bool ReadDynamicTables(BitReader& in, HuffmanTable& literal, HuffmanTable& distance, HuffmanTable& code_length) {
+    in.Refill();
+    const uint32_t literal_count = in.TakeFast(5) + 257;
+    const uint32_t distance_count = in.TakeFast(5) + 1;
+    const uint32_t code_length_count = in.TakeFast(4) + 4;
+    if (literal_count > 286 || distance_count > 30) return false;
+
+    uint8_t code_lengths[19] = {};
+    for (uint32_t i = 0; i < code_length_count; ++i) code_lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(in.Take(3));
+    if (!code_length.Build(code_lengths, 19, kCodeLengthPrimaryBits)) return false;
+
+    uint8_t lengths[286 + 30] = {};
+    const uint32_t total = literal_count + distance_count;
+    uint32_t i = 0;
+    while (i < total) {
+        in.Refill();
+        const int symbol = code_length.Decode(in);
+        if (symbol < 0) return false;
+        if (symbol < 16) {
+            lengths[i++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        uint8_t value = 0;
+        uint32_t repeat = 0;
+        if (symbol == 16) {
+            if (i == 0) return false;
+            value = lengths[i - 1];
+            repeat = 3 + in.TakeFast(2);
+        } else if (symbol == 17) {
+            repeat = 3 + in.TakeFast(3);
+        } else {
+            repeat = 11 + in.TakeFast(7);
+        }
+        if (i + repeat > total) return false;
+        std::memset(lengths + i, value, repeat);
+        i += repeat;
+    }
+    if (in.Overran() || lengths[256] == 0) return false;
+    return literal.Build(lengths, literal_count, kLiteralPrimaryBits) &&
+           distance.Build(lengths + literal_count, distance_count, kDistancePrimaryBits);
+}
+
+struct CrcTables {
+    uint32_t table[8][256];
+    CrcTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[0][i] = c;
+        }
+        for (int t = 1; t < 8; ++t) {
+            for (uint32_t i = 0; i < 256; ++i) {
+                table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+// 圧縮側
+constexpr int kHashBits = 15;
+constexpr size_t kMaxMatch = 258;
+// 一致を探すときに先を読む分（最長の一致 + ハッシュの 4 バイト）
+constexpr size_t kLookahead = kMaxMatch + 4;
+// 辿るハッシュの連鎖の長さと、探すのをやめる一致の長さ
+constexpr int kMaxChain = 8;
+constexpr size_t kNiceMatch = 128;
+constexpr size_t kNone = SIZE_MAX;
+constexpr uint32_t kMatchFlag = 0x80000000u;
+constexpr size_t kOutputFlushBytes = 64 << 10;
+
+inline uint32_t Hash4(const unsigned char* p) {
+    return (LoadLE32(p) * 2654435761u) >> (32 - kHashBits);
+}
+
+// a と b が先頭から何バイト一致するか（limit まで）
+inline size_t MatchLength(const unsigned char* a, const unsigned char* b, size_t limit) {
+    size_t n = 0;
+    while (n + 8 <= limit) {
+        const uint64_t diff = LoadLE64(a + n) ^ LoadLE64(b + n);
+        if (diff != 0) return n + static_cast<size_t>(std::countr_zero(diff)) / 8;
+        n += 8;
+    }
+    while (n < limit && a[n] == b[n]) ++n;
+    return n;
+}
+
+// 長さ - 3（0..255）から長さの記号 - 257 へ
+struct LengthCodes {
+    uint8_t code[256];
+    LengthCodes() {
+        for (int c = 0; c < 28; ++c) {
+            for (int k = 0; k < (1 << kLengthExtra[c]); ++k) code[kLengthBase[c] - 3 + k] = static_cast<uint8_t>(c);
+        }
+        code[255] = 28;
+    }
+};
+
+const LengthCodes& GetLengthCodes() {
+    static const LengthCodes codes;
+    return codes;
+}
+
+// 距離 - 1（0..32767）から距離の記号へ
+inline int DistanceCode(uint32_t x) {
+    if (x < 4) return static_cast<int>(x);
+    const int bits = std::bit_width(x) - 1;
+    return bits * 2 + static_cast<int>((x >> (bits - 1)) & 1);
+}
+
+// 頻度から符号長を作る。使わない記号は 0
+// 普通にハフマン木を作り、limit を超えた葉を limit に詰めてから、Kraft の和がちょうど 1 になるまで
+// limit より浅い葉を 1 段ずつ深くする（inflate は過不足のある符号を受け付けないことがある）
+void BuildLengths(const uint32_t* freq, int count, int limit, uint8_t* lengths) {
+    std::memset(lengths, 0, static_cast<size_t>(count));
+    int used[288];
+    int n = 0;
+    for (int s = 0; s < count; ++s) {
+        if (freq[s] != 0) used[n++] = s;
+    }
+    if (n == 0) return;
+    if (n == 1) {
+        lengths[used[0]] = 1;
+        return;
+    }
+    std::sort(used, used + n, [freq](int a, int b) { return freq[a] != freq[b] ? freq[a] < freq[b] : a < b; });
+
+    // 0..n-1 が葉（重みの小さい順）、n.. が内部節点（作った順 = 重みの小さい順）。2 つの列の先頭の小さい方を取る
+    uint64_t weight[2 * 288];
+    int parent[2 * 288];
+    for (int i = 0; i < n; ++i) weight[i] = freq[used[i]];
+    int leaf = 0;
+    int node = n;
+    auto take = [&](int next) {
+        if (leaf < n && (node >= next || weight[leaf] <= weight[node])) return leaf++;
+        return node++;
+    };
+    const int root = 2 * n - 2;
+    for (int next = n; next <= root; ++next) {
+        const int a = take(next);
+        const int b = take(next);
+        weight[next] = weight[a] + weight[b];
+        parent[a] = parent[b] = next;
+    }
+    int depth[2 * 288];
+    depth[root] = 0;
+    for (int i = root - 1; i >= 0; --i) depth[i] = depth[parent[i]] + 1;
+
+    int length_count[16] = {};
+    for (int i = 0; i < n; ++i) ++length_count[std::min(depth[i], limit)];
+    uint64_t kraft = 0;
+    for (int len = 1; len <= limit; ++len) kraft += static_cast<uint64_t>(length_count[len]) << (limit - len);
+    while (kraft > (uint64_t(1) << limit)) {
+        int bits = limit - 1;
+        while (length_count[bits] == 0) --bits;
+        --length_count[bits];
+        length_count[bits + 1] += 2;
+        --length_count[limit];
+        --kraft;
+    }
+    // 頻度の小さい記号から長い符号を割り当てる
+    int len = limit;
+    for (int i = 0; i < n; ++i) {
+        while (length_count[len] == 0) --len;
+        lengths[used[i]] = static_cast<uint8_t>(len);
+        --length_count[len];
+    }
+}
+
+// 符号長から正規ハフマン符号を作る（下位ビットから書くので反転済み）
+void BuildCodes(const uint8_t* lengths, int count, uint16_t* codes) {
+    uint16_t length_count[16] = {};
+    for (int s = 0; s < count; ++s) ++length_count[lengths[s]];
+    length_count[0] = 0;
+    uint16_t next_code[16] = {};
+    uint32_t code = 0;
+    for (int len = 1; len <= 15; ++len) {
+        code = (code + length_count[len - 1]) << 1;
+        next_code[len] = static_cast<uint16_t>(code);
+    }
+    for (int s = 0; s < count; ++s) {
+        codes[s] = lengths[s] ? static_cast<uint16_t>(ReverseBits(next_code[lengths[s]]++, lengths[s])) : 0;
+    }
+}
+
+struct FixedCodes {
+    uint8_t literal_lengths[288];
+    uint16_t literal_codes[288];
+    uint8_t distance_lengths[30];
+    uint16_t distance_codes[30];
+    FixedCodes() {
+        std::memset(literal_lengths, 8, 144);
+        std::memset(literal_lengths + 144, 9, 112);
+        std::memset(literal_lengths + 256, 7, 24);
+        std::memset(literal_lengths + 280, 8, 8);
+        BuildCodes(literal_lengths, 288, literal_codes);
+        std::memset(distance_lengths, 5, 30);
+        BuildCodes(distance_lengths, 30, distance_codes);
+    }
+};
+
+const FixedCodes& GetFixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+}
+
+bool Inflater::Inflate(std::string_view input, const std::function<bool(std::string_view)>& on_output) {
+    BitReader in{reinterpret_cast<const unsigned char*>(input.data()), input.size()};
+    // 窓（直前の 32KB）+ 溜める分 + 1 記号で増える最大（258）
+    constexpr size_t kFlushAt = kWindowBytes + kFlushBytes;
+    const std::unique_ptr<char[]> buffer(new char[kFlushAt + 258]);
+    char* const out = buffer.get();
+    size_t n = 0;
+    // 窓の分を残して渡す（残した分は次に渡す）
+    auto flush = [&]() {
+        if (!on_output(std::string_view(out, n - kWindowBytes))) return false;
+        std::memmove(out, out + n - kWindowBytes, kWindowBytes);
+        n = kWindowBytes;
+        return true;
+    };
+
+    HuffmanTable dynamic_literal, dynamic_distance, code_length;
+    bool last = false;
+    while (!last) {
+        last = in.Take(1) != 0;
+        const uint32_t type = in.Take(2);
+        if (type == 0) {
+            // 格納ブロック: バイト境界に揃え、読み込み済みのバイトを戻してからそのまま写す
+            in.Consume(in.count & 7);
+            const uint32_t length = in.Take(16);
+            const uint32_t check = in.Take(16);
+            if (in.Overran() || (length ^ 0xFFFF) != check) return false;
+            const size_t buffered = static_cast<size_t>(in.count) / 8 - in.overrun;
+            in.pos -= buffered;
+            in.bits = 0;
+            in.count = 0;
+            in.overrun = 0;
+            if (length > in.size - in.pos) return false;
+            size_t remaining = length;
+            while (remaining > 0) {
+                if (n >= kFlushAt && !flush()) return false;
+                const size_t take = std::min(remaining, kFlushAt + 258 - n);
+                std::memcpy(out + n, in.data + in.pos, take);
+                n += take;
+                in.pos += take;
+                remaining -= take;
+            }
+            continue;
+        }
+        if (type == 3) return false;
+        const HuffmanTable* literal = &GetFixedTables().literal;
+        const HuffmanTable* distance = &GetFixedTables().distance;
+        if (type == 2) {
+            if (!ReadDynamicTables(in, dynamic_literal, dynamic_distance, code_length)) return false;
+            literal = &dynamic_literal;
+            distance = &dynamic_distance;
+        }
+
+        for (;;) {
+            if (n >= kFlushAt && !flush()) return false;
+            // 長さの記号と追加ビット、距離の記号と追加ビットで最大 48 ビット
+            if (in.count < 48) {
+                in.Refill();
+                // 壊れたデータで末尾を越えて読み続けない
+                if (in.overrun > 8) return false;
+            }
+            const int symbol = literal->Decode(in);
+            if (symbol < 256) {
+                if (symbol < 0) return false;
+                out[n++] = static_cast<char>(symbol);
+                continue;
+            }
+            if (symbol == 256) break;
+            const int length_index = symbol - 257;
+            if (length_index >= 29) return false;
+            const size_t length = kLengthBase[length_index] + in.TakeFast(kLengthExtra[length_index]);
+            const int distance_index = distance->Decode(in);
+            if (distance_index < 0 || distance_index >= 30) return false;
+            const size_t dist = kDistanceBase[distance_index] + in.TakeFast(kDistanceExtra[distance_index]);
+            if (dist > n) return false;
+
+            char* dst = out + n;
+            const char* src = dst - dist;
+            if (dist >= length) {
+                std::memcpy(dst, src, length);
+            } else if (dist == 1) {
+                std::memset(dst, *src, length);
+            } else {
+                // 重なる写しは前から 1 バイトずつ（繰り返しになる）
+                for (size_t i = 0; i < length; ++i) dst[i] = src[i];
+            }
+            n += length;
+        }
+        if (in.Overran()) return false;
+    }
+    return n == 0 || on_output(std::string_view(out, n));
+}
+
+Deflater::Deflater(std::function<void(std::string_view)> on_output)
+    : on_output_(std::move(on_output)),
+      buffer_(2 * (kWindowBytes + kBlockBytes)),
+      head_(size_t(1) << kHashBits, kNone),
+      prev_(kWindowBytes, kNone) {
+    tokens_.reserve(kBlockBytes + kMaxMatch);
+}
+
+void Deflater::Write(std::string_view data) {
+    bytes_in_ += data.size();
+    while (!data.empty()) {
+        if (size_ == buffer_.size()) {
+            Compress(false);
+            // 窓（直前の 32KB）と書きかけのブロックだけを残して前に詰める
+            const size_t keep_from = std::min(block_start_, pos_ > kWindowBytes ? pos_ - kWindowBytes : 0);
+            std::memmove(buffer_.data(), buffer_.data() + keep_from, size_ - keep_from);
+            size_ -= keep_from;
+            pos_ -= keep_from;
+            block_start_ -= keep_from;
+            base_ += keep_from;
+        }
+        const size_t take = std::min(data.size(), buffer_.size() - size_);
+        std::memcpy(buffer_.data() + size_, data.data(), take);
+        size_ += take;
+        data.remove_prefix(take);
+    }
+}
+
+void Deflater::Finish() {
+    Compress(true);
+    AlignToByte();
+    FlushOutput(true);
+}
+
+void Deflater::Compress(bool finishing) {
+    // 最後でなければ、最長の一致を探せるだけ先を残す
+    const size_t limit = finishing ? size_ : (size_ > kLookahead ? size_ - kLookahead : 0);
+    const unsigned char* data = buffer_.data();
+    const auto& length_codes = GetLengthCodes().code;
+    auto insert = [this, data](size_t at) {
+        const uint32_t h = Hash4(data + at);
+        const size_t position = base_ + at;
+        prev_[position & (kWindowBytes - 1)] = head_[h];
+        head_[h] = position;
+    };
+    while (pos_ < limit) {
+        if (pos_ - block_start_ >= kBlockBytes) EmitBlock(false);
+        const size_t avail = std::min(kMaxMatch, size_ - pos_);
+        if (avail < 4) {
+            tokens_.push_back(data[pos_]);
+            ++literal_freq_[data[pos_++]];
+            continue;
+        }
+        const unsigned char* here = data + pos_;
+        const size_t position = base_ + pos_;
+        size_t best_length = 3;
+        size_t best_distance = 0;
+        size_t candidate = head_[Hash4(here)];
+        for (int chain = kMaxChain; chain > 0 && candidate != kNone && position - candidate < kWindowBytes; --chain) {
+            const unsigned char* match = data + (candidate - base_);
+            if (match[best_length] == here[best_length] && LoadLE32(match) == LoadLE32(here)) {
+                const size_t length = MatchLength(match, here, avail);
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = position - candidate;
+                    if (length >= kNiceMatch || length == avail) break;
+                }
+            }
+            const size_t next = prev_[candidate & (kWindowBytes - 1)];
+            // 窓を一周して上書きされた位置は辿らない
+            if (next >= candidate) break;
+            candidate = next;
+        }
+        insert(pos_);
+        if (best_distance == 0) {
+            tokens_.push_back(*here);
+            ++literal_freq_[*here];
+            ++pos_;
+            continue;
+        }
+        const uint32_t length_index = static_cast<uint32_t>(best_length - 3);
+        const uint32_t distance_index = static_cast<uint32_t>(best_distance - 1);
+        tokens_.push_back(kMatchFlag | length_index << 16 | distance_index);
+        ++literal_freq_[257 + length_codes[length_index]];
+        ++distance_freq_[DistanceCode(distance_index)];
+        // 一致の中の位置もハッシュに入れる
+        const size_t end = pos_ + best_length;
+        for (size_t at = pos_ + 1; at < end && at + 4 <= size_; ++at) insert(at);
+        pos_ = end;
+    }
+    if (finishing) EmitBlock(true);
+}
+
+void Deflater::EmitBlock(bool last) {
+    const unsigned char* data = buffer_.data() + block_start_;
+    const size_t size = pos_ - block_start_;
+    literal_freq_[256] = 1;
+
+    // 動的ハフマンの表。距離の符号は少なくとも 2 つ作る（1 つだけの符号を受け付けない inflate がある）
+    uint32_t distance_freq[30];
+    std::memcpy(distance_freq, distance_freq_, sizeof(distance_freq));
+    int distance_used = 0;
+    for (uint32_t f : distance_freq) distance_used += f != 0;
+    for (int s = 0; distance_used < 2; ++s) {
+        if (distance_freq[s] == 0) {
+            distance_freq[s] = 1;
+            ++distance_used;
+        }
+    }
+    uint8_t literal_lengths[286];
+    uint8_t distance_lengths[30];
+    BuildLengths(literal_freq_, 286, 15, literal_lengths);
+    BuildLengths(distance_freq, 30, 15, distance_lengths);
+    int literal_count = 286;
+    while (literal_count > 257 && literal_lengths[literal_count - 1] == 0) --literal_count;
+    int distance_count = 30;
+    while (distance_count > 1 && distance_lengths[distance_count - 1] == 0) --distance_count;
+
+    // 符号長の並びを連長で縮める（16: 直前を 3-6 回、17: 0 を 3-10 回、18: 0 を 11-138 回）
+    uint8_t all_lengths[286 + 30];
+    std::memcpy(all_lengths, literal_lengths, static_cast<size_t>(literal_count));
+    std::memcpy(all_lengths + literal_count, distance_lengths, static_cast<size_t>(distance_count));
+    const int total = literal_count + distance_count;
+    uint8_t runs[286 + 30];
+    uint8_t run_extra[286 + 30];
+    int run_count = 0;
+    uint32_t code_length_freq[19] = {};
+    auto push = [&](int symbol, int extra) {
+        runs[run_count] = static_cast<uint8_t>(symbol);
+        run_extra[run_count++] = static_cast<uint8_t>(extra);
+        ++code_length_freq[symbol];
+    };
+    for (int i = 0; i < total;) {
+        const uint8_t value = all_lengths[i];
+        int run = 1;
+        while (i + run < total && all_lengths[i + run] == value) ++run;
+        i += run;
+        if (value == 0) {
+            while (run >= 11) {
+                const int take = std::min(run, 138);
+                push(18, take - 11);
+                run -= take;
+            }
+            if (run >= 3) {
+                push(17, run - 3);
+                run = 0;
+            }
+        } else {
+            push(value, 0);
+            --run;
+            while (run >= 3) {
+                const int take = std::min(run, 6);
+                push(16, take - 3);
+                run -= take;
+            }
+        }
+        for (; run > 0; --run) push(value, 0);
+    }
+    uint8_t code_length_lengths[19];
+    BuildLengths(code_length_freq, 19, 7, code_length_lengths);
+    int code_length_count = 19;
+    while (code_length_count > 4 && code_length_lengths[kCodeLengthOrder[code_length_count - 1]] == 0) {
+        --code_length_count;
+    }
+
+    // それぞれの大きさ（ビット）を比べる
+    const auto& fixed = GetFixedCodes();
+    uint64_t extra_bits = 0;
+    uint64_t dynamic_bits = 3 + 5 + 5 + 4 + 3 * static_cast<uint64_t>(code_length_count);
+    uint64_t fixed_bits = 3;
+    for (int s = 0; s < 286; ++s) {
+        dynamic_bits += static_cast<uint64_t>(literal_freq_[s]) * literal_lengths[s];
+        fixed_bits += static_cast<uint64_t>(literal_freq_[s]) * fixed.literal_lengths[s];
+        if (s >= 257) extra_bits += static_cast<uint64_t>(literal_freq_[s]) * kLengthExtra[s - 257];
+    }
+    for (int s = 0; s < 30; ++s) {
+        dynamic_bits += static_cast<uint64_t>(distance_freq_[s]) * distance_lengths[s];
+        fixed_bits += static_cast<uint64_t>(distance_freq_[s]) * 5;
+        extra_bits += static_cast<uint64_t>(distance_freq_[s]) * kDistanceExtra[s];
+    }
+    for (int i = 0; i < run_count; ++i) {
+        dynamic_bits += code_length_lengths[runs[i]];
+        dynamic_bits += runs[i] == 16 ? 2 : runs[i] == 17 ? 3 : runs[i] == 18 ? 7 : 0;
+    }
+    dynamic_bits += extra_bits;
+    fixed_bits += extra_bits;
+    // 格納は 65535 バイトごとに見出し（3 ビット + 揃え + 長さ 4 バイト）
+    const uint64_t stored_bits = (size / 65535 + 1) * (3 + 7 + 32) + 8 * static_cast<uint64_t>(size);
+
+    if (stored_bits < dynamic_bits && stored_bits < fixed_bits) {
+        EmitStored(data, size, last);
+    } else {
+        const uint8_t* literal_length = fixed.literal_lengths;
+        const uint16_t* literal_code = fixed.literal_codes;
+        const uint8_t* distance_length = fixed.distance_lengths;
+        const uint16_t* distance_code = fixed.distance_codes;
+        uint16_t literal_codes[286];
+        uint16_t distance_codes[30];
+        if (dynamic_bits < fixed_bits) {
+            PutBits(last ? 1 : 0, 1);
+            PutBits(2, 2);
+            PutBits(static_cast<uint32_t>(literal_count - 257), 5);
+            PutBits(static_cast<uint32_t>(distance_count - 1), 5);
+            PutBits(static_cast<uint32_t>(code_length_count - 4), 4);
+            for (int i = 0; i < code_length_count; ++i) PutBits(code_length_lengths[kCodeLengthOrder[i]], 3);
+            uint16_t code_length_codes[19];
+            BuildCodes(code_length_lengths, 19, code_length_codes);
+            for (int i = 0; i < run_count; ++i) {
+                PutBits(code_length_codes[runs[i]], code_length_lengths[runs[i]]);
+                if (runs[i] >= 16) PutBits(run_extra[i], runs[i] == 16 ? 2 : runs[i] == 17 ? 3 : 7);
+            }
+            BuildCodes(literal_lengths, 286, literal_codes);
+            BuildCodes(distance_lengths, 30, distance_codes);
+            literal_length = literal_lengths;
+            literal_code = literal_codes;
+            distance_length = distance_lengths;
+            distance_code = distance_codes;
+        } else {
+            PutBits(last ? 1 : 0, 1);
+            PutBits(1, 2);
+        }
+        const auto& length_codes = GetLengthCodes().code;
+        for (const uint32_t token : tokens_) {
+            if (!(token & kMatchFlag)) {
+                PutBits(literal_code[token], literal_length[token]);
+                continue;
+            }
+            const uint32_t length_index = (token >> 16) & 0xFF;
+            const int length_code = length_codes[length_index];
+            PutBits(literal_code[257 + length_code], literal_length[257 + length_code]);
+            if (kLengthExtra[length_code]) {
+                PutBits(length_index + 3 - kLengthBase[length_code], kLengthExtra[length_code]);
+            }
+            const uint32_t distance_index = token & 0xFFFF;
+            const int code = DistanceCode(distance_index);
+            PutBits(distance_code[code], distance_length[code]);
+            if (kDistanceExtra[code]) PutBits(distance_index + 1 - kDistanceBase[code], kDistanceExtra[code]);
+        }
+        PutBits(literal_code[256], literal_length[256]);
+    }
+
+    tokens_.clear();
+    std::memset(literal_freq_, 0, sizeof(literal_freq_));
+    std::memset(distance_freq_, 0, sizeof(distance_freq_));
+    block_start_ = pos_;
+    FlushOutput(false);
+}
+
+void Deflater::EmitStored(const unsigned char* data, size_t size, bool last) {
+    do {
+        const size_t chunk = std::min<size_t>(size, 65535);
+        PutBits(last && chunk == size ? 1 : 0, 1);
+        PutBits(0, 2);
+        AlignToByte();
+        const char header[4] = {static_cast<char>(chunk & 0xFF), static_cast<char>(chunk >> 8),
+                                static_cast<char>(~chunk & 0xFF), static_cast<char>((~chunk >> 8) & 0xFF)};
+        out_.append(header, 4);
+        out_.append(reinterpret_cast<const char*>(data), chunk);
+        data += chunk;
+        size -= chunk;
+    } while (size > 0);
+}
+
+void Deflater::PutBits(uint32_t value, int count) {
+    bits_ |= static_cast<uint64_t>(value) << bit_count_;
+    bit_count_ += count;
+    if (bit_count_ >= 32) {
+        const char bytes[4] = {static_cast<char>(bits_ & 0xFF), static_cast<char>((bits_ >> 8) & 0xFF),
+                               static_cast<char>((bits_ >> 16) & 0xFF), static_cast<char>((bits_ >> 24) & 0xFF)};
+        out_.append(bytes, 4);
+        bits_ >>= 32;
+        bit_count_ -= 32;
+    }
+}
+
+void Deflater::AlignToByte() {
+    for (; bit_count_ > 0; bit_count_ -= 8) {
+        out_ += static_cast<char>(bits_ & 0xFF);
+        bits_ >>= 8;
+    }
+    bits_ = 0;
+    bit_count_ = 0;
+}
+
+void Deflater::FlushOutput(bool all) {
+    if (out_.empty() || (!all && out_.size() < kOutputFlushBytes)) return;
+    on_output_(out_);
+    out_.clear();
+}
+
+uint32_t Crc32(std::string_view data, uint32_t crc) {
+    static const CrcTables tables;
+    const auto& t = tables.table;
+    const auto* p = reinterpret_cast<const unsigned char*>(data.data());
+    size_t size = data.size();
+    crc = ~crc;
+    // 8 バイトずつ表を 8 枚引く（slicing-by-8）
+    while (size >= 8) {
+        const uint32_t a = LoadLE32(p) ^ crc;
+        const uint32_t b = LoadLE32(p + 4);
+        crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^ t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24] ^
+              t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^ t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// raw DEFLATE（RFC 1951、ZIP の圧縮方式 8）の展開
+// - 符号は表引き（短い符号は 1 回、長い符号は 2 段目の表）で復号し、ビットは 64bit ずつ読み込む
+// - 展開した分は kFlushBytes ほど溜まるごとに on_output に渡す（直前の 32KB の窓だけを持つので、
+//   展開後の大きさによらずメモリは一定）
+class Inflater {
+public:
+    static constexpr size_t kWindowBytes = 32 << 10;
+    static constexpr size_t kFlushBytes = 256 << 10;
+
+    // input 全体を展開する。データが壊れているか、on_output が false を返したら false
+    static bool Inflate(std::string_view input, const std::function<bool(std::string_view)>& on_output);
+};
+
+// raw DEFLATE の圧縮（ZIP の方式 8 で書き出す用）
+// - 4 バイトのハッシュの連鎖を短く辿る貪欲な一致探し（速さ優先。窓は 32KB）
+// - 入力 kBlockBytes ごとに 1 ブロックにまとめ、動的ハフマン・固定ハフマン・格納のうち一番小さいものを選ぶ
+// - 窓と書きかけのブロックだけを持つので、入力の大きさによらずメモリは一定
+class Deflater {
+public:
+    static constexpr size_t kWindowBytes = 32 << 10;
+    static constexpr size_t kBlockBytes = 64 << 10;
+
+    // 圧縮した分はある程度溜まるごとに on_output に渡す
+    explicit Deflater(std::function<void(std::string_view)> on_output);
+
+    Deflater(const Deflater&) = delete;
+    Deflater& operator=(const Deflater&) = delete;
+
+    void Write(std::string_view data);
+    // 最後のブロックを書いて残りを渡す（この後は Write しない）
+    void Finish();
+
+    size_t BytesIn() const { return bytes_in_; }
+
+private:
+    std::function<void(std::string_view)> on_output_;
+    // buffer_[0] はストリームの先頭から base_ バイト目
+    std::vector<unsigned char> buffer_;
+    size_t size_ = 0;
+    size_t base_ = 0;
+    size_t pos_ = 0;         // 次に一致を探す位置（buffer_ の中の位置）
+    size_t block_start_ = 0; // 書きかけのブロックの先頭（buffer_ の中の位置）
+    size_t bytes_in_ = 0;
+    // ハッシュごとの最新の位置と、位置ごとに 1 つ前の同じハッシュの位置（どちらもストリームの先頭からの位置）
+    std::vector<size_t> head_;
+    std::vector<size_t> prev_;
+    // リテラルか、一致（最上位ビット | 長さ - 3 << 16 | 距離 - 1）
+    std::vector<uint32_t> tokens_;
+    uint32_t literal_freq_[286] = {};
+    uint32_t distance_freq_[30] = {};
+    // 書き出し
+    std::string out_;
+    uint64_t bits_ = 0;
+    int bit_count_ = 0;
+
+    void Compress(bool finishing);
+    void EmitBlock(bool last);
+    void EmitStored(const unsigned char* data, size_t size, bool last);
+    void PutBits(uint32_t value, int count);
+    void AlignToByte();
+    void FlushOutput(bool all);
+};
+
+// CRC-32（ZIP/gzip の多項式）。crc に続けて計算する（最初は 0）
+uint32_t Crc32(std::string_view data, uint32_t crc = 0);
+
+}
@@ -0,0 +1,291 @@
+#include "directory_search.h"
+#include "bounded_queue.h"
+#include "error_handler.h"
+#include "mapped_file.h"
+#include "regex_search.h"
+#include "text_search.h"
+#include "thread_pool.h"
+#include "utf8_util.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <utility>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ShinoEditor {
+
+namespace fs = std::filesystem;
+
+namespace {
+#ifndef _WIN32
+// ファイル全体を buffer に読み込む（buffer はスレッドごとに使い回す）
+bool ReadWhole(const std::string& path, size_t size, std::string& buffer) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    buffer.resize(size);
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = ::read(fd, buffer.data() + done, size - done);
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    // 辿ってから縮んだファイルは読めた分だけ
+    buffer.resize(done);
+    return true;
+}
+#endif
+
+// 一致を含む行から一覧用の抜き出しを作る（長い行は一致の前後 context バイトだけ、文字の途中では切らない）
+void SetPreview(std::string_view row, size_t offset, size_t length, size_t context, DirectorySearch::Match& match) {
+    size_t begin = offset > context ? offset - context : 0;
+    size_t end = std::min(row.size(), offset + length + context);
+    while (begin > 0 && (static_cast<unsigned char>(row[begin]) & 0xC0) == 0x80) --begin;
+    while (end < row.size() && (static_cast<unsigned char>(row[end]) & 0xC0) == 0x80) ++end;
+    match.preview.assign(row.substr(begin, end - begin));
+    match.preview_offset = offset - begin;
+}
+
+// 行番号の昇順の一致に、行の内容から抜き出しを付けて out に足す
+void AddMatches(std::string_view text, const std::vector<SearchMatch>& found, size_t context,
+                std::vector<DirectorySearch::Match>& out) {
+    int line = 0;
+    size_t line_start = 0;
+    for (const SearchMatch& m : found) {
+        while (line < m.line) {
+            const void* newline = std::memchr(text.data() + line_start, '\n', text.size() - line_start);
+            if (!newline) break;
+            line_start = static_cast<size_t>(static_cast<const char*>(newline) - text.data()) + 1;
+            ++line;
+        }
+        size_t line_end = text.find('\n', line_start);
+        if (line_end == std::string_view::npos) line_end = text.size();
+        if (line_end > line_start && text[line_end - 1] == '\r') --line_end;
+        DirectorySearch::Match match;
+        match.line = m.line;
+        match.offset = m.offset;
+        match.length = m.length;
+        SetPreview(text.substr(line_start, line_end - line_start), m.offset, m.length, context, match);
+        out.push_back(std::move(match));
+    }
+}
+}
+
+DirectorySearch::DirectorySearch(std::function<void()> on_update) : on_update_(std::move(on_update)) {}
+
+DirectorySearch::~DirectorySearch() {
+    Cancel();
+}
+
+bool DirectorySearch::LooksBinary(std::string_view head) {
+    if (std::memchr(head.data(), '\0', head.size())) return true;
+    // 末尾で切れた文字は数えない。不正なバイトが 1/32 を超えれば UTF-8 のテキストではない
+    size_t invalid = 0;
+    size_t pos = 0;
+    while (pos < head.size()) {
+        // ASCII の並びは 8 バイトずつ飛ばす
+        uint64_t word;
+        if (pos + sizeof(word) <= head.size()) {
+            std::memcpy(&word, head.data() + pos, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0) {
+                pos += sizeof(word);
+                continue;
+            }
+        }
+        const size_t start = pos;
+        if (start + utf8::SequenceLength(static_cast<unsigned char>(head[start])) > head.size()) break;
+        if (utf8::Decode(head, pos) == U'\uFFFD' && pos - start == 1) ++invalid;
+    }
+    return invalid * 32 > head.size();
+}
+
+void DirectorySearch::Start(const Options& options) {
+    Cancel();
+    std::error_code ec;
+    if (!fs::is_directory(options.root, ec)) {
+        error::ThrowFileNotFound(options.root.string());
+    }
+    // 構文エラーはここで（呼び出しスレッドで）知らせる
+    if (options.regex) RegexSearcher check(options.query);
+
+    cancel_ = false;
+    done_ = false;
+    truncated_ = false;
+    files_scanned_ = 0;
+    files_skipped_ = 0;
+    bytes_scanned_ = 0;
+    matches_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        files_matched_ = 0;
+    }
+    coordinator_ = std::thread(&DirectorySearch::Run, this, options);
+}
+
+void DirectorySearch::Cancel() {
+    cancel_ = true;
+    if (coordinator_.joinable()) coordinator_.join();
+}
+
+size_t DirectorySearch::Poll(std::vector<Match>& matches, std::vector<std::string>& files) {
+    std::vector<FileResult> results;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        results.swap(pending_);
+    }
+    size_t added = 0;
+    for (auto& result : results) {
+        const auto file = static_cast<uint32_t>(files.size());
+        files.push_back(std::move(result.path));
+        for (auto& match : result.matches) {
+            match.file = file;
+            matches.push_back(std::move(match));
+            ++added;
+        }
+    }
+    return added;
+}
+
+DirectorySearch::Progress DirectorySearch::GetProgress() const {
+    Progress progress;
+    progress.files_scanned = files_scanned_;
+    progress.files_skipped = files_skipped_;
+    progress.bytes_scanned = bytes_scanned_;
+    progress.matches = matches_;
+    progress.done = done_;
+    progress.truncated = truncated_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    progress.files_matched = files_matched_;
+    return progress;
+}
+
+void DirectorySearch::Run(Options options) {
+    const size_t workers = options.workers > 0 ? options.workers : ThreadPool::DefaultThreadCount();
+    // 文字列検索の検索器は読み取りだけなので共有し、正規表現（DFA を作りながら探す）はスレッドごとに持つ
+    std::optional<SubstringSearcher> literal;
+    if (!options.regex) literal.emplace(options.query);
+
+    // (相対パス, 大きさ)
+    BoundedQueue<std::pair<fs::path, size_t>> paths(workers * 16);
+    auto worker = [&] {
+        std::unique_ptr<RegexSearcher> regex;
+        if (options.regex) regex = std::make_unique<RegexSearcher>(options.query);
+        std::string buffer;
+        while (auto item = paths.Pop()) {
+            // 止めるときも、辿る側が Push で待たないようにキューは空にする
+            if (cancel_) continue;
+            SearchFile(options, item->first, item->second, literal ? &*literal : nullptr, regex.get(), buffer);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers; ++i) threads.emplace_back(worker);
+
+    // ディレクトリを辿って渡す（このスレッド）
+    std::error_code ec;
+    const auto walk_options = fs::directory_options::skip_permission_denied;
+    for (fs::recursive_directory_iterator it(options.root, walk_options, ec), end; !ec && it != end && !cancel_;
+         it.increment(ec)) {
+        std::error_code entry_ec;
+        if (it->is_directory(entry_ec)) {
+            const std::string name = it->path().filename().string();
+            if (!name.empty() && name[0] == '.') it.disable_recursion_pending();
+            continue;
+        }
+        if (!it->is_regular_file(entry_ec)) continue;
+        const auto size = it->file_size(entry_ec);
+        if (entry_ec || size > options.max_file_bytes) {
+            ++files_skipped_;
+            continue;
+        }
+        // fs::relative は正規化のためにパスの各段を stat するので、字句だけで求める
+        paths.Push({it->path().lexically_relative(options.root), static_cast<size_t>(size)});
+    }
+    paths.Close();
+    for (auto& thread : threads) thread.join();
+
+    done_ = true;
+    if (on_update_) on_update_();
+}
+
+void DirectorySearch::SearchFile(const Options& options, const fs::path& relative, size_t size,
+                                 const SubstringSearcher* literal, RegexSearcher* regex, std::string& buffer) {
+    const std::string path = (options.root / relative).string();
+    MappedFile file;
+    std::string_view text;
+#ifndef _WIN32
+    if (size <= kReadWholeBytes) {
+        if (!ReadWhole(path, size, buffer)) {
+            ++files_skipped_;
+            return;
+        }
+        text = buffer;
+    } else
+#endif
+    {
+        if (!file.Open(path)) {
+            ++files_skipped_;
+            return;
+        }
+        text = file.View();
+    }
+    if (LooksBinary(text.substr(0, kSniffBytes))) {
+        ++files_skipped_;
+        return;
+    }
+
+    std::vector<SearchMatch> found;
+    if (literal) {
+        // 改行を数えながら、ファイル全体を 1 つのバイト列として探す
+        literal->FindInText(text, found);
+    } else {
+        int line = 0;
+        size_t start = 0;
+        while (start <= text.size() && !cancel_) {
+            const void* newline = std::memchr(text.data() + start, '\n', text.size() - start);
+            const size_t end = newline ? static_cast<size_t>(static_cast<const char*>(newline) - text.data())
+                                       : text.size();
+            std::string_view row = text.substr(start, end - start);
+            if (!row.empty() && row.back() == '\r') row.remove_suffix(1);
+            regex->FindInLine(row, line, found);
+            if (!newline) break;
+            start = end + 1;
+            ++line;
+        }
+    }
+    ++files_scanned_;
+    bytes_scanned_ += text.size();
+    if (found.empty()) return;
+
+    FileResult result;
+    result.path = relative.generic_string();
+    AddMatches(text, found, kPreviewContext, result.matches);
+    Publish(std::move(result), options);
+}
+
+void DirectorySearch::Publish(FileResult result, const Options& options) {
+    const size_t count = result.matches.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancel_) return;
+        // 上限を超える分は捨てて、残りのファイルは探さない
+        const size_t room = options.max_matches > matches_ ? options.max_matches - matches_ : 0;
+        if (count >= room) {
+            result.matches.resize(room);
+            truncated_ = true;
+            cancel_ = true;
+        }
+        matches_ += result.matches.size();
+        if (!result.matches.empty()) {
+            ++files_matched_;
+            pending_.push_back(std::move(result));
+        }
+    }
+    if (on_update_) on_update_();
+}
+
+}
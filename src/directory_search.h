@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ShinoEditor {
+
+class RegexSearcher;
+class SubstringSearcher;
+
+// ディレクトリ以下のファイルをまとめて検索する（検索プロンプトの ^D）
+// - 別スレッドでディレクトリを辿り、パスを容量付きキューで workers 本のスレッドに渡す
+// - 各スレッドはファイルを mmap して（小さなファイルはスレッドごとのバッファに読み込んで） SubstringSearcher（改行を数えながら連続したバイト列を探す）か
+//   RegexSearcher（スレッドごとに 1 つ、行ごと）で探す
+// - 一致はファイルごとにまとめて溜め、UI スレッドが Poll() で取り出す。新しい結果が溜まると on_update で知らせる
+// - 大きすぎるファイルと、先頭にバイナリ（NUL や不正な UTF-8）があるファイルは飛ばす。. で始まる
+//   ディレクトリ（.git など）には入らない
+class DirectorySearch {
+public:
+    static constexpr size_t kDefaultMaxFileBytes = 32 << 20;
+    static constexpr size_t kDefaultMaxMatches = 100000;
+    // バイナリかどうかを調べる先頭の量
+    static constexpr size_t kSniffBytes = 8192;
+    // 一覧に出す行の前後の量（長い行は一致のまわりだけ）
+    static constexpr size_t kPreviewContext = 80;
+    // これ以下のファイルは mmap せずに読み込む（mmap/munmap とページフォールトの方が高くつく）
+    static constexpr size_t kReadWholeBytes = 256 << 10;
+
+    struct Options {
+        std::filesystem::path root;
+        std::string query;
+        bool regex = false;
+        size_t workers = 0; // 0 ならハードウェアスレッド数
+        size_t max_file_bytes = kDefaultMaxFileBytes;
+        size_t max_matches = kDefaultMaxMatches; // これに達したら打ち切る
+    };
+
+    struct Match {
+        uint32_t file = 0;      // Poll() で渡したファイルの一覧の添字
+        int line = 0;
+        size_t offset = 0;      // 行の中のバイトオフセット
+        size_t length = 0;
+        std::string preview;    // 一致を含む行（長い行は一致のまわりだけ）
+        size_t preview_offset = 0; // preview の中の一致の位置
+    };
+
+    struct Progress {
+        size_t files_scanned = 0;
+        size_t files_skipped = 0; // 大きすぎる/バイナリ/読めない
+        size_t files_matched = 0;
+        size_t bytes_scanned = 0;
+        size_t matches = 0;
+        bool done = false;
+        bool truncated = false;   // max_matches に達して打ち切った
+    };
+
+    // ワーカースレッドから呼ぶ（UI ループへの受け渡しは呼び出し側）
+    explicit DirectorySearch(std::function<void()> on_update = nullptr);
+    ~DirectorySearch();
+
+    DirectorySearch(const DirectorySearch&) = delete;
+    DirectorySearch& operator=(const DirectorySearch&) = delete;
+
+    // 検索を始める（前の検索は止める）。root がディレクトリでなければ ShinoError（Category::File）、
+    // 正規表現の構文エラーは RegexSearcher の ShinoError をそのまま投げる
+    void Start(const Options& options);
+    // 検索を止めてスレッドを待つ
+    void Cancel();
+    // 前回からあとに見つかった一致を matches に、新しく一致したファイルの相対パスを files に足す
+    // 返り値は足した一致の数
+    size_t Poll(std::vector<Match>& matches, std::vector<std::string>& files);
+    Progress GetProgress() const;
+    bool Running() const { return coordinator_.joinable() && !done_; }
+
+    // 大きさとファイルの先頭で、探さないファイルを決める
+    static bool LooksBinary(std::string_view head);
+
+private:
+    struct FileResult {
+        std::string path;
+        std::vector<Match> matches;
+    };
+
+    void Run(Options options);
+    // literal か regex のどちらか一方で探す（regex はスレッドごとに持つ）
+    void SearchFile(const Options& options, const std::filesystem::path& relative, size_t size,
+                    const SubstringSearcher* literal, RegexSearcher* regex, std::string& buffer);
+    void Publish(FileResult result, const Options& options);
+
+    std::function<void()> on_update_;
+    std::thread coordinator_;
+    std::atomic<bool> cancel_{false};
+    std::atomic<bool> done_{false};
+    std::atomic<bool> truncated_{false};
+    std::atomic<size_t> files_scanned_{0};
+    std::atomic<size_t> files_skipped_{0};
+    std::atomic<size_t> bytes_scanned_{0};
+    std::atomic<size_t> matches_{0};
+
+    // ワーカーが溜めた結果（Poll() で取り出す）
+    mutable std::mutex mutex_;
+    std::vector<FileResult> pending_;
+    size_t files_matched_ = 0;
+};
+
+}
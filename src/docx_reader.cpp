@@ -0,0 +1,1025 @@
+#include "docx_reader.h"
+#include "error_handler.h"
+#include "xml_scanner.h"
+#include "zip_archive.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <unordered_map>
+#include <vector>
+
+namespace ShinoEditor {
+
+namespace {
+// 溜まった Markdown を渡す目安
+constexpr size_t kFlushBytes = 64 * 1024;
+constexpr int kMaxHeadingLevel = 6;
+constexpr int kListLevels = 9;
+// basedOn を辿る深さの上限（循環していても止まるように）
+constexpr int kMaxStyleDepth = 16;
+
+// run の書式（ビットの組み合わせ）
+constexpr uint8_t kBold = 1;
+constexpr uint8_t kItalic = 2;
+constexpr uint8_t kStrike = 4;
+constexpr uint8_t kCode = 8;
+constexpr uint8_t kRaw = 16; // 組み立て済みの Markdown（リンク）
+constexpr uint8_t kEmphasisMask = kBold | kItalic | kStrike;
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool EndsWith(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string Lower(std::string_view text) {
+    std::string lower(text);
+    for (char& c : lower) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return lower;
+}
+
+int ParseInt(std::string_view text, int fallback) {
+    int value = fallback;
+    if (std::from_chars(text.data(), text.data() + text.size(), value).ec != std::errc()) return fallback;
+    return value;
+}
+
+// <w:b/> <w:i w:val="0"/> などの切り替え（値がなければ有効）
+bool ToggleOn(const XmlAttributes& attributes) {
+    const auto value = attributes.Get("w:val");
+    return !(value == "0" || value == "false" || value == "off");
+}
+
+bool IsMonospaceFont(const XmlAttributes& attributes) {
+    for (const char* key : {"w:ascii", "w:hAnsi"}) {
+        const std::string font = Lower(attributes.Get(key));
+        for (const char* mono : {"mono", "courier", "consolas", "menlo", "monaco", "lucida console", "source code"}) {
+            if (font.find(mono) != std::string::npos) return true;
+        }
+    }
+    return false;
+}
+
+[[noreturn]] void ThrowInvalidDocx(const std::string& path, const std::string& reason) {
+    throw ShinoError(ShinoError::Category::Parser, "Invalid DOCX file", path + ": " + reason);
+}
+
+// .rels の Target を ZIP の中のパスにする（base_dir は元の部品のディレクトリ）
+std::string ResolveTarget(std::string_view base_dir, std::string_view target) {
+    std::vector<std::string_view> parts;
+    auto push = [&parts](std::string_view path) {
+        while (!path.empty()) {
+            const size_t slash = path.find('/');
+            const std::string_view part = path.substr(0, slash);
+            if (part == "..") {
+                if (!parts.empty()) parts.pop_back();
+            } else if (!part.empty() && part != ".") {
+                parts.push_back(part);
+            }
+            if (slash == std::string_view::npos) break;
+            path.remove_prefix(slash + 1);
+        }
+    };
+    if (target.empty() || target[0] != '/') push(base_dir);
+    push(target);
+    std::string path;
+    for (const auto part : parts) {
+        if (!path.empty()) path += '/';
+        path.append(part);
+    }
+    return path;
+}
+
+// ---- _rels/*.rels ----
+struct Relationship {
+    std::string type;
+    std::string target;
+    bool external = false;
+};
+using Relationships = std::unordered_map<std::string, Relationship>;
+
+class RelationshipsHandler : public XmlHandler {
+public:
+    explicit RelationshipsHandler(Relationships& relationships) : relationships_(relationships) {}
+
+    void StartElement(std::string_view name, const XmlAttributes& attributes) override {
+        if (name != "Relationship") return;
+        auto& relationship = relationships_[std::string(attributes.Get("Id"))];
+        relationship.type = attributes.Get("Type");
+        relationship.target = attributes.Get("Target");
+        relationship.external = attributes.Get("TargetMode") == "External";
+    }
+    void EndElement(std::string_view) override {}
+    void Text(std::string_view) override {}
+
+private:
+    Relationships& relationships_;
+};
+
+// 種類（Type の末尾）が合う最初の関係の Target
+const Relationship* FindRelationship(const Relationships& relationships, std::string_view type_suffix) {
+    for (const auto& [id, relationship] : relationships) {
+        if (EndsWith(relationship.type, type_suffix)) return &relationship;
+    }
+    return nullptr;
+}
+
+// ---- word/styles.xml ----
+struct StyleDefinition {
+    std::string name;      // 小文字にしたもの（"heading 1"）
+    std::string based_on;
+    int outline_level = -1;
+    uint8_t format = 0;    // rPr の太字/斜体/打ち消し線/等幅
+    std::string num_id;    // スタイルに付いた番号
+    int num_level = 0;
+};
+
+// スタイルを辿って決めた段落の種類
+struct ParagraphStyle {
+    int heading = 0; // 1〜6。0 なら見出しではない
+    bool code = false;
+    bool quote = false;
+    std::string num_id;
+    int num_level = 0;
+};
+
+class Styles {
+public:
+    std::unordered_map<std::string, StyleDefinition> definitions;
+
+    const ParagraphStyle& Paragraph(const std::string& id) {
+        auto it = paragraph_cache_.find(id);
+        if (it != paragraph_cache_.end()) return it->second;
+        ParagraphStyle style;
+        bool named = false; // 名前で種類が決まった
+        const StyleDefinition* definition = Find(id);
+        for (int depth = 0; definition && depth < kMaxStyleDepth; ++depth) {
+            if (!named) named = ClassifyParagraph(*definition, style);
+            if (style.num_id.empty() && !definition->num_id.empty()) {
+                style.num_id = definition->num_id;
+                style.num_level = definition->num_level;
+            }
+            definition = Find(definition->based_on);
+        }
+        return paragraph_cache_.emplace(id, std::move(style)).first->second;
+    }
+
+    uint8_t Character(const std::string& id) {
+        auto it = character_cache_.find(id);
+        if (it != character_cache_.end()) return it->second;
+        uint8_t format = 0;
+        const StyleDefinition* definition = Find(id);
+        for (int depth = 0; definition && depth < kMaxStyleDepth; ++depth) {
+            format |= definition->format;
+            const std::string& name = definition->name;
+            if (name == "strong") format |= kBold;
+            if (name == "emphasis") format |= kItalic;
+            if (name == "verbatim char" || name == "source code char" || name == "html code" ||
+                name == "html typewriter" || name.rfind("code", 0) == 0) {
+                format |= kCode;
+            }
+            definition = Find(definition->based_on);
+        }
+        character_cache_.emplace(id, format);
+        return format;
+    }
+
+private:
+    std::unordered_map<std::string, ParagraphStyle> paragraph_cache_;
+    std::unordered_map<std::string, uint8_t> character_cache_;
+
+    const StyleDefinition* Find(const std::string& id) const {
+        if (id.empty()) return nullptr;
+        auto it = definitions.find(id);
+        return it == definitions.end() ? nullptr : &it->second;
+    }
+
+    // 名前（なければアウトラインレベルや等幅フォント）で種類を決める。決まれば true
+    static bool ClassifyParagraph(const StyleDefinition& definition, ParagraphStyle& style) {
+        const std::string& name = definition.name;
+        if (name.rfind("heading ", 0) == 0) {
+            const int level = ParseInt(std::string_view(name).substr(8), 0);
+            if (level >= 1) {
+                style.heading = std::min(level, kMaxHeadingLevel);
+                return true;
+            }
+        }
+        if (name == "title") {
+            style.heading = 1;
+            return true;
+        }
+        if (name == "source code" || name == "html preformatted" || name == "plain text" ||
+            name == "preformatted text" || name.rfind("code", 0) == 0) {
+            style.code = true;
+            return true;
+        }
+        if (name == "quote" || name == "intense quote" || name == "block text" || name == "block quote" ||
+            name == "blockquote") {
+            style.quote = true;
+            return true;
+        }
+        if (definition.outline_level >= 0 && definition.outline_level < kListLevels) {
+            style.heading = std::min(definition.outline_level + 1, kMaxHeadingLevel);
+            return true;
+        }
+        if (definition.format & kCode) {
+            style.code = true;
+            return true;
+        }
+        return false;
+    }
+};
+
+class StylesHandler : public XmlHandler {
+public:
+    explicit StylesHandler(Styles& styles) : styles_(styles) {}
+
+    void StartElement(std::string_view name, const XmlAttributes& attributes) override {
+        if (name == "w:style") {
+            current_ = &styles_.definitions[std::string(attributes.Get("w:styleId"))];
+            return;
+        }
+        if (!current_) return;
+        if (name == "w:rPr") {
+            in_run_properties_ = true;
+        } else if (name == "w:name") {
+            current_->name = Lower(attributes.Get("w:val"));
+        } else if (name == "w:basedOn") {
+            current_->based_on = attributes.Get("w:val");
+        } else if (name == "w:outlineLvl") {
+            current_->outline_level = ParseInt(attributes.Get("w:val"), -1);
+        } else if (name == "w:numId") {
+            current_->num_id = attributes.Get("w:val");
+        } else if (name == "w:ilvl") {
+            current_->num_level = ParseInt(attributes.Get("w:val"), 0);
+        } else if (in_run_properties_) {
+            if (name == "w:b") {
+                if (ToggleOn(attributes)) current_->format |= kBold;
+            } else if (name == "w:i") {
+                if (ToggleOn(attributes)) current_->format |= kItalic;
+            } else if (name == "w:strike" || name == "w:dstrike") {
+                if (ToggleOn(attributes)) current_->format |= kStrike;
+            } else if (name == "w:rFonts") {
+                if (IsMonospaceFont(attributes)) current_->format |= kCode;
+            }
+        }
+    }
+
+    void EndElement(std::string_view name) override {
+        if (name == "w:style") {
+            current_ = nullptr;
+        } else if (name == "w:rPr") {
+            in_run_properties_ = false;
+        }
+    }
+
+    void Text(std::string_view) override {}
+
+private:
+    Styles& styles_;
+    StyleDefinition* current_ = nullptr;
+    bool in_run_properties_ = false;
+};
+
+// ---- word/numbering.xml ----
+struct NumberingLevel {
+    bool ordered = false;
+    int start = 1;
+};
+using NumberingLevels = std::array<NumberingLevel, kListLevels>;
+
+struct Numbering {
+    std::unordered_map<std::string, NumberingLevels> abstracts; // w:abstractNumId → 階層ごとの形式
+    std::unordered_map<std::string, std::string> instances;     // w:numId → w:abstractNumId
+
+    const NumberingLevels* Find(const std::string& num_id) const {
+        auto instance = instances.find(num_id);
+        if (instance == instances.end()) return nullptr;
+        auto levels = abstracts.find(instance->second);
+        return levels == abstracts.end() ? nullptr : &levels->second;
+    }
+};
+
+class NumberingHandler : public XmlHandler {
+public:
+    explicit NumberingHandler(Numbering& numbering) : numbering_(numbering) {}
+
+    void StartElement(std::string_view name, const XmlAttributes& attributes) override {
+        if (name == "w:abstractNum") {
+            abstract_ = &numbering_.abstracts[std::string(attributes.Get("w:abstractNumId"))];
+        } else if (name == "w:num") {
+            num_id_ = attributes.Get("w:numId");
+        } else if (name == "w:abstractNumId" && !num_id_.empty()) {
+            numbering_.instances[num_id_] = attributes.Get("w:val");
+        } else if (name == "w:lvlOverride" && !num_id_.empty()) {
+            const int level = ParseInt(attributes.Get("w:ilvl"), -1);
+            override_level_ = level >= 0 && level < kListLevels ? level : -1;
+        } else if (name == "w:startOverride" && override_level_ >= 0) {
+            // 開始番号だけを変えた番号は、元の形式を写した専用の定義にする
+            std::string& instance = numbering_.instances[num_id_];
+            const std::string own = "num " + num_id_;
+            if (instance != own) {
+                auto base = numbering_.abstracts.find(instance);
+                numbering_.abstracts[own] = base == numbering_.abstracts.end() ? NumberingLevels{} : base->second;
+                instance = own;
+            }
+            numbering_.abstracts[own][override_level_].start = ParseInt(attributes.Get("w:val"), 1);
+        } else if (abstract_ && name == "w:lvl") {
+            const int level = ParseInt(attributes.Get("w:ilvl"), -1);
+            level_ = level >= 0 && level < kListLevels ? &(*abstract_)[level] : nullptr;
+        } else if (level_ && name == "w:numFmt") {
+            const auto format = attributes.Get("w:val");
+            level_->ordered = format != "bullet" && format != "none";
+        } else if (level_ && name == "w:start") {
+            level_->start = ParseInt(attributes.Get("w:val"), 1);
+        }
+    }
+
+    void EndElement(std::string_view name) override {
+        if (name == "w:abstractNum") {
+            abstract_ = nullptr;
+            level_ = nullptr;
+        } else if (name == "w:lvl") {
+            level_ = nullptr;
+        } else if (name == "w:num") {
+            num_id_.clear();
+        } else if (name == "w:lvlOverride") {
+            override_level_ = -1;
+        }
+    }
+
+    void Text(std::string_view) override {}
+
+private:
+    Numbering& numbering_;
+    NumberingLevels* abstract_ = nullptr;
+    NumberingLevel* level_ = nullptr;
+    std::string num_id_;
+    int override_level_ = -1;
+};
+
+// ---- Markdown の組み立て ----
+struct Run {
+    std::string text;
+    uint8_t format = 0;
+};
+
+void AppendEscaped(std::string_view text, std::string& out) {
+    for (char c : text) {
+        switch (c) {
+            case '\\': case '`': case '*': case '_': case '[': case ']': case '<': case '~':
+                out += '\\';
+                break;
+            default:
+                break;
+        }
+        out += c;
+    }
+}
+
+void AppendCodeSpan(std::string_view text, std::string& out) {
+    size_t longest = 0;
+    size_t current = 0;
+    for (char c : text) {
+        current = c == '`' ? current + 1 : 0;
+        longest = std::max(longest, current);
+    }
+    const std::string fence(longest + 1, '`');
+    const bool pad = text.front() == '`' || text.back() == '`';
+    out += fence;
+    if (pad) out += ' ';
+    for (char c : text) out += c == '\n' ? ' ' : c;
+    if (pad) out += ' ';
+    out += fence;
+}
+
+const char* EmphasisMarker(uint8_t bit) {
+    return bit == kBold ? "**" : bit == kItalic ? "*" : "~~";
+}
+
+// run を Markdown の行内要素にする（改行は '\n' のまま残す）
+// 書式の印は空白の内側に置く（"** a**" では強調にならないため）。段落の前後の空白は落とす
+void AppendInline(const Run* runs, size_t count, std::string& out) {
+    std::array<uint8_t, 3> open{};
+    size_t open_count = 0;
+    std::string space;
+    bool started = false;
+
+    auto set_format = [&](uint8_t want) {
+        size_t keep = 0;
+        while (keep < open_count && (want & open[keep])) ++keep;
+        while (open_count > keep) out += EmphasisMarker(open[--open_count]);
+        out += space;
+        space.clear();
+        for (uint8_t bit : {kBold, kItalic, kStrike}) {
+            if (!(want & bit) || std::find(open.begin(), open.begin() + open_count, bit) != open.begin() + open_count) {
+                continue;
+            }
+            out += EmphasisMarker(bit);
+            open[open_count++] = bit;
+        }
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const Run& run = runs[i];
+        if (run.text.empty()) continue;
+        if (run.format & kRaw) {
+            set_format(0);
+            out += run.text;
+            started = true;
+            continue;
+        }
+        const std::string_view text = run.text;
+        size_t begin = 0;
+        size_t end = text.size();
+        while (begin < end && IsSpace(text[begin])) ++begin;
+        while (end > begin && IsSpace(text[end - 1])) --end;
+        if (begin == end) {
+            if (started) space.append(text);
+            continue;
+        }
+        if (started) space.append(text.substr(0, begin));
+        set_format(run.format & kEmphasisMask);
+        if (run.format & kCode) {
+            AppendCodeSpan(text.substr(begin, end - begin), out);
+        } else {
+            AppendEscaped(text.substr(begin, end - begin), out);
+        }
+        started = true;
+        space.assign(text.substr(end));
+    }
+    space.clear();
+    set_format(0);
+}
+
+// 行頭で Markdown の記法と読まれる文字を逃がす
+void AppendLineStart(std::string_view line, std::string& out) {
+    if (line.empty()) return;
+    const char first = line.front();
+    if (first == '#' || first == '>' || first == '+' || first == '-' || first == '=' || first == '|') {
+        out += '\\';
+    } else if (first >= '0' && first <= '9') {
+        size_t digits = 0;
+        while (digits < line.size() && line[digits] >= '0' && line[digits] <= '9') ++digits;
+        if (digits < line.size() && digits <= 9 && (line[digits] == '.' || line[digits] == ')')) {
+            out.append(line.substr(0, digits));
+            out += '\\';
+            out.append(line.substr(digits));
+            return;
+        }
+    }
+    out.append(line);
+}
+
+// 行内の改行を硬い改行（"\" + 改行）にし、続きの行の頭に prefix を付ける。空の行は詰める
+void AppendLines(std::string_view text, std::string_view prefix, std::string& out) {
+    bool first = true;
+    while (!text.empty()) {
+        const size_t newline = text.find('\n');
+        const std::string_view line = text.substr(0, newline);
+        if (!line.empty()) {
+            if (!first) {
+                out += "\\\n";
+                out.append(prefix);
+            }
+            AppendLineStart(line, out);
+            first = false;
+        }
+        if (newline == std::string_view::npos) break;
+        text.remove_prefix(newline + 1);
+    }
+}
+
+// ---- word/document.xml ----
+class DocumentHandler : public XmlHandler {
+public:
+    DocumentHandler(Styles& styles, const Numbering& numbering, const Relationships& relationships,
+                    const std::function<void(std::string_view)>& on_markdown, DocxReader::Result& result)
+        : styles_(styles), numbering_(numbering), relationships_(relationships),
+          on_markdown_(on_markdown), result_(result) {}
+
+    void StartElement(std::string_view name, const XmlAttributes& attributes) override {
+        ++depth_;
+        if (skip_until_ >= 0) {
+            // 水平線（pandoc などは VML の横線で書く）は落とさない
+            if (name == "v:rect" && attributes.Get("o:hr") == "t") skipped_rule_ = true;
+            return;
+        }
+
+        if (name == "w:t") {
+            in_text_ = in_run_ && !run_hidden_;
+        } else if (name == "w:r") {
+            in_run_ = true;
+            run_format_ = 0;
+            run_hidden_ = false;
+        } else if (name == "w:rPr") {
+            in_run_properties_ = in_run_;
+        } else if (in_run_properties_) {
+            RunProperty(name, attributes);
+        } else if (name == "w:p") {
+            StartParagraph();
+        } else if (name == "w:pPr") {
+            in_paragraph_properties_ = in_paragraph_;
+        } else if (in_paragraph_properties_) {
+            ParagraphProperty(name, attributes);
+        } else if (name == "w:tab" || name == "w:ptab") {
+            if (in_run_) AppendText("\t");
+        } else if (name == "w:br" || name == "w:cr") {
+            const auto type = attributes.Get("w:type");
+            if (in_run_ && type != "page" && type != "column") AppendText("\n");
+        } else if (name == "w:noBreakHyphen") {
+            if (in_run_) AppendText("-");
+        } else if (name == "w:hyperlink") {
+            StartHyperlink(attributes);
+        } else if (name == "w:tbl") {
+            if (++table_depth_ == 1) {
+                table_.clear();
+            } else {
+                Unsupported("nested w:tbl");
+            }
+        } else if (table_depth_ == 1 && name == "w:tr") {
+            table_.emplace_back();
+        } else if (table_depth_ == 1 && name == "w:tc") {
+            if (!table_.empty()) table_.back().emplace_back();
+            cell_span_ = 1;
+        } else if (table_depth_ == 1 && name == "w:gridSpan") {
+            cell_span_ = std::max(1, ParseInt(attributes.Get("w:val"), 1));
+            if (cell_span_ > 1) Unsupported("w:gridSpan");
+        } else if (table_depth_ == 1 && name == "w:vMerge") {
+            Unsupported("w:vMerge");
+        } else if (name == "w:del" || name == "w:moveFrom") {
+            // 変更履歴で消された内容
+            Skip(name, false);
+        } else if (name == "w:drawing" || name == "w:object" || name == "w:pict" || name == "mc:AlternateContent" ||
+                   name == "m:oMath" || name == "m:oMathPara" || name == "w:altChunk") {
+            Skip(name, true);
+        } else if (name == "w:footnoteReference" || name == "w:endnoteReference" || name == "w:sym") {
+            Unsupported(name);
+        }
+    }
+
+    void EndElement(std::string_view name) override {
+        if (skip_until_ >= 0) {
+            if (depth_-- == skip_until_) EndSkip();
+            return;
+        }
+        --depth_;
+        if (name == "w:t") {
+            in_text_ = false;
+        } else if (name == "w:r") {
+            in_run_ = false;
+            in_run_properties_ = false;
+        } else if (name == "w:rPr") {
+            in_run_properties_ = false;
+        } else if (name == "w:pPr") {
+            in_paragraph_properties_ = false;
+        } else if (name == "w:p") {
+            EndParagraph();
+        } else if (name == "w:hyperlink") {
+            EndHyperlink();
+        } else if (name == "w:tc") {
+            if (table_depth_ == 1 && !table_.empty()) {
+                for (int i = 1; i < cell_span_; ++i) table_.back().emplace_back();
+            }
+        } else if (name == "w:tbl") {
+            if (table_depth_ > 0 && --table_depth_ == 0) EmitTable();
+        }
+    }
+
+    void Text(std::string_view text) override {
+        if (in_text_ && skip_until_ < 0) AppendText(text);
+    }
+
+    void Finish() {
+        FlushCode();
+        if (!out_.empty()) on_markdown_(out_);
+        out_.clear();
+    }
+
+private:
+    enum class Block { kNone, kParagraph, kHeading, kList, kQuote, kCode, kTable, kRule };
+
+    Styles& styles_;
+    const Numbering& numbering_;
+    const Relationships& relationships_;
+    const std::function<void(std::string_view)>& on_markdown_;
+    DocxReader::Result& result_;
+    std::string out_;
+
+    int depth_ = 0;
+    int skip_until_ = -1; // 読み飛ばしている要素の深さ
+    std::string skipped_name_;
+    bool skipped_unsupported_ = false;
+    bool skipped_rule_ = false;
+
+    // 段落
+    bool in_paragraph_ = false;
+    bool in_paragraph_properties_ = false;
+    std::string paragraph_style_;
+    std::string paragraph_num_id_;
+    int paragraph_num_level_ = -1;
+    bool paragraph_has_numbering_ = false;
+    int paragraph_outline_ = -1;
+    bool paragraph_rule_ = false;
+    std::vector<Run> runs_; // 文字列を使い回すため、使っているのは先頭の run_count_ 個
+    size_t run_count_ = 0;
+    bool split_run_ = false; // 次の文字は新しい run にする（リンクの境目）
+
+    // run
+    bool in_run_ = false;
+    bool in_run_properties_ = false;
+    bool in_text_ = false;
+    bool run_hidden_ = false;
+    uint8_t run_format_ = 0;
+
+    // リンク
+    size_t link_begin_ = 0;
+    std::string link_url_;
+    bool in_link_ = false;
+
+    // 表（外側の表だけ。入れ子の表の中身は外側のセルに足す）
+    int table_depth_ = 0;
+    int cell_span_ = 1;
+    std::vector<std::vector<std::string>> table_;
+
+    // ブロックの並び
+    Block last_ = Block::kNone;
+    std::string code_;                 // 続いているコード段落
+    std::vector<int> list_columns_;    // リストの階層ごとの本文の桁（-1 はまだない）
+    std::string list_num_id_;          // 続いているリストの一番外側の番号
+    std::unordered_map<std::string, std::array<int, kListLevels>> list_counters_;
+    std::string inline_;
+
+    void Unsupported(std::string_view what) {
+        if (result_.unsupported.empty()) result_.unsupported = what;
+    }
+
+    // 要素の終わりまで読み飛ばす。unsupported なら落としたものとして記録する
+    void Skip(std::string_view name, bool unsupported) {
+        skip_until_ = depth_;
+        skipped_name_ = name;
+        skipped_unsupported_ = unsupported;
+        skipped_rule_ = false;
+    }
+
+    void EndSkip() {
+        skip_until_ = -1;
+        if (skipped_name_ == "w:pict" && skipped_rule_) {
+            paragraph_rule_ = true;
+        } else if (skipped_unsupported_) {
+            Unsupported(skipped_name_);
+        }
+    }
+
+    void RunProperty(std::string_view name, const XmlAttributes& attributes) {
+        if (name == "w:b") {
+            SetFormat(kBold, ToggleOn(attributes));
+        } else if (name == "w:i") {
+            SetFormat(kItalic, ToggleOn(attributes));
+        } else if (name == "w:strike" || name == "w:dstrike") {
+            SetFormat(kStrike, ToggleOn(attributes));
+        } else if (name == "w:rStyle") {
+            run_format_ |= styles_.Character(std::string(attributes.Get("w:val")));
+        } else if (name == "w:rFonts") {
+            if (IsMonospaceFont(attributes)) run_format_ |= kCode;
+        } else if (name == "w:vanish" || name == "w:specVanish") {
+            run_hidden_ = ToggleOn(attributes);
+        }
+    }
+
+    void SetFormat(uint8_t bit, bool on) {
+        run_format_ = on ? (run_format_ | bit) : (run_format_ & ~bit);
+    }
+
+    void ParagraphProperty(std::string_view name, const XmlAttributes& attributes) {
+        if (name == "w:pStyle") {
+            paragraph_style_ = attributes.Get("w:val");
+        } else if (name == "w:numId") {
+            paragraph_num_id_ = attributes.Get("w:val");
+            paragraph_has_numbering_ = true;
+        } else if (name == "w:ilvl") {
+            paragraph_num_level_ = ParseInt(attributes.Get("w:val"), 0);
+        } else if (name == "w:outlineLvl") {
+            paragraph_outline_ = ParseInt(attributes.Get("w:val"), -1);
+        }
+    }
+
+    void StartParagraph() {
+        in_paragraph_ = true;
+        paragraph_style_.clear();
+        paragraph_num_id_.clear();
+        paragraph_num_level_ = -1;
+        paragraph_has_numbering_ = false;
+        paragraph_outline_ = -1;
+        paragraph_rule_ = false;
+        run_count_ = 0;
+        split_run_ = false;
+        in_link_ = false;
+    }
+
+    Run& NewRun(uint8_t format) {
+        if (run_count_ == runs_.size()) runs_.emplace_back();
+        Run& run = runs_[run_count_++];
+        run.text.clear();
+        run.format = format;
+        split_run_ = false;
+        return run;
+    }
+
+    // 書式が同じなら前の run に続ける
+    void AppendText(std::string_view text) {
+        if (run_count_ == 0 || split_run_ || runs_[run_count_ - 1].format != run_format_) {
+            NewRun(run_format_).text.append(text);
+        } else {
+            runs_[run_count_ - 1].text.append(text);
+        }
+    }
+
+    void StartHyperlink(const XmlAttributes& attributes) {
+        link_url_.clear();
+        const auto id = attributes.Get("r:id");
+        if (!id.empty()) {
+            auto it = relationships_.find(std::string(id));
+            if (it != relationships_.end()) link_url_ = it->second.target;
+        } else if (!attributes.Get("w:anchor").empty()) {
+            link_url_ = "#";
+            link_url_.append(attributes.Get("w:anchor"));
+        }
+        in_link_ = !link_url_.empty();
+        link_begin_ = run_count_;
+        split_run_ = true;
+    }
+
+    void EndHyperlink() {
+        if (!in_link_) return;
+        in_link_ = false;
+        split_run_ = true;
+        if (link_begin_ > run_count_) return;
+        std::string label;
+        AppendInline(runs_.data() + link_begin_, run_count_ - link_begin_, label);
+        run_count_ = link_begin_;
+        if (label.empty()) return;
+        std::string link = "[" + label + "](";
+        if (link_url_.find_first_of(" ()<>") != std::string::npos) {
+            link += "<" + link_url_ + ">";
+        } else {
+            link += link_url_;
+        }
+        link += ')';
+        NewRun(kRaw).text = std::move(link);
+        split_run_ = true;
+    }
+
+    void EndParagraph() {
+        if (!in_paragraph_) return;
+        in_paragraph_ = false;
+        in_link_ = false;
+
+        if (table_depth_ > 0) {
+            if (table_.empty() || table_.back().empty()) return;
+            inline_.clear();
+            AppendInline(runs_.data(), run_count_, inline_);
+            std::string& cell = table_.back().back();
+            if (!cell.empty() && !inline_.empty()) cell += ' ';
+            for (char c : inline_) {
+                if (c == '\n') {
+                    cell += ' ';
+                } else {
+                    if (c == '|') cell += '\\';
+                    cell += c;
+                }
+            }
+            return;
+        }
+
+        const ParagraphStyle& style = styles_.Paragraph(paragraph_style_);
+        if (style.code) {
+            if (last_ != Block::kCode) StartBlock(Block::kCode);
+            for (size_t i = 0; i < run_count_; ++i) code_ += runs_[i].text;
+            code_ += '\n';
+            return;
+        }
+
+        inline_.clear();
+        AppendInline(runs_.data(), run_count_, inline_);
+        if (inline_.empty()) {
+            if (paragraph_rule_) {
+                StartBlock(Block::kRule);
+                out_ += "---\n";
+                FlushIfLarge();
+            }
+            return;
+        }
+
+        int heading = paragraph_outline_ >= 0 && paragraph_outline_ < kListLevels
+                          ? std::min(paragraph_outline_ + 1, kMaxHeadingLevel)
+                          : style.heading;
+        std::string num_id = paragraph_has_numbering_ ? paragraph_num_id_ : style.num_id;
+        int num_level = paragraph_num_level_ >= 0 ? paragraph_num_level_ : style.num_level;
+        if (num_id == "0") num_id.clear();
+
+        if (heading > 0) {
+            StartBlock(Block::kHeading);
+            out_.append(heading, '#');
+            out_ += ' ';
+            for (char c : inline_) out_ += c == '\n' ? ' ' : c;
+        } else if (!num_id.empty()) {
+            EmitListItem(num_id, std::clamp(num_level, 0, kListLevels - 1));
+        } else if (style.quote) {
+            StartBlock(Block::kQuote);
+            out_ += "> ";
+            AppendLines(inline_, "> ", out_);
+        } else {
+            StartBlock(Block::kParagraph);
+            AppendLines(inline_, "", out_);
+        }
+        out_ += '\n';
+        FlushIfLarge();
+    }
+
+    void EmitListItem(const std::string& num_id, int level) {
+        const NumberingLevels* levels = numbering_.Find(num_id);
+        const bool ordered = levels && (*levels)[level].ordered;
+        // 別のブロックを挟んでも、同じ番号の続きは数え続ける（Word と同じ）
+        auto& counters = list_counters_.try_emplace(num_id).first->second;
+        counters[level] = counters[level] == 0 ? (levels ? (*levels)[level].start : 1) : counters[level] + 1;
+        std::fill(counters.begin() + level + 1, counters.end(), 0);
+
+        // 番号の違うリストが続いたら空行で分ける（Markdown では記号や番号の種類が変わると別のリストになる）
+        const bool new_list = level == 0 && last_ == Block::kList && num_id != list_num_id_;
+        StartBlock(Block::kList);
+        if (new_list) {
+            out_ += '\n';
+            list_columns_.clear();
+        }
+        if (level == 0) list_num_id_ = num_id;
+        int indent = 0;
+        for (int parent = std::min(level, static_cast<int>(list_columns_.size())) - 1; parent >= 0; --parent) {
+            if (list_columns_[parent] >= 0) {
+                indent = list_columns_[parent];
+                break;
+            }
+        }
+        const std::string marker = ordered ? std::to_string(counters[level]) + ". " : "- ";
+        list_columns_.resize(level + 1, -1);
+        list_columns_[level] = indent + static_cast<int>(marker.size());
+
+        out_.append(indent, ' ');
+        out_ += marker;
+        AppendLines(inline_, std::string(list_columns_[level], ' '), out_);
+    }
+
+    void EmitTable() {
+        size_t columns = 0;
+        for (const auto& row : table_) columns = std::max(columns, row.size());
+        if (columns == 0) return;
+        StartBlock(Block::kTable);
+        bool header = true;
+        for (const auto& row : table_) {
+            out_ += '|';
+            for (size_t i = 0; i < columns; ++i) {
+                out_ += ' ';
+                if (i < row.size()) out_ += row[i];
+                out_ += " |";
+            }
+            out_ += '\n';
+            if (header) {
+                out_ += '|';
+                for (size_t i = 0; i < columns; ++i) out_ += " --- |";
+                out_ += '\n';
+                header = false;
+            }
+        }
+        table_.clear();
+        FlushIfLarge();
+    }
+
+    // ブロックの間に空行を入れる（リストの項目どうしは詰め、引用どうしは ">" の行で繋ぐ）
+    void StartBlock(Block kind) {
+        if (kind != Block::kCode) FlushCode();
+        if (kind != Block::kList) list_columns_.clear();
+        if (last_ == Block::kList && kind == Block::kList) {
+            // 続きの項目
+        } else if (last_ == Block::kQuote && kind == Block::kQuote) {
+            out_ += ">\n";
+        } else if (last_ != Block::kNone) {
+            out_ += '\n';
+        }
+        last_ = kind;
+    }
+
+    void FlushCode() {
+        if (last_ != Block::kCode) return;
+        while (code_.size() >= 2 && code_[code_.size() - 2] == '\n') code_.pop_back();
+        size_t longest = 0;
+        size_t current = 0;
+        for (char c : code_) {
+            current = c == '`' ? current + 1 : 0;
+            longest = std::max(longest, current);
+        }
+        const std::string fence(std::max<size_t>(3, longest + 1), '`');
+        out_ += fence;
+        out_ += '\n';
+        out_ += code_;
+        out_ += fence;
+        out_ += '\n';
+        code_.clear();
+        // 続けて呼ばれても二重に出さない（次のブロックの前の空行は kCode と同じ）
+        last_ = Block::kParagraph;
+        FlushIfLarge();
+    }
+
+    void FlushIfLarge() {
+        if (out_.size() < kFlushBytes) return;
+        on_markdown_(out_);
+        out_.clear();
+    }
+};
+
+// 部品を展開しながら handler に渡す。cancel が立てば ShinoError（Convert）
+void ParsePart(const ZipReader& zip, const ZipReader::Entry& entry, XmlHandler& handler,
+               const std::string& docx_path, const std::atomic<bool>* cancel) {
+    XmlScanner scanner(handler);
+    bool malformed = false;
+    bool cancelled = false;
+    zip.Read(entry, [&](std::string_view chunk) {
+        if (cancel && cancel->load()) {
+            cancelled = true;
+            return false;
+        }
+        if (!scanner.Feed(chunk)) {
+            malformed = true;
+            return false;
+        }
+        return true;
+    });
+    if (cancelled) error::ThrowConversionFailed("docx", "markdown", "cancelled");
+    if (malformed || !scanner.Finish()) ThrowInvalidDocx(docx_path, entry.name + ": malformed XML");
+}
+
+void ParseRelationships(const ZipReader& zip, const std::string& part, Relationships& relationships,
+                        const std::string& docx_path) {
+    const auto slash = part.rfind('/');
+    const std::string rels = slash == std::string::npos
+                                 ? "_rels/" + part + ".rels"
+                                 : part.substr(0, slash) + "/_rels/" + part.substr(slash + 1) + ".rels";
+    if (const auto* entry = zip.Find(rels)) {
+        RelationshipsHandler handler(relationships);
+        ParsePart(zip, *entry, handler, docx_path, nullptr);
+    }
+}
+}
+
+DocxReader::Result DocxReader::Convert(const std::string& docx_path,
+                                       const std::function<void(std::string_view)>& on_markdown,
+                                       const std::atomic<bool>* cancel) {
+    ZipReader zip;
+    zip.Open(docx_path);
+
+    // 本文の部品は _rels/.rels の officeDocument（たいていは word/document.xml）
+    std::string document_part = "word/document.xml";
+    Relationships package;
+    ParseRelationships(zip, "", package, docx_path);
+    if (const auto* main = FindRelationship(package, "/officeDocument")) {
+        document_part = ResolveTarget("", main->target);
+    }
+    const auto* document = zip.Find(document_part);
+    if (!document) ThrowInvalidDocx(docx_path, document_part + " not found");
+    const auto slash = document_part.rfind('/');
+    const std::string base_dir = slash == std::string::npos ? "" : document_part.substr(0, slash);
+
+    Relationships relationships;
+    ParseRelationships(zip, document_part, relationships, docx_path);
+    // 文書の中のリンク先（外部のもの以外は ZIP の中の部品なので使わない）
+    Relationships links;
+    for (auto& [id, relationship] : relationships) {
+        if (EndsWith(relationship.type, "/hyperlink") && relationship.external) links.emplace(id, relationship);
+    }
+
+    Styles styles;
+    const auto* styles_relationship = FindRelationship(relationships, "/styles");
+    if (const auto* entry = zip.Find(styles_relationship ? ResolveTarget(base_dir, styles_relationship->target)
+                                                          : ResolveTarget(base_dir, "styles.xml"))) {
+        StylesHandler handler(styles);
+        ParsePart(zip, *entry, handler, docx_path, cancel);
+    }
+    Numbering numbering;
+    const auto* numbering_relationship = FindRelationship(relationships, "/numbering");
+    if (const auto* entry = zip.Find(numbering_relationship ? ResolveTarget(base_dir, numbering_relationship->target)
+                                                             : ResolveTarget(base_dir, "numbering.xml"))) {
+        NumberingHandler handler(numbering);
+        ParsePart(zip, *entry, handler, docx_path, cancel);
+    }
+
+    Result result;
+    DocumentHandler handler(styles, numbering, links, on_markdown, result);
+    ParsePart(zip, *document, handler, docx_path, cancel);
+    handler.Finish();
+    return result;
+}
+
+}
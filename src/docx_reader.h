@@ -0,0 +1,28 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace ShinoEditor {
+
+// DOCX（WordprocessingML）を pandoc を使わずに Markdown にする
+// - word/document.xml は ZIP から展開しながら XmlScanner で読み、段落を読み終えるたびに Markdown を足していく
+//   （文書全体の XML も DOM も作らない。溜まった分を on_markdown に渡す）
+// - 見出し・太字/斜体/打ち消し線・箇条書き/番号付きリスト・表・コード・引用・リンク・水平線に対応する
+//   見出しやコードはスタイルの名前で見分け、basedOn を辿る。要素と属性は "w:" 接頭辞で書かれているものとする
+// - 画像・数式・脚注・入れ子の表・結合したセルなどは落として続け、Result::unsupported に記録する
+class DocxReader {
+public:
+    struct Result {
+        std::string unsupported; // 落とした内容の最初の 1 つ（"w:drawing" など）
+        bool Complete() const { return unsupported.empty(); }
+    };
+
+    // 開けなければ ShinoError（File）、DOCX として読めなければ ShinoError（Parser）
+    // cancel が立てば ShinoError（Convert）
+    static Result Convert(const std::string& docx_path, const std::function<void(std::string_view)>& on_markdown,
+                          const std::atomic<bool>* cancel = nullptr);
+};
+
+}
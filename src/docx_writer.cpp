@@ -0,0 +1,651 @@
+#include "docx_writer.h"
+#include "error_handler.h"
+#include "markdown_renderer.h"
+#include "output_file.h"
+#include "zip_archive.h"
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+#include <vector>
+
+namespace ShinoEditor {
+
+namespace {
+// 溜まった XML を ZIP に渡す目安
+constexpr size_t kFlushBytes = 64 * 1024;
+constexpr int kMaxHeadingLevel = 6;
+constexpr int kListLevels = 9;
+// 字下げと表の幅（1/20 pt。表は A4 の本文の幅に合わせる）
+constexpr int kListIndent = 720;
+constexpr int kTextWidth = 9026;
+
+// run の書式（ビットの組み合わせ）
+constexpr uint8_t kBold = 1;
+constexpr uint8_t kItalic = 2;
+constexpr uint8_t kStrike = 4;
+constexpr uint8_t kCode = 8;
+
+constexpr const char* kXmlDeclaration = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+constexpr const char* kWordNamespace = "http://schemas.openxmlformats.org/wordprocessingml/2006/main";
+constexpr const char* kRelationshipType = "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+
+// テキストを XML に。XML に書けない制御文字は落とす
+void AppendEscaped(std::string_view text, std::string& out, bool attribute = false) {
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        const char* replacement = nullptr;
+        switch (c) {
+        case '&': replacement = "&amp;"; break;
+        case '<': replacement = "&lt;"; break;
+        case '>': replacement = "&gt;"; break;
+        case '"': replacement = attribute ? "&quot;" : nullptr; break;
+        default:  replacement = c < 0x20 && c != '\t' && c != '\n' && c != '\r' ? "" : nullptr; break;
+        }
+        if (!replacement) continue;
+        out.append(text.substr(start, i - start));
+        out += replacement;
+        start = i + 1;
+    }
+    out.append(text.substr(start));
+}
+
+std::string ContentTypes() {
+    const std::string prefix = "application/vnd.openxmlformats-officedocument.wordprocessingml.";
+    return std::string(kXmlDeclaration) +
+           "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+           "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+           "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+           "<Override PartName=\"/word/document.xml\" ContentType=\"" + prefix + "document.main+xml\"/>"
+           "<Override PartName=\"/word/styles.xml\" ContentType=\"" + prefix + "styles+xml\"/>"
+           "<Override PartName=\"/word/numbering.xml\" ContentType=\"" + prefix + "numbering+xml\"/>"
+           "</Types>";
+}
+
+std::string PackageRelationships() {
+    return std::string(kXmlDeclaration) +
+           "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+           "<Relationship Id=\"rId1\" Type=\"" + kRelationshipType + "/officeDocument\" Target=\"word/document.xml\"/>"
+           "</Relationships>";
+}
+
+// links[i] は "rIdLink<i + 1>" のリンク先
+std::string DocumentRelationships(const std::vector<std::string>& links) {
+    std::string xml = std::string(kXmlDeclaration) +
+                      "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+                      "<Relationship Id=\"rIdStyles\" Type=\"" + kRelationshipType + "/styles\" Target=\"styles.xml\"/>"
+                      "<Relationship Id=\"rIdNumbering\" Type=\"" + kRelationshipType + "/numbering\" Target=\"numbering.xml\"/>";
+    for (size_t i = 0; i < links.size(); ++i) {
+        xml += "<Relationship Id=\"rIdLink" + std::to_string(i + 1) + "\" Type=\"" + kRelationshipType +
+               "/hyperlink\" Target=\"";
+        AppendEscaped(links[i], xml, true);
+        xml += "\" TargetMode=\"External\"/>";
+    }
+    xml += "</Relationships>";
+    return xml;
+}
+
+// pandoc の reference.docx と同じ名前のスタイル（DocxReader は名前で見分ける）
+std::string Styles() {
+    auto style = [](const char* type, const std::string& id, const std::string& name, const std::string& body) {
+        return std::string("<w:style w:type=\"") + type + "\" w:styleId=\"" + id + "\"><w:name w:val=\"" + name +
+               "\"/>" + body + "</w:style>";
+    };
+    const std::string mono = "<w:rFonts w:ascii=\"Consolas\" w:hAnsi=\"Consolas\" w:cs=\"Consolas\"/><w:sz w:val=\"20\"/>";
+    std::string xml = std::string(kXmlDeclaration) + "<w:styles xmlns:w=\"" + kWordNamespace + "\">"
+        "<w:docDefaults><w:rPrDefault><w:rPr><w:sz w:val=\"22\"/></w:rPr></w:rPrDefault>"
+        "<w:pPrDefault><w:pPr><w:spacing w:after=\"120\"/></w:pPr></w:pPrDefault></w:docDefaults>";
+    xml += "<w:style w:type=\"paragraph\" w:default=\"1\" w:styleId=\"Normal\"><w:name w:val=\"Normal\"/><w:qFormat/></w:style>";
+    constexpr const char* kHeadingSizes[kMaxHeadingLevel] = {"32", "28", "26", "24", "22", "22"};
+    for (int level = 1; level <= kMaxHeadingLevel; ++level) {
+        const std::string n = std::to_string(level);
+        xml += style("paragraph", "Heading" + n, "heading " + n,
+                     "<w:basedOn w:val=\"Normal\"/><w:next w:val=\"Normal\"/><w:qFormat/>"
+                     "<w:pPr><w:keepNext/><w:spacing w:before=\"240\" w:after=\"60\"/><w:outlineLvl w:val=\"" +
+                         std::to_string(level - 1) + "\"/></w:pPr><w:rPr><w:b/><w:sz w:val=\"" +
+                         kHeadingSizes[level - 1] + "\"/></w:rPr>");
+    }
+    xml += style("paragraph", "SourceCode", "Source Code",
+                 "<w:basedOn w:val=\"Normal\"/><w:pPr><w:wordWrap w:val=\"off\"/><w:spacing w:after=\"0\"/></w:pPr>"
+                 "<w:rPr>" + mono + "</w:rPr>");
+    xml += style("paragraph", "BlockText", "Block Text",
+                 "<w:basedOn w:val=\"Normal\"/><w:pPr><w:pBdr><w:left w:val=\"single\" w:sz=\"18\" w:space=\"8\" "
+                 "w:color=\"C0C0C0\"/></w:pBdr><w:ind w:left=\"480\"/></w:pPr>");
+    xml += style("character", "VerbatimChar", "Verbatim Char", "<w:rPr>" + mono + "</w:rPr>");
+    xml += style("character", "Hyperlink", "Hyperlink", "<w:rPr><w:color w:val=\"0563C1\"/><w:u w:val=\"single\"/></w:rPr>");
+    std::string borders;
+    for (const char* side : {"top", "left", "bottom", "right", "insideH", "insideV"}) {
+        borders += std::string("<w:") + side + " w:val=\"single\" w:sz=\"4\" w:space=\"0\" w:color=\"A0A0A0\"/>";
+    }
+    xml += style("table", "Table", "Table",
+                 "<w:tblPr><w:tblBorders>" + borders + "</w:tblBorders></w:tblPr>"
+                 "<w:tblStylePr w:type=\"firstRow\"><w:rPr><w:b/></w:rPr></w:tblStylePr>");
+    xml += "</w:styles>";
+    return xml;
+}
+
+// 番号付きリストは 1 つごとに番号を分け、開始番号を上書きする
+struct OrderedList {
+    int num_id;
+    int level;
+    int start;
+};
+
+constexpr int kBulletNumId = 1;
+
+std::string Numbering(const std::vector<OrderedList>& ordered_lists) {
+    auto levels = [](bool ordered) {
+        constexpr const char* kBullets[] = {"\xE2\x80\xA2", "\xE2\x97\xA6", "\xE2\x96\xAA"}; // • ◦ ▪
+        constexpr const char* kFormats[] = {"decimal", "lowerLetter", "lowerRoman"};
+        std::string xml;
+        for (int level = 0; level < kListLevels; ++level) {
+            // "%" + to_string(...) は GCC 12 の -O3 で -Wrestrict の誤検出になるので append で組み立てる
+            std::string text;
+            if (ordered) {
+                text.append("%").append(std::to_string(level + 1)).append(".");
+            } else {
+                text = kBullets[level % 3];
+            }
+            xml += "<w:lvl w:ilvl=\"" + std::to_string(level) + "\"><w:start w:val=\"1\"/><w:numFmt w:val=\"" +
+                   (ordered ? kFormats[level % 3] : "bullet") + "\"/><w:lvlText w:val=\"" + text +
+                   "\"/><w:lvlJc w:val=\"left\"/><w:pPr><w:ind w:left=\"" + std::to_string(kListIndent * (level + 1)) +
+                   "\" w:hanging=\"360\"/></w:pPr></w:lvl>";
+        }
+        return xml;
+    };
+    std::string xml = std::string(kXmlDeclaration) + "<w:numbering xmlns:w=\"" + kWordNamespace + "\">" +
+                      "<w:abstractNum w:abstractNumId=\"0\"><w:multiLevelType w:val=\"hybridMultilevel\"/>" +
+                      levels(false) + "</w:abstractNum>" +
+                      "<w:abstractNum w:abstractNumId=\"1\"><w:multiLevelType w:val=\"hybridMultilevel\"/>" +
+                      levels(true) + "</w:abstractNum>" +
+                      "<w:num w:numId=\"" + std::to_string(kBulletNumId) + "\"><w:abstractNumId w:val=\"0\"/></w:num>";
+    for (const auto& list : ordered_lists) {
+        xml += "<w:num w:numId=\"" + std::to_string(list.num_id) + "\"><w:abstractNumId w:val=\"1\"/>"
+               "<w:lvlOverride w:ilvl=\"" + std::to_string(list.level) + "\"><w:startOverride w:val=\"" +
+               std::to_string(list.start) + "\"/></w:lvlOverride></w:num>";
+    }
+    xml += "</w:numbering>";
+    return xml;
+}
+
+// パーサーのイベントから word/document.xml を組み立て、溜まった分ずつ ZIP の項目に書く
+class DocumentWriter : public MarkdownHandler {
+public:
+    DocumentWriter(ZipWriter& zip, DocxWriter::Result& result) : zip_(zip), result_(result) {
+        out_ = std::string(kXmlDeclaration) + "<w:document xmlns:w=\"" + kWordNamespace + "\" xmlns:r=\"" +
+               kRelationshipType + "\" xmlns:v=\"urn:schemas-microsoft-com:vml\" "
+               "xmlns:o=\"urn:schemas-microsoft-com:office:office\"><w:body>";
+    }
+
+    void Finish() {
+        CloseParagraph();
+        // A4、余白 1 インチ
+        out_ += "<w:sectPr><w:pgSz w:w=\"11906\" w:h=\"16838\"/><w:pgMar w:top=\"1440\" w:right=\"1440\" "
+                "w:bottom=\"1440\" w:left=\"1440\" w:header=\"720\" w:footer=\"720\" w:gutter=\"0\"/></w:sectPr>"
+                "</w:body></w:document>";
+        zip_.Write(out_);
+        out_.clear();
+    }
+
+    const std::vector<std::string>& Links() const { return links_; }
+    const std::vector<OrderedList>& OrderedLists() const { return ordered_lists_; }
+
+    void EnterBlock(MarkdownBlock type, int detail) override {
+        // 段落のない箇条（詰めたリストの項目、表のセル）の文字は、次のブロックの前で閉じる
+        if (type != MarkdownBlock::TABLE_HEAD && type != MarkdownBlock::TABLE_BODY &&
+            type != MarkdownBlock::TABLE_ROW) {
+            CloseParagraph();
+        }
+        switch (type) {
+        case MarkdownBlock::QUOTE:
+            ++quote_depth_;
+            break;
+        case MarkdownBlock::UNORDERED_LIST:
+        case MarkdownBlock::ORDERED_LIST: {
+            List list;
+            if (type == MarkdownBlock::ORDERED_LIST) {
+                list.num_id = next_num_id_++;
+                ordered_lists_.push_back({list.num_id, ListLevel(lists_.size()), std::max(detail, 0)});
+            }
+            lists_.push_back(list);
+            break;
+        }
+        case MarkdownBlock::LIST_ITEM:
+            if (!lists_.empty()) lists_.back().item_numbered = false;
+            break;
+        case MarkdownBlock::RULE:
+            // pandoc と同じ VML の水平線
+            out_ += "<w:p><w:r><w:pict><v:rect o:hr=\"t\" o:hrstd=\"t\" o:hralign=\"center\" "
+                    "style=\"width:0;height:1.5pt\" fillcolor=\"#a0a0a0\" stroked=\"f\"/></w:pict></w:r></w:p>";
+            break;
+        case MarkdownBlock::HEADER:
+            heading_ = std::clamp(detail, 1, kMaxHeadingLevel);
+            OpenParagraph();
+            // "#見出し" へのリンクの飛び先。名前は見出しの文字が揃ってから差し込む
+            heading_start_ = out_.size();
+            heading_text_.clear();
+            break;
+        case MarkdownBlock::CODE:
+        case MarkdownBlock::HTML:
+            // HTML ブロックは Word では表せないので、コードとしてそのまま残す
+            in_code_ = true;
+            code_line_.clear();
+            break;
+        case MarkdownBlock::PARAGRAPH:
+            OpenParagraph();
+            break;
+        case MarkdownBlock::TABLE:
+            // 列の数は最初の行を読み終えるまで分からないので、表の属性はそのとき先頭に差し込む
+            table_start_ = out_.size();
+            table_columns_ = 0;
+            in_first_row_ = true;
+            out_ += "<w:tbl>";
+            break;
+        case MarkdownBlock::TABLE_HEAD:
+            in_table_head_ = true;
+            break;
+        case MarkdownBlock::TABLE_ROW:
+            out_ += in_table_head_ ? "<w:tr><w:trPr><w:tblHeader/></w:trPr>" : "<w:tr>";
+            break;
+        case MarkdownBlock::TABLE_HEADER_CELL:
+        case MarkdownBlock::TABLE_CELL:
+            if (in_first_row_) ++table_columns_;
+            out_ += "<w:tc>";
+            break;
+        default:
+            break;
+        }
+    }
+
+    void LeaveBlock(MarkdownBlock type) override {
+        switch (type) {
+        case MarkdownBlock::QUOTE:
+            CloseParagraph();
+            --quote_depth_;
+            break;
+        case MarkdownBlock::UNORDERED_LIST:
+        case MarkdownBlock::ORDERED_LIST:
+            CloseParagraph();
+            if (!lists_.empty()) lists_.pop_back();
+            break;
+        case MarkdownBlock::LIST_ITEM:
+            // 空の項目も番号（記号）だけの段落にする
+            if (!in_paragraph_ && !lists_.empty() && !lists_.back().item_numbered) OpenParagraph();
+            CloseParagraph();
+            break;
+        case MarkdownBlock::HEADER:
+            CloseRun();
+            InsertBookmark();
+            CloseParagraph();
+            heading_ = 0;
+            break;
+        case MarkdownBlock::CODE:
+        case MarkdownBlock::HTML:
+            if (!code_line_.empty()) EmitCodeLine();
+            in_code_ = false;
+            break;
+        case MarkdownBlock::TABLE_HEAD:
+            in_table_head_ = false;
+            break;
+        case MarkdownBlock::TABLE_ROW:
+            out_ += "</w:tr>";
+            if (in_first_row_) {
+                in_first_row_ = false;
+                InsertTableProperties();
+            }
+            break;
+        case MarkdownBlock::TABLE_HEADER_CELL:
+        case MarkdownBlock::TABLE_CELL:
+            // セルには段落が少なくとも 1 つ要る
+            if (in_paragraph_) {
+                CloseParagraph();
+            } else {
+                out_ += "<w:p/>";
+            }
+            out_ += "</w:tc>";
+            break;
+        case MarkdownBlock::TABLE:
+            out_ += "</w:tbl>";
+            break;
+        default:
+            CloseParagraph();
+            break;
+        }
+        FlushIfLarge();
+    }
+
+    void EnterSpan(MarkdownSpan type, std::string_view url) override {
+        switch (type) {
+        case MarkdownSpan::EMPHASIS: ++italic_; break;
+        case MarkdownSpan::STRONG:   ++bold_; break;
+        case MarkdownSpan::STRIKE:   ++strike_; break;
+        case MarkdownSpan::CODE:     ++code_; break;
+        case MarkdownSpan::IMAGE:
+            // 画像は埋め込まず、代替テキストだけを残す
+            Unsupported("image");
+            break;
+        case MarkdownSpan::LINK:
+            if (url.empty() || in_link_) break;
+            if (!in_paragraph_) OpenParagraph();
+            CloseRun();
+            if (url[0] == '#') {
+                out_ += "<w:hyperlink w:anchor=\"";
+                AppendEscaped(url.substr(1), out_, true);
+            } else {
+                out_ += "<w:hyperlink r:id=\"rIdLink" + std::to_string(LinkIndex(url) + 1);
+            }
+            out_ += "\">";
+            in_link_ = true;
+            break;
+        }
+    }
+
+    void LeaveSpan(MarkdownSpan type) override {
+        switch (type) {
+        case MarkdownSpan::EMPHASIS: --italic_; break;
+        case MarkdownSpan::STRONG:   --bold_; break;
+        case MarkdownSpan::STRIKE:   --strike_; break;
+        case MarkdownSpan::CODE:     --code_; break;
+        case MarkdownSpan::IMAGE:    break;
+        case MarkdownSpan::LINK:
+            if (!in_link_) break;
+            CloseRun();
+            out_ += "</w:hyperlink>";
+            in_link_ = false;
+            break;
+        }
+    }
+
+    void Text(std::string_view text) override {
+        if (!in_code_) {
+            if (heading_ > 0) heading_text_.append(text);
+            AppendRunText(text);
+            return;
+        }
+        // コードは 1 行を 1 段落にする（DocxReader と pandoc はどちらも続いたコード段落を 1 つのブロックにする）
+        for (size_t newline; (newline = text.find('\n')) != std::string_view::npos;) {
+            code_line_.append(text.substr(0, newline));
+            EmitCodeLine();
+            text.remove_prefix(newline + 1);
+        }
+        code_line_.append(text);
+    }
+
+    void SoftBreak() override {
+        if (heading_ > 0) heading_text_ += ' ';
+        AppendRunText(" ");
+    }
+
+    void HardBreak() override {
+        if (!in_paragraph_) OpenParagraph();
+        CloseRun();
+        out_ += "<w:r><w:br/></w:r>";
+    }
+
+private:
+    struct List {
+        int num_id = kBulletNumId;
+        bool item_numbered = false; // 項目の最初の段落に番号を付けた
+    };
+
+    ZipWriter& zip_;
+    DocxWriter::Result& result_;
+    std::string out_;
+
+    // 段落
+    bool in_paragraph_ = false;
+    int heading_ = 0;
+    bool in_code_ = false;
+    std::string code_line_;
+    int quote_depth_ = 0;
+    std::vector<List> lists_;
+    std::vector<OrderedList> ordered_lists_;
+    int next_num_id_ = kBulletNumId + 1;
+
+    // run
+    int bold_ = 0;
+    int italic_ = 0;
+    int strike_ = 0;
+    int code_ = 0;
+    bool in_run_ = false;
+    uint8_t run_format_ = 0;
+
+    // リンク（同じリンク先は同じ関係を使う）
+    bool in_link_ = false;
+    std::unordered_map<std::string, size_t> link_indices_;
+    std::vector<std::string> links_;
+
+    // 見出しのブックマーク（名前は GitHub と同じ付け方で、重複には -1, -2 ... を付ける）
+    size_t heading_start_ = 0;
+    std::string heading_text_;
+    std::unordered_map<std::string, int> bookmark_counts_;
+    int next_bookmark_id_ = 0;
+
+    // 表
+    size_t table_start_ = 0;
+    int table_columns_ = 0;
+    bool in_first_row_ = false;
+    bool in_table_head_ = false;
+
+    void Unsupported(std::string_view what) {
+        if (result_.unsupported.empty()) result_.unsupported = what;
+    }
+
+    // depth 番目（0 から）のリストの階層。深すぎれば最後の階層にまとめる
+    static int ListLevel(size_t depth) {
+        return std::min(static_cast<int>(depth), kListLevels - 1);
+    }
+
+    size_t LinkIndex(std::string_view url) {
+        auto [it, inserted] = link_indices_.try_emplace(std::string(url), links_.size());
+        if (inserted) links_.emplace_back(url);
+        return it->second;
+    }
+
+    void OpenParagraph() {
+        in_paragraph_ = true;
+        out_ += "<w:p>";
+        std::string_view style;
+        if (heading_ > 0) {
+            style = kHeadingStyles[heading_ - 1];
+        } else if (in_code_) {
+            style = "SourceCode";
+        } else if (quote_depth_ > 0) {
+            style = "BlockText";
+        }
+        // リストの項目の最初の段落に番号を付け、続きの段落は字下げだけ揃える
+        const bool numbered = !lists_.empty() && heading_ == 0 && !in_code_ && !lists_.back().item_numbered;
+        const bool indented = !lists_.empty() && heading_ == 0 && !numbered;
+        if (style.empty() && !numbered && !indented) return;
+        out_ += "<w:pPr>";
+        if (!style.empty()) {
+            out_ += "<w:pStyle w:val=\"";
+            out_.append(style);
+            out_ += "\"/>";
+        }
+        if (numbered) {
+            lists_.back().item_numbered = true;
+            out_ += "<w:numPr><w:ilvl w:val=\"" + std::to_string(ListLevel(lists_.size() - 1)) + "\"/><w:numId w:val=\"" +
+                    std::to_string(lists_.back().num_id) + "\"/></w:numPr>";
+        } else if (indented) {
+            out_ += "<w:ind w:left=\"" + std::to_string(kListIndent * (ListLevel(lists_.size() - 1) + 1)) + "\"/>";
+        }
+        out_ += "</w:pPr>";
+    }
+
+    void CloseParagraph() {
+        if (!in_paragraph_) return;
+        CloseRun();
+        if (in_link_) {
+            out_ += "</w:hyperlink>";
+            in_link_ = false;
+        }
+        out_ += "</w:p>";
+        in_paragraph_ = false;
+    }
+
+    // 書式が同じ間は 1 つの run に続ける
+    void AppendRunText(std::string_view text) {
+        if (!in_paragraph_) OpenParagraph();
+        const uint8_t format = (bold_ > 0 ? kBold : 0) | (italic_ > 0 ? kItalic : 0) |
+                               (strike_ > 0 ? kStrike : 0) | (code_ > 0 ? kCode : 0);
+        if (in_run_ && format != run_format_) CloseRun();
+        if (!in_run_) {
+            out_ += "<w:r>";
+            if (format != 0 || in_link_) {
+                out_ += "<w:rPr>";
+                if (format & kCode) {
+                    out_ += "<w:rStyle w:val=\"VerbatimChar\"/>";
+                } else if (in_link_) {
+                    out_ += "<w:rStyle w:val=\"Hyperlink\"/>";
+                }
+                if (format & kBold) out_ += "<w:b/>";
+                if (format & kItalic) out_ += "<w:i/>";
+                if (format & kStrike) out_ += "<w:strike/>";
+                out_ += "</w:rPr>";
+            }
+            out_ += "<w:t xml:space=\"preserve\">";
+            in_run_ = true;
+            run_format_ = format;
+        }
+        AppendEscaped(text, out_);
+    }
+
+    void CloseRun() {
+        if (!in_run_) return;
+        out_ += "</w:t></w:r>";
+        in_run_ = false;
+    }
+
+    void EmitCodeLine() {
+        OpenParagraph();
+        if (!code_line_.empty()) {
+            out_ += "<w:r><w:t xml:space=\"preserve\">";
+            AppendEscaped(code_line_, out_);
+            out_ += "</w:t></w:r>";
+        }
+        out_ += "</w:p>";
+        in_paragraph_ = false;
+        code_line_.clear();
+        FlushIfLarge();
+    }
+
+    // GitHub の見出しの id: 英字を小文字にし、英数字と - _ と空白以外の ASCII を除き、空白を - にする
+    // （ASCII 以外はそのまま残す）
+    static std::string HeadingSlug(std::string_view text) {
+        std::string slug;
+        for (const char c : text) {
+            const auto byte = static_cast<unsigned char>(c);
+            if (byte >= 0x80 || std::isalnum(byte) || c == '-' || c == '_') {
+                slug += static_cast<char>(std::tolower(byte));
+            } else if (c == ' ') {
+                slug += '-';
+            }
+        }
+        return slug;
+    }
+
+    void InsertBookmark() {
+        std::string name = HeadingSlug(heading_text_);
+        if (name.empty()) return;
+        const int seen = bookmark_counts_[name]++;
+        if (seen > 0) name += "-" + std::to_string(seen);
+        const std::string id = std::to_string(next_bookmark_id_++);
+        std::string start = "<w:bookmarkStart w:id=\"" + id + "\" w:name=\"";
+        AppendEscaped(name, start, true);
+        start += "\"/>";
+        out_.insert(heading_start_, start);
+        out_ += "<w:bookmarkEnd w:id=\"" + id + "\"/>";
+    }
+
+    void InsertTableProperties() {
+        const int columns = std::max(table_columns_, 1);
+        std::string properties =
+            "<w:tblPr><w:tblStyle w:val=\"Table\"/><w:tblW w:w=\"5000\" w:type=\"pct\"/>"
+            "<w:tblLook w:val=\"04A0\" w:firstRow=\"1\" w:lastRow=\"0\" w:firstColumn=\"0\" w:lastColumn=\"0\" "
+            "w:noHBand=\"1\" w:noVBand=\"1\"/></w:tblPr><w:tblGrid>";
+        const std::string column = "<w:gridCol w:w=\"" + std::to_string(kTextWidth / columns) + "\"/>";
+        for (int i = 0; i < columns; ++i) properties += column;
+        properties += "</w:tblGrid>";
+        out_.insert(table_start_ + std::string_view("<w:tbl>").size(), properties);
+    }
+
+    void FlushIfLarge() {
+        // 表の最初の行の間は、表の属性を差し込む位置を残しておく
+        if (out_.size() < kFlushBytes || in_first_row_) return;
+        zip_.Write(out_);
+        out_.clear();
+    }
+
+    static constexpr const char* kHeadingStyles[kMaxHeadingLevel] = {"Heading1", "Heading2", "Heading3",
+                                                                     "Heading4", "Heading5", "Heading6"};
+};
+}
+
+bool DocxWriter::HasPipeTable(std::string_view markdown) {
+    // 区切りの行（"| --- | :-: |" のように | - : と空白だけで、- と | を含む）が | を含む行の直後にあれば表
+    bool in_fence = false;
+    bool previous_has_pipe = false;
+    size_t pos = 0;
+    while (pos < markdown.size()) {
+        size_t end = markdown.find('\n', pos);
+        if (end == std::string_view::npos) end = markdown.size();
+        const std::string_view line = markdown.substr(pos, end - pos);
+        pos = end + 1;
+        const size_t first = line.find_first_not_of(" \t");
+        if (first != std::string_view::npos && first <= 3 &&
+            (line.compare(first, 3, "```") == 0 || line.compare(first, 3, "~~~") == 0)) {
+            in_fence = !in_fence;
+            previous_has_pipe = false;
+            continue;
+        }
+        if (in_fence) continue;
+        const bool has_pipe = line.find('|') != std::string_view::npos;
+        if (previous_has_pipe && has_pipe && line.find('-') != std::string_view::npos &&
+            line.find_first_not_of("|-: \t\r") == std::string_view::npos) {
+            return true;
+        }
+        previous_has_pipe = has_pipe;
+    }
+    return false;
+}
+
+DocxWriter::Result DocxWriter::Write(std::string_view markdown, const std::string& docx_path,
+                                     const std::atomic<bool>* cancel, bool compress) {
+    OutputFile file(docx_path, "DOCX");
+    FdSink sink(file.fd());
+    const Result result = Write(markdown, sink, cancel, compress);
+    // 書き込みの失敗は Commit で ShinoError にする
+    file.Commit(sink);
+    return result;
+}
+
+DocxWriter::Result DocxWriter::Write(std::string_view markdown, FdSink& sink,
+                                     const std::atomic<bool>* cancel, bool compress) {
+    const uint16_t method = compress ? ZipReader::kDeflated : ZipReader::kStored;
+    Result result;
+    ZipWriter zip(sink);
+    zip.Add("[Content_Types].xml", ContentTypes(), method);
+    zip.Add("_rels/.rels", PackageRelationships(), method);
+
+    zip.Begin("word/document.xml", method);
+    DocumentWriter writer(zip, result);
+    if (!MarkdownRenderer::Parse(markdown, writer, cancel)) {
+        error::ThrowConversionFailed("markdown", "docx", "cancelled");
+    }
+    writer.Finish();
+    zip.End();
+    // フォールバックパーサーは表に対応しないので、表は段落の文字になっている
+    if (result.unsupported.empty() && !MarkdownRenderer::IsAvailable() && HasPipeTable(markdown)) {
+        result.unsupported = "table";
+    }
+
+    zip.Add("word/_rels/document.xml.rels", DocumentRelationships(writer.Links()), method);
+    zip.Add("word/styles.xml", Styles(), method);
+    zip.Add("word/numbering.xml", Numbering(writer.OrderedLists()), method);
+    zip.Finish();
+    result.output_bytes = zip.BytesWritten();
+    return result;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ShinoEditor {
+
+class FdSink;
+
+// Markdown を pandoc を使わずに DOCX（WordprocessingML）にする
+// - MarkdownRenderer::Parse のイベント（md4c かフォールバックパーサー）から word/document.xml を組み立て、
+//   DEFLATE しながら ZipWriter で出力先の fd に直接流す（文書全体の XML も ZIP もメモリに持たない）
+// - スタイルは pandoc の出力と同じ名前の最小限のもの（見出し 1〜6、Source Code、Block Text、Verbatim Char、
+//   Hyperlink、表）なので、DocxReader や pandoc で読み戻せる
+// - 見出しには GitHub と同じ付け方の名前でブックマークを置き、"[...](#見出し)" のリンクの飛び先にする
+// - 画像は代替テキストだけを書き、Result::unsupported に記録する。md4c がなければ（フォールバックパーサーは
+//   表に対応しないので）表も段落の文字として書き、"table" を記録する
+// - 一時ファイルに書いてから rename するので、失敗しても既存のファイルは壊れない
+class DocxWriter {
+public:
+    struct Result {
+        std::string unsupported; // 落とした内容の最初の 1 つ（"image" など）
+        uint64_t output_bytes = 0;
+        bool Complete() const { return unsupported.empty(); }
+    };
+
+    // compress が false なら ZIP の項目を格納で書く（速いが大きい）
+    // 書けなければ ShinoError（File）、cancel が立てば ShinoError（Convert）
+    static Result Write(std::string_view markdown, const std::string& docx_path,
+                        const std::atomic<bool>* cancel = nullptr, bool compress = true);
+    // sink に書くだけで出力先には移さない（呼び出し側が OutputFile::Commit で移すか、捨てる）
+    static Result Write(std::string_view markdown, FdSink& sink,
+                        const std::atomic<bool>* cancel = nullptr, bool compress = true);
+    // GFM の表（見出しの行と区切りの行）を含むか（フェンスの中は見ない）
+    static bool HasPipeTable(std::string_view markdown);
+};
+
+}
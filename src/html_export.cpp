@@ -0,0 +1,131 @@
+#include "html_export.h"
+#include "block_render_cache.h"
+#include "error_handler.h"
+#include "output_file.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace ShinoEditor {
+
+namespace {
+void AppendEscapedTitle(std::string& out, const std::string& title) {
+    for (char c : title) {
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        default:  out += c; break;
+        }
+    }
+}
+
+// lines[begin, end) を 1 つの Markdown にしてレンダリングする
+void RenderLines(const MarkdownRenderer& renderer, const std::vector<std::string>& lines,
+                 size_t begin, size_t end, FdSink& sink, HtmlExport::Stats& stats) {
+    size_t size = 0;
+    for (size_t i = begin; i < end; ++i) size += lines[i].size() + 1;
+    std::string markdown;
+    markdown.reserve(size);
+    for (size_t i = begin; i < end; ++i) {
+        markdown += lines[i];
+        markdown += '\n';
+    }
+    renderer.RenderHtmlTo(markdown, sink);
+    ++stats.chunks;
+}
+}
+
+void HtmlExport::WriteHeader(RenderSink& sink, const std::string& title) {
+    std::string header = "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>";
+    AppendEscapedTitle(header, title);
+    header += "</title>\n</head>\n<body>\n";
+    sink.Write(header);
+}
+
+void HtmlExport::WriteFooter(RenderSink& sink) {
+    sink.Write("</body>\n</html>\n");
+}
+
+std::string HtmlExport::DefaultOutputPath(const std::string& input_path) {
+    if (input_path.empty()) return "document.html";
+    return std::filesystem::path(input_path).replace_extension(".html").string();
+}
+
+HtmlExport::Stats HtmlExport::ExportLines(const MarkdownRenderer& renderer,
+                                          const std::vector<std::string>& lines,
+                                          const std::vector<std::shared_ptr<Block>>& blocks,
+                                          const std::string& output_path,
+                                          const std::string& title) {
+    Stats stats;
+    OutputFile file(output_path, "HTML");
+    FdSink sink(file.fd());
+    WriteHeader(sink, title);
+    // 単位の HTML の連結は文書全体の HTML と同じなので、単位ごとに流せば最大の単位分しか持たない
+    for (const auto& range : BlockRenderCache::SplitRenderUnits(lines, blocks)) {
+        RenderLines(renderer, lines, range.begin, range.end, sink, stats);
+    }
+    WriteFooter(sink);
+    for (const auto& line : lines) stats.input_bytes += line.size() + 1;
+    file.Commit(sink);
+    stats.output_bytes = sink.BytesWritten();
+    return stats;
+}
+
+HtmlExport::Stats HtmlExport::ExportFile(const MarkdownRenderer& renderer,
+                                         const std::string& input_path,
+                                         const std::string& output_path,
+                                         size_t window_bytes) {
+    std::ifstream in(input_path, std::ios::binary);
+    if (!in) error::ThrowFileNotFound(input_path);
+
+    // リンク参照定義は文書全体から参照されるので、あれば分割せずに 1 回でレンダリングする
+    bool whole_document = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (BlockRenderCache::IsLinkReferenceDefinition(line)) {
+            whole_document = true;
+            break;
+        }
+    }
+    in.clear();
+    in.seekg(0);
+
+    Stats stats;
+    OutputFile file(output_path, "HTML");
+    FdSink sink(file.fd());
+    WriteHeader(sink, std::filesystem::path(input_path).stem().string());
+
+    // 読み込んだ行のうち、後続の行で境界が変わらないと確定した単位（最後の単位以外）から書き出す
+    window_bytes = std::max<size_t>(window_bytes, 1);
+    std::vector<std::string> window;
+    size_t window_size = 0;
+    size_t threshold = window_bytes;
+    while (std::getline(in, line)) {
+        stats.input_bytes += line.size() + 1;
+        window_size += line.size() + 1;
+        window.push_back(std::move(line));
+        if (whole_document || window_size < threshold) continue;
+
+        BlockModel model(window);
+        const auto units = BlockRenderCache::SplitRenderUnits(window, model.GetBlocks());
+        if (units.size() > 1) {
+            const size_t done = static_cast<size_t>(units.back().begin);
+            RenderLines(renderer, window, 0, done, sink, stats);
+            window.erase(window.begin(), window.begin() + done);
+            window_size = 0;
+            for (const auto& rest : window) window_size += rest.size() + 1;
+        }
+        // 分割できない大きな単位で毎行解析し直さないよう、次の判定までの量を倍々に増やす
+        threshold = window_size + std::max(window_bytes, window_size);
+    }
+    if (in.bad()) error::ThrowFileNotFound(input_path);
+    if (!window.empty()) RenderLines(renderer, window, 0, window.size(), sink, stats);
+    WriteFooter(sink);
+    file.Commit(sink);
+    stats.output_bytes = sink.BytesWritten();
+    return stats;
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "block_model.h"
+#include "markdown_renderer.h"
+#include "render_sink.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ShinoEditor {
+
+// Markdown を単体の HTML ファイルとして書き出す
+// - レンダリング単位（BlockRenderCache::SplitRenderUnits）ごとに FdSink へ流すので、
+//   出力全体をメモリに持たない
+// - 一時ファイルに書いてから rename するので、失敗しても既存のファイルは壊れない
+// 失敗したら ShinoError（Category::File）を投げる
+class HtmlExport {
+public:
+    // ExportFile が一度に読み込む目安（これを超えたら確定した単位から書き出す）
+    static constexpr size_t kDefaultWindowBytes = 1024 * 1024;
+
+    struct Stats {
+        size_t input_bytes = 0;
+        size_t output_bytes = 0;
+        size_t chunks = 0;   // RenderHtmlTo を呼んだ回数
+    };
+
+    // 編集中の文書を書き出す（blocks は lines の BlockModel のブロック）
+    static Stats ExportLines(const MarkdownRenderer& renderer,
+                             const std::vector<std::string>& lines,
+                             const std::vector<std::shared_ptr<Block>>& blocks,
+                             const std::string& output_path,
+                             const std::string& title);
+
+    // ファイルを行単位で読みながら書き出す（コマンドラインの --export-html 用）
+    // メモリは window_bytes と最大の単位の大きさ程度に収まる
+    static Stats ExportFile(const MarkdownRenderer& renderer,
+                            const std::string& input_path,
+                            const std::string& output_path,
+                            size_t window_bytes = kDefaultWindowBytes);
+
+    // 文書の前後に付ける HTML
+    static void WriteHeader(RenderSink& sink, const std::string& title);
+    static void WriteFooter(RenderSink& sink);
+
+    // "notes.md" → "notes.html"
+    static std::string DefaultOutputPath(const std::string& input_path);
+};
+
+}
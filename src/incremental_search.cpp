@@ -0,0 +1,218 @@
+#include "incremental_search.h"
+#include <algorithm>
+
+namespace ShinoEditor {
+
+namespace {
+const std::string kEmptyQuery;
+const std::vector<SearchMatch> kNoMatches;
+}
+
+void IncrementalSearch::Entry::AddPosition(const SearchMatch& position) {
+    positions.push_back(position);
+    // 左から貪欲に、直前の一致と重ならないものだけを表示用に取る
+    if (matches.empty() || matches.back().line != position.line ||
+        matches.back().offset + matches.back().length <= position.offset) {
+        matches.push_back(position);
+    }
+}
+
+IncrementalSearch::IncrementalSearch(const std::vector<std::string>& lines, ThreadPool* pool)
+    : lines_(lines), pool_(pool) {}
+
+void IncrementalSearch::SetQuery(const std::string& query, uint64_t revision) {
+    if (revision != revision_) {
+        Clear();
+        revision_ = revision;
+    }
+    // 新しいクエリの接頭辞になっている段まではそのまま使える
+    size_t keep = 0;
+    while (keep < stack_.size() && query.starts_with(stack_[keep].query)) ++keep;
+    if (query.empty()) {
+        depth_ = 0;
+        return;
+    }
+    if (keep > 0 && stack_[keep - 1].query == query) {
+        // 縮めた（または同じ文字を打ち直した）: 積んである結果を使う
+        depth_ = keep;
+        return;
+    }
+    stack_.erase(stack_.begin() + static_cast<std::ptrdiff_t>(keep), stack_.end());
+
+    Entry entry(query);
+    const Entry* parent = keep > 0 ? &stack_[keep - 1] : nullptr;
+    const bool refinable = parent && !parent->truncated;
+    // 前のクエリの走査が終わっていれば絞り込むだけで済む。終わっていなければ、索引が使えるなら
+    // 索引で絞った候補の行だけを調べる（走査は要らない）
+    if (!(refinable && parent->next_line >= lines_.size()) && index_ && index_->CandidateLines(query, candidates_)) {
+        entry.next_line = lines_.size();
+        for (size_t line : candidates_) {
+            const std::string& text = lines_[line];
+            for (size_t pos = entry.searcher.Find(text, 0); pos != std::string_view::npos && !entry.truncated;
+                 pos = entry.searcher.Find(text, pos + 1)) {
+                entry.AddPosition({static_cast<int>(line), pos, query.size()});
+                entry.truncated = entry.positions.size() >= kMaxPositions;
+            }
+            if (entry.truncated) {
+                entry.next_line = line;
+                break;
+            }
+        }
+    } else if (refinable) {
+        // 伸ばした: 新しいクエリの出現位置は前のクエリの出現位置の部分集合なので、その場で確かめる
+        // 前のクエリが走査の途中なら、残りは新しいクエリで続きから走査する
+        // 巨大な文書では一致ごとにキャッシュミスになるので、少し先の一致の位置を読み込ませておく
+        const auto& positions = parent->positions;
+        constexpr size_t kPrefetchDistance = 8;
+        for (size_t i = 0; i < positions.size(); ++i) {
+#if defined(__GNUC__)
+            if (i + kPrefetchDistance < positions.size()) {
+                const SearchMatch& ahead = positions[i + kPrefetchDistance];
+                __builtin_prefetch(lines_[ahead.line].data() + ahead.offset);
+            }
+#endif
+            const SearchMatch& p = positions[i];
+            const std::string& line = lines_[p.line];
+            if (line.compare(p.offset, query.size(), query) == 0) {
+                entry.AddPosition({p.line, p.offset, query.size()});
+            }
+        }
+        entry.next_line = parent->next_line;
+        entry.next_offset = parent->next_offset;
+    }
+    stack_.push_back(std::move(entry));
+    depth_ = stack_.size();
+}
+
+bool IncrementalSearch::Step(size_t budget_bytes) {
+    Entry* entry = Top();
+    if (!entry || entry->truncated) return true;
+    bool done = false;
+    if (pool_ && pool_->Size() > 0 && entry->next_offset == 0 && StepParallel(*entry, budget_bytes, done)) {
+        return done;
+    }
+    const size_t n = entry->query.size();
+    size_t scanned = 0;
+    while (entry->next_line < lines_.size() && scanned < budget_bytes) {
+        const std::string& line = lines_[entry->next_line];
+        const size_t begin = entry->next_offset;
+        // この回に調べる開始位置は [begin, chunk_end)。長い行は何回かに分けて調べる
+        const size_t chunk_end = std::min(line.size(), begin + (budget_bytes - scanned));
+        if (line.size() >= n) {
+            // chunk_end をまたぐ一致も見つかるように、パターン長 - 1 バイト先まで見せる
+            const std::string_view view(line.data(), std::min(line.size(), chunk_end + n - 1));
+            for (size_t pos = entry->searcher.Find(view, begin); pos != std::string_view::npos;
+                 pos = entry->searcher.Find(view, pos + 1)) {
+                entry->AddPosition({static_cast<int>(entry->next_line), pos, n});
+                if (entry->positions.size() >= kMaxPositions) {
+                    entry->truncated = true;
+                    return true;
+                }
+            }
+        }
+        // 空行も 1 バイトとして数える（空行ばかりの文書でも 1 回の量に上限がかかる）
+        scanned += chunk_end - begin + 1;
+        if (chunk_end >= line.size()) {
+            ++entry->next_line;
+            entry->next_offset = 0;
+        } else {
+            entry->next_offset = chunk_end;
+        }
+    }
+    return entry->next_line >= lines_.size();
+}
+
+bool IncrementalSearch::StepParallel(Entry& entry, size_t budget_bytes, bool& done) {
+    // 行境界で、1 区間あたり budget_bytes 程度になるように区切る（数えかたは Step() と同じ）
+    // budget_bytes より長い行は区間に入れない（1 スレッドで行の途中で区切りながら調べる）
+    const size_t max_partitions = pool_->Size() + 1;
+    partitions_.clear();
+    size_t line = entry.next_line;
+    while (partitions_.size() < max_partitions && line < lines_.size()) {
+        const size_t begin = line;
+        size_t bytes = 0;
+        while (line < lines_.size() && bytes < budget_bytes) {
+            const size_t cost = lines_[line].size() + 1;
+            if (cost > budget_bytes) break;
+            bytes += cost;
+            ++line;
+        }
+        if (line == begin) break;
+        partitions_.emplace_back(begin, line);
+        if (line < lines_.size() && lines_[line].size() + 1 > budget_bytes) break;
+    }
+    if (partitions_.size() < 2) return false;
+
+    // 区間ごとに重なりを含む出現位置を集める。上限を超える分は繋げるときに捨てるので、
+    // 各区間も残りの枠までで止める
+    const size_t room = kMaxPositions - entry.positions.size();
+    if (partition_positions_.size() < partitions_.size()) partition_positions_.resize(partitions_.size());
+    const SubstringSearcher& searcher = entry.searcher;
+    const size_t n = entry.query.size();
+    pool_->ParallelFor(partitions_.size(), [&](size_t p) {
+        std::vector<SearchMatch>& out = partition_positions_[p];
+        out.clear();
+        for (size_t i = partitions_[p].first; i < partitions_[p].second && out.size() < room; ++i) {
+            const std::string_view text = lines_[i];
+            for (size_t pos = searcher.Find(text, 0); pos != std::string_view::npos; pos = searcher.Find(text, pos + 1)) {
+                out.push_back({static_cast<int>(i), pos, n});
+                if (out.size() >= room) break;
+            }
+        }
+    });
+
+    // 文書の順に繋げる。上限に達したら、1 スレッドで走査したときと同じ位置で打ち切る
+    for (size_t p = 0; p < partitions_.size(); ++p) {
+        for (const SearchMatch& position : partition_positions_[p]) {
+            entry.AddPosition(position);
+            if (entry.positions.size() >= kMaxPositions) {
+                entry.truncated = true;
+                done = true;
+                return true;
+            }
+        }
+        entry.next_line = partitions_[p].second;
+    }
+    done = entry.next_line >= lines_.size();
+    return true;
+}
+
+void IncrementalSearch::Clear() {
+    stack_.clear();
+    depth_ = 0;
+}
+
+IncrementalSearch::Entry* IncrementalSearch::Top() {
+    return depth_ > 0 ? &stack_[depth_ - 1] : nullptr;
+}
+
+const IncrementalSearch::Entry* IncrementalSearch::Top() const {
+    return depth_ > 0 ? &stack_[depth_ - 1] : nullptr;
+}
+
+const std::string& IncrementalSearch::Query() const {
+    const Entry* entry = Top();
+    return entry ? entry->query : kEmptyQuery;
+}
+
+bool IncrementalSearch::Done() const {
+    const Entry* entry = Top();
+    return !entry || entry->truncated || entry->next_line >= lines_.size();
+}
+
+bool IncrementalSearch::Truncated() const {
+    const Entry* entry = Top();
+    return entry && entry->truncated;
+}
+
+const std::vector<SearchMatch>& IncrementalSearch::Matches() const {
+    const Entry* entry = Top();
+    return entry ? entry->matches : kNoMatches;
+}
+
+size_t IncrementalSearch::ScannedLines() const {
+    const Entry* entry = Top();
+    return entry ? std::min(entry->next_line, lines_.size()) : 0;
+}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "text_search.h"
+#include "thread_pool.h"
+#include "trigram_index.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 入力しながらの検索（search-as-you-type）の状態
+// - クエリを伸ばしたとき: 新しい一致は前のクエリの一致の部分集合なので、前の一致の位置で
+//   その場で確かめるだけ（文書は読み直さない）
+// - クエリを縮めたとき: クエリごとの結果をスタックに積んであるので、それを使い直す
+// - 文書の走査は Step() ごとに一定量（バイト）ずつ進めるので、呼び出し側は UI ループの合間に
+//   少しずつ進められる。新しいクエリを設定すれば、進行中の走査はそこで打ち切られる
+// - Matches() は走査の途中でも、それまでに見つかった一致を返す
+// - スレッドプールを渡すと、Step() 1 回で行境界で区切った区間（パーティション）をいくつか並列に走査し、
+//   区間ごとの結果を文書の順に繋げる。結果はプールなしのときと同じ
+// - 使える trigram 索引があれば、前の結果から絞り込めないクエリは索引で候補の行を絞ってから確かめる
+class IncrementalSearch {
+public:
+    // Step() 1 回で調べる量の目安
+    static constexpr size_t kDefaultStepBytes = 1 << 20;
+    // 1 つのクエリで記録する出現位置の上限（1 文字の検索で巨大な文書を走査してもメモリを使い切らない）
+    static constexpr size_t kMaxPositions = 1 << 22;
+
+    // App::lines_ を参照で保持。pool が nullptr なら走査は呼び出しスレッドだけで行う
+    // Step() の間は呼び出しスレッドが待つので、走査中に lines_ が書き換わることはない
+    explicit IncrementalSearch(const std::vector<std::string>& lines, ThreadPool* pool = nullptr);
+
+    // クエリを設定する。revision は文書リビジョンで、前回と違えばキャッシュを捨てる
+    // 空のクエリは一致なしで完了
+    void SetQuery(const std::string& query, uint64_t revision);
+    // 走査を最大 budget_bytes 進める（プールがあれば 1 スレッドあたり。呼び出しスレッドを含めた
+    // スレッド数の区間を並列に調べる）。走査が完了していれば true
+    bool Step(size_t budget_bytes = kDefaultStepBytes);
+    // キャッシュを捨てる
+    void Clear();
+    // 候補の行の絞り込みに使う索引（nullptr で使わない）。索引は lines_ の編集に追従していること
+    void SetIndex(TrigramIndex* index) { index_ = index; }
+
+    const std::string& Query() const;
+    uint64_t Revision() const { return revision_; }
+    bool Done() const;
+    // 出現位置が上限に達して走査を打ち切った
+    bool Truncated() const;
+    // 現在のクエリの一致（重ならないもの、(行, オフセット) の昇順）
+    const std::vector<SearchMatch>& Matches() const;
+    // 走査済みの行数（進捗表示用）
+    size_t ScannedLines() const;
+
+private:
+    struct Entry {
+        std::string query;
+        SubstringSearcher searcher;
+        // 重なりを含むすべての出現位置（クエリを伸ばしたときの絞り込みに使う）
+        std::vector<SearchMatch> positions;
+        // positions のうち重ならないもの（表示用）
+        std::vector<SearchMatch> matches;
+        // 次に調べる位置（行, 行内のバイトオフセット）
+        size_t next_line = 0;
+        size_t next_offset = 0;
+        bool truncated = false;
+
+        explicit Entry(const std::string& q) : query(q), searcher(q) {}
+        void AddPosition(const SearchMatch& position);
+    };
+
+    Entry* Top();
+    const Entry* Top() const;
+    // entry の続きを区間に分けて並列に走査する。区間を作れない（次の行が budget_bytes より長い
+    // など）ときは何もせずに false を返し、呼び出し側が 1 スレッドで長い行を区切りながら調べる
+    bool StepParallel(Entry& entry, size_t budget_bytes, bool& done);
+
+    const std::vector<std::string>& lines_;
+    ThreadPool* pool_ = nullptr;
+    TrigramIndex* index_ = nullptr;
+    std::vector<size_t> candidates_;
+    // 区間 [begin, end) の行と、区間ごとの出現位置（並列走査の作業領域。容量を使い回す）
+    std::vector<std::pair<size_t, size_t>> partitions_;
+    std::vector<std::vector<SearchMatch>> partition_positions_;
+    // 下ほど短いクエリ（各クエリは次のクエリの接頭辞）。depth_ より上は、いまのクエリを
+    // 伸ばしたクエリの結果（縮めたあとで同じ文字を打ち直したときに使う）
+    std::vector<Entry> stack_;
+    size_t depth_ = 0; // 現在のクエリは stack_[depth_ - 1]（0 なら空のクエリ）
+    uint64_t revision_ = 0;
+};
+
+}
@@ -1,10 +1,91 @@
 #include "app.h"
 #include "error_handler.h"
+#include "batch_renderer.h"
+#include "html_export.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <charconv>
+#include <iomanip>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+// -j の値。1 以上の 10 進数だけを受け付け、ハードウェアスレッド数の 4 倍までに抑える
+bool ParseJobs(std::string_view text, size_t& jobs) {
+    size_t value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end != text.data() + text.size() || value == 0) return false;
+    jobs = std::min(value, 4 * ShinoEditor::ThreadPool::DefaultThreadCount());
+    return true;
+}
+
+int RunBatchRender(int argc, char* argv[]) {
+    ShinoEditor::BatchRenderer::Options options;
+    bool quiet = false;
+    bool usage_error = false;
+    std::vector<std::string> dirs;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-j") {
+            usage_error |= i + 1 == argc || !ParseJobs(argv[++i], options.jobs);
+        } else if (arg.rfind("-j", 0) == 0) {
+            usage_error |= !ParseJobs(std::string_view(arg).substr(2), options.jobs);
+        } else if (arg == "--force") {
+            options.force = true;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else {
+            dirs.push_back(arg);
+        }
+    }
+    if (usage_error || dirs.size() != 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " --render-html [-j N] [--force] [--quiet] <input_dir> <output_dir>" << std::endl
+                  << "  -j N  number of render threads (N >= 1)" << std::endl;
+        return 2;
+    }
+    options.input_dir = dirs[0];
+    options.output_dir = dirs[1];
+    if (!quiet) options.log = &std::cout;
+
+    ShinoEditor::MarkdownRenderer renderer;
+    const auto summary = ShinoEditor::BatchRenderer(renderer).Run(options);
+    const double seconds = summary.elapsed_ms / 1000.0;
+    std::cout << std::fixed << std::setprecision(1)
+              << summary.rendered << " rendered, " << summary.skipped << " unchanged, "
+              << summary.failed << " failed (" << summary.files << " files) in "
+              << summary.elapsed_ms << " ms";
+    if (seconds > 0 && summary.rendered > 0) {
+        std::cout << ", " << summary.input_bytes / (1024.0 * 1024.0) / seconds << " MB/s";
+    }
+    std::cout << std::endl;
+    return summary.failed == 0 ? 0 : 1;
+}
+}
 
 int main(int argc, char* argv[]) {
     try {
+        // ShinoEditor --export-html in.md [out.html]: 画面を開かずに HTML を書き出す
+        if (argc > 1 && std::string(argv[1]) == "--export-html") {
+            if (argc < 3 || argc > 4) {
+                std::cerr << "Usage: " << argv[0] << " --export-html <input.md> [output.html]" << std::endl;
+                return 2;
+            }
+            const std::string input = argv[2];
+            const std::string output = argc == 4 ? argv[3]
+                                                 : ShinoEditor::HtmlExport::DefaultOutputPath(input);
+            ShinoEditor::MarkdownRenderer renderer;
+            ShinoEditor::HtmlExport::ExportFile(renderer, input, output);
+            return 0;
+        }
+
+        // ShinoEditor --render-html [-j N] [--force] [--quiet] in/ out/: ディレクトリ以下をまとめて変換
+        if (argc > 1 && std::string(argv[1]) == "--render-html") {
+            return RunBatchRender(argc, argv);
+        }
+
         ShinoEditor::App app;
         
         std::string filename;
@@ -0,0 +1,88 @@
+#include "mapped_file.h"
+#include <fstream>
+#include <sstream>
+#include <utility>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ShinoEditor {
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this == &other) return *this;
+    Close();
+    size_ = other.size_;
+    open_ = other.open_;
+    mapped_ = other.mapped_;
+    fallback_ = std::move(other.fallback_);
+    // 読み込んだバッファは移動で場所が変わりうるので指し直す
+    data_ = mapped_ ? other.data_ : fallback_.data();
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.open_ = false;
+    other.mapped_ = false;
+    return *this;
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            // 先頭から順に読むので先読みを促す
+            madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+            mapped_ = true;
+        }
+    }
+    ::close(fd);
+    if (mapped_ || size_ == 0) {
+        if (!mapped_) data_ = fallback_.data();
+        open_ = true;
+        return true;
+    }
+#endif
+    // マップできなければ読み込む
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    fallback_ = ss.str();
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+    open_ = true;
+    return true;
+}
+
+void MappedFile::Close() {
+#ifndef _WIN32
+    if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    mapped_ = false;
+    fallback_.clear();
+}
+
+}
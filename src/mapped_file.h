@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace ShinoEditor {
+
+// ファイルを読み取り専用でメモリにマップする（Windows では読み込んだバッファで代用）
+// 大きなファイルでもコピーせずに string_view として扱える
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 失敗したら false（errno は呼び出し側で参照できる）
+    bool Open(const std::string& path);
+    void Close();
+
+    std::string_view View() const { return {data_, size_}; }
+    size_t Size() const { return size_; }
+    bool IsOpen() const { return open_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+    bool mapped_ = false;     // munmap が必要か
+    std::string fallback_;    // マップできないときの読み込み先
+};
+
+}
@@ -0,0 +1,565 @@
+#include "markdown_parser.h"
+#include "utf8_util.h"
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace ShinoEditor {
+
+namespace {
+
+bool IsCancelled(const std::atomic<bool>* cancel) {
+    return cancel && cancel->load(std::memory_order_relaxed);
+}
+
+// インライン解析で立ち止まる文字（それ以外はまとめて読み飛ばす）
+constexpr std::array<bool, 256> MakeSpecialTable() {
+    std::array<bool, 256> table{};
+    for (unsigned char c : std::string_view("\\`*_~[!&")) table[c] = true;
+    return table;
+}
+constexpr std::array<bool, 256> kInlineSpecial = MakeSpecialTable();
+
+// 特別な文字が出てくるまで読み飛ばす（ほとんどの文字はここで素通りする）
+size_t SkipPlain(std::string_view s, size_t i) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+    const size_t n = s.size();
+    while (i + 4 <= n && !(kInlineSpecial[p[i]] | kInlineSpecial[p[i + 1]] |
+                           kInlineSpecial[p[i + 2]] | kInlineSpecial[p[i + 3]])) {
+        i += 4;
+    }
+    while (i < n && !kInlineSpecial[p[i]]) ++i;
+    return i;
+}
+
+bool IsBlankLine(std::string_view line) {
+    return line.find_first_not_of(" \t") == std::string_view::npos;
+}
+
+bool IsAsciiPunct(char c) {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') ||
+           (c >= '{' && c <= '~');
+}
+
+bool IsAlnum(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) != 0;
+}
+
+size_t RunOf(std::string_view s, size_t i) {
+    size_t j = i;
+    while (j < s.size() && s[j] == s[i]) ++j;
+    return j - i;
+}
+
+std::string_view TrimRight(std::string_view s) {
+    const size_t end = s.find_last_not_of(" \t");
+    return end == std::string_view::npos ? std::string_view() : s.substr(0, end + 1);
+}
+
+// from 以降で長さ len の c の連続（閉じ区切り）を探す。コードスパンの中は飛ばす
+// 強調では中の開き区切りを数え、"**a *b***" のような閉じの共有にも対応する
+// budget は読んだ文字数だけ減らし、尽きたら見つからなかったことにする（閉じのない区切りが
+// 大量に並んだ行で 2 乗の時間にならないように）
+size_t FindClosingDelimiter(std::string_view s, size_t from, char c, size_t len, size_t& budget) {
+    std::array<size_t, 8> inner{}; // 中で開いたままの区切りの長さ
+    size_t depth = 0;
+    size_t i = from;
+    while (i < s.size()) {
+        if (budget == 0) return std::string_view::npos;
+        --budget;
+        const char ch = s[i];
+        if (ch == '\\' && c != '`') {
+            i += 2;
+            continue;
+        }
+        if (ch == '`' && c != '`') {
+            const size_t run = RunOf(s, i);
+            const size_t close = FindClosingDelimiter(s, i + run, '`', run, budget);
+            i = close == std::string_view::npos ? i + run : close + run;
+            continue;
+        }
+        if (ch != c) {
+            ++i;
+            continue;
+        }
+        const size_t run = RunOf(s, i);
+        if (c == '`') {
+            if (run == len) return i;
+            i += run;
+            continue;
+        }
+        const bool after_alnum = i + run < s.size() && IsAlnum(s[i + run]);
+        const bool can_close = i > 0 && s[i - 1] != ' ' && (c != '_' || !after_alnum);
+        const bool can_open = i + run < s.size() && s[i + run] != ' ' &&
+                              !(c == '_' && i > 0 && IsAlnum(s[i - 1]));
+        if (can_close) {
+            if (depth == 0 && run == len) return i;
+            if (depth > 0 && run == inner[depth - 1]) {
+                --depth;
+            } else if (depth == 1 && run == inner[0] + len) {
+                return i + inner[0];
+            }
+        } else if (can_open && depth < inner.size()) {
+            inner[depth++] = run;
+        }
+        i += run;
+    }
+    return std::string_view::npos;
+}
+
+// [ に対応する ] を探す（入れ子の [] とエスケープを考慮）
+size_t FindClosingBracket(std::string_view s, size_t open, size_t& budget) {
+    int depth = 0;
+    for (size_t i = open; i < s.size(); ++i) {
+        if (budget == 0) return std::string_view::npos;
+        --budget;
+        if (s[i] == '\\') {
+            ++i;
+        } else if (s[i] == '[') {
+            ++depth;
+        } else if (s[i] == ']' && --depth == 0) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// s[i] が '&' のとき、文字参照の終わりの ';' の位置を返す
+size_t FindEntityEnd(std::string_view s, size_t i) {
+    size_t j = i + 1;
+    while (j < s.size() && j - i <= 32 && (IsAlnum(s[j]) || s[j] == '#')) ++j;
+    return j < s.size() && s[j] == ';' && j > i + 1 ? j : std::string_view::npos;
+}
+
+// インライン要素をイベントに変換
+void EmitInline(std::string_view s, MarkdownHandler& h, size_t& budget) {
+    size_t plain = 0;
+    auto flush = [&](size_t end) {
+        if (end > plain) h.Text(s.substr(plain, end - plain));
+    };
+
+    size_t i = 0;
+    const size_t n = s.size();
+    while ((i = SkipPlain(s, i)) < n) {
+        const char c = s[i];
+        if (c == '\\') {
+            if (i + 1 < n && IsAsciiPunct(s[i + 1])) {
+                flush(i);
+                h.Text(s.substr(i + 1, 1));
+                i += 2;
+                plain = i;
+            } else {
+                ++i;
+            }
+            continue;
+        }
+        if (c == '`') {
+            const size_t run = RunOf(s, i);
+            const size_t close = FindClosingDelimiter(s, i + run, '`', run, budget);
+            if (close == std::string_view::npos) {
+                i += run;
+                continue;
+            }
+            std::string_view code = s.substr(i + run, close - i - run);
+            if (code.size() >= 2 && code.front() == ' ' && code.back() == ' ' && !IsBlankLine(code)) {
+                code = code.substr(1, code.size() - 2);
+            }
+            flush(i);
+            h.EnterSpan(MarkdownSpan::CODE, {});
+            h.Text(code);
+            h.LeaveSpan(MarkdownSpan::CODE);
+            i = close + run;
+            plain = i;
+            continue;
+        }
+        if (c == '*' || c == '_' || c == '~') {
+            const size_t run = RunOf(s, i);
+            const bool opens = i + run < n && s[i + run] != ' ' &&
+                               !(c == '_' && i > 0 && IsAlnum(s[i - 1]));
+            const bool valid_run = c == '~' ? run == 2 : run <= 3;
+            const size_t close = opens && valid_run ? FindClosingDelimiter(s, i + run, c, run, budget)
+                                                    : std::string_view::npos;
+            if (close == std::string_view::npos) {
+                i += run;
+                continue;
+            }
+            flush(i);
+            const std::string_view inner = s.substr(i + run, close - i - run);
+            if (c == '~') {
+                h.EnterSpan(MarkdownSpan::STRIKE, {});
+                EmitInline(inner, h, budget);
+                h.LeaveSpan(MarkdownSpan::STRIKE);
+            } else {
+                // *** は <em><strong>…</strong></em>（md4c と同じ入れ子順）
+                if (run != 2) h.EnterSpan(MarkdownSpan::EMPHASIS, {});
+                if (run >= 2) h.EnterSpan(MarkdownSpan::STRONG, {});
+                EmitInline(inner, h, budget);
+                if (run >= 2) h.LeaveSpan(MarkdownSpan::STRONG);
+                if (run != 2) h.LeaveSpan(MarkdownSpan::EMPHASIS);
+            }
+            i = close + run;
+            plain = i;
+            continue;
+        }
+        if (c == '[' || (c == '!' && i + 1 < n && s[i + 1] == '[')) {
+            const size_t open = c == '!' ? i + 1 : i;
+            const size_t close = FindClosingBracket(s, open, budget);
+            if (close != std::string_view::npos && close + 1 < n && s[close + 1] == '(') {
+                const size_t paren = s.find(')', close + 2);
+                if (paren != std::string_view::npos) {
+                    // (url "title") のタイトルは捨てる
+                    std::string_view dest = s.substr(close + 2, paren - close - 2);
+                    const size_t start = dest.find_first_not_of(' ');
+                    dest = start == std::string_view::npos ? std::string_view() : dest.substr(start);
+                    dest = dest.substr(0, dest.find(' '));
+                    if (dest.size() >= 2 && dest.front() == '<' && dest.back() == '>') {
+                        dest = dest.substr(1, dest.size() - 2);
+                    }
+                    const MarkdownSpan type = c == '!' ? MarkdownSpan::IMAGE : MarkdownSpan::LINK;
+                    flush(i);
+                    h.EnterSpan(type, dest);
+                    EmitInline(s.substr(open + 1, close - open - 1), h, budget);
+                    h.LeaveSpan(type);
+                    i = paren + 1;
+                    plain = i;
+                    continue;
+                }
+            }
+            i = open + 1;
+            continue;
+        }
+        if (c == '&') {
+            const size_t end = FindEntityEnd(s, i);
+            if (end != std::string_view::npos) {
+                flush(i);
+                h.Text(MarkdownParser::DecodeEntity(s.substr(i, end - i + 1)));
+                i = end + 1;
+                plain = i;
+                continue;
+            }
+        }
+        ++i;
+    }
+    flush(n);
+}
+
+void EmitInline(std::string_view s, MarkdownHandler& h) {
+    size_t budget = 32 * s.size() + 1024;
+    EmitInline(s, h, budget);
+}
+
+bool ParseFenceLine(std::string_view line, char& fence_char, size_t& fence_len) {
+    const size_t i = line.find_first_not_of(' ');
+    if (i == std::string_view::npos || i > 3 || (line[i] != '`' && line[i] != '~')) return false;
+    const size_t run = RunOf(line, i);
+    if (run < 3) return false;
+    // ` のフェンスの情報文字列に ` は含められない
+    if (line[i] == '`' && line.find('`', i + run) != std::string_view::npos) return false;
+    fence_char = line[i];
+    fence_len = run;
+    return true;
+}
+
+int AtxHeaderLevel(std::string_view line, std::string_view& text) {
+    const size_t i = line.find_first_not_of(' ');
+    if (i == std::string_view::npos || i > 3 || line[i] != '#') return 0;
+    const size_t run = RunOf(line, i);
+    if (run > 6 || (i + run < line.size() && line[i + run] != ' ' && line[i + run] != '\t')) return 0;
+    text = line.substr(i + run);
+    const size_t start = text.find_first_not_of(" \t");
+    text = start == std::string_view::npos ? std::string_view() : TrimRight(text.substr(start));
+    // 閉じの # を取り除く
+    size_t hashes = text.size();
+    while (hashes > 0 && text[hashes - 1] == '#') --hashes;
+    if (hashes < text.size() && (hashes == 0 || text[hashes - 1] == ' ' || text[hashes - 1] == '\t')) {
+        text = TrimRight(text.substr(0, hashes));
+    }
+    return static_cast<int>(run);
+}
+
+bool IsThematicBreak(std::string_view line) {
+    char mark = 0;
+    int count = 0;
+    for (char ch : line) {
+        if (ch == ' ' || ch == '\t') continue;
+        if ((ch != '-' && ch != '*' && ch != '_') || (mark && ch != mark)) return false;
+        mark = ch;
+        ++count;
+    }
+    return count >= 3;
+}
+
+// リスト項目なら字下げ・種類・番号・本文を返す
+bool ParseListItem(std::string_view line, size_t& indent, bool& ordered, int& number,
+                   std::string_view& text) {
+    const size_t i = line.find_first_not_of(' ');
+    if (i == std::string_view::npos) return false;
+    size_t j = i;
+    if (line[j] == '-' || line[j] == '*' || line[j] == '+') {
+        ++j;
+        ordered = false;
+    } else {
+        int value = 0;
+        while (j < line.size() && j - i < 9 && line[j] >= '0' && line[j] <= '9') {
+            value = value * 10 + (line[j] - '0');
+            ++j;
+        }
+        if (j == i || j >= line.size() || (line[j] != '.' && line[j] != ')')) return false;
+        number = value;
+        ++j;
+        ordered = true;
+    }
+    if (j < line.size() && line[j] != ' ' && line[j] != '\t') return false;
+    indent = i;
+    const size_t start = line.find_first_not_of(" \t", j);
+    text = start == std::string_view::npos ? std::string_view() : line.substr(start);
+    return true;
+}
+
+// 行頭の引用の記号（"> "）を max_depth 個まで取り除き、取り除いた数を返す
+int StripQuoteMarkers(std::string_view& rest, int max_depth) {
+    int depth = 0;
+    while (depth < max_depth) {
+        const size_t i = rest.find_first_not_of(' ');
+        if (i == std::string_view::npos || i > 3 || rest[i] != '>') break;
+        rest = rest.substr(i + 1);
+        if (!rest.empty() && rest[0] == ' ') rest = rest.substr(1);
+        ++depth;
+    }
+    return depth;
+}
+
+// 開いている段落を中断して新しいブロックを始める行か（引用の遅延継続行にはならない）
+// 番号付きリストは 1 から始まり、項目が空でないときだけ段落を中断する（CommonMark と同じ）
+bool InterruptsParagraph(std::string_view line) {
+    char fence_char;
+    size_t fence_len;
+    std::string_view text;
+    size_t indent = 0;
+    bool ordered = false;
+    int number = 1;
+    return ParseFenceLine(line, fence_char, fence_len) || AtxHeaderLevel(line, text) > 0 || IsThematicBreak(line) ||
+           (ParseListItem(line, indent, ordered, number, text) && indent <= 3 && !text.empty() &&
+            (!ordered || number == 1));
+}
+
+// 行単位のブロック解析の状態
+class BlockParser {
+public:
+    BlockParser(MarkdownHandler& handler) : h_(handler) {}
+
+    void Line(std::string_view line);
+    void Finish();
+
+private:
+    enum class OpenText { NONE, PARAGRAPH, ITEM };
+
+    MarkdownHandler& h_;
+    OpenText open_ = OpenText::NONE;
+    bool hard_break_ = false;    // 直前の行が 2 つ以上の空白で終わっていた
+    bool in_fence_ = false;
+    char fence_char_ = 0;
+    size_t fence_len_ = 0;
+    int quote_depth_ = 0;
+    std::vector<std::pair<size_t, bool>> lists_; // (字下げ, 番号付きか)
+    bool blank_before_ = false;
+
+    void CloseText();
+    void CloseListLevel();
+    void CloseLists();
+    void AppendText(std::string_view text);
+};
+
+void BlockParser::CloseText() {
+    if (open_ == OpenText::PARAGRAPH) h_.LeaveBlock(MarkdownBlock::PARAGRAPH);
+    open_ = OpenText::NONE;
+    hard_break_ = false;
+}
+
+void BlockParser::CloseListLevel() {
+    h_.LeaveBlock(MarkdownBlock::LIST_ITEM);
+    h_.LeaveBlock(lists_.back().second ? MarkdownBlock::ORDERED_LIST : MarkdownBlock::UNORDERED_LIST);
+    lists_.pop_back();
+}
+
+void BlockParser::CloseLists() {
+    CloseText();
+    while (!lists_.empty()) CloseListLevel();
+}
+
+void BlockParser::AppendText(std::string_view text) {
+    // 行末の 2 空白は改行、それ以外の行末の空白は捨てる
+    const std::string_view trimmed = TrimRight(text);
+    hard_break_ = text.size() >= trimmed.size() + 2 && text.substr(trimmed.size()).find('\t') == std::string_view::npos;
+    EmitInline(trimmed, h_);
+}
+
+void BlockParser::Line(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    if (in_fence_) {
+        // 引用の中のコードは、引用の記号を取り除いた残りがコードの行
+        std::string_view code = line;
+        if (StripQuoteMarkers(code, quote_depth_) == quote_depth_) {
+            char c;
+            size_t len;
+            if (ParseFenceLine(code, c, len) && c == fence_char_ && len >= fence_len_ &&
+                IsBlankLine(code.substr(code.find(c) + len))) {
+                h_.LeaveBlock(MarkdownBlock::CODE);
+                in_fence_ = false;
+            } else {
+                h_.Text(code);
+                h_.Text("\n");
+            }
+            return;
+        }
+        // 引用が終われば、閉じていないコードもそこで終わる（この行は引用の外として読む）
+        h_.LeaveBlock(MarkdownBlock::CODE);
+        in_fence_ = false;
+    }
+
+    // 引用の深さを数えて記号を取り除く
+    std::string_view rest = line;
+    const int depth = StripQuoteMarkers(rest, std::numeric_limits<int>::max());
+    // 浅い引用の行が段落の続きの文字なら遅延継続行（引用は閉じない）。見出しやリストなど新しいブロックは引用を閉じてから
+    const bool lazy = depth < quote_depth_ && open_ == OpenText::PARAGRAPH && !IsBlankLine(rest) &&
+                      !InterruptsParagraph(rest);
+    if (!lazy && depth != quote_depth_) {
+        CloseLists();
+        while (quote_depth_ > depth) {
+            h_.LeaveBlock(MarkdownBlock::QUOTE);
+            --quote_depth_;
+        }
+        while (quote_depth_ < depth) {
+            h_.EnterBlock(MarkdownBlock::QUOTE, 0);
+            ++quote_depth_;
+        }
+    }
+
+    if (IsBlankLine(rest)) {
+        CloseText();
+        blank_before_ = true;
+        return;
+    }
+    if (lazy) {
+        // 段落を中断しない行（"2. x" など）はそのまま段落の続き
+        if (hard_break_) {
+            h_.HardBreak();
+        } else {
+            h_.SoftBreak();
+        }
+        AppendText(rest.substr(rest.find_first_not_of(" \t")));
+        blank_before_ = false;
+        return;
+    }
+
+    std::string_view text;
+    size_t indent = 0;
+    bool ordered = false;
+    int number = 1;
+    if (ParseFenceLine(rest, fence_char_, fence_len_)) {
+        CloseLists();
+        h_.EnterBlock(MarkdownBlock::CODE, 0);
+        in_fence_ = true;
+    } else if (const int level = AtxHeaderLevel(rest, text); level > 0) {
+        CloseLists();
+        h_.EnterBlock(MarkdownBlock::HEADER, level);
+        EmitInline(text, h_);
+        h_.LeaveBlock(MarkdownBlock::HEADER);
+    } else if (IsThematicBreak(rest)) {
+        CloseLists();
+        h_.EnterBlock(MarkdownBlock::RULE, 0);
+        h_.LeaveBlock(MarkdownBlock::RULE);
+    } else if (ParseListItem(rest, indent, ordered, number, text)) {
+        CloseText();
+        while (!lists_.empty() && indent < lists_.back().first) CloseListLevel();
+        const bool nested = !lists_.empty() && indent >= lists_.back().first + 2;
+        if (!nested && !lists_.empty() && lists_.back().second == ordered) {
+            // 同じリストの次の項目
+            h_.LeaveBlock(MarkdownBlock::LIST_ITEM);
+            h_.EnterBlock(MarkdownBlock::LIST_ITEM, 0);
+        } else {
+            if (!nested && !lists_.empty()) CloseListLevel();
+            h_.EnterBlock(ordered ? MarkdownBlock::ORDERED_LIST : MarkdownBlock::UNORDERED_LIST,
+                          ordered ? number : 0);
+            h_.EnterBlock(MarkdownBlock::LIST_ITEM, 0);
+            lists_.emplace_back(indent, ordered);
+        }
+        open_ = OpenText::ITEM;
+        AppendText(text);
+    } else {
+        const bool indented = rest.find_first_not_of(' ') >= 2;
+        if (!lists_.empty() && blank_before_ && !indented) CloseLists();
+        if (open_ != OpenText::NONE) {
+            if (hard_break_) {
+                h_.HardBreak();
+            } else {
+                h_.SoftBreak();
+            }
+        } else if (lists_.empty()) {
+            h_.EnterBlock(MarkdownBlock::PARAGRAPH, 0);
+            open_ = OpenText::PARAGRAPH;
+        } else {
+            // 項目内の空行の後の続き
+            h_.HardBreak();
+            open_ = OpenText::ITEM;
+        }
+        AppendText(rest.substr(rest.find_first_not_of(" \t")));
+    }
+    blank_before_ = false;
+}
+
+void BlockParser::Finish() {
+    if (in_fence_) h_.LeaveBlock(MarkdownBlock::CODE);
+    in_fence_ = false;
+    CloseLists();
+    for (; quote_depth_ > 0; --quote_depth_) h_.LeaveBlock(MarkdownBlock::QUOTE);
+}
+
+}
+
+bool MarkdownParser::Parse(std::string_view markdown, MarkdownHandler& handler,
+                           const std::atomic<bool>* cancel) {
+    BlockParser parser(handler);
+    handler.EnterBlock(MarkdownBlock::DOCUMENT, 0);
+    bool completed = true;
+    size_t pos = 0;
+    while (pos < markdown.size()) {
+        if (IsCancelled(cancel)) {
+            completed = false;
+            break;
+        }
+        size_t nl = markdown.find('\n', pos);
+        if (nl == std::string_view::npos) nl = markdown.size();
+        parser.Line(markdown.substr(pos, nl - pos));
+        pos = nl + 1;
+    }
+    parser.Finish();
+    handler.LeaveBlock(MarkdownBlock::DOCUMENT);
+    return completed;
+}
+
+std::string MarkdownParser::DecodeEntity(std::string_view entity) {
+    std::string out;
+    if (entity.size() >= 4 && entity[1] == '#') {
+        const bool hex = entity[2] == 'x' || entity[2] == 'X';
+        const std::string digits(entity.substr(hex ? 3 : 2, entity.size() - (hex ? 4 : 3)));
+        unsigned long cp = std::strtoul(digits.c_str(), nullptr, hex ? 16 : 10);
+        if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+        utf8::Append(out, static_cast<char32_t>(cp));
+        return out;
+    }
+    static const std::pair<std::string_view, std::string_view> kNamed[] = {
+        {"&amp;", "&"}, {"&lt;", "<"}, {"&gt;", ">"}, {"&quot;", "\""},
+        {"&apos;", "'"}, {"&nbsp;", "\xC2\xA0"}, {"&copy;", "\xC2\xA9"},
+    };
+    for (const auto& [name, value] : kNamed) {
+        if (entity == name) return std::string(value);
+    }
+    return std::string(entity);
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <string_view>
+
+namespace ShinoEditor {
+
+// ブロック種別（md4c の MD_BLOCKTYPE に対応）
+enum class MarkdownBlock {
+    DOCUMENT,
+    QUOTE,
+    UNORDERED_LIST,
+    ORDERED_LIST,
+    LIST_ITEM,
+    RULE,
+    HEADER,
+    CODE,
+    HTML,
+    PARAGRAPH,
+    TABLE,
+    TABLE_HEAD,
+    TABLE_BODY,
+    TABLE_ROW,
+    TABLE_HEADER_CELL,
+    TABLE_CELL
+};
+
+// インライン要素（md4c の MD_SPANTYPE に対応）
+enum class MarkdownSpan {
+    EMPHASIS,
+    STRONG,
+    CODE,
+    LINK,
+    IMAGE,
+    STRIKE
+};
+
+// パーサーのイベントを受け取る側（HTML/テキスト出力、TUI プレビュー）
+// md4c のコールバックとフォールバックパーサーのどちらからも同じ順序で呼ばれる
+class MarkdownHandler {
+public:
+    virtual ~MarkdownHandler() = default;
+
+    // detail は HEADER なら見出しレベル、ORDERED_LIST なら開始番号
+    virtual void EnterBlock(MarkdownBlock type, int detail) = 0;
+    virtual void LeaveBlock(MarkdownBlock type) = 0;
+    // url は LINK/IMAGE のときだけ。IMAGE の中の Text は代替テキスト
+    virtual void EnterSpan(MarkdownSpan type, std::string_view url) = 0;
+    virtual void LeaveSpan(MarkdownSpan type) = 0;
+    // エスケープ・文字参照は解決済み。コードブロックでは 1 行ごとに "\n" で終わる
+    virtual void Text(std::string_view text) = 0;
+    virtual void SoftBreak() = 0;
+    virtual void HardBreak() = 0;
+};
+
+// md4c がないときの Markdown パーサー
+// 正規表現を使わず、行単位のブロック解析とインライン解析を 1 回の走査で行う
+// 対応: ATX 見出し、フェンス、引用（入れ子・遅延継続）、箇条書き/番号付きリスト（入れ子）、
+//       区切り線、段落、強調（入れ子）、コードスパン、打ち消し線、リンク、画像、
+//       バックスラッシュエスケープ、文字参照、行末の 2 空白による改行
+class MarkdownParser {
+public:
+    // 中断されたら false（それまでのイベントは送られている）
+    static bool Parse(std::string_view markdown, MarkdownHandler& handler,
+                      const std::atomic<bool>* cancel = nullptr);
+
+    // "&amp;" "&#x3042;" などの文字参照を復号（知らない名前はそのまま返す）
+    static std::string DecodeEntity(std::string_view entity);
+};
+
+}
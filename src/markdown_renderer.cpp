@@ -6,23 +6,337 @@
 #define MD_FLAG_TASKLISTS 0
 #endif
 #endif
-#include <sstream>
-#include <regex>
+#include "render_sink.h"
+#include <array>
+#include <string_view>
 
 namespace ShinoEditor {
 
+namespace {
+#ifdef HAVE_MD4C
+bool IsCancelled(const std::atomic<bool>* cancel) {
+    return cancel && cancel->load(std::memory_order_relaxed);
+}
+#endif
+
+// HTML でエスケープが必要な文字
+constexpr std::array<bool, 256> MakeEscapeTable() {
+    std::array<bool, 256> table{};
+    for (unsigned char c : std::string_view("&<>\"")) table[c] = true;
+    return table;
+}
+constexpr std::array<bool, 256> kNeedsEscape = MakeEscapeTable();
+
+// HTML の特殊文字をエスケープして追記
+void AppendEscaped(std::string& out, std::string_view text) {
+    const char* p = text.data();
+    const char* const end = p + text.size();
+    while (p < end) {
+        const char* run = p;
+        while (p < end && !kNeedsEscape[static_cast<unsigned char>(*p)]) ++p;
+        out.append(run, p - run);
+        if (p == end) break;
+        switch (*p) {
+        case '&': out.append("&amp;", 5); break;
+        case '<': out.append("&lt;", 4); break;
+        case '>': out.append("&gt;", 4); break;
+        default:  out.append("&quot;", 6); break;
+        }
+        ++p;
+    }
+}
+
+// sink へ流すときに溜める大きさ（これを超えたらブロックの切れ目で渡す）
+constexpr size_t kSinkChunkSize = 64 * 1024;
+
+// out に書き込む MarkdownHandler の共通部分
+// sink があれば out が kSinkChunkSize を超えるたびに渡して空にするので、出力全体は持たない
+class StreamingWriter : public MarkdownHandler {
+public:
+    // 残りを sink に渡す
+    void Finish() {
+        if (sink_ && !out_.empty()) Drain();
+    }
+
+protected:
+    std::string& out_;
+
+    StreamingWriter(std::string& out, RenderSink* sink) : out_(out), sink_(sink) {}
+
+    void MaybeDrain() {
+        if (sink_ && out_.size() >= kSinkChunkSize) Drain();
+    }
+    // これまでに何か書いたか
+    bool HasOutput() const { return !out_.empty() || drained_; }
+    // 最後に書いた文字（まだ何も書いていなければ '\n'）
+    char LastChar() const { return out_.empty() ? last_ : out_.back(); }
+
+private:
+    RenderSink* sink_;
+    bool drained_ = false;
+    char last_ = '\n';
+
+    void Drain() {
+        last_ = out_.back();
+        drained_ = true;
+        sink_->Write(out_);
+        out_.clear();
+    }
+};
+
+// パーサーのイベントを HTML にして out に追記（md4c-html と同じ書式）
+class HtmlWriter : public StreamingWriter {
+public:
+    explicit HtmlWriter(std::string& out, RenderSink* sink = nullptr)
+        : StreamingWriter(out, sink) {}
+
+    void EnterBlock(MarkdownBlock type, int detail) override {
+        switch (type) {
+        case MarkdownBlock::QUOTE:          BeginBlock("<blockquote>\n"); break;
+        case MarkdownBlock::UNORDERED_LIST: BeginBlock("<ul>\n"); break;
+        case MarkdownBlock::ORDERED_LIST:
+            if (detail == 1) {
+                BeginBlock("<ol>\n");
+            } else {
+                BeginBlock("<ol start=\"");
+                out_ += std::to_string(detail);
+                out_ += "\">\n";
+            }
+            break;
+        case MarkdownBlock::LIST_ITEM:      out_ += "<li>"; break;
+        case MarkdownBlock::RULE:           BeginBlock("<hr>\n"); break;
+        case MarkdownBlock::HEADER:
+            header_level_ = detail;
+            BeginBlock("<h");
+            out_ += static_cast<char>('0' + detail);
+            out_ += '>';
+            break;
+        case MarkdownBlock::CODE:           BeginBlock("<pre><code>"); break;
+        case MarkdownBlock::PARAGRAPH:      BeginBlock("<p>"); break;
+        default: break;
+        }
+    }
+
+    void LeaveBlock(MarkdownBlock type) override {
+        switch (type) {
+        case MarkdownBlock::QUOTE:          out_ += "</blockquote>\n"; break;
+        case MarkdownBlock::UNORDERED_LIST: out_ += "</ul>\n"; break;
+        case MarkdownBlock::ORDERED_LIST:   out_ += "</ol>\n"; break;
+        case MarkdownBlock::LIST_ITEM:      out_ += "</li>\n"; break;
+        case MarkdownBlock::HEADER:
+            out_ += "</h";
+            out_ += static_cast<char>('0' + header_level_);
+            out_ += ">\n";
+            break;
+        case MarkdownBlock::CODE:           out_ += "</code></pre>\n"; break;
+        case MarkdownBlock::PARAGRAPH:      out_ += "</p>\n"; break;
+        default: break;
+        }
+        MaybeDrain();
+    }
+
+    void EnterSpan(MarkdownSpan type, std::string_view url) override {
+        // 画像の代替テキストの中ではタグを出さない
+        if (image_depth_ > 0) {
+            if (type == MarkdownSpan::IMAGE) ++image_depth_;
+            return;
+        }
+        switch (type) {
+        case MarkdownSpan::EMPHASIS: out_ += "<em>"; break;
+        case MarkdownSpan::STRONG:   out_ += "<strong>"; break;
+        case MarkdownSpan::CODE:     out_ += "<code>"; break;
+        case MarkdownSpan::STRIKE:   out_ += "<del>"; break;
+        case MarkdownSpan::LINK:
+            out_ += "<a href=\"";
+            AppendEscaped(out_, url);
+            out_ += "\">";
+            break;
+        case MarkdownSpan::IMAGE:
+            out_ += "<img src=\"";
+            AppendEscaped(out_, url);
+            out_ += "\" alt=\"";
+            image_depth_ = 1;
+            break;
+        }
+    }
+
+    void LeaveSpan(MarkdownSpan type) override {
+        if (image_depth_ > 0) {
+            if (type == MarkdownSpan::IMAGE && --image_depth_ == 0) out_ += "\">";
+            return;
+        }
+        switch (type) {
+        case MarkdownSpan::EMPHASIS: out_ += "</em>"; break;
+        case MarkdownSpan::STRONG:   out_ += "</strong>"; break;
+        case MarkdownSpan::CODE:     out_ += "</code>"; break;
+        case MarkdownSpan::STRIKE:   out_ += "</del>"; break;
+        case MarkdownSpan::LINK:     out_ += "</a>"; break;
+        case MarkdownSpan::IMAGE:    break;
+        }
+    }
+
+    void Text(std::string_view text) override { AppendEscaped(out_, text); }
+    void SoftBreak() override { out_ += '\n'; }
+    void HardBreak() override { out_ += image_depth_ > 0 ? " " : "<br>\n"; }
+
+private:
+    int header_level_ = 1;
+    int image_depth_ = 0;
+
+    // 項目のテキストの後に入れ子のブロックが来たら改行してから始める
+    void BeginBlock(const char* tag) {
+        if (LastChar() != '\n') out_ += '\n';
+        out_ += tag;
+    }
+};
+
+// パーサーのイベントをプレーンテキストにして out に追記
+// 見出し・強調などの記号は取り除き、リストは "- " / "1. " と字下げで表す。ブロック間は空行
+class TextWriter : public StreamingWriter {
+public:
+    explicit TextWriter(std::string& out, RenderSink* sink = nullptr)
+        : StreamingWriter(out, sink) {}
+
+    void EnterBlock(MarkdownBlock type, int detail) override {
+        switch (type) {
+        case MarkdownBlock::UNORDERED_LIST: lists_.push_back(0); break;
+        case MarkdownBlock::ORDERED_LIST:   lists_.push_back(detail); break;
+        case MarkdownBlock::LIST_ITEM:
+            if (!lists_.empty() && lists_.back() > 0) {
+                marker_ = std::to_string(lists_.back()++) + ". ";
+            } else {
+                marker_ = "- ";
+            }
+            line_open_ = false;
+            break;
+        case MarkdownBlock::RULE:
+            StartLine();
+            out_ += "---";
+            line_open_ = false;
+            EndBlock();
+            break;
+        case MarkdownBlock::CODE:
+        case MarkdownBlock::HTML:
+            in_code_ = true;
+            line_open_ = false;
+            break;
+        case MarkdownBlock::HEADER:
+        case MarkdownBlock::PARAGRAPH:
+        case MarkdownBlock::TABLE_ROW:
+            line_open_ = false;
+            break;
+        case MarkdownBlock::TABLE_HEADER_CELL:
+        case MarkdownBlock::TABLE_CELL:
+            if (line_open_) out_ += '\t';
+            break;
+        default: break;
+        }
+    }
+
+    void LeaveBlock(MarkdownBlock type) override {
+        switch (type) {
+        case MarkdownBlock::UNORDERED_LIST:
+        case MarkdownBlock::ORDERED_LIST:
+            if (!lists_.empty()) lists_.pop_back();
+            EndBlock();
+            break;
+        case MarkdownBlock::LIST_ITEM:
+            // 中身のない項目も記号だけは出す
+            if (!marker_.empty()) StartLine();
+            line_open_ = false;
+            break;
+        case MarkdownBlock::CODE:
+        case MarkdownBlock::HTML:
+            in_code_ = false;
+            line_open_ = false;
+            EndBlock();
+            break;
+        case MarkdownBlock::QUOTE:
+        case MarkdownBlock::HEADER:
+        case MarkdownBlock::PARAGRAPH:
+        case MarkdownBlock::TABLE:
+            line_open_ = false;
+            EndBlock();
+            break;
+        default: break;
+        }
+        MaybeDrain();
+    }
+
+    void EnterSpan(MarkdownSpan, std::string_view) override {}
+    void LeaveSpan(MarkdownSpan) override {}
+
+    void Text(std::string_view text) override {
+        if (!in_code_) {
+            if (!line_open_) StartLine();
+            out_.append(text);
+            return;
+        }
+        // コードブロックは改行ごとに 1 行
+        size_t start = 0;
+        size_t nl;
+        while ((nl = text.find('\n', start)) != std::string_view::npos) {
+            if (!line_open_) StartLine();
+            out_.append(text.data() + start, nl - start);
+            line_open_ = false;
+            start = nl + 1;
+        }
+        if (start < text.size()) {
+            if (!line_open_) StartLine();
+            out_.append(text.data() + start, text.size() - start);
+        }
+    }
+
+    void SoftBreak() override { line_open_ = false; }
+    void HardBreak() override { line_open_ = false; }
+
+private:
+    std::vector<int> lists_;   // 番号付きなら次の番号、箇条書きなら 0
+    std::string marker_;       // 次の行に付ける項目の記号
+    bool line_open_ = false;
+    bool in_code_ = false;
+    bool separate_ = false;    // 次の行の前に空行を入れる
+
+    void StartLine() {
+        if (HasOutput()) {
+            out_ += '\n';
+            if (separate_) out_ += '\n';
+        }
+        separate_ = false;
+        if (!lists_.empty()) {
+            out_.append(2 * (lists_.size() - 1), ' ');
+            if (!marker_.empty()) {
+                out_ += marker_;
+                marker_.clear();
+            } else {
+                out_ += "  ";
+            }
+        }
+        line_open_ = true;
+    }
+
+    // リストの外ではブロックの後に空行を入れる
+    void EndBlock() {
+        if (lists_.empty()) separate_ = true;
+    }
+};
+}
+
 MarkdownRenderer::MarkdownRenderer() = default;
 
 MarkdownRenderer::~MarkdownRenderer() = default;
 
-std::string MarkdownRenderer::RenderToHtml(const std::string& markdown) const {
+std::string MarkdownRenderer::RenderToHtml(const std::string& markdown,
+                                           const std::atomic<bool>* cancel) const {
 #ifdef HAVE_MD4C
     std::string html_output;
-    RenderContext context{&html_output, false};
+    RenderContext context{&html_output, false, cancel};
     
     // MD4C callback functions
+    // md_html は途中で止められないので、中断後は出力の追記だけをやめる
     auto process_output = [](const MD_CHAR* text, MD_SIZE size, void* userdata) {
         RenderContext* ctx = static_cast<RenderContext*>(userdata);
+        if (IsCancelled(ctx->cancel)) return;
         ctx->output->append(text, size);
     };
     
@@ -39,128 +353,198 @@ std::string MarkdownRenderer::RenderToHtml(const std::string& markdown) const {
     
     return html_output;
 #else
-    // Fallback: simple HTML conversion
-    if (markdown.empty()) {
-        return "";
-    }
-    
-    std::istringstream in(markdown);
-    std::ostringstream out;
-    std::string line;
-    
-    // Simple Markdown to HTML conversion
-    std::regex header1_re(R"(^\s*#\s+(.+))");
-    std::regex header2_re(R"(^\s*##\s+(.+))");
-    std::regex header3_re(R"(^\s*###\s+(.+))");
-    std::regex list_re(R"(^\s*[-*]\s+(.+))");
-    std::regex bold_re(R"(\*\*([^*]+)\*\*)");
-    std::regex italic_re(R"(\*([^*]+)\*)");
-    std::regex code_re(R"(`([^`]+)`)");
-    
-    bool in_list = false;
-    bool in_paragraph = false;
-    
-    while (std::getline(in, line)) {
-        std::smatch match;
-        
-        // Check for empty line
-        if (line.empty() || std::regex_match(line, std::regex(R"(^\s*$)"))) {
-            if (in_paragraph) {
-                out << "</p>\n";
-                in_paragraph = false;
-            }
-            if (in_list) {
-                out << "</ul>\n";
-                in_list = false;
-            }
-            continue;
-        }
-        
-        // Process inline formatting
-        line = std::regex_replace(line, bold_re, "<strong>$1</strong>");
-        line = std::regex_replace(line, italic_re, "<em>$1</em>");
-        line = std::regex_replace(line, code_re, "<code>$1</code>");
-        
-        // Check for headers
-        if (std::regex_search(line, match, header1_re)) {
-            if (in_paragraph) { out << "</p>\n"; in_paragraph = false; }
-            if (in_list) { out << "</ul>\n"; in_list = false; }
-            out << "<h1>" << match[1].str() << "</h1>\n";
-        }
-        else if (std::regex_search(line, match, header2_re)) {
-            if (in_paragraph) { out << "</p>\n"; in_paragraph = false; }
-            if (in_list) { out << "</ul>\n"; in_list = false; }
-            out << "<h2>" << match[1].str() << "</h2>\n";
-        }
-        else if (std::regex_search(line, match, header3_re)) {
-            if (in_paragraph) { out << "</p>\n"; in_paragraph = false; }
-            if (in_list) { out << "</ul>\n"; in_list = false; }
-            out << "<h3>" << match[1].str() << "</h3>\n";
-        }
-        // Check for list items
-        else if (std::regex_search(line, match, list_re)) {
-            if (in_paragraph) { out << "</p>\n"; in_paragraph = false; }
-            if (!in_list) {
-                out << "<ul>\n";
-                in_list = true;
-            }
-            out << "<li>" << match[1].str() << "</li>\n";
+    // 出力はほぼ入力と同じ大きさになるので、先に確保してから 1 回の走査で書き込む
+    std::string html;
+    html.reserve(markdown.size() + markdown.size() / 4);
+    HtmlWriter writer(html);
+    MarkdownParser::Parse(markdown, writer, cancel);
+    return html;
+#endif
+}
+
+std::string MarkdownRenderer::RenderToText(const std::string& markdown,
+                                           const std::atomic<bool>* cancel) const {
+    std::string text;
+    text.reserve(markdown.size());
+    TextWriter writer(text);
+    Parse(markdown, writer, cancel);
+    return text;
+}
+
+bool MarkdownRenderer::RenderHtmlTo(std::string_view markdown, RenderSink& sink,
+                                    const std::atomic<bool>* cancel) const {
+    std::string buffer;
+    buffer.reserve(kSinkChunkSize * 2);
+#ifdef HAVE_MD4C
+    RenderContext context{&buffer, false, cancel, nullptr, &sink};
+    auto process_output = [](const MD_CHAR* text, MD_SIZE size, void* userdata) {
+        RenderContext* ctx = static_cast<RenderContext*>(userdata);
+        if (IsCancelled(ctx->cancel)) return;
+        ctx->output->append(text, size);
+        if (ctx->output->size() >= kSinkChunkSize) {
+            ctx->sink->Write(*ctx->output);
+            ctx->output->clear();
         }
-        // Regular paragraph
-        else {
-            if (in_list) {
-                out << "</ul>\n";
-                in_list = false;
-            }
-            if (!in_paragraph) {
-                out << "<p>";
-                in_paragraph = true;
-            } else {
-                out << " ";
-            }
-            out << line;
+    };
+    unsigned parser_flags = MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_TASKLISTS;
+    const int result = md_html(markdown.data(), static_cast<MD_SIZE>(markdown.size()),
+                               process_output, &context, parser_flags, 0);
+    if (!buffer.empty() && !IsCancelled(cancel)) sink.Write(buffer);
+    return result == 0 && !IsCancelled(cancel);
+#else
+    HtmlWriter writer(buffer, &sink);
+    const bool completed = MarkdownParser::Parse(markdown, writer, cancel);
+    writer.Finish();
+    return completed;
+#endif
+}
+
+bool MarkdownRenderer::RenderTextTo(std::string_view markdown, RenderSink& sink,
+                                    const std::atomic<bool>* cancel) const {
+    std::string buffer;
+    buffer.reserve(kSinkChunkSize * 2);
+    TextWriter writer(buffer, &sink);
+    const bool completed = Parse(markdown, writer, cancel);
+    writer.Finish();
+    return completed;
+}
+
+std::vector<PreviewLine> MarkdownRenderer::RenderToPreview(const std::string& markdown) const {
+    PreviewBuilder builder;
+    Parse(markdown, builder, nullptr);
+    return builder.Finish();
+}
+
+bool MarkdownRenderer::Parse(std::string_view markdown, MarkdownHandler& handler,
+                             const std::atomic<bool>* cancel) {
+#ifdef HAVE_MD4C
+    RenderContext context{nullptr, true, cancel, &handler};
+    MD_PARSER parser = {};
+    parser.abi_version = 0;
+    parser.flags = MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_TASKLISTS;
+    parser.enter_block = [](MD_BLOCKTYPE type, void* detail, void* userdata) {
+        return ProcessBlock(type, true, detail, userdata);
+    };
+    parser.leave_block = [](MD_BLOCKTYPE type, void* detail, void* userdata) {
+        return ProcessBlock(type, false, detail, userdata);
+    };
+    parser.enter_span = [](MD_SPANTYPE type, void* detail, void* userdata) {
+        return ProcessSpan(type, true, detail, userdata);
+    };
+    parser.leave_span = [](MD_SPANTYPE type, void* detail, void* userdata) {
+        return ProcessSpan(type, false, detail, userdata);
+    };
+    parser.text = [](MD_TEXTTYPE type, const MD_CHAR* text, MD_SIZE size, void* userdata) {
+        return ProcessText(type, text, size, userdata);
+    };
+    return md_parse(markdown.data(), static_cast<MD_SIZE>(markdown.size()), &parser, &context) == 0;
+#else
+    return MarkdownParser::Parse(markdown, handler, cancel);
+#endif
+}
+
+int MarkdownRenderer::ProcessBlock(int block_type, bool enter, void* detail, void* userdata) {
+#ifdef HAVE_MD4C
+    RenderContext* ctx = static_cast<RenderContext*>(userdata);
+    MarkdownHandler& h = *ctx->handler;
+    MarkdownBlock type;
+    int arg = 0;
+    switch (static_cast<MD_BLOCKTYPE>(block_type)) {
+    case MD_BLOCK_DOC:   type = MarkdownBlock::DOCUMENT; break;
+    case MD_BLOCK_QUOTE: type = MarkdownBlock::QUOTE; break;
+    case MD_BLOCK_UL:    type = MarkdownBlock::UNORDERED_LIST; break;
+    case MD_BLOCK_OL:
+        type = MarkdownBlock::ORDERED_LIST;
+        arg = static_cast<int>(static_cast<MD_BLOCK_OL_DETAIL*>(detail)->start);
+        break;
+    case MD_BLOCK_LI:    type = MarkdownBlock::LIST_ITEM; break;
+    case MD_BLOCK_HR:    type = MarkdownBlock::RULE; break;
+    case MD_BLOCK_H:
+        type = MarkdownBlock::HEADER;
+        arg = static_cast<int>(static_cast<MD_BLOCK_H_DETAIL*>(detail)->level);
+        break;
+    case MD_BLOCK_CODE:  type = MarkdownBlock::CODE; break;
+    case MD_BLOCK_HTML:  type = MarkdownBlock::HTML; break;
+    case MD_BLOCK_P:     type = MarkdownBlock::PARAGRAPH; break;
+    case MD_BLOCK_TABLE: type = MarkdownBlock::TABLE; break;
+    case MD_BLOCK_THEAD: type = MarkdownBlock::TABLE_HEAD; break;
+    case MD_BLOCK_TBODY: type = MarkdownBlock::TABLE_BODY; break;
+    case MD_BLOCK_TR:    type = MarkdownBlock::TABLE_ROW; break;
+    case MD_BLOCK_TH:    type = MarkdownBlock::TABLE_HEADER_CELL; break;
+    case MD_BLOCK_TD:    type = MarkdownBlock::TABLE_CELL; break;
+    default: return 0;
+    }
+    if (enter) {
+        h.EnterBlock(type, arg);
+        if (type == MarkdownBlock::LIST_ITEM) {
+            const auto* li = static_cast<MD_BLOCK_LI_DETAIL*>(detail);
+            if (li->is_task) h.Text(li->task_mark == ' ' ? "[ ] " : "[x] ");
         }
+    } else {
+        h.LeaveBlock(type);
     }
-    
-    // Close any open tags
-    if (in_paragraph) {
-        out << "</p>\n";
+    // 0 以外を返すと md_parse が中断する
+    return IsCancelled(ctx->cancel) ? 1 : 0;
+#else
+    (void)block_type;
+    (void)enter;
+    (void)detail;
+    (void)userdata;
+    return 0;
+#endif
+}
+
+int MarkdownRenderer::ProcessSpan(int span_type, bool enter, void* detail, void* userdata) {
+#ifdef HAVE_MD4C
+    MarkdownHandler& h = *static_cast<RenderContext*>(userdata)->handler;
+    MarkdownSpan type;
+    MD_ATTRIBUTE* url = nullptr;
+    switch (static_cast<MD_SPANTYPE>(span_type)) {
+    case MD_SPAN_EM:     type = MarkdownSpan::EMPHASIS; break;
+    case MD_SPAN_STRONG: type = MarkdownSpan::STRONG; break;
+    case MD_SPAN_A:
+        type = MarkdownSpan::LINK;
+        url = &static_cast<MD_SPAN_A_DETAIL*>(detail)->href;
+        break;
+    case MD_SPAN_IMG:
+        type = MarkdownSpan::IMAGE;
+        url = &static_cast<MD_SPAN_IMG_DETAIL*>(detail)->src;
+        break;
+    case MD_SPAN_CODE:   type = MarkdownSpan::CODE; break;
+    case MD_SPAN_DEL:    type = MarkdownSpan::STRIKE; break;
+    default: return 0;
     }
-    if (in_list) {
-        out << "</ul>\n";
+    if (enter) {
+        h.EnterSpan(type, url ? std::string_view(url->text, url->size) : std::string_view());
+    } else {
+        h.LeaveSpan(type);
     }
-    
-    return out.str();
+#else
+    (void)span_type;
+    (void)enter;
+    (void)detail;
+    (void)userdata;
 #endif
+    return 0;
 }
 
-std::string MarkdownRenderer::RenderToText(const std::string& markdown) const {
-    // 行単位に処理して ^ アンカーを正しく機能させる
-    std::istringstream in(markdown);
-    std::ostringstream out;
-    std::string line;
-    bool first = true;
-
-    const std::regex header_re(R"(^\s*#{1,6}\s*)");
-    const std::regex bold_re(R"(\*\*([^*]+)\*\*)");
-    const std::regex italic_re(R"(\*([^*]+)\*)");
-    const std::regex link_re(R"(\[([^\]]+)\]\([^)]+\))");
-    const std::regex code_re(R"(`([^`]+)`)");
-    const std::regex quote_re(R"(^\s*>\s*)");
-
-    while (std::getline(in, line)) {
-        line = std::regex_replace(line, header_re, "");
-        line = std::regex_replace(line, bold_re, "$1");
-        line = std::regex_replace(line, italic_re, "$1");
-        line = std::regex_replace(line, link_re, "$1");
-        line = std::regex_replace(line, code_re, "$1");
-        line = std::regex_replace(line, quote_re, "");
-        if (!first) out << '\n';
-        out << line;
-        first = false;
-    }
-
-    return out.str();
+int MarkdownRenderer::ProcessText(int text_type, const char* text, unsigned size, void* userdata) {
+#ifdef HAVE_MD4C
+    MarkdownHandler& h = *static_cast<RenderContext*>(userdata)->handler;
+    switch (static_cast<MD_TEXTTYPE>(text_type)) {
+    case MD_TEXT_NULLCHAR: h.Text("\xEF\xBF\xBD"); break;
+    case MD_TEXT_BR:       h.HardBreak(); break;
+    case MD_TEXT_SOFTBR:   h.SoftBreak(); break;
+    case MD_TEXT_ENTITY:   h.Text(MarkdownParser::DecodeEntity(std::string_view(text, size))); break;
+    default:               h.Text(std::string_view(text, size)); break;
+    }
+#else
+    (void)text_type;
+    (void)text;
+    (void)size;
+    (void)userdata;
+#endif
+    return 0;
 }
 
 bool MarkdownRenderer::IsAvailable() {
@@ -1,5 +1,9 @@
 #pragma once
+#include "preview_model.h"
+#include "render_sink.h"
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ShinoEditor {
@@ -10,23 +14,46 @@ public:
     ~MarkdownRenderer();
     
     // Render markdown text to HTML
-    std::string RenderToHtml(const std::string& markdown) const;
+    // cancel が立つと途中で打ち切る（戻り値は不完全）
+    std::string RenderToHtml(const std::string& markdown,
+                             const std::atomic<bool>* cancel = nullptr) const;
     
     // Render markdown to plain text (for preview)
-    std::string RenderToText(const std::string& markdown) const;
+    // 見出し・強調などの記号を取り除き、ブロックの間は空行で区切る
+    std::string RenderToText(const std::string& markdown,
+                             const std::atomic<bool>* cancel = nullptr) const;
+    
+    // RenderToHtml / RenderToText と同じ出力を、結果全体を持たずに塊ごとに sink へ流す
+    // 最後まで出力できたら true（中断されたら false）。sink の Flush は呼び出し側で行う
+    bool RenderHtmlTo(std::string_view markdown, RenderSink& sink,
+                      const std::atomic<bool>* cancel = nullptr) const;
+    bool RenderTextTo(std::string_view markdown, RenderSink& sink,
+                      const std::atomic<bool>* cancel = nullptr) const;
+    
+    // TUI プレビュー用の行に変換（HTML を経由せず、パーサーのイベントから直接組み立てる）
+    std::vector<PreviewLine> RenderToPreview(const std::string& markdown) const;
+    
+    // markdown を解析して handler にイベントを送る（md4c があれば md_parse、なければ MarkdownParser）
+    // HTML/テキスト/プレビュー以外の出力（DocxWriter）もこれを使う。中断されたら false
+    static bool Parse(std::string_view markdown, MarkdownHandler& handler,
+                      const std::atomic<bool>* cancel);
     
     // Check if md4c is available
     static bool IsAvailable();
     
 private:
-    // MD4C callback functions
-    static int ProcessBlock(int block_type, void* detail, void* userdata);
-    static int ProcessSpan(int span_type, void* detail, void* userdata);
+
+    // MD4C callback functions（md_parse のイベントを MarkdownHandler に渡す）
+    static int ProcessBlock(int block_type, bool enter, void* detail, void* userdata);
+    static int ProcessSpan(int span_type, bool enter, void* detail, void* userdata);
     static int ProcessText(int text_type, const char* text, unsigned size, void* userdata);
     
     struct RenderContext {
         std::string* output;
         bool plain_text_mode;
+        const std::atomic<bool>* cancel;
+        MarkdownHandler* handler = nullptr;
+        RenderSink* sink = nullptr;
     };
 };
 
@@ -0,0 +1,100 @@
+#include "output_file.h"
+#include "error_handler.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <random>
+#include <utility>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ShinoEditor {
+
+namespace {
+// 同じ名前を作り直す回数の上限（乱数の名前が続けて衝突することはまずない）
+constexpr int kTempAttempts = 100;
+
+// path + ".XXXXXXXX.tmp"（X は乱数）
+std::string RandomTempPath(const std::string& path) {
+    static constexpr char kChars[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    thread_local std::mt19937_64 engine{std::random_device{}()};
+    std::uniform_int_distribution<size_t> pick(0, sizeof(kChars) - 2);
+    std::string temp = path + ".";
+    for (int i = 0; i < 8; ++i) temp += kChars[pick(engine)];
+    return temp + ".tmp";
+}
+}
+
+OutputFile::OutputFile(const std::string& path, std::string what)
+    : path_(path), what_(std::move(what)) {
+    // 出力先が既存のファイルへのシンボリックリンクなら、リンクは残してリンク先を置き換える
+    // （リンク先がなければリンクを普通のファイルで置き換える）
+    std::error_code ec;
+    if (std::filesystem::is_symlink(path_, ec)) {
+        const auto target = std::filesystem::canonical(path_, ec);
+        if (!ec) path_ = target.string();
+    }
+
+    // 一時ファイルは出力先と同じディレクトリに、推測できない名前で新しく作る（既存のファイルやリンクは開かない）
+    for (int attempt = 0; attempt < kTempAttempts && fd_ < 0; ++attempt) {
+        temp_path_ = RandomTempPath(path_);
+#ifdef _WIN32
+        fd_ = _open(temp_path_.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        fd_ = ::open(temp_path_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+#endif
+        if (fd_ < 0 && errno != EEXIST) break;
+    }
+    if (fd_ < 0) error::ThrowFileNotWritable(path_);
+
+#ifndef _WIN32
+    // 既存のファイルを置き換えるときは、rename で権限と所有者が変わらないよう一時ファイルに写す
+    // （0600 の文書を書き出して誰でも読めるファイルにしない）。所有者を写せなければ setuid/setgid は落とす
+    struct stat st;
+    if (::stat(path_.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        if (::fchown(fd_, st.st_uid, st.st_gid) != 0) st.st_mode &= ~(S_ISUID | S_ISGID);
+        ::fchmod(fd_, st.st_mode & 07777);
+    }
+#endif
+}
+
+OutputFile::~OutputFile() {
+    if (fd_ >= 0) Close();
+    if (!committed_) {
+        std::error_code ec;
+        std::filesystem::remove(temp_path_, ec);
+    }
+}
+
+void OutputFile::Commit(FdSink& sink) {
+    if (!sink.Flush()) {
+        throw ShinoError(ShinoError::Category::File, "Failed to write " + what_,
+                         path_ + ": " + std::strerror(sink.Error()));
+    }
+    if (!Close()) error::ThrowFileNotWritable(path_);
+    std::error_code ec;
+    std::filesystem::rename(temp_path_, path_, ec);
+    if (ec) {
+        throw ShinoError(ShinoError::Category::File, "Failed to write " + what_,
+                         path_ + ": " + ec.message());
+    }
+    committed_ = true;
+}
+
+bool OutputFile::Close() {
+#ifdef _WIN32
+    const bool ok = _close(fd_) == 0;
+#else
+    const bool ok = ::close(fd_) == 0;
+#endif
+    fd_ = -1;
+    return ok;
+}
+
+}
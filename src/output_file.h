@@ -0,0 +1,38 @@
+#pragma once
+#include "render_sink.h"
+#include <string>
+
+namespace ShinoEditor {
+
+// 書き出し先のファイル
+// 同じディレクトリの一時ファイル（path + ".<乱数>.tmp" を O_EXCL で作る）に書き、Commit で出力先へ rename する。Commit しなければ一時ファイルを消すので、
+// 失敗しても既存のファイルは壊れない
+// 既存のファイルを置き換えるときは権限と（できれば）所有者を引き継ぐ。出力先が既存のファイルへの
+// シンボリックリンクなら、リンクはそのままでリンク先を置き換える
+class OutputFile {
+public:
+    // 作れなければ ShinoError（File）。what は失敗したときのメッセージに使う（"HTML" など）
+    OutputFile(const std::string& path, std::string what);
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    int fd() const { return fd_; }
+    // 一時ファイルのパス（別のプロセスに書かせてから Commit するとき）
+    const std::string& temp_path() const { return temp_path_; }
+
+    // sink を Flush して閉じ、出力先へ移す。失敗したら ShinoError（File）
+    void Commit(FdSink& sink);
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::string what_;
+    int fd_ = -1;
+    bool committed_ = false;
+
+    bool Close();
+};
+
+}
@@ -1,109 +1,249 @@
 #include "pandoc_io.h"
+#include "docx_reader.h"
+#include "docx_writer.h"
+#include "error_handler.h"
+#include "output_file.h"
 #include "security.h"
+#include "subprocess.h"
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
-#include <cstdio>
-#include <fstream>
 #include <sstream>
-#include <iostream>
-#include <memory>
-#include <random>
-#include <chrono>
 #include <filesystem>
+#include <future>
+#include <mutex>
 #include <system_error>
 
 namespace fs = std::filesystem;
 
 namespace ShinoEditor {
 
-// Generate a secure temporary file name
-std::string PandocIO::GenerateTempFileName() {
-    fs::path dir;
-    try {
-        dir = fs::temp_directory_path();
-    } catch (...) {
+namespace {
+// 調べた pandoc の実行ファイル（パスと更新時刻が同じなら同じものとみなす）
+struct PandocBinary {
+    std::string path;
+    fs::file_time_type mtime;
+    bool operator==(const PandocBinary& other) const = default;
+};
+
+// PATH から pandoc を探す（プロセスは起動せず stat するだけ）
+std::optional<PandocBinary> LocatePandoc() {
+    const char* env = std::getenv("PATH");
+    if (!env) return std::nullopt;
 #ifdef _WIN32
-        dir = "C:/Windows/Temp";
+    const char separator = ';';
+    const char* name = "pandoc.exe";
 #else
-        dir = "/tmp";
+    const char separator = ':';
+    const char* name = "pandoc";
 #endif
+    std::string_view rest(env);
+    while (true) {
+        const size_t end = rest.find(separator);
+        const std::string_view dir = rest.substr(0, end);
+        // 空の要素はカレントディレクトリ
+        const fs::path candidate = fs::path(dir.empty() ? std::string(".") : std::string(dir)) / name;
+        std::error_code ec;
+        const auto status = fs::status(candidate, ec);
+        const auto exec = fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec;
+        if (!ec && fs::is_regular_file(status) && (status.permissions() & exec) != fs::perms::none) {
+            const auto mtime = fs::last_write_time(candidate, ec);
+            if (!ec) {
+                const fs::path absolute = fs::absolute(candidate, ec);
+                return PandocBinary{ec ? candidate.string() : absolute.string(), mtime};
+            }
+        }
+        if (end == std::string_view::npos) break;
+        rest.remove_prefix(end + 1);
     }
-    std::random_device rd;
-    std::mt19937_64 gen(rd());
-    std::uniform_int_distribution<uint64_t> dist;
+    return std::nullopt;
+}
 
-    for (int attempt = 0; attempt < 64; ++attempt) {
-        const auto now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-        std::ostringstream oss;
-        oss << "shino_temp_" << std::hex << now << '_' << dist(gen) << ".md";
-        const fs::path candidate = dir / oss.str();
+// 調べた（調べている）実行ファイルと、その結果。プロセス全体で 1 つ
+struct ProbeState {
+    std::mutex mutex;
+    std::optional<PandocBinary> binary;
+    std::shared_future<PandocCapabilities> result;
+};
 
-        std::error_code ec;
-        if (!fs::exists(candidate, ec)) {
-            return candidate.string();
-        }
+ProbeState& GetProbeState() {
+    static ProbeState state;
+    return state;
+}
+
+std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) {
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.pop_back();
+        if (!line.empty()) lines.push_back(std::move(line));
     }
+    return lines;
+}
+
+bool Contains(const std::vector<std::string>& list, std::string_view value) {
+    return std::find(list.begin(), list.end(), value) != list.end();
+}
+}
 
-    // Fallback in the unlikely event all attempts fail
-    return (dir / "shino_temp_fallback.md").string();
+bool PandocCapabilities::SupportsInput(std::string_view format) const {
+    return available && (input_formats.empty() || Contains(input_formats, format));
+}
+
+bool PandocCapabilities::SupportsOutput(std::string_view format) const {
+    return available && (output_formats.empty() || Contains(output_formats, format));
+}
+
+bool PandocCapabilities::HasExtension(std::string_view extension) const {
+    return Contains(extensions, extension);
 }
 
 bool PandocIO::IsPandocAvailable() {
-    try {
-        // Execute pandoc --version and consider it available if we get any output
-        std::string cmd = security::CommandValidator::BuildSafeCommand("pandoc", {"--version"});
-        std::string output = ExecutePandocCommand(cmd);
-        return !output.empty();
-    } catch (...) {
-        return false;
+    return GetCapabilities().available;
+}
+
+void PandocIO::StartCapabilityProbe() {
+    const auto binary = LocatePandoc();
+    auto& state = GetProbeState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.result.valid() && state.binary == binary) return;
+    state.binary = binary;
+    if (!binary) {
+        std::promise<PandocCapabilities> none;
+        none.set_value(PandocCapabilities{});
+        state.result = none.get_future().share();
+        return;
     }
+    state.result = std::async(std::launch::async, &PandocIO::ProbeCapabilities, binary->path).share();
 }
 
-std::optional<std::string> PandocIO::ImportDocx(const std::string& docx_path) {
-    // Verify pandoc availability
-    if (!IsPandocAvailable()) {
-        return std::nullopt;
+PandocCapabilities PandocIO::GetCapabilities() {
+    StartCapabilityProbe();
+    std::shared_future<PandocCapabilities> result;
+    {
+        auto& state = GetProbeState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        result = state.result;
     }
-    
+    return result.get();
+}
+
+PandocCapabilities PandocIO::ProbeCapabilities(const std::string& path) {
+    auto run = [&path](const std::string& arg) {
+        std::string output;
+        try {
+            const auto result = Subprocess::Run({path, arg}, {}, [&output](std::string_view chunk) { output += chunk; });
+            if (!result.Succeeded()) output.clear();
+        } catch (const ShinoError&) {
+            output.clear();
+        }
+        return output;
+    };
+    PandocCapabilities caps;
+    caps.path = path;
+    const auto version = SplitLines(run("--version"));
+    if (version.empty()) return caps;
+    caps.available = true;
+    caps.version = version.front();
+    caps.input_formats = SplitLines(run("--list-input-formats"));
+    caps.output_formats = SplitLines(run("--list-output-formats"));
+    // "+smart" は既定で有効、"-emoji" は無効
+    for (const auto& extension : SplitLines(run("--list-extensions=markdown"))) {
+        if (extension[0] == '+') caps.extensions.push_back(extension.substr(1));
+    }
+    return caps;
+}
+
+namespace {
+// 読み込んでよい DOCX のパスか（組み込みの変換も pandoc も、これを通ったものだけを読む）
+bool IsImportableDocx(const std::string& docx_path) {
     // Validate file security and permissions
     try {
         security::PathValidator::ValidateFileOperation(docx_path, false);
     } catch (const security::SecurityError&) {
-        return std::nullopt;
+        return false;
     }
     
     // Verify file has .docx extension
-    if (fs::path(docx_path).extension() != ".docx") {
-        return std::nullopt;
+    return fs::path(docx_path).extension() == ".docx";
+}
+
+// 組み込みの変換（DocxReader）で読む。そのまま使えるなら true、pandoc で読み直すなら false
+// 落とした内容があったり DOCX として読めなかったりしても、pandoc で読めなければ組み込みの結果（か例外）のまま
+bool ImportNative(const std::string& docx_path, const std::function<void(std::string_view)>& on_markdown,
+                  const std::atomic<bool>* cancel) {
+    try {
+        if (DocxReader::Convert(docx_path, on_markdown, cancel).Complete()) return true;
+    } catch (const ShinoError& e) {
+        // 中止と、pandoc でも読めないものはそのまま投げる
+        if (e.category() == ShinoError::Category::Convert || !PandocIO::GetCapabilities().SupportsInput("docx")) throw;
+        return false;
+    }
+    return !PandocIO::GetCapabilities().SupportsInput("docx");
+}
+
+bool ImportWithPandoc(const std::string& docx_path, const std::function<void(std::string_view)>& on_markdown,
+                      const std::atomic<bool>* cancel) {
+    // Verify pandoc availability
+    const auto caps = PandocIO::GetCapabilities();
+    if (!caps.SupportsInput("docx")) {
+        return false;
     }
     
-    // Build and validate command
-    std::vector<std::string> args = {
-        "-f", "docx",
-        "-t", "markdown",
-        docx_path
-    };
-    
+    // shell を通さずに起動し、出力は読めた分ずつ渡す
+    const auto result = Subprocess::Run({caps.path, "-f", "docx", "-t", "markdown", docx_path}, {}, on_markdown, cancel);
+    if (!result.Succeeded()) {
+        error::ThrowConversionFailed("docx", "markdown", "pandoc " + result.Describe());
+    }
+    return true;
+}
+}
+
+std::optional<std::string> PandocIO::ImportDocx(const std::string& docx_path) {
+    std::string markdown;
+    if (!ImportDocx(docx_path, [&markdown](std::string_view chunk) { markdown += chunk; })) {
+        return std::nullopt;
+    }
+    return markdown;
+}
+
+bool PandocIO::ImportDocx(const std::string& docx_path, std::vector<std::string>& lines,
+                          const std::atomic<bool>* cancel) {
+    if (!IsImportableDocx(docx_path)) {
+        return false;
+    }
+    // 組み込みの変換は行に直接書き、pandoc で読み直すときや失敗したときは書いた分を戻す
+    const size_t keep = lines.size();
     try {
-        // Build and execute pandoc command
-        std::string command = security::CommandValidator::BuildSafeCommand("pandoc", args);
-        std::string result = ExecutePandocCommand(command);
-        
-        if (result.empty()) {
-            return std::nullopt;
+        LineSplitter splitter(lines);
+        if (ImportNative(docx_path, [&splitter](std::string_view chunk) { splitter.Append(chunk); }, cancel)) {
+            return true;
         }
-        
-        return result;
     } catch (...) {
-        return std::nullopt;
+        lines.resize(keep);
+        throw;
     }
+    lines.resize(keep);
+    LineSplitter splitter(lines);
+    return ImportWithPandoc(docx_path, [&splitter](std::string_view chunk) { splitter.Append(chunk); }, cancel);
 }
 
-bool PandocIO::ExportDocx(const std::string& markdown_content, const std::string& docx_path) {
-    // Verify pandoc availability
-    if (!IsPandocAvailable()) {
+bool PandocIO::ImportDocx(const std::string& docx_path, const std::function<void(std::string_view)>& on_markdown,
+                          const std::atomic<bool>* cancel) {
+    if (!IsImportableDocx(docx_path)) {
         return false;
     }
-    
+    // pandoc で読み直すことがあるので、組み込みの変換の出力は溜めてから渡す
+    std::string markdown;
+    if (ImportNative(docx_path, [&markdown](std::string_view chunk) { markdown += chunk; }, cancel)) {
+        on_markdown(markdown);
+        return true;
+    }
+    return ImportWithPandoc(docx_path, on_markdown, cancel);
+}
+
+bool PandocIO::ExportDocx(std::string_view markdown_content, const std::string& docx_path,
+                          const std::atomic<bool>* cancel, DocxEngine engine) {
     // Verify output file has .docx extension
     if (fs::path(docx_path).extension() != ".docx") {
         return false;
@@ -116,114 +256,41 @@ bool PandocIO::ExportDocx(const std::string& markdown_content, const std::string
         return false;
     }
     
-    // Create and validate temporary file
-    std::string temp_file = GenerateTempFileName();
-    
-    try {
-        security::PathValidator::ValidateFileOperation(temp_file, true);
-    } catch (const security::SecurityError&) {
-        return false;
-    }
-    
-    // Write content to temp file
-    std::ofstream temp_out(temp_file);
-    if (!temp_out) {
-        return false;
-    }
-    temp_out << markdown_content;
-    temp_out.close();
-    
-    // Ensure temp file was written
-    if (!fs::exists(temp_file)) {
-        return false;
+    // どちらの変換も同じディレクトリの一時ファイルに書き、最後に 1 回だけ出力先へ rename する
+    // （pandoc が失敗しても、止めても、既存のファイルは壊れない）
+    OutputFile file(docx_path, "DOCX");
+    const auto caps = GetCapabilities();
+    if (engine == DocxEngine::AUTO) {
+        // まず組み込みの変換（DocxWriter）で書く。画像など落とした内容がなければ、pandoc は起動しない
+        FdSink sink(file.fd());
+        if (DocxWriter::Write(markdown_content, sink, cancel).Complete() || !caps.SupportsOutput("docx")) {
+            file.Commit(sink);
+            return true;
+        }
+        // 書いた分は pandoc が一時ファイルごと書き直す（バッファを後から書き足さないよう、ここで出し切る）
+        sink.Flush();
+    } else if (!caps.SupportsOutput("docx")) {
+        error::ThrowConversionFailed("markdown", "docx", "pandoc is not available");
     }
     
-    // Build and validate command
-    std::vector<std::string> args = {
-        "-f", "markdown",
-        "-t", "docx",
-        temp_file,
-        "-o", docx_path
-    };
-    
-    try {
-        std::string command = security::CommandValidator::BuildSafeCommand("pandoc", args);
-        std::string result = ExecutePandocCommand(command);
-        
-        // Clean up temp file
-        try {
-            fs::remove(temp_file);
-        } catch (...) {
-            // Log but don't throw - temp file cleanup failure isn't critical
-            std::cerr << "Warning: Failed to remove temporary file: " << temp_file << std::endl;
-        }
-        
-        // Check if output file was created and is readable
-        if (!fs::exists(docx_path)) {
-            return false;
-        }
-        
-        return true;
-    } catch (...) {
-        // Clean up temp file
-        try {
-            fs::remove(temp_file);
-        } catch (...) {
-            // Ignore cleanup errors
-        }
-        return false;
+    // pandoc で一時ファイルに書き直す。Markdown は一時ファイルを介さずに stdin に流し込む
+    const auto result = Subprocess::Run({caps.path, "-f", "markdown", "-t", "docx", "-o", file.temp_path()},
+                                        markdown_content, nullptr, cancel);
+    if (!result.Succeeded()) {
+        error::ThrowConversionFailed("markdown", "docx", "pandoc " + result.Describe());
     }
+    FdSink sink(file.fd());
+    file.Commit(sink);
+    return true;
 }
 
 std::string PandocIO::GetPandocVersion() {
-    if (!IsPandocAvailable()) {
+    // 起動時に調べた結果を使う（pandoc は起動しない）
+    const auto caps = GetCapabilities();
+    if (!caps.available) {
         error::ThrowSystemError("version check", "pandoc is not available");
     }
-    std::string command = security::CommandValidator::BuildSafeCommand("pandoc", {"--version"});
-    std::string output = ExecutePandocCommand(command);
-    if (output.empty()) {
-        error::ThrowSystemError("version check", "failed to get pandoc version");
-    }
-    std::istringstream stream(output);
-    std::string first_line;
-    std::getline(stream, first_line);
-    if (first_line.empty()) {
-        error::ThrowSystemError("version check", "failed to parse pandoc version");
-    }
-    return first_line;
-}
-
-std::string PandocIO::ExecutePandocCommand(const std::string& command) {
-#ifdef _WIN32
-    FILE* pipe = _popen(command.c_str(), "r");
-#else
-    FILE* pipe = popen(command.c_str(), "r");
-#endif
-    if (!pipe) {
-        return "";
-    }
-
-    std::string result;
-    char buffer[256];
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
-    }
-
-#ifdef _WIN32
-    int status = _pclose(pipe);
-#else
-    int status = pclose(pipe);
-#endif
-    if (status != 0) {
-        return "";
-    }
-
-    return result;
-}
-
-std::string PandocIO::ShellEscape(const std::string& arg) {
-    // Use the security framework's shell escaping
-    return security::CommandValidator::SafeShellEscape(arg);
+    return caps.version;
 }
 
 }
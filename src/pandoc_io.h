@@ -1,32 +1,73 @@
 #pragma once
+#include <atomic>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <vector>
 
 namespace ShinoEditor {
 
+// pandoc で何ができるか（プロセス全体で 1 回調べて使い回す）
+struct PandocCapabilities {
+    bool available = false;
+    std::string path;    // PATH から見つけた実行ファイル
+    std::string version; // --version の 1 行目（例: "pandoc 3.1.11"）
+    std::vector<std::string> input_formats;  // --list-input-formats
+    std::vector<std::string> output_formats; // --list-output-formats
+    std::vector<std::string> extensions;     // --list-extensions=markdown のうち既定で有効なもの
+
+    // 一覧を出せない古い pandoc（1.18 より前）では、使えるものとして扱う
+    bool SupportsInput(std::string_view format) const;
+    bool SupportsOutput(std::string_view format) const;
+    bool HasExtension(std::string_view extension) const;
+};
+
+// DOCX の書き出し方
+enum class DocxEngine {
+    AUTO,   // 組み込みの変換で書き、落とした内容があって pandoc が使えれば pandoc で書き直す
+    PANDOC, // 最初から pandoc で書く（忠実さを優先）
+};
+
 class PandocIO {
 public:
     // Check if pandoc is available
     static bool IsPandocAvailable();
+
+    // pandoc の能力の調査をバックグラウンドで始める（起動時に呼ぶ。調べてあれば何もしない）
+    static void StartCapabilityProbe();
+    // 調べた結果を返す。調査中なら終わるまで待つ
+    // PATH から見つかる実行ファイルのパスか更新時刻が前回と違えば（入れ替え/更新）調べ直す。
+    // 見つからなければ pandoc を起動せずに available = false
+    static PandocCapabilities GetCapabilities();
     
-    // Import DOCX file to markdown
+    // DOCX を Markdown に変換する。まず組み込みの変換（DocxReader）で読み、
+    // 画像や脚注など落とした内容があるか読めなければ pandoc で読み直す（pandoc は shell を通さずに起動）。
+    // pandoc がなければ組み込みの結果をそのまま使い、読めなければ ShinoError（Parser）を投げる。
+    // パスが不正なら nullopt/false。pandoc が失敗したら終了状態と stderr を添えて ShinoError（Convert）を投げる
     static std::optional<std::string> ImportDocx(const std::string& docx_path);
+    // 出力を読めた分ずつそのまま行に分けて lines の末尾に足す（文書全体の文字列を作らない）
+    // cancel が立てば変換を止めて ShinoError（Convert）
+    static bool ImportDocx(const std::string& docx_path, std::vector<std::string>& lines,
+                           const std::atomic<bool>* cancel = nullptr);
+    static bool ImportDocx(const std::string& docx_path, const std::function<void(std::string_view)>& on_markdown,
+                           const std::atomic<bool>* cancel = nullptr);
     
-    // Export markdown to DOCX file
-    static bool ExportDocx(const std::string& markdown_content, const std::string& docx_path);
+    // Markdown を DOCX に書き出す。AUTO ならまず組み込みの変換（DocxWriter）で書き、画像や（md4c がなければ）表など
+    // 落とした内容があって pandoc が使えれば pandoc で書き直す。PANDOC なら最初から pandoc で書く
+    // （Markdown は一時ファイルを作らずに pandoc の stdin に流し込む）。どちらも出力先と同じディレクトリの一時ファイルに
+    // 書いて最後に rename するので、pandoc が失敗しても既存のファイルは残る。
+    // パスが不正なら false。書けなければ ShinoError（File）、pandoc が失敗したか PANDOC で pandoc が
+    // DOCX を書けなければ ShinoError（Convert）
+    static bool ExportDocx(std::string_view markdown_content, const std::string& docx_path,
+                           const std::atomic<bool>* cancel = nullptr, DocxEngine engine = DocxEngine::AUTO);
     
     // Get pandoc version
     static std::string GetPandocVersion();
     
 private:
-    // Execute pandoc command
-    static std::string ExecutePandocCommand(const std::string& command);
-
-    // Generate a secure temporary file name
-    static std::string GenerateTempFileName();
-
-    // Shell安全のための簡易エスケープ（主にPOSIX想定）
-    static std::string ShellEscape(const std::string& arg);
+    // pandoc を起動して能力を調べる（4 回起動する）
+    static PandocCapabilities ProbeCapabilities(const std::string& path);
 };
 
 }
@@ -0,0 +1,273 @@
+#include "preview_model.h"
+#include <algorithm>
+
+namespace ShinoEditor {
+
+namespace {
+int StyleIndex(MarkdownSpan type) {
+    switch (type) {
+    case MarkdownSpan::STRONG:   return 0;
+    case MarkdownSpan::EMPHASIS: return 1;
+    case MarkdownSpan::CODE:     return 2;
+    case MarkdownSpan::LINK:
+    case MarkdownSpan::IMAGE:    return 3;
+    case MarkdownSpan::STRIKE:   return 4;
+    }
+    return 0;
+}
+}
+
+std::string PreviewLine::PlainText() const {
+    std::string out;
+    for (const auto& run : runs) out += run.text;
+    return out;
+}
+
+void PreviewBuilder::EnterBlock(MarkdownBlock type, int detail) {
+    switch (type) {
+    case MarkdownBlock::DOCUMENT:
+    case MarkdownBlock::TABLE_HEAD:
+    case MarkdownBlock::TABLE_BODY:
+        break;
+    case MarkdownBlock::QUOTE:
+        FlushLine();
+        ++quote_depth_;
+        break;
+    case MarkdownBlock::UNORDERED_LIST:
+    case MarkdownBlock::ORDERED_LIST:
+        FlushLine();
+        lists_.push_back({type == MarkdownBlock::ORDERED_LIST, detail > 0 ? detail : 1});
+        break;
+    case MarkdownBlock::LIST_ITEM:
+        FlushLine();
+        if (!lists_.empty()) {
+            ListState& list = lists_.back();
+            pending_bullet_ = list.ordered ? std::to_string(list.next_number++) + ". " : "• ";
+        }
+        break;
+    case MarkdownBlock::RULE: {
+        FlushLine();
+        PreviewLine rule;
+        rule.kind = PreviewLineKind::RULE;
+        rule.quote_depth = quote_depth_;
+        lines_.push_back(std::move(rule));
+        EndTopLevelBlock();
+        break;
+    }
+    case MarkdownBlock::HEADER:
+        header_level_ = detail;
+        StartLine(PreviewLineKind::HEADER);
+        break;
+    case MarkdownBlock::CODE:
+    case MarkdownBlock::HTML:
+        in_code_ = true;
+        StartLine(PreviewLineKind::CODE);
+        break;
+    case MarkdownBlock::PARAGRAPH:
+        StartLine(PreviewLineKind::TEXT);
+        break;
+    case MarkdownBlock::TABLE:
+        FlushLine();
+        break;
+    case MarkdownBlock::TABLE_ROW:
+        StartLine(PreviewLineKind::TEXT);
+        cell_index_ = 0;
+        break;
+    case MarkdownBlock::TABLE_HEADER_CELL:
+    case MarkdownBlock::TABLE_CELL:
+        if (!has_current_) StartLine(PreviewLineKind::TEXT);
+        if (cell_index_++ > 0) current_.runs.push_back({" │ ", PREVIEW_PLAIN});
+        if (type == MarkdownBlock::TABLE_HEADER_CELL) EnterSpan(MarkdownSpan::STRONG, {});
+        break;
+    }
+}
+
+void PreviewBuilder::LeaveBlock(MarkdownBlock type) {
+    switch (type) {
+    case MarkdownBlock::DOCUMENT:
+    case MarkdownBlock::TABLE_BODY:
+    case MarkdownBlock::RULE:
+        break;
+    case MarkdownBlock::QUOTE:
+        FlushLine();
+        if (quote_depth_ > 0) --quote_depth_;
+        break;
+    case MarkdownBlock::UNORDERED_LIST:
+    case MarkdownBlock::ORDERED_LIST:
+        FlushLine();
+        if (!lists_.empty()) lists_.pop_back();
+        EndTopLevelBlock();
+        break;
+    case MarkdownBlock::LIST_ITEM:
+        // 中身のない項目も行頭記号だけは出す
+        if (!pending_bullet_.empty()) StartLine(PreviewLineKind::TEXT);
+        FlushLine();
+        break;
+    case MarkdownBlock::HEADER:
+        FlushLine();
+        header_level_ = 0;
+        EndTopLevelBlock();
+        break;
+    case MarkdownBlock::CODE:
+    case MarkdownBlock::HTML:
+        // 最後の改行の後に始めた空行は捨てる
+        if (has_current_ && current_.runs.empty()) has_current_ = false;
+        FlushLine();
+        in_code_ = false;
+        EndTopLevelBlock();
+        break;
+    case MarkdownBlock::PARAGRAPH:
+        FlushLine();
+        EndTopLevelBlock();
+        break;
+    case MarkdownBlock::TABLE_HEAD: {
+        PreviewLine rule;
+        rule.kind = PreviewLineKind::RULE;
+        rule.quote_depth = quote_depth_;
+        lines_.push_back(std::move(rule));
+        break;
+    }
+    case MarkdownBlock::TABLE_ROW:
+        FlushLine();
+        break;
+    case MarkdownBlock::TABLE:
+        EndTopLevelBlock();
+        break;
+    case MarkdownBlock::TABLE_HEADER_CELL:
+        LeaveSpan(MarkdownSpan::STRONG);
+        break;
+    case MarkdownBlock::TABLE_CELL:
+        break;
+    }
+}
+
+void PreviewBuilder::EnterSpan(MarkdownSpan type, std::string_view) {
+    ++style_counts_[StyleIndex(type)];
+}
+
+void PreviewBuilder::LeaveSpan(MarkdownSpan type) {
+    int& count = style_counts_[StyleIndex(type)];
+    if (count > 0) --count;
+}
+
+void PreviewBuilder::Text(std::string_view text) {
+    if (in_code_) {
+        // コードブロックは改行ごとに 1 行
+        size_t start = 0;
+        while (start <= text.size()) {
+            const size_t nl = text.find('\n', start);
+            const size_t end = nl == std::string_view::npos ? text.size() : nl;
+            if (end > start) {
+                if (!has_current_) StartLine(PreviewLineKind::CODE);
+                current_.runs.push_back({std::string(text.substr(start, end - start)), PREVIEW_CODE});
+            }
+            if (nl == std::string_view::npos) break;
+            if (!has_current_) StartLine(PreviewLineKind::CODE);
+            FlushLine();
+            StartLine(PreviewLineKind::CODE);
+            start = nl + 1;
+        }
+        return;
+    }
+
+    if (text.empty()) return;
+    // 緊密なリストでは段落なしで項目の中に直接テキストが来る
+    if (!has_current_) StartLine(PreviewLineKind::TEXT);
+    const uint8_t style = CurrentStyle();
+    if (!current_.runs.empty() && current_.runs.back().style == style) {
+        current_.runs.back().text.append(text);
+    } else {
+        current_.runs.push_back({std::string(text), style});
+    }
+}
+
+void PreviewBuilder::SoftBreak() {
+    Text(" ");
+}
+
+void PreviewBuilder::HardBreak() {
+    const PreviewLineKind kind = has_current_ ? current_.kind : PreviewLineKind::TEXT;
+    FlushLine();
+    StartLine(kind);
+}
+
+void PreviewScrollMap::AddAnchor(int source_line, int row) {
+    auto it = std::lower_bound(anchors_.begin(), anchors_.end(), source_line,
+                               [](const Anchor& a, int line) { return a.line < line; });
+    if (it != anchors_.end() && it->line == source_line) {
+        it->row = row;
+        return;
+    }
+    anchors_.insert(it, Anchor{source_line, row});
+}
+
+int PreviewScrollMap::RowForLine(int source_line) const {
+    if (anchors_.empty()) return 0;
+    auto it = std::upper_bound(anchors_.begin(), anchors_.end(), source_line,
+                               [](int line, const Anchor& a) { return line < a.line; });
+    if (it == anchors_.begin()) return anchors_.front().row;
+    if (it == anchors_.end()) return anchors_.back().row;
+    const Anchor& a = *(it - 1);
+    const Anchor& b = *it;
+    return a.row + (b.row - a.row) * (source_line - a.line) / (b.line - a.line);
+}
+
+int PreviewScrollMap::LineForRow(int row) const {
+    if (anchors_.empty()) return 0;
+    // 段の昇順でもある
+    auto it = std::upper_bound(anchors_.begin(), anchors_.end(), row,
+                               [](int r, const Anchor& a) { return r < a.row; });
+    if (it == anchors_.begin()) return anchors_.front().line;
+    if (it == anchors_.end()) return anchors_.back().line;
+    const Anchor& a = *(it - 1);
+    const Anchor& b = *it;
+    return a.line + (b.line - a.line) * (row - a.row) / (b.row - a.row);
+}
+
+std::vector<PreviewLine> PreviewBuilder::Finish() {
+    FlushLine();
+    return std::move(lines_);
+}
+
+void PreviewBuilder::StartLine(PreviewLineKind kind) {
+    FlushLine();
+    current_ = PreviewLine{};
+    current_.kind = kind;
+    current_.level = kind == PreviewLineKind::HEADER ? header_level_ : 0;
+    current_.quote_depth = quote_depth_;
+    if (!lists_.empty()) {
+        current_.prefix.assign(2 * (lists_.size() - 1), ' ');
+        if (!pending_bullet_.empty()) {
+            current_.prefix += pending_bullet_;
+            pending_bullet_.clear();
+        } else {
+            current_.prefix += "  ";
+        }
+    }
+    has_current_ = true;
+}
+
+void PreviewBuilder::FlushLine() {
+    if (!has_current_) return;
+    lines_.push_back(std::move(current_));
+    has_current_ = false;
+}
+
+void PreviewBuilder::EndTopLevelBlock() {
+    // リストの外では、ブロックの後に空行を入れて区切る
+    if (!lists_.empty()) return;
+    PreviewLine blank;
+    blank.kind = PreviewLineKind::BLANK;
+    blank.quote_depth = quote_depth_;
+    lines_.push_back(std::move(blank));
+}
+
+uint8_t PreviewBuilder::CurrentStyle() const {
+    uint8_t style = PREVIEW_PLAIN;
+    for (int i = 0; i < 5; ++i) {
+        if (style_counts_[i] > 0) style |= static_cast<uint8_t>(1 << i);
+    }
+    return style;
+}
+
+}
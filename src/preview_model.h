@@ -0,0 +1,102 @@
+#pragma once
+#include "markdown_parser.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// インライン装飾（ビットの組み合わせ）
+enum PreviewStyle : uint8_t {
+    PREVIEW_PLAIN = 0,
+    PREVIEW_STRONG = 1 << 0,
+    PREVIEW_EMPHASIS = 1 << 1,
+    PREVIEW_CODE = 1 << 2,
+    PREVIEW_LINK = 1 << 3,
+    PREVIEW_STRIKE = 1 << 4
+};
+
+struct PreviewRun {
+    std::string text;
+    uint8_t style = PREVIEW_PLAIN;
+};
+
+enum class PreviewLineKind {
+    TEXT,
+    HEADER,
+    CODE,
+    RULE,
+    BLANK
+};
+
+// プレビューの 1 論理行（折り返しは表示側で行う）
+struct PreviewLine {
+    PreviewLineKind kind = PreviewLineKind::TEXT;
+    int level = 0;          // 見出しレベル
+    int quote_depth = 0;    // 引用の深さ
+    std::string prefix;     // リストの字下げと行頭記号
+    std::vector<PreviewRun> runs;
+
+    std::string PlainText() const;
+};
+
+// パーサーのイベント（md4c のコールバックまたは MarkdownParser）から PreviewLine を組み立てる
+class PreviewBuilder : public MarkdownHandler {
+public:
+    void EnterBlock(MarkdownBlock type, int detail) override;
+    void LeaveBlock(MarkdownBlock type) override;
+    void EnterSpan(MarkdownSpan type, std::string_view url) override;
+    void LeaveSpan(MarkdownSpan type) override;
+    void Text(std::string_view text) override;
+    void SoftBreak() override;
+    void HardBreak() override;
+
+    std::vector<PreviewLine> Finish();
+
+private:
+    struct ListState {
+        bool ordered;
+        int next_number;
+    };
+
+    std::vector<PreviewLine> lines_;
+    PreviewLine current_;
+    bool has_current_ = false;
+    int quote_depth_ = 0;
+    std::vector<ListState> lists_;
+    std::string pending_bullet_;
+    int header_level_ = 0;
+    bool in_code_ = false;
+    int cell_index_ = 0;
+    int style_counts_[5] = {}; // PreviewStyle のビットごとの入れ子数
+
+    void StartLine(PreviewLineKind kind);
+    void FlushLine();
+    void EndTopLevelBlock();
+    uint8_t CurrentStyle() const;
+};
+
+// ソース行 ↔ プレビューの段の対応（描画した範囲だけ）
+// 描画しながら「この行はこの段から始まる」という目印を置き、目印の間は線形に補間する
+class PreviewScrollMap {
+public:
+    void Clear() { anchors_.clear(); }
+    bool Empty() const { return anchors_.empty(); }
+
+    // 順不同で追加してよい。行と段はどちらも単調に増える前提
+    void AddAnchor(int source_line, int row);
+
+    // 範囲外は端の目印に寄せる。空なら 0
+    int RowForLine(int source_line) const;
+    int LineForRow(int row) const;
+
+private:
+    struct Anchor {
+        int line;
+        int row;
+    };
+    std::vector<Anchor> anchors_; // line の昇順
+};
+
+}
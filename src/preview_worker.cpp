@@ -0,0 +1,72 @@
+#include "preview_worker.h"
+#include <utility>
+
+namespace ShinoEditor {
+
+PreviewWorker::PreviewWorker(RenderFunc render, ResultCallback on_result,
+                             std::chrono::milliseconds debounce)
+    : render_(std::move(render)), on_result_(std::move(on_result)), debounce_(debounce) {
+    thread_ = std::thread([this] { Run(); });
+}
+
+PreviewWorker::~PreviewWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        cancel_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void PreviewWorker::Request(uint64_t revision, PreviewSnapshot snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_revision_ = revision;
+        pending_snapshot_ = std::move(snapshot);
+        pending_since_ = std::chrono::steady_clock::now();
+        has_pending_ = true;
+        // 実行中のレンダリングはもう古い
+        if (rendering_) cancel_ = true;
+    }
+    cv_.notify_all();
+}
+
+bool PreviewWorker::IsBusy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return has_pending_ || rendering_;
+}
+
+void PreviewWorker::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stop_ || has_pending_; });
+        if (stop_) return;
+
+        // デバウンス: 最後の要求から debounce_ の間、次の要求が来なくなるまで待つ
+        const auto deadline = pending_since_ + debounce_;
+        if (std::chrono::steady_clock::now() < deadline) {
+            cv_.wait_until(lock, deadline);
+            continue;
+        }
+
+        const uint64_t revision = pending_revision_;
+        PreviewSnapshot snapshot = std::move(pending_snapshot_);
+        has_pending_ = false;
+        rendering_ = true;
+        cancel_ = false;
+
+        lock.unlock();
+        std::string content = render_(snapshot, cancel_);
+        const bool cancelled = cancel_;
+        if (!cancelled) {
+            on_result_(revision, std::move(content));
+        }
+        lock.lock();
+        rendering_ = false;
+    }
+}
+
+}
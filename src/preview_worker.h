@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 文書のスナップショット（レンダリング単位ごとの Markdown）
+using PreviewSnapshot = std::vector<std::string>;
+
+// プレビューをバックグラウンドでレンダリングするワーカー
+// - Request() は文書のスナップショットを受け取り、すぐに戻る
+// - デバウンス期間内に次の要求が来たら前の要求は捨てる（連続入力で 1 回だけ描画）
+// - レンダリング中に新しい要求が来たら cancel フラグを立てて協調的に中断させる
+// - 完了結果はワーカースレッドから on_result で通知する（UI ループへの受け渡しは呼び出し側）
+class PreviewWorker {
+public:
+    // cancel が立ったら途中で戻ってよい（戻り値は捨てられる）
+    using RenderFunc = std::function<std::string(const PreviewSnapshot& snapshot,
+                                                 const std::atomic<bool>& cancel)>;
+    using ResultCallback = std::function<void(uint64_t revision, std::string content)>;
+
+    static constexpr std::chrono::milliseconds kDefaultDebounce{150};
+
+    PreviewWorker(RenderFunc render, ResultCallback on_result,
+                  std::chrono::milliseconds debounce = kDefaultDebounce);
+    ~PreviewWorker();
+
+    PreviewWorker(const PreviewWorker&) = delete;
+    PreviewWorker& operator=(const PreviewWorker&) = delete;
+
+    // revision の文書スナップショットのレンダリングを要求
+    void Request(uint64_t revision, PreviewSnapshot snapshot);
+
+    // 未処理の要求があるか、レンダリング中か
+    bool IsBusy() const;
+
+private:
+    RenderFunc render_;
+    ResultCallback on_result_;
+    const std::chrono::milliseconds debounce_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    bool has_pending_ = false;
+    uint64_t pending_revision_ = 0;
+    PreviewSnapshot pending_snapshot_;
+    std::chrono::steady_clock::time_point pending_since_;
+    bool rendering_ = false;
+    std::atomic<bool> cancel_{false};
+
+    std::thread thread_;
+
+    void Run();
+};
+
+}
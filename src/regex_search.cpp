@@ -0,0 +1,888 @@
+#include "regex_search.h"
+#include "error_handler.h"
+#include "utf8_util.h"
+#include <algorithm>
+#include <utility>
+
+namespace ShinoEditor {
+
+namespace {
+constexpr size_t npos = std::string_view::npos;
+constexpr char32_t kMaxCodepoint = 0x10FFFF;
+
+// 構文木。文字と文字クラスは構文解析の時点で UTF-8 のバイト範囲の並び/選択に展開する
+struct Node {
+    enum class Kind { EMPTY, BYTES, CONCAT, ALT, REPEAT, BEGIN_LINE, END_LINE };
+    Kind kind = Kind::EMPTY;
+    uint8_t lo = 0;
+    uint8_t hi = 0;
+    int min = 0;
+    int max = -1; // -1 は上限なし
+    std::vector<Node> children;
+
+    static Node Bytes(uint8_t lo, uint8_t hi) {
+        Node node;
+        node.kind = Kind::BYTES;
+        node.lo = lo;
+        node.hi = hi;
+        return node;
+    }
+    static Node Of(Kind kind, std::vector<Node> children = {}) {
+        Node node;
+        node.kind = kind;
+        node.children = std::move(children);
+        return node;
+    }
+};
+
+using CodepointRanges = std::vector<std::pair<char32_t, char32_t>>;
+
+[[noreturn]] void ThrowSyntaxError(const std::string& pattern, const std::string& detail) {
+    throw ShinoError(ShinoError::Category::Parser, "Invalid regular expression: " + detail, pattern);
+}
+
+// コードポイントの範囲 [lo, hi] を、UTF-8 のバイト範囲の並びの選択として alt に追加する
+// 符号化の長さが同じで、先頭以外のバイトが範囲全体を覆うところまで分割すれば、
+// 各バイト位置の範囲の並びで表せる
+void AddUtf8Range(char32_t lo, char32_t hi, std::vector<Node>& alt) {
+    if (lo > hi) return;
+    // サロゲートは符号化しない
+    if (lo <= 0xDFFF && hi >= 0xD800) {
+        if (lo < 0xD800) AddUtf8Range(lo, 0xD7FF, alt);
+        if (hi > 0xDFFF) AddUtf8Range(0xE000, hi, alt);
+        return;
+    }
+    // 符号化の長さが変わるところで分ける
+    for (char32_t limit : {char32_t(0x7F), char32_t(0x7FF), char32_t(0xFFFF)}) {
+        if (lo <= limit && hi > limit) {
+            AddUtf8Range(lo, limit, alt);
+            AddUtf8Range(limit + 1, hi, alt);
+            return;
+        }
+    }
+    if (hi <= 0x7F) {
+        alt.push_back(Node::Bytes(static_cast<uint8_t>(lo), static_cast<uint8_t>(hi)));
+        return;
+    }
+    // 下位の継続バイトが 0x80-0xBF 全体を覆うように分ける
+    for (int i = 1; i < 4; ++i) {
+        const char32_t mask = (char32_t(1) << (6 * i)) - 1;
+        if ((lo & ~mask) == (hi & ~mask)) continue;
+        if ((lo & mask) != 0) {
+            AddUtf8Range(lo, lo | mask, alt);
+            AddUtf8Range((lo | mask) + 1, hi, alt);
+            return;
+        }
+        if ((hi & mask) != mask) {
+            AddUtf8Range(lo, (hi & ~mask) - 1, alt);
+            AddUtf8Range(hi & ~mask, hi, alt);
+            return;
+        }
+    }
+    std::string a, b;
+    utf8::Append(a, lo);
+    utf8::Append(b, hi);
+    Node seq = Node::Of(Node::Kind::CONCAT);
+    for (size_t i = 0; i < a.size(); ++i) {
+        seq.children.push_back(Node::Bytes(static_cast<uint8_t>(a[i]), static_cast<uint8_t>(b[i])));
+    }
+    alt.push_back(std::move(seq));
+}
+
+Node ClassNode(CodepointRanges ranges, bool negate) {
+    std::sort(ranges.begin(), ranges.end());
+    CodepointRanges merged;
+    for (const auto& r : ranges) {
+        if (!merged.empty() && r.first <= merged.back().second + 1) {
+            merged.back().second = std::max(merged.back().second, r.second);
+        } else {
+            merged.push_back(r);
+        }
+    }
+    if (negate) {
+        // 否定した文字クラスは改行も含まない（行ごとに探すので影響はない）
+        merged.push_back({'\n', '\n'});
+        std::sort(merged.begin(), merged.end());
+        CodepointRanges complement;
+        char32_t next = 0;
+        for (const auto& r : merged) {
+            if (r.first > next) complement.push_back({next, r.first - 1});
+            next = std::max<char32_t>(next, r.second + 1);
+        }
+        if (next <= kMaxCodepoint) complement.push_back({next, kMaxCodepoint});
+        merged = std::move(complement);
+    }
+    Node alt = Node::Of(Node::Kind::ALT);
+    for (const auto& r : merged) AddUtf8Range(r.first, r.second, alt.children);
+    if (alt.children.size() == 1) return std::move(alt.children[0]);
+    return alt;
+}
+
+// \d \w \s（ASCII のみ）
+bool AddPerlClass(char c, CodepointRanges& ranges, bool& negate) {
+    negate = c == 'D' || c == 'W' || c == 'S';
+    switch (c) {
+        case 'd': case 'D':
+            ranges.push_back({'0', '9'});
+            return true;
+        case 'w': case 'W':
+            ranges.push_back({'0', '9'});
+            ranges.push_back({'A', 'Z'});
+            ranges.push_back({'a', 'z'});
+            ranges.push_back({'_', '_'});
+            return true;
+        case 's': case 'S':
+            ranges.push_back({'\t', '\r'});
+            ranges.push_back({' ', ' '});
+            return true;
+        default:
+            return false;
+    }
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 再帰下降の構文解析
+class Parser {
+public:
+    explicit Parser(const std::string& pattern) : pattern_(pattern) {}
+
+    Node Parse() {
+        Node node = ParseAlt(0);
+        if (pos_ < pattern_.size()) Fail("unmatched ')'");
+        return node;
+    }
+
+private:
+    [[noreturn]] void Fail(const std::string& detail) const { ThrowSyntaxError(pattern_, detail); }
+    bool AtEnd() const { return pos_ >= pattern_.size(); }
+    char Peek() const { return pattern_[pos_]; }
+
+    Node ParseAlt(int depth) {
+        if (depth > 200) Fail("nesting too deep");
+        std::vector<Node> branches;
+        branches.push_back(ParseConcat(depth));
+        while (!AtEnd() && Peek() == '|') {
+            ++pos_;
+            branches.push_back(ParseConcat(depth));
+        }
+        if (branches.size() == 1) return std::move(branches[0]);
+        return Node::Of(Node::Kind::ALT, std::move(branches));
+    }
+
+    Node ParseConcat(int depth) {
+        std::vector<Node> items;
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') items.push_back(ParseRepeat(depth));
+        if (items.empty()) return Node{};
+        if (items.size() == 1) return std::move(items[0]);
+        return Node::Of(Node::Kind::CONCAT, std::move(items));
+    }
+
+    Node ParseRepeat(int depth) {
+        Node atom = ParseAtom(depth);
+        while (!AtEnd()) {
+            int min = 0, max = -1;
+            const char c = Peek();
+            if (c == '*') {
+                ++pos_;
+            } else if (c == '+') {
+                min = 1;
+                ++pos_;
+            } else if (c == '?') {
+                max = 1;
+                ++pos_;
+            } else if (c == '{' && ParseBraces(min, max)) {
+                // 位置は ParseBraces が進める
+            } else {
+                break;
+            }
+            if (atom.kind == Node::Kind::BEGIN_LINE || atom.kind == Node::Kind::END_LINE) {
+                Fail("nothing to repeat");
+            }
+            Node repeat = Node::Of(Node::Kind::REPEAT);
+            repeat.min = min;
+            repeat.max = max;
+            repeat.children.push_back(std::move(atom));
+            atom = std::move(repeat);
+        }
+        return atom;
+    }
+
+    // {m} {m,} {m,n}。数字で始まらなければ '{' はリテラル
+    bool ParseBraces(int& min, int& max) {
+        size_t p = pos_ + 1;
+        auto number = [&](int& value) {
+            const size_t begin = p;
+            value = 0;
+            while (p < pattern_.size() && pattern_[p] >= '0' && pattern_[p] <= '9') {
+                value = std::min(value * 10 + (pattern_[p] - '0'), kMaxRepeatValue);
+                ++p;
+            }
+            return p > begin;
+        };
+        if (!number(min)) return false;
+        max = min;
+        if (p < pattern_.size() && pattern_[p] == ',') {
+            ++p;
+            if (!number(max)) max = -1;
+        }
+        if (p >= pattern_.size() || pattern_[p] != '}') return false;
+        if (min > RegexSearcher::kMaxRepeat || max > RegexSearcher::kMaxRepeat) Fail("repeat count too large");
+        if (max >= 0 && max < min) Fail("invalid repeat range");
+        pos_ = p + 1;
+        return true;
+    }
+
+    Node ParseAtom(int depth) {
+        const char c = Peek();
+        switch (c) {
+            case '(': {
+                ++pos_;
+                if (pattern_.compare(pos_, 2, "?:") == 0) {
+                    pos_ += 2;
+                } else if (!AtEnd() && Peek() == '?') {
+                    Fail("unsupported group syntax");
+                }
+                Node inner = ParseAlt(depth + 1);
+                if (AtEnd() || Peek() != ')') Fail("missing ')'");
+                ++pos_;
+                return inner;
+            }
+            case '*': case '+': case '?':
+                Fail("nothing to repeat");
+            case '.':
+                ++pos_;
+                return ClassNode({{0, kMaxCodepoint}}, false);
+            case '[':
+                return ParseClass();
+            case '^':
+                ++pos_;
+                return Node::Of(Node::Kind::BEGIN_LINE);
+            case '$':
+                ++pos_;
+                return Node::Of(Node::Kind::END_LINE);
+            case '\\':
+                return ParseEscape();
+            default:
+                return ParseLiteral();
+        }
+    }
+
+    // UTF-8 の 1 文字をそのバイト列として（不正なバイトはその 1 バイト）
+    Node ParseLiteral() {
+        const size_t len = std::min(utf8::SequenceLength(static_cast<unsigned char>(Peek())), pattern_.size() - pos_);
+        Node seq = Node::Of(Node::Kind::CONCAT);
+        for (size_t i = 0; i < len; ++i) {
+            const auto b = static_cast<uint8_t>(pattern_[pos_ + i]);
+            seq.children.push_back(Node::Bytes(b, b));
+        }
+        pos_ += len;
+        if (seq.children.size() == 1) return std::move(seq.children[0]);
+        return seq;
+    }
+
+    Node ParseEscape() {
+        ++pos_;
+        if (AtEnd()) Fail("trailing backslash");
+        CodepointRanges ranges;
+        bool negate = false;
+        if (AddPerlClass(Peek(), ranges, negate)) {
+            ++pos_;
+            return ClassNode(std::move(ranges), negate);
+        }
+        const bool raw_byte = Peek() == 'x';
+        const char32_t cp = ParseEscapedChar();
+        if (raw_byte) {
+            // \xHH は 0x80 以上でも生の 1 バイト
+            return Node::Bytes(static_cast<uint8_t>(cp), static_cast<uint8_t>(cp));
+        }
+        std::string bytes;
+        utf8::Append(bytes, cp);
+        Node seq = Node::Of(Node::Kind::CONCAT);
+        for (char b : bytes) seq.children.push_back(Node::Bytes(static_cast<uint8_t>(b), static_cast<uint8_t>(b)));
+        if (seq.children.size() == 1) return std::move(seq.children[0]);
+        return seq;
+    }
+
+    // \ の次の 1 文字（\d などの文字クラス以外）。pos_ は \ の次を指している
+    char32_t ParseEscapedChar() {
+        const char c = Peek();
+        ++pos_;
+        switch (c) {
+            case 't': return '\t';
+            case 'n': return '\n';
+            case 'r': return '\r';
+            case 'f': return '\f';
+            case 'v': return '\v';
+            case 'x': {
+                const int h1 = pos_ < pattern_.size() ? HexValue(pattern_[pos_]) : -1;
+                const int h2 = pos_ + 1 < pattern_.size() ? HexValue(pattern_[pos_ + 1]) : -1;
+                if (h1 < 0 || h2 < 0) Fail("invalid \\x escape");
+                pos_ += 2;
+                return static_cast<char32_t>(h1 * 16 + h2);
+            }
+            default:
+                break;
+        }
+        const auto u = static_cast<unsigned char>(c);
+        if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9')) {
+            Fail(std::string("unsupported escape \\") + c);
+        }
+        if (u >= 0x80) {
+            size_t p = pos_ - 1;
+            const char32_t cp = utf8::Decode(pattern_, p);
+            pos_ = p;
+            return cp;
+        }
+        return u;
+    }
+
+    Node ParseClass() {
+        ++pos_; // '['
+        bool negate = false;
+        if (!AtEnd() && Peek() == '^') {
+            negate = true;
+            ++pos_;
+        }
+        CodepointRanges ranges;
+        bool first = true;
+        while (true) {
+            if (AtEnd()) Fail("missing ']'");
+            if (Peek() == ']' && !first) {
+                ++pos_;
+                break;
+            }
+            first = false;
+            if (Peek() == '\\' && pos_ + 1 < pattern_.size()) {
+                bool perl_negate = false;
+                CodepointRanges perl;
+                if (AddPerlClass(pattern_[pos_ + 1], perl, perl_negate)) {
+                    if (perl_negate) Fail("negated class escape inside []");
+                    pos_ += 2;
+                    ranges.insert(ranges.end(), perl.begin(), perl.end());
+                    continue;
+                }
+            }
+            const char32_t lo = ParseClassChar();
+            char32_t hi = lo;
+            if (pos_ + 1 < pattern_.size() && Peek() == '-' && pattern_[pos_ + 1] != ']') {
+                ++pos_;
+                hi = ParseClassChar();
+                if (hi < lo) Fail("invalid range in []");
+            }
+            ranges.push_back({lo, hi});
+        }
+        return ClassNode(std::move(ranges), negate);
+    }
+
+    char32_t ParseClassChar() {
+        if (Peek() == '\\') {
+            ++pos_;
+            if (AtEnd()) Fail("missing ']'");
+            return ParseEscapedChar();
+        }
+        const size_t before = pos_;
+        const char32_t cp = utf8::Decode(pattern_, pos_);
+        if (cp == U'\uFFFD' && pattern_.compare(before, 3, "\xEF\xBF\xBD") != 0) Fail("invalid UTF-8 in []");
+        return cp;
+    }
+
+    static constexpr int kMaxRepeatValue = 100000;
+    const std::string& pattern_;
+    size_t pos_ = 0;
+};
+
+// 逆順のパターン（行末から逆向きに読むためのもの）。^ と $ も入れ替わる
+Node Reverse(const Node& node) {
+    Node out = node;
+    switch (node.kind) {
+        case Node::Kind::BEGIN_LINE: out.kind = Node::Kind::END_LINE; break;
+        case Node::Kind::END_LINE: out.kind = Node::Kind::BEGIN_LINE; break;
+        case Node::Kind::CONCAT:
+            std::reverse(out.children.begin(), out.children.end());
+            [[fallthrough]];
+        default:
+            for (auto& child : out.children) child = Reverse(child);
+            break;
+    }
+    return out;
+}
+
+// すべての一致の先頭にある固定のバイト列を集める。続きがありうるなら true
+bool CollectPrefix(const Node& node, std::string& prefix) {
+    switch (node.kind) {
+        case Node::Kind::EMPTY:
+        case Node::Kind::BEGIN_LINE:
+            return true;
+        case Node::Kind::BYTES:
+            if (node.lo != node.hi) return false;
+            prefix.push_back(static_cast<char>(node.lo));
+            return true;
+        case Node::Kind::CONCAT:
+            for (const auto& child : node.children) {
+                if (!CollectPrefix(child, prefix)) return false;
+            }
+            return true;
+        case Node::Kind::REPEAT:
+            // 1 回目の分だけ
+            if (node.min >= 1) CollectPrefix(node.children[0], prefix);
+            return false;
+        default:
+            return false;
+    }
+}
+
+bool StartsWithBeginLine(const Node& node) {
+    if (node.kind == Node::Kind::BEGIN_LINE) return true;
+    return node.kind == Node::Kind::CONCAT && !node.children.empty() && StartsWithBeginLine(node.children[0]);
+}
+
+// 継続渡しで後ろから組み立てる Thompson 構成（Compile(node, next) は node を読んだら next へ進む状態）
+class Compiler {
+public:
+    explicit Compiler(const std::string& pattern) : pattern_(pattern) {}
+
+    RegexProgram Compile(const Node& root) {
+        const int match = Add({});
+        program_.start = Compile(root, match);
+        return std::move(program_);
+    }
+
+private:
+    using Op = RegexProgram::State::Op;
+
+    int Add(RegexProgram::State state) {
+        if (program_.states.size() >= RegexSearcher::kMaxProgramStates) {
+            ThrowSyntaxError(pattern_, "pattern too large");
+        }
+        program_.states.push_back(state);
+        return static_cast<int>(program_.states.size()) - 1;
+    }
+    int Split(int out, int out1) {
+        RegexProgram::State state;
+        state.op = Op::SPLIT;
+        state.out = out;
+        state.out1 = out1;
+        return Add(state);
+    }
+
+    int Compile(const Node& node, int next) {
+        switch (node.kind) {
+            case Node::Kind::EMPTY:
+                return next;
+            case Node::Kind::BYTES: {
+                RegexProgram::State state;
+                state.op = Op::BYTE;
+                state.lo = node.lo;
+                state.hi = node.hi;
+                state.out = next;
+                return Add(state);
+            }
+            case Node::Kind::BEGIN_LINE:
+            case Node::Kind::END_LINE: {
+                RegexProgram::State state;
+                state.op = node.kind == Node::Kind::BEGIN_LINE ? Op::BEGIN_LINE : Op::END_LINE;
+                state.out = next;
+                return Add(state);
+            }
+            case Node::Kind::CONCAT:
+                for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) next = Compile(*it, next);
+                return next;
+            case Node::Kind::ALT: {
+                int result = Compile(node.children.back(), next);
+                for (size_t i = node.children.size() - 1; i-- > 0;) result = Split(Compile(node.children[i], next), result);
+                return result;
+            }
+            case Node::Kind::REPEAT: {
+                const Node& child = node.children[0];
+                int tail = next;
+                if (node.max < 0) {
+                    // x* : ループ。out は後で本体に向ける
+                    const int loop = Split(-1, next);
+                    program_.states[loop].out = Compile(child, loop);
+                    tail = loop;
+                } else {
+                    // x{0,k} = (x(x(...)?)?)?
+                    for (int i = node.min; i < node.max; ++i) tail = Split(Compile(child, tail), next);
+                }
+                for (int i = 0; i < node.min; ++i) tail = Compile(child, tail);
+                return tail;
+            }
+        }
+        return next;
+    }
+
+    const std::string& pattern_;
+    RegexProgram program_;
+};
+
+// 状態 1 つあたりのおおよそのメモリ（遷移表、集合とハッシュ表のキー、管理領域）
+size_t StateCost(size_t set_size, int class_count) {
+    return 2 * set_size * sizeof(int) + static_cast<size_t>(class_count) * (sizeof(int) + 1) + 128;
+}
+
+// キャッシュをこの回数作り直し、その間に状態 1 つあたり平均 kMinStepsPerState バイトも
+// 進めていなければ NFA シミュレーションに切り替える
+constexpr size_t kResetsBeforeFallback = 3;
+constexpr uint64_t kMinStepsPerState = 16;
+}
+
+size_t LazyDfa::SetHash::operator()(const std::vector<int>& set) const {
+    uint64_t h = 1469598103934665603ULL;
+    for (int s : set) {
+        h ^= static_cast<uint64_t>(s);
+        h *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(h);
+}
+
+LazyDfa::LazyDfa(RegexProgram program, bool unanchored, size_t memory_limit)
+    : program_(std::move(program)), unanchored_(unanchored), memory_limit_(memory_limit) {
+    // バイト範囲の境目で同値類を分ける
+    std::array<bool, 257> boundary{};
+    for (const auto& state : program_.states) {
+        if (state.op != RegexProgram::State::Op::BYTE) continue;
+        boundary[state.lo] = true;
+        boundary[state.hi + 1] = true;
+    }
+    int cls = 0;
+    for (int b = 0; b < 256; ++b) {
+        if (b > 0 && boundary[b]) ++cls;
+        class_of_[b] = static_cast<uint8_t>(cls);
+    }
+    class_count_ = cls + 1;
+    marks_.assign(program_.states.size(), 0);
+    ResetCache();
+}
+
+void LazyDfa::ResetCache() {
+    if (!sets_.empty()) {
+        ++resets_;
+        if (resets_ >= kResetsBeforeFallback && steps_ - steps_at_reset_ < kMinStepsPerState * sets_.size()) {
+            nfa_mode_ = true;
+        }
+    }
+    steps_at_reset_ = steps_;
+    ++generation_;
+    sets_.clear();
+    next_.clear();
+    flags_.clear();
+    ids_.clear();
+    start_ = {-1, -1};
+    memory_used_ = 0;
+    // 0 は行き止まり（どの入力でも 0 のまま）
+    AppendState(kDead);
+    if (nfa_mode_) {
+        // 1 と 2 は NFA シミュレーションの作業状態（遷移は覚えない）
+        AppendState(-1);
+        AppendState(-1);
+    }
+}
+
+int LazyDfa::AppendState(int fill) {
+    const auto state = static_cast<int>(next_.size());
+    sets_.emplace_back();
+    flags_.insert(flags_.end(), static_cast<size_t>(class_count_), 0);
+    next_.insert(next_.end(), static_cast<size_t>(class_count_), fill);
+    return state;
+}
+
+void LazyDfa::AddClosure(int nfa_state, bool at_begin, bool at_end, std::vector<int>& out) {
+    using Op = RegexProgram::State::Op;
+    stack_.push_back(nfa_state);
+    while (!stack_.empty()) {
+        const int s = stack_.back();
+        stack_.pop_back();
+        if (marks_[s] == mark_) continue;
+        marks_[s] = mark_;
+        const RegexProgram::State& state = program_.states[s];
+        switch (state.op) {
+            case Op::BYTE:
+            case Op::MATCH:
+                out.push_back(s);
+                break;
+            case Op::SPLIT:
+                stack_.push_back(state.out1);
+                stack_.push_back(state.out);
+                break;
+            case Op::BEGIN_LINE:
+                if (at_begin) stack_.push_back(state.out);
+                break;
+            case Op::END_LINE:
+                // 行末かどうかは読み進めるまでわからないので、集合に残しておく
+                if (at_end) {
+                    stack_.push_back(state.out);
+                } else {
+                    out.push_back(s);
+                }
+                break;
+        }
+    }
+}
+
+void LazyDfa::SetState(int state, std::vector<int>& set) {
+    using Op = RegexProgram::State::Op;
+    std::sort(set.begin(), set.end());
+    bool match = false;
+    bool has_end = false;
+    for (int s : set) {
+        const Op op = program_.states[s].op;
+        match |= op == Op::MATCH;
+        has_end |= op == Op::END_LINE;
+    }
+    bool match_at_end = match;
+    if (has_end && !match) {
+        ++mark_;
+        std::vector<int> at_end;
+        for (int s : set) {
+            if (program_.states[s].op == Op::END_LINE) AddClosure(program_.states[s].out, false, true, at_end);
+        }
+        for (int s : at_end) match_at_end |= program_.states[s].op == Op::MATCH;
+    }
+    flags_[state] = static_cast<uint8_t>((match ? kMatch : 0) | (match_at_end ? kMatchAtEnd : 0));
+    sets_[state / class_count_].swap(set);
+}
+
+int LazyDfa::Scratch(std::vector<int>& set, int previous) {
+    const int slot = previous == class_count_ ? 2 * class_count_ : class_count_;
+    SetState(slot, set);
+    return slot;
+}
+
+int LazyDfa::Intern(std::vector<int>& set, int previous) {
+    if (nfa_mode_) return Scratch(set, previous);
+    std::sort(set.begin(), set.end());
+    auto it = ids_.find(set);
+    if (it != ids_.end()) return it->second;
+    const size_t cost = StateCost(set.size(), class_count_);
+    if (memory_used_ + cost > memory_limit_ && sets_.size() > 1) {
+        ResetCache();
+        if (nfa_mode_) return Scratch(set, previous);
+    }
+    memory_used_ += cost;
+    const int state = AppendState(-1);
+    ids_.emplace(set, state);
+    SetState(state, set);
+    return state;
+}
+
+int LazyDfa::Start(bool at_line_begin) {
+    int& cached = start_[at_line_begin ? 1 : 0];
+    if (cached >= 0) return cached;
+    ++mark_;
+    scratch_set_.clear();
+    AddClosure(program_.start, at_line_begin, false, scratch_set_);
+    if (scratch_set_.empty()) return kDead;
+    const int id = Intern(scratch_set_, -1);
+    // NFA シミュレーションの作業状態は次の遷移で上書きされるので覚えない
+    if (!nfa_mode_) start_[at_line_begin ? 1 : 0] = id;
+    return id;
+}
+
+int LazyDfa::Compute(int state, unsigned char byte) {
+    using Op = RegexProgram::State::Op;
+    ++mark_;
+    scratch_set_.clear();
+    for (int s : sets_[state / class_count_]) {
+        const RegexProgram::State& nfa = program_.states[s];
+        if (nfa.op == Op::BYTE && byte >= nfa.lo && byte <= nfa.hi) AddClosure(nfa.out, false, false, scratch_set_);
+    }
+    if (unanchored_) AddClosure(program_.start, false, false, scratch_set_);
+
+    const size_t slot = static_cast<size_t>(state) + class_of_[byte];
+    if (scratch_set_.empty()) {
+        if (!nfa_mode_) next_[slot] = kDead;
+        return kDead;
+    }
+    const uint64_t generation = generation_;
+    const int id = Intern(scratch_set_, state);
+    // キャッシュを作り直していなければ遷移を覚える（作り直したら state はもうない）
+    if (!nfa_mode_ && generation == generation_) next_[slot] = id;
+    return id;
+}
+
+RegexSearcher::RegexSearcher(const std::string& pattern, size_t dfa_memory) : pattern_(pattern) {
+    const Node root = Parser(pattern_).Parse();
+    std::string prefix;
+    CollectPrefix(root, prefix);
+    prefix_ = SubstringSearcher(std::move(prefix));
+    anchored_begin_ = StartsWithBeginLine(root);
+    forward_ = LazyDfa(Compiler(pattern_).Compile(root), false, dfa_memory);
+    reverse_ = LazyDfa(Compiler(pattern_).Compile(Reverse(root)), true, dfa_memory);
+}
+
+size_t RegexSearcher::LongestMatchFrom(std::string_view line, size_t start) {
+    int state = forward_.Start(start == 0);
+    if (forward_.IsDead(state)) return npos;
+    size_t last = forward_.IsMatch(state) ? start : npos;
+    const auto* data = reinterpret_cast<const unsigned char*>(line.data());
+    size_t i = start;
+    for (; i < line.size(); ++i) {
+        state = forward_.Next(state, data[i]);
+        if (forward_.IsDead(state)) break;
+        if (forward_.IsMatch(state)) last = i + 1;
+    }
+    scanned_ += i - start;
+    if (i == line.size() && forward_.IsMatchAtEnd(state)) last = line.size();
+    return last;
+}
+
+void RegexSearcher::FindInLine(std::string_view line, int line_number, std::vector<SearchMatch>& out) {
+    if (anchored_begin_) {
+        const size_t end = LongestMatchFrom(line, 0);
+        if (end != npos && end > 0) out.push_back({line_number, 0, end});
+        return;
+    }
+    // 始まりごとに前向きに読み進める量がこれを超えたら、残りは終わりを持つ NFA シミュレーションで求める
+    scanned_ = 0;
+    budget_ = 4 * line.size() + 1024;
+    if (prefix_.Empty()) {
+        FindWithReverseScan(line, line_number, 0, out);
+        return;
+    }
+    // 一致は必ず固定の文字列で始まるので、その出現位置だけを調べる
+    size_t candidate = prefix_.Find(line);
+    while (candidate != npos) {
+        if (scanned_ > budget_) {
+            FindWithEndTracking(line, line_number, candidate, out);
+            return;
+        }
+        const size_t end = LongestMatchFrom(line, candidate);
+        if (end != npos && end > candidate) {
+            out.push_back({line_number, candidate, end - candidate});
+            candidate = prefix_.Find(line, end);
+        } else {
+            candidate = prefix_.Find(line, candidate + 1);
+        }
+    }
+}
+
+void RegexSearcher::FindWithReverseScan(std::string_view line, int line_number, size_t from,
+                                        std::vector<SearchMatch>& out) {
+    // 逆順のパターンで行末から from まで読み、一致の始まる位置を集める（1 回の走査）
+    starts_.clear();
+    const auto* data = reinterpret_cast<const unsigned char*>(line.data());
+    int state = reverse_.Start(true);
+    for (size_t i = line.size(); i > from; --i) {
+        state = reverse_.Next(state, data[i - 1]);
+        if (reverse_.IsMatch(state) || (i == 1 && reverse_.IsMatchAtEnd(state))) starts_.push_back(i - 1);
+    }
+    // 始まりの早い順に、最長の一致を重ならないように取る
+    size_t pos = from;
+    for (auto it = starts_.rbegin(); it != starts_.rend(); ++it) {
+        if (*it < pos) continue;
+        if (scanned_ > budget_) {
+            // 一致が短いのに始まりから長く読み進めることが続いた（"a(.*Z)?" で Z のない行など）
+            FindWithEndTracking(line, line_number, pos, out);
+            return;
+        }
+        const size_t end = LongestMatchFrom(line, *it);
+        if (end != npos && end > *it) {
+            out.push_back({line_number, *it, end - *it});
+            pos = end;
+        }
+    }
+}
+
+void RegexSearcher::AddThread(int nfa_state, size_t end, size_t pos, size_t size, std::vector<Thread>& out) {
+    using Op = RegexProgram::State::Op;
+    const RegexProgram& program = reverse_.Program();
+    stack_.clear();
+    stack_.push_back(nfa_state);
+    while (!stack_.empty()) {
+        const int s = stack_.back();
+        stack_.pop_back();
+        // この位置ですでに（終わりの遅いスレッドが）通った状態は足さない
+        if (marks_[s] == mark_) continue;
+        marks_[s] = mark_;
+        const RegexProgram::State& state = program.states[s];
+        switch (state.op) {
+            case Op::BYTE:
+            case Op::MATCH:
+                out.push_back({s, end});
+                break;
+            case Op::SPLIT:
+                stack_.push_back(state.out1);
+                stack_.push_back(state.out);
+                break;
+            // 逆順のパターンなので、^ は元の $（行末）、$ は元の ^（行頭）
+            case Op::BEGIN_LINE:
+                if (pos == size) stack_.push_back(state.out);
+                break;
+            case Op::END_LINE:
+                if (pos == 0) stack_.push_back(state.out);
+                break;
+        }
+    }
+}
+
+void RegexSearcher::FindWithEndTracking(std::string_view line, int line_number, size_t from,
+                                        std::vector<SearchMatch>& out) {
+    using Op = RegexProgram::State::Op;
+    ++end_tracking_lines_;
+    const RegexProgram& program = reverse_.Program();
+    if (marks_.size() < program.states.size()) marks_.assign(program.states.size(), 0);
+    auto next_mark = [this] {
+        if (++mark_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            mark_ = 1;
+        }
+    };
+    // threads_ は終わりの遅い順に並ぶ（前の位置のスレッドを順に進め、この位置から始まるスレッドを最後に足す）
+    // ので、同じ NFA 状態に来たスレッドは先に来た方（終わりの遅い方）だけを残せばよい
+    const auto* data = reinterpret_cast<const unsigned char*>(line.data());
+    const size_t size = line.size();
+    size_t pos = size;
+    spans_.clear();
+    threads_.clear();
+    next_mark();
+    AddThread(program.start, pos, pos, size, threads_);
+    while (true) {
+        // 最初に見つかる MATCH が pos から始まる最長の一致
+        for (const Thread& thread : threads_) {
+            if (program.states[thread.state].op != Op::MATCH) continue;
+            if (thread.end > pos) spans_.push_back({pos, thread.end});
+            break;
+        }
+        if (pos == from) break;
+        const unsigned char byte = data[pos - 1];
+        --pos;
+        next_mark();
+        next_threads_.clear();
+        for (const Thread& thread : threads_) {
+            const RegexProgram::State& state = program.states[thread.state];
+            if (state.op == Op::BYTE && byte >= state.lo && byte <= state.hi) {
+                AddThread(state.out, thread.end, pos, size, next_threads_);
+            }
+        }
+        AddThread(program.start, pos, pos, size, next_threads_);
+        threads_.swap(next_threads_);
+    }
+    // 始まりの早い順に、最長の一致を重ならないように取る
+    size_t next = from;
+    for (auto it = spans_.rbegin(); it != spans_.rend(); ++it) {
+        if (it->first < next) continue;
+        out.push_back({line_number, it->first, it->second - it->first});
+        next = it->second;
+    }
+}
+
+void RegexSearcher::FindInLines(const std::vector<std::string>& lines, std::vector<SearchMatch>& out) {
+    for (size_t i = 0; i < lines.size(); ++i) FindInLine(lines[i], static_cast<int>(i), out);
+}
+
+RegexSearcher::Stats RegexSearcher::GetStats() const {
+    Stats stats;
+    stats.dfa_states = forward_.StateCount() + reverse_.StateCount();
+    stats.cache_resets = forward_.CacheResets() + reverse_.CacheResets();
+    stats.nfa_fallback = forward_.UsingNfa() || reverse_.UsingNfa();
+    stats.end_tracking_lines = end_tracking_lines_;
+    return stats;
+}
+
+}
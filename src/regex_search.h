@@ -0,0 +1,188 @@
+#pragma once
+#include "text_search.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 正規表現をコンパイルした NFA（Thompson 構成）。文字はバイト単位で、UTF-8 の文字や文字クラスは
+// バイト列の並び/選択に展開してある
+struct RegexProgram {
+    struct State {
+        enum class Op : uint8_t {
+            BYTE,       // [lo, hi] の 1 バイトを読んで out へ
+            SPLIT,      // out と out1 の両方へ（読まない）
+            BEGIN_LINE, // 行頭でだけ out へ
+            END_LINE,   // 行末でだけ out へ
+            MATCH,
+        };
+        Op op = Op::MATCH;
+        uint8_t lo = 0;
+        uint8_t hi = 0;
+        int out = -1;
+        int out1 = -1;
+    };
+    std::vector<State> states;
+    int start = 0;
+};
+
+// 遅延 DFA: NFA の状態集合を DFA の 1 状態とし、検索中に必要になった状態と遷移だけを作る
+// 遷移表はバイトを同値類（NFA から見て区別のつかないバイトの組）にまとめて小さくする
+// キャッシュが memory_limit を超えたら捨てて作り直し、作り直してもほとんど使い回されない
+// （状態が爆発する）パターンでは、キャッシュを使わない NFA シミュレーションに切り替える
+// どちらも 1 バイトあたり NFA の状態数に比例する時間で、バックトラックはしない
+class LazyDfa {
+public:
+    static constexpr int kDead = 0;
+
+    LazyDfa() = default;
+    // unanchored なら、各位置で新しく一致を始められる（パターンの先頭に .* を付けたもの）
+    LazyDfa(RegexProgram program, bool unanchored, size_t memory_limit);
+
+    // 検索の開始状態。at_line_begin は開始位置が行頭かどうか（^ を満たせるか）
+    int Start(bool at_line_begin);
+    // 状態は遷移表の行の先頭（状態の番号 * 同値類の数）で表し、掛け算を依存の連鎖から外す
+    int Next(int state, unsigned char byte) {
+        ++steps_;
+        const int next = next_[static_cast<size_t>(state) + class_of_[byte]];
+        return next >= 0 ? next : Compute(state, byte);
+    }
+    bool IsDead(int state) const { return state == kDead; }
+    // この位置までで一致している
+    bool IsMatch(int state) const { return flags_[state] & kMatch; }
+    // この位置が行末なら一致している（$ を満たして一致する場合を含む）
+    bool IsMatchAtEnd(int state) const { return flags_[state] & kMatchAtEnd; }
+
+    const RegexProgram& Program() const { return program_; }
+    size_t StateCount() const { return sets_.size(); }
+    size_t CacheResets() const { return resets_; }
+    bool UsingNfa() const { return nfa_mode_; }
+
+private:
+    static constexpr uint8_t kMatch = 1;
+    static constexpr uint8_t kMatchAtEnd = 2;
+
+    struct SetHash {
+        size_t operator()(const std::vector<int>& set) const;
+    };
+
+    int Compute(int state, unsigned char byte);
+    // 集合に対応する状態（なければ作る）。キャッシュを作り直したら generation_ が進む
+    int Intern(std::vector<int>& set, int previous);
+    // NFA シミュレーション用の作業状態に集合を入れる（previous とは別の枠を使う）
+    int Scratch(std::vector<int>& set, int previous);
+    // 状態を 1 つ足す（遷移はすべて fill）
+    int AppendState(int fill);
+    void SetState(int state, std::vector<int>& set);
+    void ResetCache();
+    void AddClosure(int nfa_state, bool at_begin, bool at_end, std::vector<int>& out);
+
+    RegexProgram program_;
+    std::array<uint8_t, 256> class_of_{};
+    int class_count_ = 1;
+    bool unanchored_ = false;
+    size_t memory_limit_ = 0;
+    size_t memory_used_ = 0;
+
+    // 状態の番号ごとの NFA 状態の集合（昇順）、遷移表 [状態 + 同値類]（-1 は未計算）、
+    // 一致フラグ（遷移表と同じ添字の行の先頭だけを使う）
+    std::vector<std::vector<int>> sets_;
+    std::vector<int> next_;
+    std::vector<uint8_t> flags_;
+    std::unordered_map<std::vector<int>, int, SetHash> ids_;
+    std::array<int, 2> start_ = {-1, -1}; // [行頭でない, 行頭]
+    uint64_t generation_ = 0;
+
+    // 閉包の計算用
+    std::vector<uint32_t> marks_;
+    uint32_t mark_ = 0;
+    std::vector<int> stack_;
+    std::vector<int> scratch_set_;
+
+    // キャッシュの作り直しの監視
+    uint64_t steps_ = 0;
+    uint64_t steps_at_reset_ = 0;
+    size_t resets_ = 0;
+    bool nfa_mode_ = false;
+};
+
+// 正規表現による検索（バックトラックしない）
+// - 一致は最左最長で、重ならないように左から取る。空の一致は返さない
+// - 行ごとに探す（^ と $ は行頭と行末）
+// - 一致の先頭が固定の文字列なら、その文字列を SubstringSearcher で探して一致の候補にする。
+//   そうでなければ、逆向きの DFA で行を 1 回なめて一致の始まる位置を求める
+// - 一致の終わりは、始まりから前向きの DFA で最長の一致を探して求める
+// - 始まりごとの前向きの走査が行の長さの数倍を超えたら（"a(.*Z)?" で Z のない行など）、行の残りは
+//   逆順のパターンの NFA を行末から 1 回だけシミュレートする。スレッドは一致の終わりの位置を持ち、
+//   同じ NFA 状態では終わりの遅い方だけを残すので、各位置から始まる最長の一致が 1 回の走査でわかる
+//   どの行でも時間は行の長さ × NFA の状態数に比例する
+// 対応する構文: リテラル（UTF-8 可）、. [...] [^...]、\d \w \s \D \W \S（ASCII）、\t \n \r \xHH、
+// 記号のエスケープ、( ) (?: )、|、* + ? {m} {m,} {m,n}、^ $
+// 構文エラーやパターンが大きすぎるときは ShinoError（Parser）を投げる
+class RegexSearcher {
+public:
+    // 前向き/逆向きそれぞれの DFA キャッシュの上限
+    static constexpr size_t kDefaultDfaMemory = 2 << 20;
+    // {m,n} の上限と、展開後の NFA の状態数の上限
+    static constexpr int kMaxRepeat = 1000;
+    static constexpr size_t kMaxProgramStates = 1 << 16;
+
+    explicit RegexSearcher(const std::string& pattern, size_t dfa_memory = kDefaultDfaMemory);
+
+    const std::string& Pattern() const { return pattern_; }
+    // すべての一致の先頭にある固定の文字列（なければ空）
+    const std::string& LiteralPrefix() const { return prefix_.Needle(); }
+
+    // 1 行の中の一致を out に追加
+    void FindInLine(std::string_view line, int line_number, std::vector<SearchMatch>& out);
+    // 行の配列（App::lines_）全体
+    void FindInLines(const std::vector<std::string>& lines, std::vector<SearchMatch>& out);
+
+    struct Stats {
+        size_t dfa_states = 0;   // 前向き + 逆向きの DFA 状態数
+        size_t cache_resets = 0; // DFA キャッシュを作り直した回数
+        bool nfa_fallback = false;
+        size_t end_tracking_lines = 0; // 終わりを持つ NFA シミュレーションに切り替えた行の数
+    };
+    Stats GetStats() const;
+
+private:
+    // start から始まる最長の一致の終わり（なければ npos）。読んだバイト数を scanned_ に足す
+    size_t LongestMatchFrom(std::string_view line, size_t start);
+    // 逆向きの DFA で一致の始まりを求めてから、from 以降の一致を取る
+    void FindWithReverseScan(std::string_view line, int line_number, size_t from, std::vector<SearchMatch>& out);
+
+    std::string pattern_;
+    SubstringSearcher prefix_{""};
+    bool anchored_begin_ = false; // パターンが ^ で始まる（行頭でしか一致しない）
+    LazyDfa forward_;             // 始まりを固定して前向きに
+    LazyDfa reverse_;             // 逆順のパターンを行末から（始まりは固定しない）
+    std::vector<size_t> starts_;  // 逆向きの走査で見つけた一致の始まり（降順）
+    size_t scanned_ = 0;
+    size_t budget_ = 0;           // 行ごとの前向きの走査の上限（超えたら FindWithEndTracking）
+
+    // 逆順のパターンの NFA 状態と、そのスレッドが表す一致の終わり
+    struct Thread {
+        int state;
+        size_t end;
+    };
+    // 行末から from まで逆順のパターンの NFA をシミュレートし、from 以降の一致を取る
+    void FindWithEndTracking(std::string_view line, int line_number, size_t from, std::vector<SearchMatch>& out);
+    // nfa_state からの閉包を終わり end のスレッドとして out に足す（pos は位置、^ と $ の判定用）
+    void AddThread(int nfa_state, size_t end, size_t pos, size_t size, std::vector<Thread>& out);
+    std::vector<Thread> threads_;
+    std::vector<Thread> next_threads_;
+    std::vector<uint32_t> marks_;
+    uint32_t mark_ = 0;
+    std::vector<int> stack_;
+    std::vector<std::pair<size_t, size_t>> spans_; // 位置ごとの最長の一致 [始まり, 終わり)（始まりの降順）
+    size_t end_tracking_lines_ = 0;
+};
+
+}
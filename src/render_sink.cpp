@@ -0,0 +1,61 @@
+#include "render_sink.h"
+#include <cerrno>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ShinoEditor {
+
+FdSink::FdSink(int fd, size_t buffer_size)
+    : fd_(fd), buffer_size_(buffer_size > 0 ? buffer_size : 1) {
+    buffer_.reserve(buffer_size_);
+}
+
+FdSink::~FdSink() {
+    Flush();
+}
+
+void FdSink::Write(std::string_view chunk) {
+    if (error_) return;
+    if (buffer_.size() + chunk.size() <= buffer_size_) {
+        buffer_.append(chunk);
+        return;
+    }
+    Flush();
+    // バッファより大きい塊はコピーせずにそのまま書く
+    if (chunk.size() >= buffer_size_) {
+        WriteAll(chunk.data(), chunk.size());
+    } else {
+        buffer_.append(chunk);
+    }
+}
+
+bool FdSink::Flush() {
+    if (!buffer_.empty()) {
+        WriteAll(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+    return error_ == 0;
+}
+
+void FdSink::WriteAll(const char* data, size_t size) {
+    while (size > 0 && !error_) {
+#ifdef _WIN32
+        const int n = _write(fd_, data, static_cast<unsigned>(size > 0x40000000 ? 0x40000000 : size));
+#else
+        const ssize_t n = ::write(fd_, data, size);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error_ = errno;
+            return;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        bytes_written_ += static_cast<size_t>(n);
+    }
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace ShinoEditor {
+
+// レンダリング結果の書き込み先
+// MarkdownRenderer はある程度まとまった塊ごとに Write を呼ぶので、結果全体をメモリに持たずに済む
+class RenderSink {
+public:
+    virtual ~RenderSink() = default;
+
+    virtual void Write(std::string_view chunk) = 0;
+    // バッファを書き出す。失敗していたら false
+    virtual bool Flush() { return true; }
+};
+
+// std::string に追記する
+class StringSink : public RenderSink {
+public:
+    explicit StringSink(std::string& out) : out_(out) {}
+
+    void Write(std::string_view chunk) override { out_.append(chunk); }
+
+private:
+    std::string& out_;
+};
+
+// 塊ごとにコールバックを呼ぶ
+class CallbackSink : public RenderSink {
+public:
+    using Callback = std::function<void(std::string_view)>;
+
+    explicit CallbackSink(Callback callback) : callback_(std::move(callback)) {}
+
+    void Write(std::string_view chunk) override { callback_(chunk); }
+
+private:
+    Callback callback_;
+};
+
+// ファイルディスクリプタへバッファ付きで書き込む（fd は閉じない）
+// 書き込みに失敗したら以降は捨て、Flush が false を返す
+class FdSink : public RenderSink {
+public:
+    static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+    explicit FdSink(int fd, size_t buffer_size = kDefaultBufferSize);
+    ~FdSink() override;
+
+    FdSink(const FdSink&) = delete;
+    FdSink& operator=(const FdSink&) = delete;
+
+    void Write(std::string_view chunk) override;
+    bool Flush() override;
+
+    bool Failed() const { return error_ != 0; }
+    // 失敗したときの errno
+    int Error() const { return error_; }
+    size_t BytesWritten() const { return bytes_written_; }
+
+private:
+    int fd_;
+    size_t buffer_size_;
+    std::string buffer_;
+    size_t bytes_written_ = 0;
+    int error_ = 0;
+
+    void WriteAll(const char* data, size_t size);
+};
+
+}
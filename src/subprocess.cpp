@@ -0,0 +1,321 @@
+#include "subprocess.h"
+#include "error_handler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#ifdef _WIN32
+#include <cstdio>
+#include <filesystem>
+#include "output_file.h"
+#include "render_sink.h"
+#include "security.h"
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace ShinoEditor {
+
+std::string Subprocess::Result::Describe() const {
+    std::string out;
+    if (cancelled) {
+        out = "cancelled";
+    } else if (signal != 0) {
+        out = "killed by signal " + std::to_string(signal);
+    } else {
+        out = "exit status " + std::to_string(exit_code);
+    }
+    // stderr の最初の空でない行
+    size_t begin = 0;
+    while (begin < stderr_text.size()) {
+        size_t end = stderr_text.find('\n', begin);
+        if (end == std::string::npos) end = stderr_text.size();
+        std::string_view line(stderr_text.data() + begin, end - begin);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.remove_suffix(1);
+        if (!line.empty()) {
+            out += ": ";
+            out += line;
+            break;
+        }
+        begin = end + 1;
+    }
+    return out;
+}
+
+void LineSplitter::Append(std::string_view chunk) {
+    while (!chunk.empty()) {
+        const size_t newline = chunk.find('\n');
+        const std::string_view piece = chunk.substr(0, newline);
+        if (open_) {
+            lines_.back().append(piece);
+        } else if (newline != std::string_view::npos || !piece.empty()) {
+            lines_.emplace_back(piece);
+        }
+        if (newline == std::string_view::npos) {
+            open_ = true;
+            return;
+        }
+        open_ = false;
+        chunk.remove_prefix(newline + 1);
+    }
+}
+
+#ifdef _WIN32
+
+// Windows: _popen で起動する（stdin は一時ファイルからのリダイレクト、stderr は取らない）
+Subprocess::Result Subprocess::Run(const std::vector<std::string>& argv, std::string_view input,
+                                   const std::function<void(std::string_view)>& on_stdout,
+                                   const std::atomic<bool>* cancel) {
+    namespace fs = std::filesystem;
+    if (argv.empty()) error::ThrowSystemError("spawn", "empty argv");
+    std::string command = security::CommandValidator::BuildSafeCommand(
+        argv[0], std::vector<std::string>(argv.begin() + 1, argv.end()));
+    // stdin の一時ファイルは OutputFile と同じく推測できない名前で新しく作る（Commit しないので最後に消える）
+    std::unique_ptr<OutputFile> input_file;
+    if (!input.empty()) {
+        input_file = std::make_unique<OutputFile>((fs::temp_directory_path() / "shino_stdin").string(), "stdin");
+        FdSink sink(input_file->fd());
+        sink.Write(input);
+        if (!sink.Flush()) error::ThrowSystemError("spawn " + argv[0], std::strerror(sink.Error()));
+        command += " < " + security::CommandValidator::SafeShellEscape(input_file->temp_path());
+    }
+    FILE* pipe = _popen(command.c_str(), "rb");
+    if (!pipe) error::ThrowSystemError("spawn " + argv[0], std::strerror(errno));
+    // on_stdout が投げても子を待ってから抜ける
+    struct PipeCloser {
+        FILE*& pipe;
+        ~PipeCloser() {
+            if (pipe) _pclose(pipe);
+        }
+    } closer{pipe};
+    Result result;
+    std::string buffer(kReadChunk, '\0');
+    size_t n = 0;
+    while ((n = fread(buffer.data(), 1, buffer.size(), pipe)) > 0) {
+        // 子を止める手段がないので、読むのをやめてパイプを閉じる（子は次に書いたときに終わる）
+        if (cancel && *cancel) {
+            result.cancelled = true;
+            break;
+        }
+        if (on_stdout) on_stdout(std::string_view(buffer.data(), n));
+    }
+    result.exit_code = _pclose(pipe);
+    pipe = nullptr;
+    return result;
+}
+
+#else
+
+namespace {
+void SetNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+void CloseFd(int& fd) {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+// 子に渡す端以外が子に残らないよう、両端に FD_CLOEXEC を付ける
+bool MakePipe(int fds[2]) {
+    if (::pipe(fds) != 0) return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
+// 起動した子とその fd。どこで抜けても（on_stdout が投げても）デストラクタで fd を閉じ、まだ回収していなければ
+// プロセスグループごと止めて回収し、このスレッドで止めていた SIGPIPE を元に戻す
+class Child {
+public:
+    Child(pid_t pid, int stdin_fd, int stdout_fd, int stderr_fd)
+        : in_fd(stdin_fd), out_fd(stdout_fd), err_fd(stderr_fd), pid_(pid) {
+        // 子が stdin を読まずに終わったときの write の SIGPIPE は、このスレッドでは止めて EPIPE として扱う
+        sigemptyset(&pipe_set_);
+        sigaddset(&pipe_set_, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipe_set_, &old_set_);
+    }
+
+    ~Child() {
+        if (!reaped_) {
+            kill(-pid_, SIGKILL);
+            Wait();
+        }
+        // 止めていた間に届いた SIGPIPE を捨ててから元に戻す
+        if (broken_pipe) {
+            sigset_t pending;
+            int sig = 0;
+            if (sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE)) sigwait(&pipe_set_, &sig);
+        }
+        pthread_sigmask(SIG_SETMASK, &old_set_, nullptr);
+    }
+
+    Child(const Child&) = delete;
+    Child& operator=(const Child&) = delete;
+
+    // プロセスグループごと止める（回収は Wait かデストラクタで）
+    void Kill() { kill(-pid_, SIGKILL); }
+
+    // fd を閉じて子の終了を待ち、waitpid の status を返す
+    int Wait() {
+        CloseFd(in_fd);
+        CloseFd(out_fd);
+        CloseFd(err_fd);
+        int status = 0;
+        while (waitpid(pid_, &status, 0) < 0 && errno == EINTR) {}
+        reaped_ = true;
+        return status;
+    }
+
+    int in_fd, out_fd, err_fd;
+    bool broken_pipe = false;
+
+private:
+    pid_t pid_;
+    sigset_t pipe_set_, old_set_;
+    bool reaped_ = false;
+};
+}
+
+Subprocess::Result Subprocess::Run(const std::vector<std::string>& argv, std::string_view input,
+                                   const std::function<void(std::string_view)>& on_stdout,
+                                   const std::atomic<bool>* cancel) {
+    if (argv.empty()) error::ThrowSystemError("spawn", "empty argv");
+
+    int in[2] = {-1, -1}, out[2] = {-1, -1}, err[2] = {-1, -1};
+    if (!MakePipe(in) || !MakePipe(out) || !MakePipe(err)) {
+        const int saved = errno;
+        for (int* fds : {in, out, err}) {
+            CloseFd(fds[0]);
+            CloseFd(fds[1]);
+        }
+        error::ThrowSystemError("spawn " + argv[0], std::strerror(saved));
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err[1], STDERR_FILENO);
+    // 子は自分のプロセスグループに入れ（止めるときに孫ごと止める）、
+    // このスレッドで止めている SIGPIPE は子では既定に戻す
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t child_mask, child_default;
+    sigemptyset(&child_mask);
+    sigemptyset(&child_default);
+    sigaddset(&child_default, SIGPIPE);
+    posix_spawnattr_setsigmask(&attr, &child_mask);
+    posix_spawnattr_setsigdefault(&attr, &child_default);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const auto& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+    pid_t pid = -1;
+    const int spawn_error = posix_spawn(&pid, argv[0].c_str(), &actions, &attr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    CloseFd(in[0]);
+    CloseFd(out[1]);
+    CloseFd(err[1]);
+    if (spawn_error != 0) {
+        CloseFd(in[1]);
+        CloseFd(out[0]);
+        CloseFd(err[0]);
+        error::ThrowSystemError("spawn " + argv[0], std::strerror(spawn_error));
+    }
+
+    Child child(pid, in[1], out[0], err[0]);
+    int& in_fd = child.in_fd;
+    int& out_fd = child.out_fd;
+    int& err_fd = child.err_fd;
+    SetNonBlocking(in_fd);
+    SetNonBlocking(out_fd);
+    SetNonBlocking(err_fd);
+    if (input.empty()) CloseFd(in_fd);
+
+    Result result;
+    std::string buffer(kReadChunk, '\0');
+    size_t written = 0;
+    while (out_fd >= 0 || err_fd >= 0) {
+        if (cancel && *cancel) {
+            child.Kill();
+            result.cancelled = true;
+            break;
+        }
+        pollfd fds[3];
+        nfds_t count = 0;
+        int in_slot = -1, out_slot = -1, err_slot = -1;
+        if (in_fd >= 0) {
+            in_slot = static_cast<int>(count);
+            fds[count++] = {in_fd, POLLOUT, 0};
+        }
+        if (out_fd >= 0) {
+            out_slot = static_cast<int>(count);
+            fds[count++] = {out_fd, POLLIN, 0};
+        }
+        if (err_fd >= 0) {
+            err_slot = static_cast<int>(count);
+            fds[count++] = {err_fd, POLLIN, 0};
+        }
+        if (::poll(fds, count, cancel ? kCancelPollMillis : -1) < 0) {
+            if (errno == EINTR) continue;
+            // 待てなくなったら、終わらない子を待ち続けないよう止めてから回収する
+            child.Kill();
+            break;
+        }
+
+        if (in_slot >= 0 && fds[in_slot].revents) {
+            const size_t size = std::min(input.size() - written, kReadChunk);
+            const ssize_t n = ::write(in_fd, input.data() + written, size);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+                if (written == input.size()) CloseFd(in_fd);
+            } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                // 子が stdin を閉じた（残りは読まれない）
+                child.broken_pipe = child.broken_pipe || errno == EPIPE;
+                CloseFd(in_fd);
+            }
+        }
+        if (out_slot >= 0 && fds[out_slot].revents) {
+            const ssize_t n = ::read(out_fd, buffer.data(), buffer.size());
+            if (n > 0) {
+                if (on_stdout) on_stdout(std::string_view(buffer.data(), static_cast<size_t>(n)));
+            } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                CloseFd(out_fd);
+            }
+        }
+        if (err_slot >= 0 && fds[err_slot].revents) {
+            const ssize_t n = ::read(err_fd, buffer.data(), buffer.size());
+            if (n > 0) {
+                const size_t room = kMaxStderrBytes - std::min(kMaxStderrBytes, result.stderr_text.size());
+                result.stderr_text.append(buffer.data(), std::min(room, static_cast<size_t>(n)));
+            } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                CloseFd(err_fd);
+            }
+        }
+    }
+
+    const int status = child.Wait();
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.signal = WTERMSIG(status);
+    }
+    return result;
+}
+
+#endif
+
+}
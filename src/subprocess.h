@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// shell を通さずに子プロセスを起動し（posix_spawn、引数は argv のまま渡す）、
+// stdin に書き込みながら stdout/stderr を読む
+// - stdin/stdout/stderr は poll で同時に進めるので、大きな入出力でも互いに詰まらない
+// - stdout は大きな固定バッファに読み、読めた分ずつ on_stdout に渡す（全体を溜めるかは呼び出し側）
+// - 子が stdin を読み終える前に終わっても SIGPIPE では落ちない
+// - Windows では _popen で起動する（stdin は推測できない名前の一時ファイルから、stderr は取らない）。
+//   子を止められないので、cancel は出力を読む合間に確かめてパイプを閉じるだけで、子が出力を書かずに
+//   計算している間は止まらない
+class Subprocess {
+public:
+    // 1 回の read で読む量
+    static constexpr size_t kReadChunk = 64 << 10;
+    // stderr は先頭のこれだけ残す（エラーの説明用）
+    static constexpr size_t kMaxStderrBytes = 64 << 10;
+    // cancel を確かめる間隔
+    static constexpr int kCancelPollMillis = 50;
+
+    struct Result {
+        int exit_code = -1;      // 終了コード（シグナルで終わったら -1）
+        int signal = 0;          // 終わらせたシグナル
+        bool cancelled = false;  // cancel で止めた
+        std::string stderr_text; // 先頭 kMaxStderrBytes まで
+
+        bool Succeeded() const { return exit_code == 0 && !cancelled; }
+        // "exit status 1: <stderr の 1 行目>" のような説明
+        std::string Describe() const;
+    };
+
+    // argv[0] は実行ファイルのパス（PATH からは探さない）。input を stdin に書き込んで閉じる
+    // 起動できなければ ShinoError（System）。cancel が立つと子プロセス（とその子）を SIGKILL で止める
+    static Result Run(const std::vector<std::string>& argv, std::string_view input,
+                      const std::function<void(std::string_view)>& on_stdout,
+                      const std::atomic<bool>* cancel = nullptr);
+};
+
+// 読めた分ずつ渡されるテキストを行に分けて lines の末尾に足す（std::getline と同じ分け方）
+class LineSplitter {
+public:
+    explicit LineSplitter(std::vector<std::string>& lines) : lines_(lines) {}
+
+    void Append(std::string_view chunk);
+
+private:
+    std::vector<std::string>& lines_;
+    bool open_ = false; // lines_.back() が改行で終わっていない
+};
+
+}
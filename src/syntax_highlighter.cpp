@@ -0,0 +1,303 @@
+#include "syntax_highlighter.h"
+#include <algorithm>
+#include <optional>
+
+namespace ShinoEditor {
+
+namespace {
+// 先頭の最大3文字のスペースを読み飛ばす
+size_t SkipIndent(std::string_view line) {
+    size_t i = 0;
+    while (i < line.size() && i < 3 && line[i] == ' ') ++i;
+    return i;
+}
+
+// コードフェンス行か（``` / ~~~ を3文字以上）
+bool ParseFence(std::string_view line, char& fence_char, int& fence_len) {
+    const size_t i = SkipIndent(line);
+    if (i >= line.size() || (line[i] != '`' && line[i] != '~')) return false;
+    const char c = line[i];
+    size_t j = i;
+    while (j < line.size() && line[j] == c) ++j;
+    if (j - i < 3) return false;
+    fence_char = c;
+    fence_len = static_cast<int>(j - i);
+    return true;
+}
+
+bool IsBlankFrom(std::string_view line, size_t from) {
+    for (size_t i = from; i < line.size(); ++i) {
+        if (line[i] != ' ' && line[i] != '\t') return false;
+    }
+    return true;
+}
+
+bool IsHeader(std::string_view line) {
+    size_t i = SkipIndent(line);
+    const size_t start = i;
+    while (i < line.size() && line[i] == '#') ++i;
+    const size_t level = i - start;
+    return level >= 1 && level <= 6 && (i == line.size() || line[i] == ' ' || line[i] == '\t');
+}
+
+// リストマーカーの終端（マーカー直後の空白を含む）。リストでなければ 0
+size_t ListMarkerEnd(std::string_view line, size_t i) {
+    if (i < line.size() && (line[i] == '-' || line[i] == '*' || line[i] == '+')) {
+        if (i + 1 < line.size() && line[i + 1] == ' ') return i + 2;
+        return 0;
+    }
+    size_t j = i;
+    while (j < line.size() && j - i < 9 && line[j] >= '0' && line[j] <= '9') ++j;
+    if (j > i && j + 1 < line.size() && (line[j] == '.' || line[j] == ')') && line[j + 1] == ' ') {
+        return j + 2;
+    }
+    return 0;
+}
+
+size_t RunLength(std::string_view line, size_t i) {
+    size_t j = i;
+    while (j < line.size() && line[j] == line[i]) ++j;
+    return j - i;
+}
+
+bool IsAlnum(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+// 同じ長さの閉じ区切りを探す（見つからなければ npos）
+size_t FindClosingRun(std::string_view line, size_t from, char c, size_t len) {
+    size_t j = from;
+    while (j < line.size()) {
+        if (line[j] == '`' && c != '`') {
+            // コードスパン内の区切りは無視
+            const size_t run = RunLength(line, j);
+            const size_t close = FindClosingRun(line, j + run, '`', run);
+            j = close == std::string_view::npos ? j + run : close + run;
+            continue;
+        }
+        if (line[j] == c) {
+            const size_t run = RunLength(line, j);
+            if (run == len && (c == '`' || line[j - 1] != ' ')) return j;
+            j += run;
+            continue;
+        }
+        ++j;
+    }
+    return std::string_view::npos;
+}
+
+// [text](url) の終端（')' の次）。リンクでなければ npos
+size_t LinkEnd(std::string_view line, size_t i) {
+    const size_t close = line.find(']', i + 1);
+    if (close == std::string_view::npos || close + 1 >= line.size() || line[close + 1] != '(') {
+        return std::string_view::npos;
+    }
+    const size_t paren = line.find(')', close + 2);
+    return paren == std::string_view::npos ? paren : paren + 1;
+}
+
+// インライン要素を走査。base が指定されていれば装飾のない部分をその種別で埋める
+void TokenizeInline(std::string_view line, size_t from, std::optional<HighlightStyle> base,
+                    std::vector<HighlightSpan>& spans) {
+    size_t plain_start = from;
+    auto emit = [&](size_t begin, size_t end, HighlightStyle style) {
+        if (base && begin > plain_start) spans.push_back({plain_start, begin, *base});
+        spans.push_back({begin, end, style});
+        plain_start = end;
+    };
+
+    size_t i = from;
+    while (i < line.size()) {
+        const char c = line[i];
+        if (c == '\\' && i + 1 < line.size()) {
+            i += 2;
+            continue;
+        }
+        if (c == '`') {
+            const size_t run = RunLength(line, i);
+            const size_t close = FindClosingRun(line, i + run, '`', run);
+            if (close != std::string_view::npos) {
+                emit(i, close + run, HighlightStyle::INLINE_CODE);
+                i = close + run;
+            } else {
+                i += run;
+            }
+            continue;
+        }
+        if (c == '[') {
+            const size_t end = LinkEnd(line, i);
+            if (end != std::string_view::npos) {
+                emit(i, end, HighlightStyle::LINK);
+                i = end;
+                continue;
+            }
+        }
+        if (c == '*' || c == '_') {
+            const size_t run = RunLength(line, i);
+            const bool opens = i + run < line.size() && line[i + run] != ' ' &&
+                               !(c == '_' && i > 0 && IsAlnum(line[i - 1]));
+            if (opens && run <= 3) {
+                const size_t close = FindClosingRun(line, i + run, c, run);
+                if (close != std::string_view::npos) {
+                    emit(i, close + run, run >= 2 ? HighlightStyle::STRONG : HighlightStyle::EMPHASIS);
+                    i = close + run;
+                    continue;
+                }
+            }
+            i += run;
+            continue;
+        }
+        ++i;
+    }
+    if (base && line.size() > plain_start) {
+        spans.push_back({plain_start, line.size(), *base});
+    }
+}
+}
+
+SyntaxHighlighter::SyntaxHighlighter(const std::vector<std::string>& lines)
+    : lines_(lines) {
+    InvalidateAll();
+}
+
+void SyntaxHighlighter::InvalidateLine(int real_line) {
+    if (real_line < 0 || real_line >= static_cast<int>(cache_.size())) return;
+    cache_[real_line].valid = false;
+    // 行頭状態は前の行で決まるので、この行の状態は有効なまま
+    stable_until_ = std::min(stable_until_, real_line);
+    dirty_max_ = std::max(dirty_max_, real_line);
+}
+
+void SyntaxHighlighter::InsertLines(int pos, int count) {
+    if (count <= 0) return;
+    pos = std::clamp(pos, 0, static_cast<int>(cache_.size()));
+    // 新しい行 pos..pos+count-1 の直後の状態を未確定として挿入
+    start_states_.insert(start_states_.begin() + pos + 1, count, LineState{});
+    cache_.insert(cache_.begin() + pos, count, SpanCache{});
+    if (pos < static_cast<int>(cache_.size()) - count) {
+        cache_[pos + count].valid = false;
+    }
+    stable_until_ = std::min(stable_until_, pos);
+    if (dirty_max_ >= pos) dirty_max_ += count;
+    dirty_max_ = std::max(dirty_max_, pos + count);
+}
+
+void SyntaxHighlighter::EraseLines(int pos, int count) {
+    const int size = static_cast<int>(cache_.size());
+    if (count <= 0 || pos < 0 || pos >= size) return;
+    count = std::min(count, size - pos);
+    start_states_.erase(start_states_.begin() + pos + 1, start_states_.begin() + pos + 1 + count);
+    cache_.erase(cache_.begin() + pos, cache_.begin() + pos + count);
+    if (pos < static_cast<int>(cache_.size())) {
+        cache_[pos].valid = false;
+    }
+    stable_until_ = std::min(stable_until_, pos);
+    dirty_max_ = dirty_max_ >= pos + count ? dirty_max_ - count : std::max(dirty_max_, pos);
+}
+
+void SyntaxHighlighter::InvalidateAll() {
+    Resize();
+    std::fill(start_states_.begin(), start_states_.end(), LineState{});
+    for (auto& entry : cache_) entry.valid = false;
+    stable_until_ = 0;
+    // 旧状態は信用できないので収束判定をしない
+    dirty_max_ = static_cast<int>(lines_.size());
+}
+
+const std::vector<HighlightSpan>& SyntaxHighlighter::GetSpans(int real_line) {
+    static const std::vector<HighlightSpan> kEmpty;
+    if (cache_.size() != lines_.size()) InvalidateAll();
+    if (real_line < 0 || real_line >= static_cast<int>(lines_.size())) return kEmpty;
+
+    EnsureStates(real_line);
+    SpanCache& entry = cache_[real_line];
+    if (!entry.valid) {
+        entry.spans.clear();
+        TokenizeLine(lines_[real_line], start_states_[real_line], &entry.spans);
+        entry.valid = true;
+    }
+    return entry.spans;
+}
+
+LineState SyntaxHighlighter::GetLineState(int real_line) {
+    if (cache_.size() != lines_.size()) InvalidateAll();
+    real_line = std::clamp(real_line, 0, static_cast<int>(lines_.size()));
+    EnsureStates(real_line);
+    return start_states_[real_line];
+}
+
+void SyntaxHighlighter::Resize() {
+    start_states_.resize(lines_.size() + 1);
+    cache_.resize(lines_.size());
+}
+
+void SyntaxHighlighter::EnsureStates(int real_line) {
+    const int n = static_cast<int>(lines_.size());
+    while (stable_until_ < real_line) {
+        const int j = stable_until_;
+        const LineState end = TokenizeLine(lines_[j], start_states_[j], nullptr);
+        if (start_states_[j + 1] == end) {
+            if (j + 1 > dirty_max_) {
+                // 編集範囲を過ぎて旧状態と一致したので、以降の状態・キャッシュはそのまま使える
+                stable_until_ = n;
+                dirty_max_ = -1;
+                return;
+            }
+        } else {
+            start_states_[j + 1] = end;
+            if (j + 1 < n) cache_[j + 1].valid = false;
+        }
+        stable_until_ = j + 1;
+    }
+    if (stable_until_ >= n) dirty_max_ = -1;
+}
+
+LineState SyntaxHighlighter::TokenizeLine(std::string_view line, LineState state,
+                                          std::vector<HighlightSpan>* spans) {
+    char fence_char = 0;
+    int fence_len = 0;
+    const bool fence = ParseFence(line, fence_char, fence_len);
+
+    if (state.in_fence) {
+        if (fence && fence_char == state.fence_char && fence_len >= state.fence_len &&
+            IsBlankFrom(line, SkipIndent(line) + fence_len)) {
+            if (spans) spans->push_back({0, line.size(), HighlightStyle::FENCE_MARKER});
+            return LineState{};
+        }
+        if (spans && !line.empty()) spans->push_back({0, line.size(), HighlightStyle::FENCE_BODY});
+        return state;
+    }
+
+    if (fence) {
+        if (spans) spans->push_back({0, line.size(), HighlightStyle::FENCE_MARKER});
+        return LineState{true, fence_char, fence_len};
+    }
+    // 以降は行をまたがない
+    if (!spans) return state;
+
+    if (IsHeader(line)) {
+        spans->push_back({0, line.size(), HighlightStyle::HEADER});
+        return state;
+    }
+
+    const size_t indent = SkipIndent(line);
+    if (indent < line.size() && line[indent] == '>') {
+        size_t i = indent;
+        while (i < line.size() && (line[i] == '>' || line[i] == ' ')) ++i;
+        spans->push_back({0, i, HighlightStyle::QUOTE});
+        TokenizeInline(line, i, HighlightStyle::QUOTE, *spans);
+        return state;
+    }
+
+    const size_t marker_end = ListMarkerEnd(line, indent);
+    if (marker_end > 0) {
+        spans->push_back({indent, marker_end, HighlightStyle::LIST_MARKER});
+        TokenizeInline(line, marker_end, std::nullopt, *spans);
+        return state;
+    }
+
+    TokenizeInline(line, 0, std::nullopt, *spans);
+    return state;
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+enum class HighlightStyle {
+    HEADER,
+    EMPHASIS,
+    STRONG,
+    INLINE_CODE,
+    LINK,
+    FENCE_MARKER,
+    FENCE_BODY,
+    QUOTE,
+    LIST_MARKER,
+    // 検索の一致箇所（App が重ねる。ハイライタ自身は生成しない）
+    SEARCH_MATCH,
+    SEARCH_CURRENT
+};
+
+// 行内のハイライト範囲 [begin, end)（バイトオフセット、重なりなし・昇順）
+struct HighlightSpan {
+    size_t begin;
+    size_t end;
+    HighlightStyle style;
+};
+
+// 行頭時点のトークナイザ状態（行をまたぐのはコードフェンスのみ）
+struct LineState {
+    bool in_fence = false;
+    char fence_char = 0;
+    int fence_len = 0;
+
+    bool operator==(const LineState& other) const {
+        return in_fence == other.in_fence && fence_char == other.fence_char &&
+               fence_len == other.fence_len;
+    }
+    bool operator!=(const LineState& other) const { return !(*this == other); }
+};
+
+// 行単位の Markdown ハイライタ
+// - 各行の行頭状態をチェックポイントとして保持し、編集後は状態が収束するまでだけ再走査
+// - ハイライト範囲は行ごとにキャッシュし、要求された（画面内の）行だけ生成する
+class SyntaxHighlighter {
+public:
+    // App::lines_ を参照で保持
+    explicit SyntaxHighlighter(const std::vector<std::string>& lines);
+
+    // 編集通知（実行行インデックス）
+    void InvalidateLine(int real_line);
+    void InsertLines(int pos, int count);
+    void EraseLines(int pos, int count);
+    void InvalidateAll();
+
+    // 実行行のハイライト範囲
+    const std::vector<HighlightSpan>& GetSpans(int real_line);
+
+    // 行頭状態（必要なところまで状態を進める）
+    LineState GetLineState(int real_line);
+
+    // 1行をトークナイズし、行末（次の行頭）の状態を返す。spans が null なら状態だけ進める
+    static LineState TokenizeLine(std::string_view line, LineState state,
+                                  std::vector<HighlightSpan>* spans);
+
+private:
+    struct SpanCache {
+        bool valid = false;
+        std::vector<HighlightSpan> spans;
+    };
+
+    const std::vector<std::string>& lines_;
+    // start_states_[i] は i 行目の行頭状態（要素数は行数 + 1）
+    std::vector<LineState> start_states_;
+    std::vector<SpanCache> cache_;
+    // [0, stable_until_] の行頭状態は確定済み
+    int stable_until_ = 0;
+    // 最後に編集された行。これより後で旧状態と一致すれば以降も一致（収束）
+    int dirty_max_ = -1;
+
+    void Resize();
+    void EnsureStates(int real_line);
+};
+
+}
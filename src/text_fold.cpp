@@ -0,0 +1,275 @@
+#include "text_fold.h"
+#include "utf8_util.h"
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <numeric>
+
+namespace ShinoEditor {
+
+namespace {
+// 正規化し直す行の一覧をこれより長くしない（行の挿入/削除で一覧をずらす手間を抑える）
+constexpr size_t kMaxStaleLines = 4096;
+
+// 半角カナ U+FF61〜U+FF9F -> 全角（ﾞ ﾟ は結合用の濁点/半濁点）
+constexpr std::array<char16_t, 0x3F> kHalfwidthKana = {
+    u'。', u'「', u'」', u'、', u'・', u'ヲ', u'ァ', u'ィ',
+    u'ゥ', u'ェ', u'ォ', u'ャ', u'ュ', u'ョ', u'ッ', u'ー',
+    u'ア', u'イ', u'ウ', u'エ', u'オ', u'カ', u'キ', u'ク',
+    u'ケ', u'コ', u'サ', u'シ', u'ス', u'セ', u'ソ', u'タ',
+    u'チ', u'ツ', u'テ', u'ト', u'ナ', u'ニ', u'ヌ', u'ネ',
+    u'ノ', u'ハ', u'ヒ', u'フ', u'ヘ', u'ホ', u'マ', u'ミ',
+    u'ム', u'メ', u'モ', u'ヤ', u'ユ', u'ヨ', u'ラ', u'リ',
+    u'ル', u'レ', u'ロ', u'ワ', u'ン', u'\u3099', u'\u309A',
+};
+
+constexpr char32_t kCombiningVoiced = 0x3099;
+constexpr char32_t kCombiningSemiVoiced = 0x309A;
+
+// 全角の英数記号など（幅だけが違う文字）を半角に。対象でなければ 0
+char32_t NarrowForm(char32_t cp) {
+    if (cp >= 0xFF01 && cp <= 0xFF5E) return cp - 0xFEE0;
+    switch (cp) {
+        case 0x3000: return 0x20;
+        case 0xFF5F: return 0x2985;
+        case 0xFF60: return 0x2986;
+        case 0xFFE0: return 0xA2;
+        case 0xFFE1: return 0xA3;
+        case 0xFFE2: return 0xAC;
+        case 0xFFE4: return 0xA6;
+        case 0xFFE5: return 0xA5;
+        case 0xFFE6: return 0x20A9;
+        default: return 0;
+    }
+}
+
+// かなと結合用の濁点/半濁点を合成した文字。合成できなければ 0
+char32_t ComposeKana(char32_t base, char32_t mark) {
+    // ひらがなはカタカナに直して調べ、結果をひらがなに戻す
+    const bool hiragana = base >= 0x3041 && base <= 0x309F;
+    const char32_t k = hiragana ? base + 0x60 : base;
+    char32_t composed = 0;
+    if (mark == kCombiningVoiced) {
+        if ((k >= 0x30AB && k <= 0x30C2 && (k - 0x30AB) % 2 == 0) || k == 0x30C4 || k == 0x30C6 || k == 0x30C8) {
+            composed = k + 1; // カ〜チ、ツ テ ト
+        } else if (k >= 0x30CF && k <= 0x30DB && (k - 0x30CF) % 3 == 0) {
+            composed = k + 1; // ハ ヒ フ ヘ ホ
+        } else if (k == 0x30A6) {
+            composed = 0x30F4; // ウ
+        } else if (k == 0x30FD) {
+            composed = 0x30FE; // ヽ
+        } else if (!hiragana && k >= 0x30EF && k <= 0x30F2) {
+            composed = k + 8; // ワ ヰ ヱ ヲ（ひらがなにはない）
+        }
+    } else if (mark == kCombiningSemiVoiced) {
+        if (k >= 0x30CF && k <= 0x30DB && (k - 0x30CF) % 3 == 0) composed = k + 2;
+    }
+    if (composed == 0) return 0;
+    return hiragana ? composed - 0x60 : composed;
+}
+
+// s[pos] から 1 文字読む。不正なバイトは valid = false で 1 バイトだけ進める
+char32_t ReadChar(std::string_view s, size_t& pos, bool& valid) {
+    const size_t start = pos;
+    const char32_t cp = utf8::Decode(s, pos);
+    // 本物の U+FFFD（EF BF BD）と、不正なバイトの置き換えを見分ける
+    valid = cp != U'\uFFFD' || pos - start == 3;
+    return cp;
+}
+}
+
+void FoldText(std::string_view in, const FoldOptions& options, std::string& out, std::vector<uint32_t>* offsets) {
+    out.clear();
+    out.reserve(in.size());
+    if (offsets) offsets->clear();
+    // ここまでのすべての文字でバイト数が変わっていなければ、offsets には何も書かない
+    bool mapped = false;
+    size_t pos = 0;
+    while (pos < in.size()) {
+        const size_t start = pos;
+        const auto lead = static_cast<unsigned char>(in[pos]);
+        if (lead < 0x80) {
+            // ASCII は 1 バイトのまま
+            out.push_back(options.case_fold && lead >= 'A' && lead <= 'Z' ? static_cast<char>(lead + 32)
+                                                                         : static_cast<char>(lead));
+            ++pos;
+            if (mapped) offsets->push_back(static_cast<uint32_t>(start));
+            continue;
+        }
+        bool valid = true;
+        char32_t cp = ReadChar(in, pos, valid);
+        const size_t before = out.size();
+        if (!valid) {
+            out.append(in.substr(start, pos - start));
+        } else {
+            if (options.width_fold) {
+                if (cp >= 0xFF61 && cp <= 0xFF9F) {
+                    cp = kHalfwidthKana[cp - 0xFF61];
+                } else if (const char32_t narrow = NarrowForm(cp)) {
+                    cp = narrow;
+                }
+                // 後ろの濁点/半濁点（半角または結合用）を合成する（NFKC と同じ）
+                if (pos < in.size()) {
+                    size_t next = pos;
+                    bool next_valid = true;
+                    char32_t mark = ReadChar(in, next, next_valid);
+                    if (mark == 0xFF9E) mark = kCombiningVoiced;
+                    if (mark == 0xFF9F) mark = kCombiningSemiVoiced;
+                    if (next_valid && (mark == kCombiningVoiced || mark == kCombiningSemiVoiced)) {
+                        if (const char32_t composed = ComposeKana(cp, mark)) {
+                            cp = composed;
+                            pos = next;
+                        }
+                    }
+                }
+            }
+            if (options.case_fold && cp >= 'A' && cp <= 'Z') cp += 32;
+            if (options.kana_fold) {
+                if (cp >= 0x30A1 && cp <= 0x30F6) {
+                    cp -= 0x60;
+                } else if (cp == 0x30FD || cp == 0x30FE) {
+                    cp -= 0x60; // ヽ ヾ
+                }
+            }
+            utf8::Append(out, cp);
+        }
+        const size_t produced = out.size() - before;
+        if (offsets) {
+            if (!mapped && produced != pos - start) {
+                // ここまでは 1 対 1 なので、出力のバイト位置がそのまま元のオフセット
+                offsets->resize(before);
+                std::iota(offsets->begin(), offsets->end(), 0u);
+                mapped = true;
+            }
+            if (mapped) offsets->insert(offsets->end(), produced, static_cast<uint32_t>(start));
+        }
+    }
+    if (mapped) offsets->push_back(static_cast<uint32_t>(in.size()));
+}
+
+FoldedLines::FoldedLines(const std::vector<std::string>& lines) : lines_(lines) {}
+
+size_t FoldedLines::Sync(const FoldOptions& options) {
+    if (!built_ || !(options == options_)) {
+        options_ = options;
+        built_ = true;
+        folded_.resize(lines_.size());
+        offsets_.resize(lines_.size());
+        stale_.assign(lines_.size(), 1);
+        stale_count_ = lines_.size();
+        stale_lines_.clear();
+        scan_all_ = true;
+    }
+    if (stale_count_ == 0) return 0;
+    size_t refolded = 0;
+    auto refold = [&](size_t i) {
+        if (!stale_[i]) return;
+        FoldText(lines_[i], options_, folded_[i], &scratch_);
+        if (scratch_.empty()) {
+            offsets_[i].reset();
+        } else {
+            offsets_[i] = std::make_unique<std::vector<uint32_t>>(scratch_);
+        }
+        stale_[i] = 0;
+        ++refolded;
+    };
+    if (scan_all_) {
+        for (size_t i = 0; i < lines_.size(); ++i) refold(i);
+    } else {
+        for (int line : stale_lines_) refold(static_cast<size_t>(line));
+    }
+    stale_count_ = 0;
+    stale_lines_.clear();
+    scan_all_ = false;
+    return refolded;
+}
+
+SearchMatch FoldedLines::ToOriginal(const SearchMatch& match) const {
+    if (!offsets_[match.line]) return match;
+    const auto& map = *offsets_[match.line];
+    const size_t begin = map[match.offset];
+    // 終わりは、最後のバイトが由来する文字の次の文字の先頭
+    size_t end = match.offset + match.length;
+    if (end > 0) {
+        const uint32_t last = map[end - 1];
+        while (map[end] == last) ++end;
+    }
+    return {match.line, begin, map[end] - begin};
+}
+
+void FoldedLines::Clear() {
+    std::vector<std::string>().swap(folded_);
+    std::vector<std::unique_ptr<std::vector<uint32_t>>>().swap(offsets_);
+    std::vector<uint32_t>().swap(scratch_);
+    std::vector<uint8_t>().swap(stale_);
+    std::vector<int>().swap(stale_lines_);
+    stale_count_ = 0;
+    scan_all_ = false;
+    built_ = false;
+}
+
+size_t FoldedLines::MemoryUsage() const {
+    size_t bytes = folded_.capacity() * sizeof(std::string) + offsets_.capacity() * sizeof(offsets_[0]) +
+                   stale_.capacity() + scratch_.capacity() * sizeof(uint32_t);
+    for (const auto& line : folded_) bytes += line.capacity();
+    for (const auto& map : offsets_) {
+        if (map) bytes += sizeof(*map) + map->capacity() * sizeof(uint32_t);
+    }
+    return bytes + stale_lines_.capacity() * sizeof(int);
+}
+
+void FoldedLines::MarkStale(int line) {
+    if (stale_[line]) return;
+    stale_[line] = 1;
+    ++stale_count_;
+    if (scan_all_) return;
+    if (stale_lines_.size() >= kMaxStaleLines) {
+        stale_lines_.clear();
+        scan_all_ = true;
+    } else {
+        stale_lines_.push_back(line);
+    }
+}
+
+void FoldedLines::InvalidateLine(int real_line) {
+    if (!built_ || real_line < 0 || real_line >= static_cast<int>(stale_.size())) return;
+    MarkStale(real_line);
+}
+
+void FoldedLines::InsertLines(int pos, int count) {
+    if (!built_ || count <= 0) return;
+    pos = std::clamp(pos, 0, static_cast<int>(stale_.size()));
+    folded_.insert(folded_.begin() + pos, count, std::string());
+    std::vector<std::unique_ptr<std::vector<uint32_t>>> inserted(static_cast<size_t>(count));
+    offsets_.insert(offsets_.begin() + pos, std::make_move_iterator(inserted.begin()),
+                    std::make_move_iterator(inserted.end()));
+    stale_.insert(stale_.begin() + pos, count, 0);
+    for (int& line : stale_lines_) {
+        if (line >= pos) line += count;
+    }
+    for (int line = pos; line < pos + count; ++line) MarkStale(line);
+}
+
+void FoldedLines::EraseLines(int pos, int count) {
+    const int size = static_cast<int>(stale_.size());
+    if (!built_ || count <= 0 || pos < 0 || pos >= size) return;
+    const int end = std::min(size, pos + count);
+    for (int i = pos; i < end; ++i) stale_count_ -= stale_[i];
+    folded_.erase(folded_.begin() + pos, folded_.begin() + end);
+    offsets_.erase(offsets_.begin() + pos, offsets_.begin() + end);
+    stale_.erase(stale_.begin() + pos, stale_.begin() + end);
+    // 消した行を一覧から除き、後ろの行をずらす
+    size_t kept = 0;
+    for (int line : stale_lines_) {
+        if (line >= pos && line < end) continue;
+        stale_lines_[kept++] = line >= end ? line - (end - pos) : line;
+    }
+    stale_lines_.resize(kept);
+}
+
+void FoldedLines::InvalidateAll() {
+    // 行数も変わりうるので、次の Sync() で作り直す
+    built_ = false;
+}
+
+}
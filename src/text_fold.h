@@ -0,0 +1,72 @@
+#pragma once
+#include "text_search.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 検索用の正規化（畳み込み）の種類
+struct FoldOptions {
+    bool case_fold = false;  // ASCII の大文字 -> 小文字
+    bool width_fold = false; // 全角英数記号 -> 半角、半角カナ -> 全角（濁点/半濁点は合成）、全角空白 -> 空白
+    bool kana_fold = false;  // カタカナ -> ひらがな
+
+    bool Any() const { return case_fold || width_fold || kana_fold; }
+    bool operator==(const FoldOptions& other) const {
+        return case_fold == other.case_fold && width_fold == other.width_fold && kana_fold == other.kana_fold;
+    }
+};
+
+// in を正規化して out に入れる
+// width_fold は NFKC のうち文字幅に関わる対応だけ（互換分解の全体ではない）。不正な UTF-8 はそのまま写す
+// offsets を渡すと、out の各バイトが由来する in の文字の先頭オフセットと、末尾の番兵 in.size() を入れる
+// すべての文字でバイト数が変わらなかったとき（ASCII の大文字小文字だけなど）は offsets を空にする（恒等写像）
+void FoldText(std::string_view in, const FoldOptions& options, std::string& out,
+              std::vector<uint32_t>* offsets = nullptr);
+
+// 正規化した行の影（シャドウ）と、元の行へのオフセットの対応
+// 検索のたびに正規化せずに済むよう、正規化した行を持っておき、その上をそのまま検索する
+// 作るのは Sync() を呼んだときで、編集通知では印を付けるだけ（次の Sync() で変わった行だけ作り直す）
+class FoldedLines {
+public:
+    // App::lines_ を参照で保持
+    explicit FoldedLines(const std::vector<std::string>& lines);
+
+    // 正規化した行（Sync() のあとで lines_ と揃っている）
+    const std::vector<std::string>& Lines() const { return folded_; }
+    // options で正規化した行を lines_ に揃える。正規化し直した行数を返す
+    size_t Sync(const FoldOptions& options);
+    // 正規化した行での一致を、元の行のバイト範囲に直す（文字の途中にかかる場合は文字全体に広げる）
+    SearchMatch ToOriginal(const SearchMatch& match) const;
+    // 影を捨てる（メモリを返す）
+    void Clear();
+    size_t MemoryUsage() const;
+
+    // 編集通知（実行行インデックス）
+    void InvalidateLine(int real_line);
+    void InsertLines(int pos, int count);
+    void EraseLines(int pos, int count);
+    void InvalidateAll();
+
+private:
+    const std::vector<std::string>& lines_;
+    FoldOptions options_;
+    bool built_ = false;
+    std::vector<std::string> folded_;
+    // 行ごとの対応（なければ恒等写像）。対応が要る行は少ないので、要る行だけ確保する
+    std::vector<std::unique_ptr<std::vector<uint32_t>>> offsets_;
+    std::vector<uint32_t> scratch_;
+    // 正規化し直す行の印と、その行番号の一覧（多すぎるときは一覧を持たずに印を全部見る）
+    std::vector<uint8_t> stale_;
+    size_t stale_count_ = 0;
+    std::vector<int> stale_lines_;
+    bool scan_all_ = false;
+
+    void MarkStale(int line);
+};
+
+}
@@ -0,0 +1,55 @@
+#include "text_replace.h"
+#include <utility>
+
+namespace ShinoEditor {
+
+std::vector<LineEdit> BuildLineEdits(const std::vector<std::string>& lines, const std::vector<SearchMatch>& matches,
+                                     std::string_view replacement, size_t* replaced) {
+    std::vector<LineEdit> edits;
+    size_t count = 0;
+    size_t i = 0;
+    while (i < matches.size()) {
+        const int line = matches[i].line;
+        if (line < 0 || line >= static_cast<int>(lines.size())) {
+            ++i;
+            continue;
+        }
+        // この行の一致の範囲 [i, end) と、組み立てたあとの長さ
+        const std::string& source = lines[line];
+        size_t end = i;
+        size_t size = source.size();
+        size_t prev_end = 0;
+        for (; end < matches.size() && matches[end].line == line; ++end) {
+            const SearchMatch& match = matches[end];
+            if (match.offset < prev_end || match.offset + match.length > source.size()) continue;
+            size = size - match.length + replacement.size();
+            prev_end = match.offset + match.length;
+        }
+
+        LineEdit edit;
+        edit.line = line;
+        edit.text.reserve(size);
+        size_t copied = 0;
+        for (size_t m = i; m < end; ++m) {
+            const SearchMatch& match = matches[m];
+            if (match.offset < copied || match.offset + match.length > source.size()) continue;
+            edit.text.append(source, copied, match.offset - copied);
+            edit.text.append(replacement);
+            copied = match.offset + match.length;
+            ++count;
+        }
+        edit.text.append(source, copied, std::string::npos);
+        if (edit.text != source) edits.push_back(std::move(edit));
+        i = end;
+    }
+    if (replaced) *replaced = count;
+    return edits;
+}
+
+void SwapLineEdits(std::vector<std::string>& lines, std::vector<LineEdit>& edits) {
+    for (auto& edit : edits) {
+        if (edit.line >= 0 && edit.line < static_cast<int>(lines.size())) lines[edit.line].swap(edit.text);
+    }
+}
+
+}
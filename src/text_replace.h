@@ -0,0 +1,26 @@
+#pragma once
+#include "text_search.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 置換で 1 行を書き換える内容
+struct LineEdit {
+    int line = 0;     // 実行行インデックス
+    std::string text; // 書き換えたあとの行（SwapLineEdits() のあとは元の行）
+};
+
+// matches（(行, オフセット) の昇順、検索の結果そのまま）を replacement に置き換えた行を、
+// 変わる行ごとに 1 回だけ組み立てる（一致ごとに行を作り直さない）。前の一致と重なる一致は飛ばす
+// replaced を渡すと、置き換えた一致の数を入れる
+std::vector<LineEdit> BuildLineEdits(const std::vector<std::string>& lines, const std::vector<SearchMatch>& matches,
+                                     std::string_view replacement, size_t* replaced = nullptr);
+
+// lines の行と edits の内容を入れ替える（コピーしない）
+// 入れ替えたあとの edits は元の行を持つので、もう一度呼べば元に戻る
+void SwapLineEdits(std::vector<std::string>& lines, std::vector<LineEdit>& edits);
+
+}
@@ -0,0 +1,248 @@
+#include "text_search.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHINO_SEARCH_SSE2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHINO_SEARCH_SSE2 1
+#endif
+
+namespace ShinoEditor {
+
+namespace {
+constexpr size_t npos = std::string_view::npos;
+
+bool OneOf(unsigned char c, const char* set) {
+    return c != 0 && std::strchr(set, c) != nullptr;
+}
+
+// Markdown/ソースコードでのバイトのおおよその出現頻度（大きいほどよく出る）
+// 絞り込みに使うバイトを選ぶためだけのものなので、順位の大小が合っていればよい
+uint8_t ByteRank(unsigned char c) {
+    if (c == ' ' || c == '\n') return 255;
+    if (OneOf(c, "etaoinsrhldcum")) return 240;
+    if (c >= 'a' && c <= 'z') return OneOf(c, "zqxjkv") ? 150 : 210;
+    if (c >= 0x80 && c <= 0xBF) return 200; // UTF-8 の継続バイト
+    if (c == 0xE3) return 190;              // かな・CJK 記号の先頭バイト
+    if (c >= 0xE4 && c <= 0xE9) return 170; // 漢字の先頭バイト
+    if (OneOf(c, ".,-#*`()[]/:_\"'=")) return 160;
+    if (c >= '0' && c <= '9') return 140;
+    if (c >= 'A' && c <= 'Z') return 120;
+    if (c == '\t' || c == '\r') return 120;
+    if (c >= 0x20 && c < 0x7F) return 90;
+    if (c >= 0xC0) return 60;
+    return 10; // 制御文字
+}
+
+// これより出現頻度の低いバイトを含むパターンは、まずそのバイトを memchr で探す
+constexpr uint8_t kRareRank = 155;
+// memchr で探す候補が kPrefilterMinCandidates 個を超えても、平均して kPrefilterMinSkip バイト
+// 進めていなければ絞り込みが効いていないとみなす
+constexpr size_t kPrefilterMinCandidates = 16;
+constexpr size_t kPrefilterMinSkip = 256;
+}
+
+SubstringSearcher::SubstringSearcher(std::string needle) : needle_(std::move(needle)) {
+    const size_t n = needle_.size();
+    if (n <= 1) return;
+
+    // 最も出にくいバイトとその次（別の位置）を選ぶ。同順位なら両端を優先（離れた位置ほど絞り込みが効く）
+    auto rank = [&](size_t i) { return ByteRank(static_cast<unsigned char>(needle_[i])); };
+    size_t rare1 = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (rank(i) < rank(rare1)) rare1 = i;
+    }
+    size_t rare2 = rare1 == n - 1 ? 0 : n - 1;
+    for (size_t i = 0; i < n; ++i) {
+        if (i != rare1 && rank(i) < rank(rare2)) rare2 = i;
+    }
+    rare1_ = rare1;
+    rare2_ = rare2;
+
+    if (rank(rare1) < kRareRank) {
+        method_ = Method::RARE_BYTE;
+    } else if (n >= kHorspoolThreshold) {
+        method_ = Method::HORSPOOL;
+        shift_.fill(static_cast<uint32_t>(n));
+        for (size_t i = 0; i + 1 < n; ++i) {
+            shift_[static_cast<unsigned char>(needle_[i])] = static_cast<uint32_t>(n - 1 - i);
+        }
+    } else {
+        method_ = Method::BYTE_PAIR;
+    }
+}
+
+size_t SubstringSearcher::Find(std::string_view text, size_t from) const {
+    const size_t n = needle_.size();
+    if (n == 0 || from > text.size() || text.size() - from < n) return npos;
+    switch (method_) {
+        case Method::MEMCHR: {
+            const void* hit = std::memchr(text.data() + from, needle_[0], text.size() - from);
+            return hit ? static_cast<size_t>(static_cast<const char*>(hit) - text.data()) : npos;
+        }
+        case Method::RARE_BYTE: return FindRareByte(text, from);
+        case Method::BYTE_PAIR: return FindBytePair(text, from);
+        case Method::HORSPOOL: return FindHorspool(text, from);
+    }
+    return npos;
+}
+
+size_t SubstringSearcher::FindRareByte(std::string_view text, size_t from) const {
+    const char* data = text.data();
+    const size_t n = needle_.size();
+    const char rare = needle_[rare1_];
+    // 候補の開始位置は [from, end)。各候補の rare1_ の位置のバイトを memchr で探す
+    const size_t end = text.size() - n + 1;
+    size_t candidates = 0;
+    for (size_t i = from; i < end;) {
+        // 思ったより頻繁に出るバイトだった（memchr が短い距離で止まり続ける）なら 2 バイトの絞り込みに切り替える
+        if (++candidates > kPrefilterMinCandidates &&
+            (i - from) < candidates * kPrefilterMinSkip) {
+            return FindBytePair(text, i);
+        }
+        const void* hit = std::memchr(data + i + rare1_, rare, end - i);
+        if (!hit) return npos;
+        const size_t candidate = static_cast<size_t>(static_cast<const char*>(hit) - data) - rare1_;
+        if (std::memcmp(data + candidate, needle_.data(), n) == 0) return candidate;
+        i = candidate + 1;
+    }
+    return npos;
+}
+
+size_t SubstringSearcher::FindBytePair(std::string_view text, size_t from) const {
+    const char* data = text.data();
+    const size_t n = needle_.size();
+    // 候補の開始位置は [from, end)
+    const size_t end = text.size() - n + 1;
+    // メンバーは char* 経由の読み込みと別名になりうるので、ループの前にローカルへ写す
+    const size_t o1 = rare1_;
+    const size_t o2 = rare2_;
+    const char b1 = needle_[o1];
+    const char b2 = needle_[o2];
+    const char* pattern = needle_.data();
+    auto check = [&](size_t candidate) {
+        return std::memcmp(data + candidate, pattern, n) == 0;
+    };
+    size_t i = from;
+#if defined(__AVX2__)
+    const __m256i v1 = _mm256_set1_epi8(b1);
+    const __m256i v2 = _mm256_set1_epi8(b2);
+    for (; i + 32 <= end; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + o1));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + o2));
+        auto mask = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, v1), _mm256_cmpeq_epi8(b, v2))));
+        while (mask != 0) {
+            const size_t candidate = i + static_cast<size_t>(std::countr_zero(mask));
+            if (check(candidate)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+#elif defined(SHINO_SEARCH_SSE2)
+    const __m128i v1 = _mm_set1_epi8(b1);
+    const __m128i v2 = _mm_set1_epi8(b2);
+    auto block_mask = [&](size_t at) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + at + o1));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + at + o2));
+        return _mm_and_si128(_mm_cmpeq_epi8(a, v1), _mm_cmpeq_epi8(b, v2));
+    };
+    // 候補のない区間を速く読み飛ばすため 32 バイトずつ見る
+    for (; i + 32 <= end; i += 32) {
+        const __m128i lo = block_mask(i);
+        const __m128i hi = block_mask(i + 16);
+        if (_mm_movemask_epi8(_mm_or_si128(lo, hi)) == 0) continue;
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(lo)) |
+                    (static_cast<uint32_t>(_mm_movemask_epi8(hi)) << 16);
+        while (mask != 0) {
+            const size_t candidate = i + static_cast<size_t>(std::countr_zero(mask));
+            if (check(candidate)) return candidate;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    // 残り（と SIMD のない環境）
+    for (; i < end; ++i) {
+        if (data[i + o1] == b1 && data[i + o2] == b2 && check(i)) return i;
+    }
+    return npos;
+}
+
+size_t SubstringSearcher::FindHorspool(std::string_view text, size_t from) const {
+    const char* data = text.data();
+    const size_t n = needle_.size();
+    const char last = needle_.back();
+    for (size_t i = from; i + n <= text.size();) {
+        const char c = data[i + n - 1];
+        if (c == last && std::memcmp(data + i, needle_.data(), n - 1) == 0) return i;
+        i += shift_[static_cast<unsigned char>(c)];
+    }
+    return npos;
+}
+
+size_t SubstringSearcher::CountNewlines(std::string_view text) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t count = 0;
+    size_t i = 0;
+#if defined(SHINO_SEARCH_SSE2)
+    // 一致したバイトは cmpeq で -1 になるので、引き算でバイトごとに数えておき、
+    // あふれる前（255 回ごと）に psadbw で合計する
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= size) {
+        __m128i counts = zero;
+        const size_t blocks = std::min<size_t>(255, (size - i) / 16);
+        for (size_t b = 0; b < blocks; ++b, i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(v, nl));
+        }
+        const __m128i sums = _mm_sad_epu8(counts, zero);
+        count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+                 static_cast<size_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+    }
+#endif
+    for (; i < size; ++i) count += data[i] == '\n';
+    return count;
+}
+
+void SubstringSearcher::FindInLine(std::string_view line, int line_number, std::vector<SearchMatch>& out) const {
+    if (needle_.empty()) return;
+    for (size_t pos = Find(line); pos != npos; pos = Find(line, pos + needle_.size())) {
+        out.push_back({line_number, pos, needle_.size()});
+    }
+}
+
+void SubstringSearcher::FindInLines(const std::vector<std::string>& lines, std::vector<SearchMatch>& out) const {
+    for (size_t i = 0; i < lines.size(); ++i) {
+        // パターンより短い行は調べるまでもない
+        const std::string& line = lines[i];
+        if (line.size() < needle_.size()) continue;
+        FindInLine(line, static_cast<int>(i), out);
+    }
+}
+
+void SubstringSearcher::FindInText(std::string_view text, std::vector<SearchMatch>& out, int first_line) const {
+    if (needle_.empty()) return;
+    const char* data = text.data();
+    int line = first_line;
+    size_t line_start = 0;
+    size_t counted = 0; // [0, counted) の改行は数え済み
+    for (size_t pos = Find(text); pos != npos; pos = Find(text, pos + needle_.size())) {
+        // 前の一致からこの一致までの改行をまとめて数え、行頭は一致から後ろ向きに探す
+        const size_t newlines = CountNewlines(text.substr(counted, pos - counted));
+        if (newlines > 0) {
+            line += static_cast<int>(newlines);
+            size_t p = pos;
+            while (data[p - 1] != '\n') --p;
+            line_start = p;
+        }
+        counted = pos;
+        out.push_back({line, pos - line_start, needle_.size()});
+    }
+}
+
+}
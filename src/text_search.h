@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 検索の一致箇所（実行行、行頭からのバイトオフセット、バイト長）
+struct SearchMatch {
+    int line = 0;
+    size_t offset = 0;
+    size_t length = 0;
+
+    bool operator==(const SearchMatch& other) const {
+        return line == other.line && offset == other.offset && length == other.length;
+    }
+    bool operator<(const SearchMatch& other) const {
+        return line != other.line ? line < other.line : offset < other.offset;
+    }
+};
+
+// 部分文字列の検索エンジン
+// パターンの中で出現頻度の低いバイトを選び、パターンに応じて方式を変える
+// - 十分に珍しいバイトがある: そのバイトを memchr で探してから確かめる
+// - 短いパターン: 珍しい 2 バイトの位置を 16/32 バイトずつまとめて比較し（SSE2/AVX2）、
+//   両方が一致した候補だけを memcmp で確かめる
+// - 長いパターン: Horspool（末尾バイトによるずらし表）
+// 一致は重ならないように左から取る
+class SubstringSearcher {
+public:
+    // これ以上の長さで珍しいバイトのないパターンは Horspool で探す
+    static constexpr size_t kHorspoolThreshold = 64;
+
+    explicit SubstringSearcher(std::string needle);
+
+    const std::string& Needle() const { return needle_; }
+    bool Empty() const { return needle_.empty(); }
+
+    // from 以降で最初の一致位置（なければ npos）
+    size_t Find(std::string_view text, size_t from = 0) const;
+
+    // 1 行の中の一致を out に追加
+    void FindInLine(std::string_view line, int line_number, std::vector<SearchMatch>& out) const;
+    // 行の配列（App::lines_）全体
+    void FindInLines(const std::vector<std::string>& lines, std::vector<SearchMatch>& out) const;
+    // 改行区切りの連続したバイト列（mmap したファイルなど）。行番号は first_line から数える
+    void FindInText(std::string_view text, std::vector<SearchMatch>& out, int first_line = 0) const;
+
+    // text に含まれる '\n' の数
+    static size_t CountNewlines(std::string_view text);
+
+private:
+    enum class Method { MEMCHR, RARE_BYTE, BYTE_PAIR, HORSPOOL };
+
+    size_t FindRareByte(std::string_view text, size_t from) const;
+    size_t FindBytePair(std::string_view text, size_t from) const;
+    size_t FindHorspool(std::string_view text, size_t from) const;
+
+    std::string needle_;
+    Method method_ = Method::MEMCHR;
+    size_t rare1_ = 0; // 最も出にくいバイトの位置
+    size_t rare2_ = 0; // 次に出にくいバイトの位置（rare1_ とは別）
+    std::array<uint32_t, 256> shift_{}; // Horspool のずらし量（HORSPOOL のみ）
+};
+
+}
@@ -0,0 +1,101 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace ShinoEditor {
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = DefaultThreadCount();
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+size_t ThreadPool::DefaultThreadCount() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            // 停止時も積まれたタスクは最後まで実行する
+            if (tasks_.empty()) return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+
+    struct State {
+        std::atomic<size_t> next{0};
+        size_t count = 0;
+        const std::function<void(size_t)>* fn = nullptr;
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t running_helpers = 0;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->count = count;
+    state->fn = &fn;
+
+    // インデックスを 1 つずつ取り合う（ブロックの大きさがばらばらでも偏らない）
+    auto drain = [](State& s) {
+        size_t i;
+        while ((i = s.next.fetch_add(1, std::memory_order_relaxed)) < s.count) {
+            try {
+                (*s.fn)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (!s.error) s.error = std::current_exception();
+                s.next = s.count;
+            }
+        }
+    };
+
+    const size_t helpers = std::min(workers_.size(), count - 1);
+    state->running_helpers = helpers;
+    for (size_t h = 0; h < helpers; ++h) {
+        Submit([state, drain] {
+            drain(*state);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->running_helpers == 0) state->done.notify_all();
+        });
+    }
+
+    drain(*state);
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&] { return state->running_helpers == 0; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 固定サイズのスレッドプール
+// タスクの中から同じプールの ParallelFor を呼ぶと、空きスレッドがないときに待ち合わせで詰まるので避けること
+class ThreadPool {
+public:
+    // threads が 0 ならハードウェアスレッド数
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t Size() const { return workers_.size(); }
+
+    void Submit(std::function<void()> task);
+
+    // fn(i) を i = [0, count) について並列に実行し、すべて終わるまで待つ
+    // 呼び出しスレッドも処理に加わる。fn が投げた例外は最初の 1 つを呼び出し側で再送出する
+    void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    static size_t DefaultThreadCount();
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+
+    void WorkerLoop();
+};
+
+}
@@ -0,0 +1,285 @@
+#include "trigram_index.h"
+#include <algorithm>
+#include <numeric>
+
+namespace ShinoEditor {
+
+namespace {
+constexpr size_t kInitialSlots = 1 << 16;
+// 使わない ID がこれ（と行数の半分）を超えたら作り直す
+constexpr size_t kDeadIdsBeforeRebuild = 4096;
+// 候補のブロックがこの数と、全体のこの割合（1/n）の両方を超えたら索引を使わない
+constexpr size_t kMinCandidateBlocks = 64;
+constexpr size_t kMaxCandidateBlocksDivisor = 8;
+
+size_t SlotOf(uint32_t key, size_t mask) {
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+}
+
+TrigramIndex::TrigramIndex(const std::vector<std::string>& lines, size_t memory_limit)
+    : lines_(lines), memory_limit_(memory_limit) {}
+
+void TrigramIndex::Build() {
+    Clear();
+    state_ = State::BUILDING;
+    slots_.assign(kInitialSlots, Slot{});
+    ids_.resize(lines_.size());
+    std::iota(ids_.begin(), ids_.end(), 0u);
+    line_of_id_ = ids_;
+}
+
+void TrigramIndex::Clear() {
+    // 容量ごと返す
+    std::vector<Slot>().swap(slots_);
+    std::vector<Posting>().swap(postings_);
+    std::vector<uint32_t>().swap(ids_);
+    std::vector<uint32_t>().swap(line_of_id_);
+    std::vector<uint32_t>().swap(blocks_);
+    std::vector<uint32_t>().swap(decoded_);
+    posting_bytes_ = 0;
+    line_map_dirty_ = false;
+    dead_ids_ = 0;
+    next_id_ = 0;
+    state_ = State::EMPTY;
+}
+
+bool TrigramIndex::Step(size_t budget_bytes) {
+    if (state_ != State::BUILDING) return true;
+    IndexPending(budget_bytes);
+    CheckLimits();
+    if (state_ == State::BUILDING && next_id_ >= line_of_id_.size()) state_ = State::READY;
+    return state_ != State::BUILDING;
+}
+
+void TrigramIndex::UpdateLine(int real_line) {
+    if (state_ != State::BUILDING && state_ != State::READY) return;
+    if (real_line < 0 || real_line >= static_cast<int>(ids_.size())) return;
+    const size_t line = static_cast<size_t>(real_line);
+    line_of_id_[ids_[line]] = kNoLine;
+    ++dead_ids_;
+    const uint32_t id = NewId(line);
+    ids_[line] = id;
+    if (state_ == State::READY) {
+        // 作り終わっていれば、未索引の ID はいま振ったものだけ
+        IndexLine(id, lines_[line]);
+        next_id_ = id + 1;
+    }
+    CheckLimits();
+}
+
+void TrigramIndex::InsertLines(int pos, int count) {
+    if (state_ != State::BUILDING && state_ != State::READY) return;
+    if (count <= 0) return;
+    const size_t begin = static_cast<size_t>(std::clamp(pos, 0, static_cast<int>(ids_.size())));
+    if (begin < ids_.size()) line_map_dirty_ = true; // 後ろの行がずれる
+    ids_.insert(ids_.begin() + static_cast<std::ptrdiff_t>(begin), static_cast<size_t>(count), 0);
+    for (size_t line = begin; line < begin + static_cast<size_t>(count); ++line) {
+        const uint32_t id = NewId(line);
+        ids_[line] = id;
+        if (state_ == State::READY && line < lines_.size()) {
+            IndexLine(id, lines_[line]);
+            next_id_ = id + 1;
+        }
+    }
+    CheckLimits();
+}
+
+void TrigramIndex::EraseLines(int pos, int count) {
+    if (state_ != State::BUILDING && state_ != State::READY) return;
+    const int size = static_cast<int>(ids_.size());
+    if (count <= 0 || pos < 0 || pos >= size) return;
+    const int end = std::min(size, pos + count);
+    for (int line = pos; line < end; ++line) line_of_id_[ids_[line]] = kNoLine;
+    dead_ids_ += static_cast<size_t>(end - pos);
+    if (end < size) line_map_dirty_ = true;
+    ids_.erase(ids_.begin() + pos, ids_.begin() + end);
+    CheckLimits();
+}
+
+double TrigramIndex::Progress() const {
+    switch (state_) {
+        case State::READY:
+            return 1.0;
+        case State::BUILDING:
+            return line_of_id_.empty() ? 1.0 : static_cast<double>(next_id_) / line_of_id_.size();
+        default:
+            return 0.0;
+    }
+}
+
+size_t TrigramIndex::MemoryUsage() const {
+    return posting_bytes_ + postings_.capacity() * sizeof(Posting) + slots_.capacity() * sizeof(Slot) +
+           (ids_.capacity() + line_of_id_.capacity() + blocks_.capacity() + decoded_.capacity()) * sizeof(uint32_t);
+}
+
+bool TrigramIndex::CandidateLines(std::string_view query, std::vector<size_t>& out) {
+    out.clear();
+    if (state_ != State::READY || query.size() < kMinQuery) return false;
+    if (line_map_dirty_) RebuildLineMap();
+
+    // クエリの trigram の転置リストを短い順に交わらせる（1 つでもなければ一致なし）
+    std::vector<const Posting*> lists;
+    uint32_t key = 0;
+    for (size_t i = 0; i < query.size(); ++i) {
+        key = (key << 8 | static_cast<unsigned char>(query[i])) & 0xFFFFFF;
+        if (i + 1 < kMinQuery) continue;
+        const Posting* posting = Find(key);
+        if (!posting) return true;
+        lists.push_back(posting);
+    }
+    std::sort(lists.begin(), lists.end(), [](const Posting* a, const Posting* b) {
+        return a->count != b->count ? a->count < b->count : a < b;
+    });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    Decode(*lists[0], blocks_);
+    for (size_t l = 1; l < lists.size() && !blocks_.empty(); ++l) {
+        Decode(*lists[l], decoded_);
+        size_t kept = 0;
+        size_t j = 0;
+        for (size_t i = 0; i < blocks_.size(); ++i) {
+            while (j < decoded_.size() && decoded_[j] < blocks_[i]) ++j;
+            if (j == decoded_.size()) break;
+            if (decoded_[j] == blocks_[i]) blocks_[kept++] = blocks_[i];
+        }
+        blocks_.resize(kept);
+    }
+
+    // 候補が多すぎるなら索引では絞れていない（走査のほうが速く、UI ループで少しずつ進められる）
+    const size_t total_blocks = (line_of_id_.size() + kLinesPerBlock - 1) / kLinesPerBlock;
+    if (blocks_.size() > kMinCandidateBlocks && blocks_.size() > total_blocks / kMaxCandidateBlocksDivisor) {
+        return false;
+    }
+
+    for (uint32_t block : blocks_) {
+        const size_t first = static_cast<size_t>(block) * kLinesPerBlock;
+        const size_t last = std::min(first + kLinesPerBlock, line_of_id_.size());
+        for (size_t id = first; id < last; ++id) {
+            const uint32_t line = line_of_id_[id];
+            if (line != kNoLine) out.push_back(line);
+        }
+    }
+    // 編集した行の ID は後ろに振られるので、ブロックの順と行の順は一致しない
+    std::sort(out.begin(), out.end());
+    return true;
+}
+
+TrigramIndex::Posting* TrigramIndex::Find(uint32_t key) {
+    const size_t mask = slots_.size() - 1;
+    for (size_t s = SlotOf(key, mask);; s = (s + 1) & mask) {
+        if (slots_[s].key == key) return &postings_[slots_[s].posting];
+        if (slots_[s].key == kNoKey) return nullptr;
+    }
+}
+
+TrigramIndex::Posting& TrigramIndex::FindOrAdd(uint32_t key) {
+    size_t mask = slots_.size() - 1;
+    size_t s = SlotOf(key, mask);
+    for (;; s = (s + 1) & mask) {
+        if (slots_[s].key == key) return postings_[slots_[s].posting];
+        if (slots_[s].key == kNoKey) break;
+    }
+    // 埋まりが半分を超えたら広げる
+    if ((postings_.size() + 1) * 2 > slots_.size()) {
+        Grow();
+        mask = slots_.size() - 1;
+        for (s = SlotOf(key, mask); slots_[s].key != kNoKey; s = (s + 1) & mask) {}
+    }
+    slots_[s] = {key, static_cast<uint32_t>(postings_.size())};
+    postings_.emplace_back();
+    return postings_.back();
+}
+
+void TrigramIndex::Grow() {
+    std::vector<Slot> old(slots_.size() * 2);
+    old.swap(slots_);
+    const size_t mask = slots_.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.key == kNoKey) continue;
+        size_t s = SlotOf(slot.key, mask);
+        while (slots_[s].key != kNoKey) s = (s + 1) & mask;
+        slots_[s] = slot;
+    }
+}
+
+void TrigramIndex::IndexLine(uint32_t id, std::string_view line) {
+    if (line.size() < kMinQuery) return;
+    const uint32_t block = id / kLinesPerBlock;
+    uint32_t key = static_cast<unsigned char>(line[0]) << 8 | static_cast<unsigned char>(line[1]);
+    for (size_t i = 2; i < line.size(); ++i) {
+        key = (key << 8 | static_cast<unsigned char>(line[i])) & 0xFFFFFF;
+        Posting& posting = FindOrAdd(key);
+        // 同じブロックの行で足してあれば要らない（ID は昇順に足すので、最後と比べるだけ）
+        if (posting.count > 0 && posting.last == block) continue;
+        uint32_t delta = posting.count > 0 ? block - posting.last : block;
+        const size_t capacity = posting.bytes.capacity();
+        while (delta >= 0x80) {
+            posting.bytes.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        posting.bytes.push_back(static_cast<uint8_t>(delta));
+        posting_bytes_ += posting.bytes.capacity() - capacity;
+        posting.last = block;
+        ++posting.count;
+    }
+}
+
+size_t TrigramIndex::IndexPending(size_t budget_bytes) {
+    if (line_map_dirty_) RebuildLineMap();
+    size_t scanned = 0;
+    while (next_id_ < line_of_id_.size() && scanned < budget_bytes) {
+        const uint32_t line = line_of_id_[next_id_];
+        if (line != kNoLine) {
+            IndexLine(next_id_, lines_[line]);
+            scanned += lines_[line].size();
+        }
+        // 空行や使わない ID も 1 バイトとして数える
+        ++scanned;
+        ++next_id_;
+    }
+    return scanned;
+}
+
+void TrigramIndex::RebuildLineMap() {
+    std::fill(line_of_id_.begin(), line_of_id_.end(), kNoLine);
+    for (size_t line = 0; line < ids_.size(); ++line) line_of_id_[ids_[line]] = static_cast<uint32_t>(line);
+    line_map_dirty_ = false;
+}
+
+uint32_t TrigramIndex::NewId(size_t line) {
+    line_of_id_.push_back(static_cast<uint32_t>(line));
+    return static_cast<uint32_t>(line_of_id_.size() - 1);
+}
+
+void TrigramIndex::CheckLimits() {
+    if (MemoryUsage() > memory_limit_) {
+        Clear();
+        state_ = State::DISABLED;
+        return;
+    }
+    // 使わない ID が増えると転置リストと ID -> 行の対応が無駄に大きくなるので作り直す
+    if (dead_ids_ > lines_.size() / 2 + kDeadIdsBeforeRebuild) Build();
+}
+
+void TrigramIndex::Decode(const Posting& posting, std::vector<uint32_t>& out) {
+    out.clear();
+    out.reserve(posting.count);
+    uint32_t value = 0;
+    const uint8_t* p = posting.bytes.data();
+    const uint8_t* end = p + posting.bytes.size();
+    while (p < end) {
+        uint32_t delta = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            byte = *p++;
+            delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        value += delta;
+        out.push_back(value);
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 検索用の trigram（連続する 3 バイト）索引
+// - 行ごとに番号（ID）を振り、trigram ごとに、それを含む行のブロック（ID を kLinesPerBlock 個ずつ
+//   まとめたもの）の番号を昇順に並べた転置リストを持つ。リストは差分を可変長で詰めて小さくする
+// - 3 バイト以上のクエリは、クエリの trigram の転置リストの共通部分のブロックの行だけが候補になる
+// - 構築は Step() ごとに一定量ずつ進めるので、呼び出し側は UI ループの合間に少しずつ進められる
+// - 編集は行単位で反映する。変更した行には新しい ID を振って索引に足し、古い ID は使わなくする
+//   （転置リストは末尾に足すだけで済む）。使わない ID が増えすぎたら作り直す
+// - 使用メモリが上限を超えたら索引を捨てて無効にする（呼び出し側は全体を走査する）
+class TrigramIndex {
+public:
+    static constexpr size_t kMinQuery = 3;
+    static constexpr size_t kLinesPerBlock = 64;
+    static constexpr size_t kDefaultMemoryLimit = 256 << 20;
+    // Step() 1 回で索引に足す量の目安
+    static constexpr size_t kDefaultStepBytes = 2 << 20;
+
+    enum class State {
+        EMPTY,    // 索引なし（Build() で構築を始める）
+        BUILDING, // 構築中
+        READY,    // 使える
+        DISABLED, // メモリの上限を超えたので無効
+    };
+
+    // App::lines_ を参照で保持
+    explicit TrigramIndex(const std::vector<std::string>& lines, size_t memory_limit = kDefaultMemoryLimit);
+
+    // いまの文書で構築を始める（作りかけや作り終わった索引は捨てる）
+    void Build();
+    // 索引を捨てる
+    void Clear();
+    // 構築を最大 budget_bytes 進める。構築中でなくなれば true
+    bool Step(size_t budget_bytes = kDefaultStepBytes);
+
+    // 編集通知（lines_ を書き換えたあと、実行行インデックス）。EMPTY/DISABLED なら何もしない
+    void UpdateLine(int real_line);
+    void InsertLines(int pos, int count);
+    void EraseLines(int pos, int count);
+
+    State GetState() const { return state_; }
+    bool Ready() const { return state_ == State::READY; }
+    // 構築の進み具合（0〜1）
+    double Progress() const;
+    // 使用メモリの見積もり（バイト）
+    size_t MemoryUsage() const;
+    size_t MemoryLimit() const { return memory_limit_; }
+
+    // query を含むかもしれない行（実行行インデックスの昇順）を out に入れる
+    // Ready() でないか、query が kMinQuery バイトより短いか、候補が文書の大部分になるなら
+    // 索引では絞り込めないので false
+    bool CandidateLines(std::string_view query, std::vector<size_t>& out);
+
+private:
+    static constexpr uint32_t kNoLine = UINT32_MAX;
+
+    // 転置リスト: ブロック番号の差分を LEB128 で並べたもの
+    struct Posting {
+        std::vector<uint8_t> bytes;
+        uint32_t last = 0; // 最後に足したブロック番号
+        uint32_t count = 0;
+    };
+
+    // trigram -> postings_ の添字（オープンアドレス法、空きは key が kNoKey）
+    static constexpr uint32_t kNoKey = UINT32_MAX;
+    struct Slot {
+        uint32_t key = kNoKey;
+        uint32_t posting = 0;
+    };
+
+    Posting* Find(uint32_t key);
+    Posting& FindOrAdd(uint32_t key);
+    void Grow();
+    // ID が id の行（line_of_id_[id] 行目）を索引に足す
+    void IndexLine(uint32_t id, std::string_view line);
+    // 未索引の ID を next_id_ から budget_bytes まで足す
+    size_t IndexPending(size_t budget_bytes);
+    // ID -> 行の対応を ids_ から作り直す（行の挿入/削除で行番号がずれたとき）
+    void RebuildLineMap();
+    // 新しい ID を line 行目に振る
+    uint32_t NewId(size_t line);
+    // 使わない ID が増えすぎたら作り直し、メモリが上限を超えたら無効にする
+    void CheckLimits();
+    static void Decode(const Posting& posting, std::vector<uint32_t>& out);
+
+    const std::vector<std::string>& lines_;
+    size_t memory_limit_;
+    State state_ = State::EMPTY;
+
+    std::vector<Slot> slots_;
+    std::vector<Posting> postings_;
+    size_t posting_bytes_ = 0; // 転置リストの容量の合計
+
+    // 行 -> ID、ID -> 行（使わない ID は kNoLine）
+    std::vector<uint32_t> ids_;
+    std::vector<uint32_t> line_of_id_;
+    bool line_map_dirty_ = false;
+    size_t dead_ids_ = 0;
+    // これより小さい ID は索引に入っている
+    uint32_t next_id_ = 0;
+
+    // 検索の作業領域
+    std::vector<uint32_t> blocks_;
+    std::vector<uint32_t> decoded_;
+};
+
+}
@@ -3,7 +3,7 @@
 namespace ShinoEditor {
 
 std::string TUIBindings::GetHelpLine() {
-    return "^O 保存  ^X 終了  ^W 検索  ^G ヘルプ  ^J フォールド  ^P プレビュー  ^I ImportDOCX  ^E ExportDOCX";
+    return "^O 保存  ^X 終了  ^W 検索  ^N/^R 次/前の一致  ^G ヘルプ  ^J フォールド  ^P プレビュー  ^I ImportDOCX  ^E ExportDOCX  ^L 折り返し  ^T プレビュー方式  ^K ExportHTML";
 }
 
 std::vector<KeyBinding> TUIBindings::GetAllBindings() {
@@ -11,18 +11,31 @@ std::vector<KeyBinding> TUIBindings::GetAllBindings() {
         {"Ctrl+O", "ファイルを保存 (Write Out)"},
         {"Ctrl+X", "エディタを終了"},
         {"Ctrl+W", "テキストを検索"},
+        {"Ctrl+R (検索中)", "正規表現モードを切り替え（Enter で検索）"},
+        {"Ctrl+F (検索中)", "大文字小文字・全角半角（さらにカタカナ/ひらがな）を区別しない検索を切り替え"},
+        {"Tab (検索中)", "検索文字列と置換後の文字列の入力を切り替え（置換後の入力中は Enter で現在の一致を置換）"},
+        {"Ctrl+A (検索中)", "すべての一致を置換"},
+        {"Ctrl+U", "直前の置換を元に戻す"},
+        {"Ctrl+D (検索中)", "開いているファイルのディレクトリ以下を検索（結果の一覧で Enter で開く）"},
+        {"Ctrl+D", "最後のディレクトリ検索の結果を表示"},
+        {"Ctrl+N / Ctrl+R", "次/前の一致へ移動（折り返しオフ時は一致箇所まで横スクロール）"},
         {"Ctrl+G", "ヘルプを表示/非表示"},
         {"Ctrl+J", "現在のブロックを折り畳み/展開"},
         {"Page Up/Down", "現在のブロックを上下に移動"},
         {"Ctrl+P", "プレビュー表示を切り替え"},
-        {"Ctrl+I", "DOCX ファイルをインポート (pandoc必須)"},
-        {"Ctrl+E", "DOCX ファイルにエクスポート (pandoc必須)"},
+        {"Ctrl+I", "DOCX ファイルをインポート (画像や脚注などは pandoc で)"},
+        {"Ctrl+E", "DOCX ファイルにエクスポート (画像や表を組み込みで書けないときは pandoc で。プロンプトで ^P を押すと常に pandoc)"},
+        {"Ctrl+L", "折り返し表示を切り替え"},
+        {"Ctrl+T", "プレビュー方式を切り替え（ネイティブ/HTML）"},
+        {"Ctrl+K", "HTML ファイルにエクスポート"},
+        {"←/→", "折り返しオフ時: 横スクロール (Home/End で行頭/行末)"},
         {"↑/↓", "カーソルを上下に移動"},
         {"Enter", "新しい行を挿入"},
         {"Delete/Backspace", "現在の行を削除"},
         {"文字キー", "編集モードに入る"},
         {"Enter (編集中)", "編集を保存"},
-        {"Esc (編集中)", "編集をキャンセル"}
+        {"Esc (編集中)", "編集をキャンセル"},
+        {"Esc (DOCX 変換中)", "DOCX のインポート/エクスポートを中止"}
     };
 }
 
@@ -20,6 +20,15 @@ public:
     static constexpr int CTRL_P = 16;  // Preview toggle
     static constexpr int CTRL_I = 9;   // Import DOCX
     static constexpr int CTRL_E = 5;   // Export DOCX
+    static constexpr int CTRL_L = 12;  // Soft wrap toggle
+    static constexpr int CTRL_T = 20;  // Preview mode toggle (native/HTML)
+    static constexpr int CTRL_K = 11;  // Export HTML
+    static constexpr int CTRL_N = 14;  // Next search match
+    static constexpr int CTRL_R = 18;  // Previous search match
+    static constexpr int CTRL_F = 6;   // Search folding (in search prompt)
+    static constexpr int CTRL_A = 1;   // Replace all (in search prompt)
+    static constexpr int CTRL_U = 21;  // Undo replace
+    static constexpr int CTRL_D = 4;   // Directory search (in search prompt) / show its results
     
     // Get help line text
     static std::string GetHelpLine();
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace ShinoEditor {
+namespace utf8 {
+
+// 先頭バイトからシーケンス長を求める（不正な先頭バイトは1として扱う）
+inline size_t SequenceLength(unsigned char lead) {
+    if (lead < 0x80) return 1;
+    if ((lead & 0xE0) == 0xC0) return 2;
+    if ((lead & 0xF0) == 0xE0) return 3;
+    if ((lead & 0xF8) == 0xF0) return 4;
+    return 1;
+}
+
+// pos から1コードポイントをデコードして pos を進める
+// 不正なシーケンスは U+FFFD として1バイトだけ進める
+inline char32_t Decode(std::string_view s, size_t& pos) {
+    const auto lead = static_cast<unsigned char>(s[pos]);
+    const size_t len = SequenceLength(lead);
+    if (len == 1) {
+        ++pos;
+        return lead < 0x80 ? static_cast<char32_t>(lead) : U'\uFFFD';
+    }
+    if (pos + len > s.size()) {
+        ++pos;
+        return U'\uFFFD';
+    }
+    char32_t cp = lead & (0x3F >> (len - 1));
+    for (size_t i = 1; i < len; ++i) {
+        const auto c = static_cast<unsigned char>(s[pos + i]);
+        if ((c & 0xC0) != 0x80) {
+            ++pos;
+            return U'\uFFFD';
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    pos += len;
+    return cp;
+}
+
+// pos の直前のコードポイント先頭位置を返す
+inline size_t PrevBoundary(std::string_view s, size_t pos) {
+    if (pos == 0) return 0;
+    size_t i = pos - 1;
+    while (i > 0 && (static_cast<unsigned char>(s[i]) & 0xC0) == 0x80 && pos - i < 4) {
+        --i;
+    }
+    return i;
+}
+
+// コードポイントを UTF-8 で追記
+inline void Append(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+// 端末上の表示桁数（East Asian Width の W/F を2桁、結合文字・制御文字を0桁）
+inline int CodepointWidth(char32_t cp) {
+    if (cp < 0x20 || cp == 0x7F) return 0;
+    if (cp < 0x300) return 1;
+    if ((cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x200B && cp <= 0x200F) ||
+        (cp >= 0x20D0 && cp <= 0x20FF) || (cp >= 0xFE00 && cp <= 0xFE0F) ||
+        cp == 0x3099 || cp == 0x309A) {
+        return 0;
+    }
+    if ((cp >= 0x1100 && cp <= 0x115F) || cp == 0x2329 || cp == 0x232A ||
+        (cp >= 0x2E80 && cp <= 0x303E) || (cp >= 0x3041 && cp <= 0x33FF) ||
+        (cp >= 0x3400 && cp <= 0x4DBF) || (cp >= 0x4E00 && cp <= 0x9FFF) ||
+        (cp >= 0xA000 && cp <= 0xA4CF) || (cp >= 0xAC00 && cp <= 0xD7A3) ||
+        (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE10 && cp <= 0xFE19) ||
+        (cp >= 0xFE30 && cp <= 0xFE6F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+        (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1F64F) ||
+        (cp >= 0x1F900 && cp <= 0x1F9FF) || (cp >= 0x20000 && cp <= 0x3FFFD)) {
+        return 2;
+    }
+    return 1;
+}
+
+// 文字列全体の表示桁数
+inline int DisplayWidth(std::string_view s) {
+    int width = 0;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        width += CodepointWidth(Decode(s, pos));
+    }
+    return width;
+}
+
+} // namespace utf8
+} // namespace ShinoEditor
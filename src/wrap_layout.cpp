@@ -0,0 +1,232 @@
+#include "wrap_layout.h"
+#include "utf8_util.h"
+#include <algorithm>
+
+namespace ShinoEditor {
+
+namespace {
+// 行頭禁則（JIS X 4051 の行頭禁則文字の主要なもの）
+constexpr std::u32string_view kLineStartProhibited =
+    U"、。，．,.・：；:;？！?!‼⁇⁈⁉ー‐゠–〜～ヽヾゝゞ々〻゛゜"
+    U"」』）)］]｝}〕〉》】〙〗〟’”｠»"
+    U"ぁぃぅぇぉっゃゅょゎゕゖァィゥェォッャュョヮヵヶ";
+// 行末禁則
+constexpr std::u32string_view kLineEndProhibited = U"「『（(［[｛{〔〈《【〘〖〝‘“｟«";
+
+// 禁則処理で改行位置を前へずらす最大文字数（それ以上は強制改行）
+constexpr int kMaxKinsokuShift = 4;
+
+// brk で改行したときに禁則に触れるなら、行頭側へずらした位置を返す
+size_t AdjustBreak(std::string_view text, size_t row_start, size_t brk) {
+    size_t b = brk;
+    for (int shift = 0; shift <= kMaxKinsokuShift; ++shift) {
+        size_t p = b;
+        const char32_t next = utf8::Decode(text, p);
+        const size_t prev_start = utf8::PrevBoundary(text, b);
+        size_t q = prev_start;
+        const char32_t prev = utf8::Decode(text, q);
+
+        const bool bad = WrapLayout::IsLineStartProhibited(next) ||
+                         utf8::CodepointWidth(next) == 0 ||
+                         WrapLayout::IsLineEndProhibited(prev);
+        if (!bad) return b;
+        // 段が空になるならずらせないので強制改行
+        if (prev_start <= row_start) return brk;
+        b = prev_start;
+    }
+    return brk;
+}
+}
+
+WrapLayout::WrapLayout(const std::vector<std::string>& lines)
+    : lines_(lines), cache_(lines.size()) {}
+
+void WrapLayout::SetWidth(int width) {
+    if (width == width_) return;
+    width_ = width;
+    // 各行の結果は幅の不一致で遅延再計算される。段数は桁数キャッシュから見積もり直す
+    if (indices_) RebuildTree();
+}
+
+void WrapLayout::SetVisibleLines(const std::vector<int>& indices,
+                                 const std::vector<std::string>& texts) {
+    indices_ = &indices;
+    texts_ = &texts;
+    if (cache_.size() != lines_.size()) {
+        cache_.resize(lines_.size());
+    }
+    RebuildTree();
+}
+
+void WrapLayout::InvalidateLine(int real_line) {
+    if (real_line >= 0 && real_line < static_cast<int>(cache_.size())) {
+        cache_[real_line] = LineLayout{};
+    }
+}
+
+void WrapLayout::InsertLines(int pos, int count) {
+    if (count <= 0) return;
+    pos = std::clamp(pos, 0, static_cast<int>(cache_.size()));
+    cache_.insert(cache_.begin() + pos, count, LineLayout{});
+}
+
+void WrapLayout::EraseLines(int pos, int count) {
+    const int size = static_cast<int>(cache_.size());
+    if (count <= 0 || pos < 0 || pos >= size) return;
+    const int end = std::min(size, pos + count);
+    cache_.erase(cache_.begin() + pos, cache_.begin() + end);
+}
+
+void WrapLayout::InvalidateAll() {
+    cache_.assign(lines_.size(), LineLayout{});
+}
+
+const std::vector<size_t>& WrapLayout::GetRowStarts(int visible_index) {
+    static const std::vector<size_t> kSingleRow{0};
+    if (!indices_ || visible_index < 0 || visible_index >= static_cast<int>(indices_->size())) {
+        return kSingleRow;
+    }
+    const int real = (*indices_)[visible_index];
+    if (real < 0 || real >= static_cast<int>(cache_.size())) {
+        return kSingleRow;
+    }
+    LineLayout& entry = cache_[real];
+    const bool placeholder = IsPlaceholder(visible_index);
+    if (entry.width != width_ || entry.placeholder != placeholder || entry.row_starts.empty()) {
+        entry.row_starts = ComputeRowStarts((*texts_)[visible_index], width_);
+        entry.width = width_;
+        entry.placeholder = placeholder;
+        // 見積もりとの差分だけ Fenwick 木を更新
+        const int rows = static_cast<int>(entry.row_starts.size());
+        if (rows != row_counts_[visible_index]) {
+            AddRows(visible_index, rows - row_counts_[visible_index]);
+        }
+    }
+    return entry.row_starts;
+}
+
+int WrapLayout::FirstRowOf(int visible_index) const {
+    int i = std::clamp(visible_index, 0, static_cast<int>(row_counts_.size()));
+    int sum = 0;
+    while (i > 0) {
+        sum += tree_[i];
+        i -= i & -i;
+    }
+    return sum;
+}
+
+int WrapLayout::RowToVisible(int row, int* sub_row) const {
+    const int n = static_cast<int>(row_counts_.size());
+    if (n == 0) {
+        if (sub_row) *sub_row = 0;
+        return -1;
+    }
+    int rem = std::clamp(row, 0, std::max(0, total_rows_ - 1));
+    int pos = 0;
+    int step = 1;
+    while (step * 2 <= n) step *= 2;
+    for (; step > 0; step /= 2) {
+        if (pos + step <= n && tree_[pos + step] <= rem) {
+            pos += step;
+            rem -= tree_[pos];
+        }
+    }
+    if (sub_row) *sub_row = rem;
+    return std::min(pos, n - 1);
+}
+
+int WrapLayout::TotalRows() const {
+    return total_rows_;
+}
+
+std::vector<size_t> WrapLayout::ComputeRowStarts(std::string_view text, int width) {
+    std::vector<size_t> starts{0};
+    // UTF-8 では表示桁数 <= バイト数なので、短い行は走査不要
+    if (width <= 0 || text.size() <= static_cast<size_t>(width)) {
+        return starts;
+    }
+
+    size_t row_start = 0;
+    size_t pos = 0;
+    int col = 0;
+    while (pos < text.size()) {
+        const size_t cp_start = pos;
+        const int w = utf8::CodepointWidth(utf8::Decode(text, pos));
+        if (col + w <= width || cp_start == row_start) {
+            col += w;
+            continue;
+        }
+        const size_t brk = AdjustBreak(text, row_start, cp_start);
+        starts.push_back(brk);
+        row_start = brk;
+        pos = brk;
+        col = 0;
+    }
+    return starts;
+}
+
+bool WrapLayout::IsLineStartProhibited(char32_t cp) {
+    return kLineStartProhibited.find(cp) != std::u32string_view::npos;
+}
+
+bool WrapLayout::IsLineEndProhibited(char32_t cp) {
+    return kLineEndProhibited.find(cp) != std::u32string_view::npos;
+}
+
+bool WrapLayout::IsPlaceholder(int visible_index) const {
+    // 折り畳みだけが行を隠すので、次の可視行との間に飛びがあれば折り畳み表示
+    const auto& idx = *indices_;
+    const int next = visible_index + 1 < static_cast<int>(idx.size())
+        ? idx[visible_index + 1]
+        : static_cast<int>(lines_.size());
+    return next - idx[visible_index] > 1;
+}
+
+int WrapLayout::EstimateRows(int visible_index) {
+    if (width_ <= 0) return 1;
+    const int real = (*indices_)[visible_index];
+    const std::string& text = (*texts_)[visible_index];
+    if (real < 0 || real >= static_cast<int>(cache_.size())) return 1;
+
+    LineLayout& entry = cache_[real];
+    const bool placeholder = IsPlaceholder(visible_index);
+    if (entry.width == width_ && entry.placeholder == placeholder && !entry.row_starts.empty()) {
+        return static_cast<int>(entry.row_starts.size());
+    }
+    if (text.size() <= static_cast<size_t>(width_)) return 1;
+
+    int cols = 0;
+    if (placeholder) {
+        cols = utf8::DisplayWidth(text);
+    } else {
+        if (entry.cols < 0) entry.cols = utf8::DisplayWidth(text);
+        cols = entry.cols;
+    }
+    // 禁則による段の増加は描画時に確定させる
+    return std::max(1, (cols + width_ - 1) / width_);
+}
+
+void WrapLayout::RebuildTree() {
+    const int n = indices_ ? static_cast<int>(indices_->size()) : 0;
+    row_counts_.assign(n, 1);
+    tree_.assign(n + 1, 0);
+    total_rows_ = 0;
+    for (int v = 0; v < n; ++v) {
+        row_counts_[v] = EstimateRows(v);
+        total_rows_ += row_counts_[v];
+        tree_[v + 1] += row_counts_[v];
+        // O(n) 構築: 親ノードへ部分和を伝播
+        const int parent = (v + 1) + ((v + 1) & -(v + 1));
+        if (parent <= n) tree_[parent] += tree_[v + 1];
+    }
+}
+
+void WrapLayout::AddRows(int visible_index, int delta) {
+    row_counts_[visible_index] += delta;
+    total_rows_ += delta;
+    for (int i = visible_index + 1; i < static_cast<int>(tree_.size()); i += i & -i) {
+        tree_[i] += delta;
+    }
+}
+
+}
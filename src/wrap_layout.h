@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// ソフトラップのレイアウトエンジン
+// - 行ごとの折り返し位置（各表示段の開始バイト）を禁則処理付きで計算
+// - 結果は実行行ごとに幅と一緒にキャッシュし、リサイズ時は遅延で再計算
+// - 可視行ごとの段数を Fenwick 木で保持し、表示段 <-> 可視行の変換を O(log n) で行う
+class WrapLayout {
+public:
+    // App::lines_ を参照で保持（BlockModel と同じくコピーしない）
+    explicit WrapLayout(const std::vector<std::string>& lines);
+
+    // 折り返し幅（桁数）。0 以下なら折り返さない
+    void SetWidth(int width);
+    int GetWidth() const { return width_; }
+
+    // 可視行の設定。indices/texts は BlockModel の可視ビューを指し、次の再構築まで有効であること
+    void SetVisibleLines(const std::vector<int>& indices, const std::vector<std::string>& texts);
+
+    // 編集通知（実行行インデックス）
+    void InvalidateLine(int real_line);
+    void InsertLines(int pos, int count);
+    void EraseLines(int pos, int count);
+    void InvalidateAll();
+
+    // 可視行の各表示段の開始バイトオフセット（先頭は常に 0）
+    const std::vector<size_t>& GetRowStarts(int visible_index);
+
+    // 可視行の先頭が何段目か
+    int FirstRowOf(int visible_index) const;
+    // 表示段 -> 可視行（sub_row には行内の段番号を返す）
+    int RowToVisible(int row, int* sub_row = nullptr) const;
+    int TotalRows() const;
+
+    // 折り返し計算の本体（キャッシュなし）
+    static std::vector<size_t> ComputeRowStarts(std::string_view text, int width);
+
+    // 禁則文字
+    static bool IsLineStartProhibited(char32_t cp);
+    static bool IsLineEndProhibited(char32_t cp);
+
+private:
+    struct LineLayout {
+        int cols = -1;               // 行全体の表示桁数（幅に依存しない、-1 は未計算）
+        int width = 0;               // row_starts を計算したときの幅（0 は未計算）
+        bool placeholder = false;    // 折り畳み表示（"[...]"）に対する結果か
+        std::vector<size_t> row_starts;
+    };
+
+    const std::vector<std::string>& lines_;
+    std::vector<LineLayout> cache_;
+    const std::vector<int>* indices_ = nullptr;
+    const std::vector<std::string>* texts_ = nullptr;
+    int width_ = 0;
+
+    // 可視行ごとの段数と、その Fenwick 木
+    std::vector<int> row_counts_;
+    std::vector<int> tree_;
+    int total_rows_ = 0;
+
+    bool IsPlaceholder(int visible_index) const;
+    int EstimateRows(int visible_index);
+    void RebuildTree();
+    void AddRows(int visible_index, int delta);
+};
+
+}
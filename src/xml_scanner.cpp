@@ -0,0 +1,274 @@
+#include "xml_scanner.h"
+#include "utf8_util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace ShinoEditor {
+
+namespace {
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool StartsWith(std::string_view text, size_t pos, std::string_view prefix) {
+    return text.size() - pos >= prefix.size() && text.compare(pos, prefix.size(), prefix) == 0;
+}
+
+// 参照（"&" から ";" まで）の長さの上限
+constexpr size_t kMaxReferenceBytes = 14;
+
+// 参照の名前（& と ; の間）を復号して out に足す。知らなければ false
+bool AppendReference(std::string_view name, std::string& out) {
+    if (name == "lt") {
+        out += '<';
+    } else if (name == "gt") {
+        out += '>';
+    } else if (name == "amp") {
+        out += '&';
+    } else if (name == "quot") {
+        out += '"';
+    } else if (name == "apos") {
+        out += '\'';
+    } else if (name.size() >= 2 && name[0] == '#') {
+        const bool hex = name[1] == 'x' || name[1] == 'X';
+        const std::string digits(name.substr(hex ? 2 : 1));
+        if (digits.empty()) return false;
+        char* end = nullptr;
+        const unsigned long cp = std::strtoul(digits.c_str(), &end, hex ? 16 : 10);
+        if (*end != '\0' || cp == 0 || cp > 0x10FFFF) return false;
+        utf8::Append(out, static_cast<char32_t>(cp));
+    } else {
+        return false;
+    }
+    return true;
+}
+}
+
+std::string_view XmlAttributes::Get(std::string_view name) const {
+    for (const auto& item : items_) {
+        if (item.name == name) return item.value;
+    }
+    return {};
+}
+
+bool XmlAttributes::Has(std::string_view name) const {
+    for (const auto& item : items_) {
+        if (item.name == name) return true;
+    }
+    return false;
+}
+
+void XmlScanner::AppendDecoded(std::string_view text, std::string& out) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t amp = text.find('&', pos);
+        if (amp == std::string_view::npos) break;
+        out.append(text.substr(pos, amp - pos));
+        const size_t semicolon = text.find(';', amp);
+        if (semicolon != std::string_view::npos && semicolon - amp < kMaxReferenceBytes &&
+            AppendReference(text.substr(amp + 1, semicolon - amp - 1), out)) {
+            pos = semicolon + 1;
+        } else {
+            out += '&';
+            pos = amp + 1;
+        }
+    }
+    out.append(text.substr(pos));
+}
+
+bool XmlScanner::Feed(std::string_view chunk) {
+    if (failed_) return false;
+    // 持ち越した残りには、次の '>' までを繋げて読む（残りが片付けば、あとは断片をそのまま走査する）
+    // 残りの先頭のタグなどは前回調べたところから続けるので、'>' が何度来ても読み直さない
+    while (!pending_.empty() && !chunk.empty()) {
+        const size_t gt = chunk.find('>');
+        const size_t take = gt == std::string_view::npos ? chunk.size() : gt + 1;
+        pending_.append(chunk.substr(0, take));
+        chunk.remove_prefix(take);
+        const size_t used = Scan(pending_, false, resume_);
+        if (failed_) return false;
+        pending_.erase(0, used);
+        if (pending_.size() > kMaxPendingBytes) {
+            failed_ = true;
+            return false;
+        }
+    }
+    if (pending_.empty() && !chunk.empty()) {
+        const size_t used = Scan(chunk, false);
+        if (failed_) return false;
+        pending_.assign(chunk.substr(used));
+    }
+    return true;
+}
+
+bool XmlScanner::Finish() {
+    if (failed_) return false;
+    if (!pending_.empty()) {
+        const size_t used = Scan(pending_, true, resume_);
+        if (failed_ || used != pending_.size()) return false;
+        pending_.clear();
+    }
+    return true;
+}
+
+size_t XmlScanner::Scan(std::string_view text, bool last, size_t resume) {
+    const size_t n = text.size();
+    size_t i = 0;
+    const char quote_at_resume = resume_quote_;
+    resume_ = 0;
+    resume_quote_ = 0;
+    // 終わりの印を探し始める位置（前回調べた分は飛ばす。印が境目をまたぐ分だけ戻る）
+    auto search_from = [&](size_t start, size_t marker) {
+        return i == 0 && resume >= marker ? std::max(start, resume - (marker - 1)) : start;
+    };
+    // 終わっていないので残りとして持ち越す（ここまで調べた）
+    auto hold = [&](char quote) {
+        resume_ = n - i;
+        resume_quote_ = quote;
+    };
+    while (i < n) {
+        if (text[i] != '<') {
+            const void* lt = std::memchr(text.data() + i, '<', n - i);
+            size_t end = lt ? static_cast<size_t>(static_cast<const char*>(lt) - text.data()) : n;
+            if (!lt && !last) {
+                // 断片の終わりで切れた参照は、続きと繋げてから復号する（参照になりうる短いものだけ）
+                const size_t amp = text.rfind('&');
+                if (amp != std::string_view::npos && amp >= i && n - amp <= kMaxReferenceBytes &&
+                    text.find(';', amp) == std::string_view::npos) {
+                    end = amp;
+                }
+            }
+            if (end > i) EmitText(text.substr(i, end - i));
+            i = end;
+            if (!lt) break;
+            continue;
+        }
+
+        // "<!--" "<![CDATA[" を見分けられるだけの長さがなければ続きを待つ
+        if (!last && n - i < 9 && (i + 1 == n || text[i + 1] == '!')) break;
+        if (StartsWith(text, i, "<!--")) {
+            const size_t close = text.find("-->", search_from(i + 4, 3));
+            if (close == std::string_view::npos) {
+                hold(0);
+                break;
+            }
+            i = close + 3;
+        } else if (StartsWith(text, i, "<![CDATA[")) {
+            const size_t close = text.find("]]>", search_from(i + 9, 3));
+            if (close == std::string_view::npos) {
+                hold(0);
+                break;
+            }
+            if (close > i + 9) handler_.Text(text.substr(i + 9, close - i - 9));
+            i = close + 3;
+        } else if (StartsWith(text, i, "<?")) {
+            const size_t close = text.find("?>", search_from(i + 2, 2));
+            if (close == std::string_view::npos) {
+                hold(0);
+                break;
+            }
+            i = close + 2;
+        } else if (StartsWith(text, i, "<!")) {
+            const size_t close = text.find('>', search_from(i + 2, 1));
+            if (close == std::string_view::npos) {
+                hold(0);
+                break;
+            }
+            i = close + 1;
+        } else {
+            // 引用符の中の '>' ではタグは終わらない
+            size_t j = search_from(i + 1, 1);
+            char quote = j > i + 1 ? quote_at_resume : 0;
+            for (; j < n; ++j) {
+                const char c = text[j];
+                if (quote) {
+                    if (c == quote) quote = 0;
+                } else if (c == '"' || c == '\'') {
+                    quote = c;
+                } else if (c == '>') {
+                    break;
+                }
+            }
+            if (j == n) {
+                hold(quote);
+                break;
+            }
+            if (!ScanTag(text.substr(i + 1, j - i - 1))) {
+                failed_ = true;
+                return i;
+            }
+            i = j + 1;
+        }
+    }
+    if (last && i < n) failed_ = true;
+    return i;
+}
+
+bool XmlScanner::ScanTag(std::string_view tag) {
+    if (tag.empty()) return false;
+    if (tag[0] == '/') {
+        size_t end = tag.size();
+        while (end > 1 && IsSpace(tag[end - 1])) --end;
+        if (end <= 1) return false;
+        handler_.EndElement(tag.substr(1, end - 1));
+        return true;
+    }
+    const bool empty_element = tag.back() == '/';
+    if (empty_element) tag.remove_suffix(1);
+
+    size_t pos = 0;
+    while (pos < tag.size() && !IsSpace(tag[pos])) ++pos;
+    const std::string_view name = tag.substr(0, pos);
+    if (name.empty()) return false;
+
+    attributes_.clear();
+    attribute_offsets_.clear();
+    decoded_.clear();
+    for (;;) {
+        while (pos < tag.size() && IsSpace(tag[pos])) ++pos;
+        if (pos == tag.size()) break;
+        const size_t name_start = pos;
+        while (pos < tag.size() && tag[pos] != '=' && !IsSpace(tag[pos])) ++pos;
+        const std::string_view attribute = tag.substr(name_start, pos - name_start);
+        while (pos < tag.size() && IsSpace(tag[pos])) ++pos;
+        if (attribute.empty() || pos == tag.size() || tag[pos] != '=') return false;
+        ++pos;
+        while (pos < tag.size() && IsSpace(tag[pos])) ++pos;
+        if (pos == tag.size() || (tag[pos] != '"' && tag[pos] != '\'')) return false;
+        const char quote = tag[pos++];
+        const size_t close = tag.find(quote, pos);
+        if (close == std::string_view::npos) return false;
+        const std::string_view value = tag.substr(pos, close - pos);
+        if (value.find('&') == std::string_view::npos) {
+            attributes_.push_back({attribute, value});
+        } else {
+            // 復号した値は decoded_ に置き、全部読んでから指す（途中で decoded_ が伸びて動くため）
+            attribute_offsets_.push_back(attributes_.size());
+            attribute_offsets_.push_back(decoded_.size());
+            AppendDecoded(value, decoded_);
+            attribute_offsets_.push_back(decoded_.size());
+            attributes_.push_back({attribute, {}});
+        }
+        pos = close + 1;
+    }
+    for (size_t k = 0; k < attribute_offsets_.size(); k += 3) {
+        attributes_[attribute_offsets_[k]].value =
+            std::string_view(decoded_).substr(attribute_offsets_[k + 1], attribute_offsets_[k + 2] - attribute_offsets_[k + 1]);
+    }
+    handler_.StartElement(name, XmlAttributes(attributes_));
+    if (empty_element) handler_.EndElement(name);
+    return true;
+}
+
+void XmlScanner::EmitText(std::string_view text) {
+    if (text.find('&') == std::string_view::npos) {
+        handler_.Text(text);
+        return;
+    }
+    decoded_.clear();
+    AppendDecoded(text, decoded_);
+    handler_.Text(decoded_);
+}
+
+}
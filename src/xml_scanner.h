@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// 属性（値は文字参照を復号済み）。呼び出しの間だけ有効
+struct XmlAttribute {
+    std::string_view name;
+    std::string_view value;
+};
+
+class XmlAttributes {
+public:
+    explicit XmlAttributes(const std::vector<XmlAttribute>& items) : items_(items) {}
+    // 名前の完全一致（"w:val" のように接頭辞も含める）。なければ空
+    std::string_view Get(std::string_view name) const;
+    bool Has(std::string_view name) const;
+    const std::vector<XmlAttribute>& Items() const { return items_; }
+
+private:
+    const std::vector<XmlAttribute>& items_;
+};
+
+// XmlScanner のイベントを受け取る側
+class XmlHandler {
+public:
+    virtual ~XmlHandler() = default;
+    // name は接頭辞付きのまま（"w:p"）。空要素 <a/> でも StartElement と EndElement を呼ぶ
+    virtual void StartElement(std::string_view name, const XmlAttributes& attributes) = 0;
+    virtual void EndElement(std::string_view name) = 0;
+    // 文字参照と CDATA は復号済み。1 つのテキストが何回かに分かれて届くことがある
+    virtual void Text(std::string_view text) = 0;
+};
+
+// 少しずつ渡されるバイト列を読む SAX 形式の XML スキャナー（展開しながら読む DOCX の本文用）
+// - 渡された断片をそのまま走査し、断片の境目で切れたタグだけを持ち越す
+// - 名前空間は解決しない。DTD・処理命令・コメントは読み飛ばし、入れ子の対応は確かめない
+class XmlScanner {
+public:
+    // 持ち越す残り（終わっていないタグ・コメント・CDATA）の上限。超えたら壊れているとみなす
+    static constexpr size_t kMaxPendingBytes = 16 << 20;
+
+    explicit XmlScanner(XmlHandler& handler) : handler_(handler) {}
+
+    // 続きを渡す。タグが壊れていれば false（以降も false）
+    bool Feed(std::string_view chunk);
+    // 終わり。途中のタグが残っていれば false
+    bool Finish();
+
+    // "&lt;" "&#x3042;" などを復号して out に足す（知らない参照はそのまま）
+    static void AppendDecoded(std::string_view text, std::string& out);
+
+private:
+    XmlHandler& handler_;
+    std::string pending_; // 前の断片の、終わっていないタグやテキストの残り
+    std::string decoded_;
+    std::vector<XmlAttribute> attributes_;
+    std::vector<size_t> attribute_offsets_;
+    bool failed_ = false;
+    // pending_ の先頭の終わっていないタグなどを、先頭からどこまで調べたか（続きはそこから調べる）と、
+    // そこでのタグの引用符
+    size_t resume_ = 0;
+    char resume_quote_ = 0;
+
+    // text を走査して、処理した長さを返す（残りは次の断片と繋げて読む）。壊れていれば failed_
+    // resume は text の先頭のタグなどを調べ終えた長さ（前の Scan で切れたところから続ける）
+    size_t Scan(std::string_view text, bool last, size_t resume = 0);
+    bool ScanTag(std::string_view tag);
+    void EmitText(std::string_view text);
+};
+
+}
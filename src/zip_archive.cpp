@@ -0,0 +1,270 @@
+#include "zip_archive.h"
+#include "deflate.h"
+#include "error_handler.h"
+#include <algorithm>
+
+namespace ShinoEditor {
+
+namespace {
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr uint32_t kEndOfCentralDirectorySignature = 0x06054b50;
+constexpr uint32_t kDataDescriptorSignature = 0x08074b50;
+constexpr size_t kLocalHeaderBytes = 30;
+constexpr size_t kCentralHeaderBytes = 46;
+constexpr size_t kEndOfCentralDirectoryBytes = 22;
+// 書き出す項目の属性: 展開に要る版（2.0）、データ記述子あり（ビット 3）、時刻は固定（1980-01-01 00:00）
+constexpr uint16_t kVersionNeeded = 20;
+constexpr uint16_t kFlagDataDescriptor = 0x0008;
+constexpr uint16_t kDosDate = (0 << 9) | (1 << 5) | 1;
+// 格納された項目を渡す単位（途中で止められるように分ける）
+constexpr size_t kStoredChunkBytes = 1 << 20;
+// ReadAll で先に確保するのは圧縮後の大きさのこの倍まで（XML の DEFLATE はふつう 10 倍前後）
+constexpr uint64_t kReserveRatio = 8;
+
+uint16_t Read16(std::string_view data, size_t pos) {
+    return static_cast<uint16_t>(static_cast<unsigned char>(data[pos]) |
+                                 static_cast<unsigned char>(data[pos + 1]) << 8);
+}
+
+uint32_t Read32(std::string_view data, size_t pos) {
+    return static_cast<uint32_t>(Read16(data, pos)) | static_cast<uint32_t>(Read16(data, pos + 2)) << 16;
+}
+
+void Put16(std::string& out, uint32_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+void Put32(std::string& out, uint32_t value) {
+    Put16(out, value & 0xFFFF);
+    Put16(out, value >> 16);
+}
+
+// ZIP64 を使わずに書ける大きさか
+uint32_t Check32(uint64_t value, const std::string& name) {
+    if (value > 0xFFFFFFFFu) {
+        throw ShinoError(ShinoError::Category::Convert, "ZIP archive too large", name + ": ZIP64 is not supported");
+    }
+    return static_cast<uint32_t>(value);
+}
+
+// ローカルヘッダー（central なら中央ディレクトリの項目）の名前の前まで
+void PutHeader(std::string& out, const ZipReader::Entry& entry, bool central) {
+    Put32(out, central ? kCentralHeaderSignature : kLocalHeaderSignature);
+    if (central) Put16(out, kVersionNeeded); // 作成した版
+    Put16(out, kVersionNeeded);
+    Put16(out, entry.flags);
+    Put16(out, entry.method);
+    Put16(out, 0); // 時刻
+    Put16(out, kDosDate);
+    // ローカルヘッダーではデータ記述子に書く
+    Put32(out, central ? entry.crc32 : 0);
+    Put32(out, central ? static_cast<uint32_t>(entry.compressed_size) : 0);
+    Put32(out, central ? static_cast<uint32_t>(entry.size) : 0);
+    Put16(out, static_cast<uint32_t>(entry.name.size()));
+    Put16(out, 0); // 拡張領域
+    if (central) {
+        Put16(out, 0); // コメント
+        Put16(out, 0); // ディスク番号
+        Put16(out, 0); // 内部属性
+        Put32(out, 0); // 外部属性
+        Put32(out, static_cast<uint32_t>(entry.local_header_offset));
+    }
+}
+}
+
+void ZipReader::ThrowInvalid(const std::string& reason) const {
+    throw ShinoError(ShinoError::Category::Parser, "Invalid ZIP archive", path_ + ": " + reason);
+}
+
+void ZipReader::Open(const std::string& path) {
+    path_ = path;
+    entries_.clear();
+    if (!file_.Open(path)) error::ThrowFileNotFound(path);
+    const std::string_view data = file_.View();
+
+    // 末尾の中央ディレクトリの終わりのレコード（後ろにコメントが最大 64KB 付く）
+    if (data.size() < kEndOfCentralDirectoryBytes) ThrowInvalid("too small");
+    const size_t lowest = data.size() > kEndOfCentralDirectoryBytes + 0xFFFF
+                              ? data.size() - kEndOfCentralDirectoryBytes - 0xFFFF
+                              : 0;
+    size_t end_record = std::string_view::npos;
+    for (size_t pos = data.size() - kEndOfCentralDirectoryBytes + 1; pos-- > lowest;) {
+        if (Read32(data, pos) == kEndOfCentralDirectorySignature) {
+            end_record = pos;
+            break;
+        }
+    }
+    if (end_record == std::string_view::npos) ThrowInvalid("end of central directory not found");
+    const uint16_t count = Read16(data, end_record + 10);
+    const uint32_t directory_size = Read32(data, end_record + 12);
+    const uint32_t directory_offset = Read32(data, end_record + 16);
+    if (count == 0xFFFF || directory_offset == 0xFFFFFFFFu) ThrowInvalid("ZIP64 is not supported");
+    if (static_cast<uint64_t>(directory_offset) + directory_size > end_record) {
+        ThrowInvalid("central directory out of range");
+    }
+
+    entries_.reserve(count);
+    size_t pos = directory_offset;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (pos + kCentralHeaderBytes > end_record || Read32(data, pos) != kCentralHeaderSignature) {
+            ThrowInvalid("broken central directory");
+        }
+        Entry entry;
+        entry.flags = Read16(data, pos + 8);
+        entry.method = Read16(data, pos + 10);
+        entry.crc32 = Read32(data, pos + 16);
+        entry.compressed_size = Read32(data, pos + 20);
+        entry.size = Read32(data, pos + 24);
+        const uint16_t name_length = Read16(data, pos + 28);
+        const uint16_t extra_length = Read16(data, pos + 30);
+        const uint16_t comment_length = Read16(data, pos + 32);
+        entry.local_header_offset = Read32(data, pos + 42);
+        const size_t next = pos + kCentralHeaderBytes + name_length + extra_length + comment_length;
+        if (next > end_record) ThrowInvalid("broken central directory");
+        entry.name.assign(data.substr(pos + kCentralHeaderBytes, name_length));
+        entries_.push_back(std::move(entry));
+        pos = next;
+    }
+}
+
+const ZipReader::Entry* ZipReader::Find(std::string_view name) const {
+    auto it = std::find_if(entries_.begin(), entries_.end(), [&](const Entry& e) { return e.name == name; });
+    return it == entries_.end() ? nullptr : &*it;
+}
+
+bool ZipReader::Read(const Entry& entry, const std::function<bool(std::string_view)>& on_data) const {
+    const std::string_view data = file_.View();
+    if (entry.flags & 1) ThrowInvalid(entry.name + ": encrypted");
+    const uint64_t header = entry.local_header_offset;
+    if (header + kLocalHeaderBytes > data.size() || Read32(data, header) != kLocalHeaderSignature) {
+        ThrowInvalid(entry.name + ": broken local header");
+    }
+    // 名前と拡張領域の長さは中央ディレクトリと違うことがあるので、ローカルヘッダーのものを使う
+    const uint64_t start = header + kLocalHeaderBytes + Read16(data, header + 26) + Read16(data, header + 28);
+    if (start + entry.compressed_size > data.size()) ThrowInvalid(entry.name + ": truncated");
+    const std::string_view body = data.substr(start, entry.compressed_size);
+    if (entry.size > kMaxEntryBytes) ThrowInvalid(entry.name + ": entry too large");
+
+    uint32_t crc = 0;
+    uint64_t size = 0;
+    bool stopped = false;
+    auto forward = [&](std::string_view chunk) {
+        if (size + chunk.size() > entry.size) ThrowInvalid(entry.name + ": larger than its recorded size");
+        crc = Crc32(chunk, crc);
+        size += chunk.size();
+        if (on_data(chunk)) return true;
+        stopped = true;
+        return false;
+    };
+    if (entry.method == kStored) {
+        for (size_t pos = 0; pos < body.size() && !stopped; pos += kStoredChunkBytes) {
+            forward(body.substr(pos, kStoredChunkBytes));
+        }
+    } else if (entry.method == kDeflated) {
+        if (!Inflater::Inflate(body, forward) && !stopped) ThrowInvalid(entry.name + ": broken deflate data");
+    } else {
+        ThrowInvalid(entry.name + ": unsupported compression method " + std::to_string(entry.method));
+    }
+    if (stopped) return false;
+    if (size != entry.size || crc != entry.crc32) ThrowInvalid(entry.name + ": checksum mismatch");
+    return true;
+}
+
+void ZipReader::ReadAll(const Entry& entry, std::string& out) const {
+    out.clear();
+    // 大きさはファイルに書かれた値なので、圧縮後の大きさから見て妥当な分だけ先に確保する
+    out.reserve(std::min(entry.size, std::max<uint64_t>(entry.compressed_size * kReserveRatio, kStoredChunkBytes)));
+    Read(entry, [&out](std::string_view chunk) {
+        out.append(chunk);
+        return true;
+    });
+}
+
+void ZipWriter::Emit(std::string_view data) {
+    sink_.Write(data);
+    offset_ += data.size();
+}
+
+void ZipWriter::Begin(const std::string& name, uint16_t method) {
+    if (open_) End();
+    ZipReader::Entry entry;
+    entry.name = name;
+    entry.method = method;
+    entry.flags = kFlagDataDescriptor;
+    entry.local_header_offset = Check32(offset_, name);
+    std::string header;
+    PutHeader(header, entry, false);
+    header += name;
+    Emit(header);
+    entries_.push_back(std::move(entry));
+    if (method == ZipReader::kDeflated) {
+        deflater_.emplace([this](std::string_view chunk) {
+            entries_.back().compressed_size += chunk.size();
+            Emit(chunk);
+        });
+    }
+    open_ = true;
+}
+
+void ZipWriter::Write(std::string_view data) {
+    auto& entry = entries_.back();
+    entry.crc32 = Crc32(data, entry.crc32);
+    entry.size += data.size();
+    if (deflater_) {
+        deflater_->Write(data);
+    } else {
+        entry.compressed_size += data.size();
+        Emit(data);
+    }
+}
+
+void ZipWriter::End() {
+    if (!open_) return;
+    open_ = false;
+    if (deflater_) {
+        deflater_->Finish();
+        deflater_.reset();
+    }
+    const auto& entry = entries_.back();
+    std::string descriptor;
+    Put32(descriptor, kDataDescriptorSignature);
+    Put32(descriptor, entry.crc32);
+    Put32(descriptor, Check32(entry.compressed_size, entry.name));
+    Put32(descriptor, Check32(entry.size, entry.name));
+    Emit(descriptor);
+}
+
+void ZipWriter::Add(const std::string& name, std::string_view data, uint16_t method) {
+    Begin(name, method);
+    Write(data);
+    End();
+}
+
+bool ZipWriter::Finish() {
+    End();
+    const uint64_t directory_offset = offset_;
+    std::string directory;
+    for (const auto& entry : entries_) {
+        PutHeader(directory, entry, true);
+        directory += entry.name;
+    }
+    const auto directory_size = static_cast<uint32_t>(directory.size());
+    const auto count = static_cast<uint32_t>(entries_.size());
+    if (count >= 0xFFFF) {
+        throw ShinoError(ShinoError::Category::Convert, "ZIP archive too large", "too many entries");
+    }
+    Put32(directory, kEndOfCentralDirectorySignature);
+    Put16(directory, 0); // このディスクの番号
+    Put16(directory, 0); // 中央ディレクトリのあるディスク
+    Put16(directory, count);
+    Put16(directory, count);
+    Put32(directory, directory_size);
+    Put32(directory, Check32(directory_offset, "central directory"));
+    Put16(directory, 0); // コメント
+    Emit(directory);
+    return sink_.Flush();
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "deflate.h"
+#include "mapped_file.h"
+#include "render_sink.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ShinoEditor {
+
+// ZIP の読み込み（DOCX などのコンテナ用）
+// - ファイルは mmap し、末尾の中央ディレクトリから項目の一覧を作る
+// - 中身は格納（方式 0）か DEFLATE（方式 8）だけ。展開しながら渡し、CRC-32 と大きさを確かめる
+// - 暗号化と ZIP64 には対応しない
+class ZipReader {
+public:
+    static constexpr uint16_t kStored = 0;
+    static constexpr uint16_t kDeflated = 8;
+    // 展開後の大きさの上限（これより大きいと書かれた項目は読まない）
+    static constexpr uint64_t kMaxEntryBytes = 1ull << 30;
+
+    struct Entry {
+        std::string name;
+        uint16_t method = 0;
+        uint16_t flags = 0;
+        uint32_t crc32 = 0;
+        uint64_t compressed_size = 0;
+        uint64_t size = 0;
+        uint64_t local_header_offset = 0;
+    };
+
+    // 開けなければ ShinoError（File）、ZIP として読めなければ ShinoError（Parser）
+    void Open(const std::string& path);
+    const std::vector<Entry>& Entries() const { return entries_; }
+    // 名前の完全一致（なければ nullptr）
+    const Entry* Find(std::string_view name) const;
+
+    // 展開した分ずつ on_data に渡す。on_data が false を返したら止めて false
+    // 壊れている（CRC や大きさが合わない、対応していない方式）なら ShinoError（Parser）
+    // 展開した分が中央ディレクトリの大きさを超えたらその時点で投げる（小さな ZIP を際限なく展開しない）
+    bool Read(const Entry& entry, const std::function<bool(std::string_view)>& on_data) const;
+    // 中身全体を out に
+    void ReadAll(const Entry& entry, std::string& out) const;
+
+private:
+    std::string path_;
+    MappedFile file_;
+    std::vector<Entry> entries_;
+
+    [[noreturn]] void ThrowInvalid(const std::string& reason) const;
+};
+
+// ZIP の書き出し（DOCX などのコンテナ用）
+// - 項目は Begin / Write / End で流し込む。CRC-32 と大きさは中身の後ろのデータ記述子と中央ディレクトリに書くので、
+//   書き込み先を巻き戻さず、項目全体をメモリに持たない
+// - 方式は格納か DEFLATE。ZIP64 は使わない（4GB を超えたら ShinoError（Convert））
+class ZipWriter {
+public:
+    // sink には書いた順に渡す（Flush は Finish で呼ぶ）
+    explicit ZipWriter(RenderSink& sink) : sink_(sink) {}
+
+    ZipWriter(const ZipWriter&) = delete;
+    ZipWriter& operator=(const ZipWriter&) = delete;
+
+    // method は ZipReader::kStored か ZipReader::kDeflated
+    void Begin(const std::string& name, uint16_t method);
+    // 展開後の中身を足す
+    void Write(std::string_view data);
+    void End();
+    // 項目 1 つを一度に書く
+    void Add(const std::string& name, std::string_view data, uint16_t method);
+
+    // 中央ディレクトリを書いて sink を Flush する。書き込みに失敗していたら false
+    bool Finish();
+
+    uint64_t BytesWritten() const { return offset_; }
+
+private:
+    RenderSink& sink_;
+    std::vector<ZipReader::Entry> entries_;
+    std::optional<Deflater> deflater_;
+    uint64_t offset_ = 0;
+    bool open_ = false;
+
+    void Emit(std::string_view data);
+};
+
+}
@@ -1,6 +1,11 @@
 #include "test_framework.h"
 #include "app_test_helper.h"
+#include "docx_reader.h"
+#include "docx_test_helper.h"
 #include "tui_bindings.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 
@@ -49,6 +54,522 @@ TEST(App_Search) {
     helper.SendKeys({"p"}); // Previous match
 }
 
+TEST(App_SearchSpansAndHorizontalJump) {
+    const auto path = fs::temp_directory_path() / "shino_search_spans_test.md";
+    {
+        std::ofstream out(path);
+        out << "foo needle bar needle\n";
+        out << "nothing here\n";
+        out << std::string(4000, 'x') << "needle\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+    helper.SendControlKey(TUIBindings::CTRL_L); // 折り返しオフ
+
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"n", "e", "e", "d", "l", "e"});
+    helper.SendSpecialKey(ftxui::Event::Return);
+
+    // 一致は (行, バイトオフセット, 長さ) で得られる
+    const std::vector<SearchMatch> expected = {{0, 4, 6}, {0, 15, 6}, {2, 4000, 6}};
+    ASSERT_TRUE(helper.GetSearchMatches() == expected);
+    ASSERT_EQ(helper.CurrentRealLine(), 0);
+    ASSERT_EQ(helper.GetHorizontalScroll(), 0);
+
+    // 1 行目の一致箇所がハイライト範囲に重なり、現在の一致だけ別のスタイルになる
+    const auto* spans = helper.GetEditorSpans(0);
+    ASSERT_TRUE(spans != nullptr);
+    int current = 0, others = 0;
+    for (const auto& span : *spans) {
+        if (span.style == HighlightStyle::SEARCH_CURRENT) {
+            ++current;
+            ASSERT_EQ(span.begin, size_t(4));
+        }
+        if (span.style == HighlightStyle::SEARCH_MATCH) ++others;
+    }
+    ASSERT_EQ(current, 1);
+    ASSERT_EQ(others, 1);
+
+    // 画面の外の一致へは横スクロールして移動する
+    helper.SendControlKey(TUIBindings::CTRL_N);
+    helper.SendControlKey(TUIBindings::CTRL_N);
+    ASSERT_EQ(helper.GetCurrentMatch(), 2);
+    ASSERT_EQ(helper.CurrentRealLine(), 2);
+    ASSERT_TRUE(helper.GetHorizontalScroll() > 3800);
+    ASSERT_TRUE(helper.GetHorizontalScroll() <= 4000);
+    helper.RenderFrame();
+
+    // 先頭に戻ると横スクロールも戻る
+    helper.SendControlKey(TUIBindings::CTRL_N);
+    ASSERT_EQ(helper.GetHorizontalScroll(), 0);
+    helper.SendControlKey(TUIBindings::CTRL_R);
+    ASSERT_EQ(helper.GetCurrentMatch(), 2);
+}
+
+TEST(App_IncrementalSearchWhileTyping) {
+    // 1 回の走査量（1MB）より大きい文書: 打った時点では先頭の一部だけ探し、残りは UI ループで進める
+    const auto path = fs::temp_directory_path() / "shino_incremental_search_test.md";
+    const int kLines = 30000;
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < kLines; ++i) {
+            out << std::string(60, 'x') << (i % 3 == 0 ? " needle " : " noodle ") << i << "\n";
+        }
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"n", "e"});
+    ASSERT_TRUE(!helper.IsSearchDone());
+    // 見つかった分はすぐに出ていて、最初の一致へ移動している
+    ASSERT_TRUE(!helper.GetSearchMatches().empty());
+    ASSERT_EQ(helper.GetCurrentMatch(), 0);
+    ASSERT_EQ(helper.CurrentRealLine(), 0);
+    ASSERT_TRUE(helper.RunSearchSteps() > 0);
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t((kLines + 2) / 3));
+
+    // 伸ばしても縮めても走査し直さない
+    helper.SendKeys({"e", "d"});
+    ASSERT_TRUE(helper.IsSearchDone());
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t((kLines + 2) / 3));
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    ASSERT_TRUE(helper.IsSearchDone());
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t((kLines + 2) / 3));
+    helper.RenderFrame();
+
+    // Enter で閉じても一致は残り、Esc なら消える
+    helper.SendSpecialKey(ftxui::Event::Return);
+    helper.SendControlKey(TUIBindings::CTRL_N);
+    ASSERT_EQ(helper.GetCurrentMatch(), 1);
+    ASSERT_EQ(helper.CurrentRealLine(), 3);
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"o"});
+    helper.SendSpecialKey(ftxui::Event::Escape);
+    ASSERT_TRUE(helper.IsSearchDone());
+    ASSERT_TRUE(helper.GetSearchMatches().empty());
+}
+
+TEST(App_SearchUsesTrigramIndex) {
+    const auto path = fs::temp_directory_path() / "shino_search_index_test.md";
+    const int kLines = 30000;
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < kLines; ++i) {
+            out << std::string(60, 'x') << (i % 1000 == 0 ? " needle " : " noodle ") << i << "\n";
+        }
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+    // 小さな文書では作らない
+    ASSERT_TRUE(helper.GetSearchIndexState() == TrigramIndex::State::EMPTY);
+    helper.BuildSearchIndex();
+    ASSERT_TRUE(helper.GetSearchIndexState() == TrigramIndex::State::READY);
+
+    // 2 文字までは走査するが、3 文字目からは索引で候補の行だけを調べるので走査は残らない
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"n", "e"});
+    ASSERT_TRUE(!helper.IsSearchDone());
+    helper.SendKeys({"e", "d"});
+    ASSERT_TRUE(helper.IsSearchDone());
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t(kLines / 1000));
+    helper.RenderFrame();
+    helper.SendSpecialKey(ftxui::Event::Return);
+
+    // 行の削除も索引に反映される（後ろの行は 1 行ずつ上にずれる）
+    ASSERT_EQ(helper.CurrentRealLine(), 0);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    ASSERT_TRUE(helper.GetSearchIndexState() == TrigramIndex::State::READY);
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"n", "e", "e", "d"});
+    ASSERT_TRUE(helper.IsSearchDone());
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t(kLines / 1000 - 1));
+    ASSERT_EQ(helper.GetSearchMatches()[0].line, 999);
+}
+
+TEST(App_RegexSearchMode) {
+    const auto path = fs::temp_directory_path() / "shino_regex_search_test.md";
+    {
+        std::ofstream out(path);
+        out << "# a1\n";
+        out << "b22 c333\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+
+    // ^R で正規表現モードにし、Enter で検索する（入力中は探さない）
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendControlKey(TUIBindings::CTRL_R);
+    helper.SendKeys({"[", "a", "-", "c", "]", "\\", "d", "{", "2", ",", "}"});
+    ASSERT_TRUE(helper.GetSearchMatches().empty());
+    helper.SendSpecialKey(ftxui::Event::Return);
+    const std::vector<SearchMatch> expected = {{1, 0, 3}, {1, 4, 4}};
+    ASSERT_TRUE(helper.GetSearchMatches() == expected);
+    ASSERT_EQ(helper.CurrentRealLine(), 1);
+
+    // 構文エラーは一致なしでステータスに出る
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"(", "a"});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_TRUE(helper.GetSearchMatches().empty());
+    ASSERT_TRUE(helper.GetStatusMessage().find("Invalid regular expression") != std::string::npos);
+
+    // 文字列検索に戻すと入力中の文字列で探す
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"3", "3"});
+    helper.SendControlKey(TUIBindings::CTRL_R);
+    helper.RunSearchSteps();
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t(1));
+}
+
+TEST(App_RegexSearchRunsInSteps) {
+    const auto path = fs::temp_directory_path() / "shino_regex_steps_test.md";
+    const int kLines = 40000;
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < kLines; ++i) out << std::string(60, 'x') << " item" << i % 7 << "\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+
+    // Enter では最初の区切りだけを探して戻り、続きは UI ループで進める（最初の一致へはすぐ移動する）
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendControlKey(TUIBindings::CTRL_R);
+    helper.SendKeys({"m", "3", "$"});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_TRUE(!helper.IsSearchDone());
+    ASSERT_TRUE(helper.GetStatusMessage().find("Searching...") == 0);
+    ASSERT_EQ(helper.CurrentRealLine(), 3);
+    helper.RunSearchSteps();
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t((kLines + 3) / 7));
+    ASSERT_TRUE(helper.GetStatusMessage().find("Found") == 0);
+
+    // 編集したら残りの走査はやめる
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"m", "4", "$"});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_TRUE(!helper.IsSearchDone());
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.RunSearchSteps();
+    ASSERT_TRUE(helper.IsSearchDone());
+    ASSERT_TRUE(helper.GetSearchMatches().size() < size_t(kLines / 7));
+}
+
+TEST(App_SearchIgnoresCaseAndWidth) {
+    const auto path = fs::temp_directory_path() / "shino_fold_search_test.md";
+    {
+        std::ofstream out(path);
+        out << "ﾃﾞｰﾀﾍﾞｰｽ と ＤＡＴＡ\n";
+        out << "データベース と data\n";
+        out << "でーたべーす\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"デ", "ー", "タ"});
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t(1));
+
+    // ^F: 大文字小文字・全角半角を区別しない。一致は元の行のバイト範囲で得られる
+    helper.SendControlKey(TUIBindings::CTRL_F);
+    helper.RunSearchSteps();
+    const std::vector<SearchMatch> width = {{0, 0, 12}, {1, 0, 9}};
+    ASSERT_TRUE(helper.GetSearchMatches() == width);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendKeys({"D", "a", "T", "a"});
+    helper.RunSearchSteps();
+    const std::vector<SearchMatch> latin = {{0, 29, 12}, {1, 23, 4}};
+    ASSERT_TRUE(helper.GetSearchMatches() == latin);
+    helper.RenderFrame();
+
+    // もう一度 ^F でかなも区別しない
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendKeys({"ﾃ", "ﾞ", "ｰ", "ﾀ"});
+    helper.SendControlKey(TUIBindings::CTRL_F);
+    helper.RunSearchSteps();
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t(3));
+    ASSERT_TRUE(helper.GetSearchMatches()[2] == (SearchMatch{2, 0, 9}));
+
+    // 編集は影にも反映される（1 行目を消すと後ろが 1 行ずつ上にずれる）
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_EQ(helper.CurrentRealLine(), 0);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"ﾃ", "ﾞ", "ｰ", "ﾀ"});
+    helper.RunSearchSteps();
+    const std::vector<SearchMatch> edited = {{0, 0, 9}, {1, 0, 9}};
+    ASSERT_TRUE(helper.GetSearchMatches() == edited);
+
+    // 区別するモードに戻ると半角カナでは見つからない
+    helper.SendControlKey(TUIBindings::CTRL_F);
+    ASSERT_TRUE(helper.GetSearchMatches().empty());
+}
+
+TEST(App_ReplaceOneAndAll) {
+    const auto path = fs::temp_directory_path() / "shino_replace_test.md";
+    {
+        std::ofstream out(path);
+        out << "# foo title\n";
+        out << "foo and foo\n";
+        out << "no match\n";
+        out << "last foo\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+
+    // Tab で置換後の文字列を入力し、Enter で現在の一致を 1 件ずつ置き換える
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"f", "o", "o"});
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t(4));
+    helper.SendSpecialKey(ftxui::Event::Tab);
+    helper.SendKeys({"b", "a", "r"});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_EQ(helper.GetLines()[0], std::string("# bar title"));
+    ASSERT_TRUE(helper.IsModified());
+    // 残りの一致はそのまま使え、次の一致へ進んでいる
+    ASSERT_EQ(helper.GetSearchMatches().size(), size_t(3));
+    ASSERT_EQ(helper.GetCurrentMatch(), 0);
+    ASSERT_EQ(helper.CurrentRealLine(), 1);
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_EQ(helper.GetLines()[1], std::string("bar and foo"));
+    const std::vector<SearchMatch> left = {{1, 8, 3}, {3, 5, 3}};
+    ASSERT_TRUE(helper.GetSearchMatches() == left);
+    helper.RenderFrame();
+
+    // ^U は直前の置換だけを元に戻す
+    helper.SendControlKey(TUIBindings::CTRL_U);
+    ASSERT_EQ(helper.GetLines()[1], std::string("foo and foo"));
+    ASSERT_EQ(helper.GetLines()[0], std::string("# bar title"));
+
+    // ^A ですべて置き換える（1 回の操作として元に戻せる）
+    helper.SendControlKey(TUIBindings::CTRL_A);
+    ASSERT_EQ(helper.GetLines()[1], std::string("bar and bar"));
+    ASSERT_EQ(helper.GetLines()[3], std::string("last bar"));
+    ASSERT_TRUE(helper.GetStatusMessage().find("Replaced 3 matches in 2 lines") != std::string::npos);
+    helper.SendSpecialKey(ftxui::Event::Escape);
+    helper.SendControlKey(TUIBindings::CTRL_U);
+    ASSERT_EQ(helper.GetLines()[1], std::string("foo and foo"));
+    ASSERT_EQ(helper.GetLines()[3], std::string("last foo"));
+    helper.SendControlKey(TUIBindings::CTRL_U);
+    ASSERT_TRUE(helper.GetStatusMessage().find("Nothing to undo") != std::string::npos);
+
+    // 正規表現でも置き換えられる（置換後の文字列は空にして削除）
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendControlKey(TUIBindings::CTRL_R);
+    helper.SendKeys({"^", "#", " "});
+    helper.SendSpecialKey(ftxui::Event::Tab);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendControlKey(TUIBindings::CTRL_A);
+    ASSERT_EQ(helper.GetLines()[0], std::string("bar title"));
+
+    // 置換のあとに編集したら元に戻さない
+    helper.SendSpecialKey(ftxui::Event::Escape);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.SendControlKey(TUIBindings::CTRL_U);
+    ASSERT_TRUE(helper.GetStatusMessage().find("Nothing to undo") != std::string::npos);
+}
+
+TEST(App_DirectorySearchOpensMatch) {
+    const auto dir = test_utils::create_temp_dir("app_dir_search");
+    fs::create_directories(dir / "sub");
+    {
+        std::ofstream(dir / "a.md") << "alpha\nneedle here\n";
+        std::ofstream(dir / "sub" / "b.md") << "x\ny\nz needle\n";
+        std::ofstream(dir / "sub" / "c.md") << "nothing\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile((dir / "a.md").string()));
+
+    // 検索プロンプトで ^D: 開いているファイルのディレクトリ以下を探して一覧に出す
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendKeys({"n", "e", "e", "d", "l", "e"});
+    helper.SendControlKey(TUIBindings::CTRL_D);
+    ASSERT_TRUE(helper.IsDirectoryResultsShown());
+    helper.WaitDirectorySearch();
+    const auto& matches = helper.GetDirectoryMatches();
+    ASSERT_EQ(matches.size(), size_t(2));
+    helper.RenderFrame();
+
+    // 結果の順はワーカー次第なので、sub/b.md の一致まで選択を動かして開く
+    int target = 0;
+    while (helper.GetDirectoryFiles()[matches[target].file] != "sub/b.md") ++target;
+    helper.SendSpecialKey(ftxui::Event::ArrowUp);
+    for (int i = 0; i < target; ++i) helper.SendSpecialKey(ftxui::Event::ArrowDown);
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_FALSE(helper.IsDirectoryResultsShown());
+    ASSERT_EQ(fs::path(helper.GetFilename()).filename().string(), std::string("b.md"));
+    ASSERT_EQ(helper.CurrentRealLine(), 2);
+    const std::vector<SearchMatch> opened = {{2, 2, 6}};
+    ASSERT_TRUE(helper.GetSearchMatches() == opened);
+    ASSERT_TRUE(helper.GetEditorSpans(2) != nullptr);
+
+    // ^D で一覧をもう一度開ける。未保存の変更があれば別のファイルは開かない
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    ASSERT_TRUE(helper.IsModified());
+    helper.SendControlKey(TUIBindings::CTRL_D);
+    ASSERT_TRUE(helper.IsDirectoryResultsShown());
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_TRUE(helper.IsDirectoryResultsShown());
+    ASSERT_TRUE(helper.GetStatusMessage().find("Save changes first") != std::string::npos);
+    helper.SendSpecialKey(ftxui::Event::Escape);
+    ASSERT_FALSE(helper.IsDirectoryResultsShown());
+
+    // 正規表現の構文エラーは一覧を開かずに知らせる
+    helper.SendControlKey(TUIBindings::CTRL_W);
+    helper.SendControlKey(TUIBindings::CTRL_R);
+    helper.SendKeys({"("});
+    helper.SendControlKey(TUIBindings::CTRL_D);
+    ASSERT_FALSE(helper.IsDirectoryResultsShown());
+    ASSERT_FALSE(helper.GetStatusMessage().empty());
+    test_utils::cleanup_temp_dir(dir);
+}
+
+#ifndef _WIN32
+namespace {
+std::string ReadDocx(const fs::path& path) {
+    std::string markdown;
+    DocxReader::Convert(path.string(), [&markdown](std::string_view chunk) { markdown += chunk; });
+    return markdown;
+}
+}
+
+TEST(App_DocxConversionRunsInBackground) {
+    const auto dir = test_utils::create_temp_dir("app_docx_job");
+    const std::string old_path = std::getenv("PATH") ? std::getenv("PATH") : "";
+    // 読み込みは少し待ってから決まった Markdown を返す（slow.docx は返らない）。書き出しは組み込みの変換で pandoc を使わない
+    {
+        std::ofstream out(dir / "pandoc");
+        out << "#!/bin/sh\n"
+            << "case \"$1\" in\n"
+            << "  --version) echo 'pandoc 9.3' ;;\n"
+            << "  --list-input-formats) echo docx ;;\n"
+            << "  --list-output-formats) echo docx ;;\n"
+            << "  -f)\n"
+            << "    if [ \"$2\" = markdown ]; then exit 1; fi\n"
+            << "    case \"$5\" in *slow*) sleep 30 ;; esac\n"
+            << "    sleep 0.2; printf '# Imported\\n\\nBody\\n' ;;\n"
+            << "esac\n";
+    }
+    fs::permissions(dir / "pandoc", fs::perms::owner_all, fs::perm_options::add);
+    setenv("PATH", (dir.string() + ":" + old_path).c_str(), 1);
+    std::ofstream(dir / "in.docx") << "PK";
+    std::ofstream(dir / "slow.docx") << "PK";
+    std::ofstream(dir / "doc.md") << "original\n";
+
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile((dir / "doc.md").string()));
+
+    // 取り込みは UI を止めずに進み、終わってから文書をまるごと入れ替える
+    helper.SendControlKey(TUIBindings::CTRL_I);
+    helper.SendKeys({(dir / "in.docx").string()});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_TRUE(helper.IsDocxJobRunning());
+    ASSERT_TRUE(helper.GetStatusText().find("Importing in.docx") == 0);
+    ASSERT_TRUE(helper.GetLines() == std::vector<std::string>{"original"});
+    helper.RenderFrame();
+    // 実行中は次の変換を始めない
+    helper.SendControlKey(TUIBindings::CTRL_E);
+    ASSERT_TRUE(helper.GetStatusMessage().find("in progress") != std::string::npos);
+    helper.WaitDocxJob();
+    const std::vector<std::string> imported = {"# Imported", "", "Body"};
+    ASSERT_TRUE(helper.GetLines() == imported);
+    ASSERT_TRUE(helper.IsModified());
+    ASSERT_TRUE(helper.GetStatusMessage().find("DOCX imported successfully") == 0);
+
+    // Esc で pandoc を止め、文書はそのまま
+    helper.SendControlKey(TUIBindings::CTRL_I);
+    helper.SendKeys({(dir / "slow.docx").string()});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    ASSERT_TRUE(helper.IsDocxJobRunning());
+    const auto start = std::chrono::steady_clock::now();
+    helper.SendSpecialKey(ftxui::Event::Escape);
+    helper.WaitDocxJob();
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    ASSERT_EQ(helper.GetStatusMessage(), std::string("Import cancelled"));
+    ASSERT_TRUE(helper.GetLines() == imported);
+
+    // 書き出しは始めた時点の文書を書く（その後の編集は含めない）
+    helper.SendControlKey(TUIBindings::CTRL_E);
+    helper.SendKeys({(dir / "out.docx").string()});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    helper.SendSpecialKey(ftxui::Event::Backspace);
+    helper.WaitDocxJob();
+    ASSERT_TRUE(helper.GetStatusMessage().find("DOCX exported successfully") == 0);
+    ASSERT_EQ(ReadDocx(dir / "out.docx"), std::string("# Imported\n\nBody\n"));
+
+    // 書き終えたあとに届いた中断は成功を取り消さない
+    helper.SendControlKey(TUIBindings::CTRL_E);
+    helper.SendKeys({(dir / "late.docx").string()});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    helper.WaitDocxJobCancelledLate();
+    ASSERT_TRUE(helper.GetStatusMessage().find("DOCX exported successfully") == 0);
+    ASSERT_TRUE(fs::exists(dir / "late.docx"));
+
+    // プロンプトで ^P を押すと組み込みの変換を使わずに pandoc で書く（この pandoc は書き出しに失敗する）
+    helper.SendControlKey(TUIBindings::CTRL_E);
+    helper.SendControlKey(TUIBindings::CTRL_P);
+    ASSERT_TRUE(helper.GetStatusText().find("(pandoc, ^P: built-in)") != std::string::npos);
+    helper.SendKeys({(dir / "pandoc.docx").string()});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    helper.WaitDocxJob();
+    ASSERT_TRUE(helper.GetStatusMessage().find("pandoc") != std::string::npos);
+    ASSERT_FALSE(fs::exists(dir / "pandoc.docx"));
+
+    setenv("PATH", old_path.c_str(), 1);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(App_ConvertsDocxWithoutPandoc) {
+    const auto dir = test_utils::create_temp_dir("app_docx_native");
+    const std::string old_path = std::getenv("PATH") ? std::getenv("PATH") : "";
+    // pandoc が見つからない PATH でも組み込みの変換で取り込める
+    setenv("PATH", dir.string().c_str(), 1);
+    test_docx::WriteFile(dir / "in.docx", test_docx::BuildDocx(
+        test_docx::Paragraph(test_docx::Run("Native"), "Heading1") +
+        test_docx::Paragraph(test_docx::Run("plain ") + test_docx::Run("bold", "<w:b/>"))));
+
+    test::AppTestHelper helper;
+    helper.SendControlKey(TUIBindings::CTRL_I);
+    helper.SendKeys({(dir / "in.docx").string()});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    helper.WaitDocxJob();
+    const std::vector<std::string> expected = {"# Native", "", "plain **bold**"};
+    ASSERT_TRUE(helper.GetLines() == expected);
+    ASSERT_TRUE(helper.GetStatusMessage().find("DOCX imported successfully") == 0);
+
+    // 書き出しも pandoc なしで組み込みの変換を使う
+    helper.SendControlKey(TUIBindings::CTRL_E);
+    helper.SendKeys({(dir / "out.docx").string()});
+    helper.SendSpecialKey(ftxui::Event::Return);
+    helper.WaitDocxJob();
+    ASSERT_TRUE(helper.GetStatusMessage().find("DOCX exported successfully") == 0);
+    ASSERT_EQ(ReadDocx(dir / "out.docx"), std::string("# Native\n\nplain **bold**\n"));
+    // pandoc がなければ pandoc には切り替えられない
+    helper.SendControlKey(TUIBindings::CTRL_E);
+    helper.SendControlKey(TUIBindings::CTRL_P);
+    ASSERT_EQ(helper.GetStatusMessage(), std::string("Pandoc not available"));
+    helper.SendSpecialKey(ftxui::Event::Escape);
+
+    setenv("PATH", old_path.c_str(), 1);
+    test_utils::cleanup_temp_dir(dir);
+}
+#endif
+
 TEST(App_BlockOperations) {
     test::AppTestHelper helper;
     
@@ -79,6 +600,68 @@ TEST(App_Preview) {
     helper.SendControlKey(TUIBindings::CTRL_P);
 }
 
+TEST(App_NativePreview) {
+    namespace fs = std::filesystem;
+    const auto path = fs::temp_directory_path() / "shino_native_preview_test.md";
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < 2000; ++i) out << "# Section " << i << "\n\nParagraph **" << i << "**\n\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+    helper.SendControlKey(TUIBindings::CTRL_P);
+    helper.RenderFrame();
+
+    // ネイティブ表示ではワーカーに HTML のレンダリングを要求しない
+    ASSERT_TRUE(helper.GetPreviewMode() == PreviewMode::NATIVE);
+    ASSERT_TRUE(!helper.IsPreviewRequested());
+    // 画面に入る分のブロックだけを解析する
+    ASSERT_TRUE(helper.NativePreviewBlockCount() > 0);
+    ASSERT_TRUE(helper.NativePreviewBlockCount() < 100);
+
+    helper.SendControlKey(TUIBindings::CTRL_T);
+    ASSERT_TRUE(helper.GetPreviewMode() == PreviewMode::HTML);
+    helper.RenderFrame();
+    ASSERT_TRUE(helper.IsPreviewRequested());
+
+    helper.SendControlKey(TUIBindings::CTRL_T);
+    ASSERT_TRUE(helper.GetPreviewMode() == PreviewMode::NATIVE);
+}
+
+TEST(App_NativePreviewScrollSync) {
+    namespace fs = std::filesystem;
+    const auto path = fs::temp_directory_path() / "shino_native_scroll_test.md";
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < 2000; ++i) out << "# Section " << i << "\n\nParagraph **" << i << "**\n\n";
+    }
+    test::AppTestHelper helper;
+    ASSERT_TRUE(helper.LoadFile(path.string()));
+    fs::remove(path);
+    helper.SendControlKey(TUIBindings::CTRL_P);
+    helper.RenderFrame();
+
+    // 下へ動かしながら描くと、プレビューのカーソル行はエディタのカーソルと同じ高さに来る
+    // （プレビュー本文は見出しの 2 段の下から始まるので、それより上にはならない）
+    auto editor_row = [&] { return std::max(2, helper.EditorCursorScreenRow()); };
+    for (int step = 0; step < 60; ++step) {
+        for (int i = 0; i < 7; ++i) helper.SendSpecialKey(ftxui::Event::ArrowDown);
+        helper.RenderFrame();
+        ASSERT_EQ(editor_row(), helper.NativePreviewRowForLine(helper.CurrentRealLine()));
+    }
+    ASSERT_TRUE(helper.CurrentRealLine() > 400);
+    // 画面の周りと先読み分だけを解析する（文書全体の 2000 ブロックではない）
+    ASSERT_TRUE(helper.NativePreviewBlockCount() < 600);
+
+    // 上へ戻っても同期したまま
+    for (int step = 0; step < 20; ++step) {
+        for (int i = 0; i < 5; ++i) helper.SendSpecialKey(ftxui::Event::ArrowUp);
+        helper.RenderFrame();
+        ASSERT_EQ(editor_row(), helper.NativePreviewRowForLine(helper.CurrentRealLine()));
+    }
+}
+
 TEST(App_Help) {
     test::AppTestHelper helper;
     
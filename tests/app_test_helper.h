@@ -3,6 +3,8 @@
 #include "tui_bindings.h"
 #include <ftxui/component/event.hpp>
 #include <ftxui/component/screen_interactive.hpp>
+#include <ftxui/dom/node.hpp>
+#include <ftxui/screen/screen.hpp>
 #include <memory>
 #include <string>
 #include <vector>
@@ -56,11 +58,104 @@ public:
         return result;
     }
 
+    // Load a file without starting the event loop
+    bool LoadFile(const std::string& filename) {
+        return app_->LoadFile(filename);
+    }
+
+    // Render one frame into an off-screen buffer (no terminal needed)
+    void RenderFrame(int width = 120, int height = 40) {
+        if (!component_) {
+            component_ = app_->CreateMainComponent();
+        }
+        auto screen = ftxui::Screen::Create(ftxui::Dimension::Fixed(width),
+                                            ftxui::Dimension::Fixed(height));
+        ftxui::Render(screen, component_->Render());
+    }
+
+    // プレビューの状態確認
+    PreviewMode GetPreviewMode() const { return app_->preview_mode_; }
+    bool IsPreviewRequested() const { return app_->preview_requested_; }
+    size_t NativePreviewBlockCount() const { return app_->native_blocks_.size(); }
+    // 直近に描いたネイティブプレビューで、ソース行が何段目に表示されたか
+    int NativePreviewRowForLine(int real_line) const { return app_->native_scroll_map_.RowForLine(real_line); }
+    int EditorCursorScreenRow() const { return app_->EditorCursorScreenRow(); }
+    int CurrentRealLine() const { return app_->VisibleToRealIndex(app_->current_line_); }
+
+    // 検索の状態確認
+    const std::vector<SearchMatch>& GetSearchMatches() const { return app_->search_matches_; }
+    int GetCurrentMatch() const { return app_->current_match_; }
+    int GetHorizontalScroll() const { return app_->h_scroll_; }
+    const std::vector<HighlightSpan>* GetEditorSpans(int real_line) { return app_->EditorSpans(real_line); }
+    // 入力しながらの検索の残りの走査を進める（UI ループの代わり）。進めた回数を返す
+    int RunSearchSteps() {
+        int steps = 0;
+        while (!app_->ActiveSearch().Done()) {
+            app_->StepIncrementalSearch();
+            ++steps;
+        }
+        while (app_->regex_search_) {
+            app_->StepRegexSearch();
+            ++steps;
+        }
+        return steps;
+    }
+    bool IsSearchDone() const { return app_->ActiveSearch().Done() && !app_->regex_search_; }
+    // 検索の索引を作り終える（小さな文書では作らないので、テストでは明示的に作る）
+    void BuildSearchIndex() {
+        app_->search_index_->Build();
+        while (!app_->search_index_->Step()) {}
+    }
+    TrigramIndex::State GetSearchIndexState() const { return app_->search_index_->GetState(); }
+    const std::string& GetStatusMessage() const { return app_->status_message_; }
+    const std::vector<std::string>& GetLines() const { return app_->lines_; }
+    // 編集モードで 1 行を書き換えて Enter で確定したときと同じ更新
+    void EditLine(int real_line, const std::string& text) {
+        app_->lines_[real_line] = text;
+        app_->NotifyLineChanged(real_line);
+        app_->UpdateBlockModel();
+    }
+    bool IsModified() const { return app_->modified_; }
+    const std::string& GetFilename() const { return app_->filename_; }
+
+    // ディレクトリ検索が終わるのを待って、結果を一覧に取り出す（UI ループの代わり）
+    void WaitDirectorySearch() {
+        while (!app_->dir_search_->GetProgress().done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        app_->PollDirectorySearch();
+    }
+    const std::vector<DirectorySearch::Match>& GetDirectoryMatches() const { return app_->dir_matches_; }
+    const std::vector<std::string>& GetDirectoryFiles() const { return app_->dir_files_; }
+    bool IsDirectoryResultsShown() const { return app_->show_dir_results_; }
+
+    // DOCX のジョブが終わるのを待って、結果を反映する（UI ループの代わり）
+    void WaitDocxJob() {
+        while (app_->docx_job_->Running()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        app_->FinishDocxJob();
+    }
+    // work が戻ったあと、結果を反映する前に Esc の中断が届いた場合
+    void WaitDocxJobCancelledLate() {
+        while (app_->docx_job_->Running()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        app_->docx_job_->Cancel();
+        app_->FinishDocxJob();
+    }
+    bool IsDocxJobRunning() const { return app_->docx_job_->Running(); }
+    // ステータス欄に出ている文字列（ジョブの実行中は進み具合）
+    std::string GetStatusText() const {
+        return app_->docx_job_->Running() ? app_->docx_job_->StatusText() : app_->status_message_;
+    }
+
     // Get the app instance for direct state checks
     App* GetApp() { return app_.get(); }
 
 private:
     std::unique_ptr<App> app_;
+    ftxui::Component component_;
 };
 
 } // namespace test
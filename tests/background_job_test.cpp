@@ -0,0 +1,88 @@
+#include "test_framework.h"
+#include "background_job.h"
+#include <chrono>
+#include <thread>
+
+using namespace ShinoEditor;
+
+namespace {
+void WaitUntilDone(const BackgroundJob& job) {
+    while (job.Running()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+}
+
+TEST(BackgroundJob_RunsOffThreadAndTicks) {
+    std::atomic<int> ticks{0};
+    std::atomic<int> finished{0};
+    std::atomic<bool> release{false};
+    BackgroundJob job([&] { ++ticks; }, [&] {
+        // Running() が false になってから呼ばれる
+        finished += job.Running() ? 100 : 1;
+    });
+    const auto caller = std::this_thread::get_id();
+    std::thread::id worker;
+    ASSERT_TRUE(job.Start("Importing a.docx", [&](const std::atomic<bool>&) {
+        worker = std::this_thread::get_id();
+        while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }));
+    ASSERT_TRUE(job.Running());
+    // 実行中は次を始めない
+    ASSERT_FALSE(job.Start("second", [](const std::atomic<bool>&) {}));
+
+    std::this_thread::sleep_for(BackgroundJob::kTickInterval * 3);
+    ASSERT_TRUE(job.StatusText().find("Importing a.docx ") == 0);
+    ASSERT_TRUE(job.StatusText().find("(Esc to cancel)") != std::string::npos);
+    release = true;
+    WaitUntilDone(job);
+    ASSERT_TRUE(worker != caller);
+    ASSERT_TRUE(ticks >= 1);
+    ASSERT_FALSE(job.Cancelled());
+    ASSERT_TRUE(job.Elapsed() >= BackgroundJob::kTickInterval * 3);
+
+    // 終わったあとの経過時間は止まる。続けて次を始められる
+    const auto elapsed = job.Elapsed();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(job.Elapsed() == elapsed);
+    bool ran = false;
+    ASSERT_TRUE(job.Start("second", [&](const std::atomic<bool>&) { ran = true; }));
+    // 前のスレッドは Start() で回収済み（on_finished も呼び終えている）
+    ASSERT_EQ(finished.load(), 1);
+    WaitUntilDone(job);
+    ASSERT_TRUE(ran);
+}
+
+TEST(BackgroundJob_CancelSetsFlagForWork) {
+    BackgroundJob job;
+    bool saw_cancel = false;
+    job.Start("Exporting b.docx", [&](const std::atomic<bool>& cancel) {
+        while (!cancel) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        saw_cancel = true;
+    });
+    job.Cancel();
+    ASSERT_TRUE(job.StatusText().find("(cancelling)") != std::string::npos || !job.Running());
+    WaitUntilDone(job);
+    ASSERT_TRUE(saw_cancel);
+    ASSERT_TRUE(job.Cancelled());
+
+    // 破棄するときは中断して待つ
+    std::atomic<bool> stopped{false};
+    {
+        BackgroundJob scoped;
+        scoped.Start("long", [&stopped](const std::atomic<bool>& cancel) {
+            while (!cancel) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stopped = true;
+        });
+    }
+    ASSERT_TRUE(stopped.load());
+}
+
+TEST(BackgroundJob_SpinnerAdvancesWithTime) {
+    const std::string a = BackgroundJob::SpinnerFrame(std::chrono::milliseconds(0));
+    const std::string b = BackgroundJob::SpinnerFrame(BackgroundJob::kTickInterval);
+    ASSERT_FALSE(a == b);
+    ASSERT_EQ(a, std::string(BackgroundJob::SpinnerFrame(BackgroundJob::kTickInterval * 10)));
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,167 @@
+#include "test_framework.h"
+#include "batch_renderer.h"
+#include "bounded_queue.h"
+#include "error_handler.h"
+#include "html_export.h"
+#include "mapped_file.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace ShinoEditor;
+namespace fs = std::filesystem;
+
+namespace {
+std::string ReadAll(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void WriteAll(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+std::string Expected(const MarkdownRenderer& renderer, const std::string& md, const std::string& title) {
+    std::string out;
+    StringSink sink(out);
+    HtmlExport::WriteHeader(sink, title);
+    out += renderer.RenderToHtml(md);
+    HtmlExport::WriteFooter(sink);
+    return out;
+}
+
+// in/ に a.md, sub/b.markdown, sub/deep/c.md, notes.txt を作る
+fs::path MakeTree() {
+    auto dir = test_utils::create_temp_dir("batch_render");
+    WriteAll(dir / "in" / "a.md", "# A\n\nalpha *one*\n");
+    WriteAll(dir / "in" / "sub" / "b.markdown", "- b1\n- b2\n");
+    WriteAll(dir / "in" / "sub" / "deep" / "c.md", "```\ncode\n```\n");
+    WriteAll(dir / "in" / "notes.txt", "not markdown");
+    return dir;
+}
+}
+
+TEST(BoundedQueue_BlocksWhenFullAndDrainsAfterClose) {
+    BoundedQueue<int> queue(2);
+    ASSERT_TRUE(queue.Push(1));
+    ASSERT_TRUE(queue.Push(2));
+    // 満杯なので 3 つ目は取り出されるまで待つ
+    std::thread producer([&] { queue.Push(3); queue.Close(); });
+    ASSERT_EQ(*queue.Pop(), 1);
+    ASSERT_EQ(*queue.Pop(), 2);
+    ASSERT_EQ(*queue.Pop(), 3);
+    ASSERT_TRUE(!queue.Pop().has_value());
+    producer.join();
+    ASSERT_TRUE(!queue.Push(4));
+}
+
+TEST(MappedFile_ViewsContents) {
+    auto path = test_utils::create_temp_file("hello mapped file");
+    MappedFile file;
+    ASSERT_TRUE(file.Open(path.string()));
+    ASSERT_EQ(std::string(file.View()), std::string("hello mapped file"));
+    // ムーブしても同じ内容を指す
+    MappedFile moved = std::move(file);
+    ASSERT_EQ(std::string(moved.View()), std::string("hello mapped file"));
+    ASSERT_TRUE(!file.IsOpen());
+    fs::remove(path);
+
+    auto empty = test_utils::create_temp_file("");
+    ASSERT_TRUE(file.Open(empty.string()));
+    ASSERT_EQ(file.Size(), static_cast<size_t>(0));
+    fs::remove(empty);
+    ASSERT_TRUE(!file.Open((fs::temp_directory_path() / "shino_missing_file.md").string()));
+}
+
+TEST(BatchRenderer_RendersTreeAndSkipsUnchanged) {
+    auto dir = MakeTree();
+    MarkdownRenderer renderer;
+    BatchRenderer batch(renderer);
+    BatchRenderer::Options options;
+    options.input_dir = dir / "in";
+    options.output_dir = dir / "out";
+    options.jobs = 3;
+    std::ostringstream log;
+    options.log = &log;
+
+    auto first = batch.Run(options);
+    ASSERT_EQ(first.files, static_cast<size_t>(3));
+    ASSERT_EQ(first.rendered, static_cast<size_t>(3));
+    ASSERT_EQ(first.failed, static_cast<size_t>(0));
+    ASSERT_EQ(ReadAll(dir / "out" / "a.html"), Expected(renderer, "# A\n\nalpha *one*\n", "a"));
+    ASSERT_EQ(ReadAll(dir / "out" / "sub" / "deep" / "c.html"), Expected(renderer, "```\ncode\n```\n", "c"));
+    ASSERT_TRUE(fs::exists(dir / "out" / "sub" / "b.html"));
+    ASSERT_TRUE(!fs::exists(dir / "out" / "notes.html"));
+    // 一時ファイル（HTML とマニフェスト）は残らない
+    for (const auto& entry : fs::recursive_directory_iterator(dir / "out")) {
+        ASSERT_TRUE(entry.path().extension() != ".tmp");
+    }
+    // ファイルごとの所要時間
+    ASSERT_TRUE(log.str().find("render ") != std::string::npos);
+    ASSERT_TRUE(log.str().find("sub/deep/c.md") != std::string::npos);
+
+    // 変更がなければすべて飛ばす
+    auto second = batch.Run(options);
+    ASSERT_EQ(second.rendered, static_cast<size_t>(0));
+    ASSERT_EQ(second.skipped, static_cast<size_t>(3));
+
+    // 変更したファイルと、出力が消えたファイルだけを変換し直す
+    WriteAll(dir / "in" / "a.md", "# A2\n");
+    fs::remove(dir / "out" / "sub" / "b.html");
+    auto third = batch.Run(options);
+    ASSERT_EQ(third.rendered, static_cast<size_t>(2));
+    ASSERT_EQ(third.skipped, static_cast<size_t>(1));
+    ASSERT_EQ(ReadAll(dir / "out" / "a.html"), Expected(renderer, "# A2\n", "a"));
+
+    // --force なら全部
+    options.force = true;
+    ASSERT_EQ(batch.Run(options).rendered, static_cast<size_t>(3));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(BatchRenderer_ReportsFilesWithTheSameOutput) {
+    auto dir = MakeTree();
+    // sub/b.md と sub/b.markdown はどちらも sub/b.html になる。.md を変換し、.markdown は報告して飛ばす
+    WriteAll(dir / "in" / "sub" / "b.md", "# B\n");
+    MarkdownRenderer renderer;
+    BatchRenderer::Options options;
+    options.input_dir = dir / "in";
+    options.output_dir = dir / "out";
+    options.jobs = 2;
+    std::ostringstream log;
+    options.log = &log;
+    for (int run = 0; run < 2; ++run) {
+        const auto summary = BatchRenderer(renderer).Run(options);
+        ASSERT_EQ(summary.files, static_cast<size_t>(4));
+        ASSERT_EQ(summary.failed, static_cast<size_t>(1));
+        ASSERT_EQ(ReadAll(dir / "out" / "sub" / "b.html"), Expected(renderer, "# B\n", "b"));
+    }
+    ASSERT_TRUE(log.str().find("error  sub/b.markdown: same output as sub/b.md") != std::string::npos);
+    // マニフェストには変換したファイルだけを記録する
+    ASSERT_TRUE(ReadAll(dir / "out" / BatchRenderer::kManifestName).find("b.markdown") == std::string::npos);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(BatchRenderer_MissingInputThrows) {
+    auto dir = test_utils::create_temp_dir("batch_render");
+    MarkdownRenderer renderer;
+    BatchRenderer::Options options;
+    options.input_dir = dir / "missing";
+    options.output_dir = dir / "out";
+    bool thrown = false;
+    try {
+        BatchRenderer(renderer).Run(options);
+    } catch (const ShinoError& e) {
+        thrown = e.category() == ShinoError::Category::File;
+    }
+    ASSERT_TRUE(thrown);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,185 @@
+#include "test_framework.h"
+#include "block_render_cache.h"
+#include <sstream>
+
+using namespace ShinoEditor;
+
+namespace {
+std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) lines.push_back(line);
+    return lines;
+}
+
+std::vector<std::string> BuildUnits(const std::vector<std::string>& lines,
+                                    const std::vector<LineRange>& ranges) {
+    std::vector<std::string> units;
+    for (const auto& range : ranges) {
+        std::string unit;
+        for (int i = range.begin; i < range.end; ++i) unit += lines[i] + "\n";
+        units.push_back(unit);
+    }
+    return units;
+}
+
+const char* kDocument =
+    "# Title\n"
+    "\n"
+    "Intro with **bold** text.\n"
+    "\n"
+    "## Section\n"
+    "\n"
+    "- one\n"
+    "- two\n"
+    "\n"
+    "```\n"
+    "code\n"
+    "```\n"
+    "\n"
+    "Tail paragraph.\n";
+
+// Markdown の中のコードフェンスを見せる文書（~~~ の中の ```、長い ```` の中の ```）
+const char* kNestedFences =
+    "Example:\n"
+    "\n"
+    "~~~markdown\n"
+    "```cpp\n"
+    "int x = 1;\n"
+    "```\n"
+    "~~~\n"
+    "\n"
+    "After.\n"
+    "\n"
+    "````\n"
+    "```\n"
+    "# not a heading\n"
+    "```\n"
+    "````\n"
+    "\n"
+    "- item\n";
+}
+
+TEST(SplitRenderUnits_FollowsBlocks) {
+    auto lines = SplitLines(kDocument);
+    BlockModel bm(lines);
+    auto units = BlockRenderCache::SplitRenderUnits(lines, bm.GetBlocks());
+    ASSERT_EQ(static_cast<int>(units.size()), static_cast<int>(bm.GetBlocks().size()));
+    ASSERT_EQ(units.front().begin, 0);
+    ASSERT_EQ(units.back().end, static_cast<int>(lines.size()));
+    for (size_t i = 1; i < units.size(); ++i) {
+        ASSERT_EQ(units[i].begin, units[i - 1].end);
+    }
+}
+
+TEST(SplitRenderUnits_KeepsUnsafeBoundaries) {
+    // 引用の遅延継続行は引用と同じ単位にする
+    std::vector<std::string> lines = {"> quote", "lazy", "", "# H"};
+    BlockModel bm(lines);
+    auto units = BlockRenderCache::SplitRenderUnits(lines, bm.GetBlocks());
+    ASSERT_EQ(static_cast<int>(units.size()), 2);
+    ASSERT_EQ(units[0].end, 3);
+    // 遅延継続行の後の引用の行は同じ引用の続き
+    lines = {"> q", "lazy", "> q", "lazy", "", "# H"};
+    BlockModel bm_quote(lines);
+    units = BlockRenderCache::SplitRenderUnits(lines, bm_quote.GetBlocks());
+    ASSERT_EQ(units[0].end, 5);
+
+    // リンク参照定義がある文書は分割しない
+    lines = {"# H", "", "[x][ref]", "", "# H2", "", "[ref]: https://example.com"};
+    BlockModel bm2(lines);
+    units = BlockRenderCache::SplitRenderUnits(lines, bm2.GetBlocks());
+    ASSERT_EQ(static_cast<int>(units.size()), 1);
+}
+
+TEST(SplitRenderUnits_KeepsMixedFencesTogether) {
+    // 開いたフェンスと文字や長さの違うフェンス行では分けない
+    auto lines = SplitLines(kNestedFences);
+    BlockModel bm(lines);
+    auto units = BlockRenderCache::SplitRenderUnits(lines, bm.GetBlocks());
+    for (const auto& unit : units) {
+        ASSERT_FALSE(unit.begin > 2 && unit.begin <= 6);
+        ASSERT_FALSE(unit.begin > 10 && unit.begin <= 14);
+    }
+    // フェンスの外では今までどおり分ける
+    ASSERT_TRUE(units.size() >= 4);
+
+    MarkdownRenderer renderer;
+    BlockRenderCache cache(renderer);
+    ASSERT_EQ(cache.Render(BuildUnits(lines, units)), renderer.RenderToHtml(kNestedFences));
+}
+
+TEST(Render_MatchesWholeDocument) {
+    MarkdownRenderer renderer;
+    BlockRenderCache cache(renderer);
+    auto lines = SplitLines(kDocument);
+    BlockModel bm(lines);
+    auto units = BuildUnits(lines, BlockRenderCache::SplitRenderUnits(lines, bm.GetBlocks()));
+    ASSERT_EQ(cache.Render(units), renderer.RenderToHtml(kDocument));
+}
+
+TEST(Render_OnlyEditedUnitIsRendered) {
+    MarkdownRenderer renderer;
+    BlockRenderCache cache(renderer);
+    auto lines = SplitLines(kDocument);
+    BlockModel bm(lines);
+    cache.Render(BuildUnits(lines, BlockRenderCache::SplitRenderUnits(lines, bm.GetBlocks())));
+    const size_t misses = cache.GetStats().misses;
+
+    lines[2] = "Intro with *changed* text.";
+    bm.UpdateLines();
+    cache.Render(BuildUnits(lines, BlockRenderCache::SplitRenderUnits(lines, bm.GetBlocks())));
+    ASSERT_EQ(cache.GetStats().misses, misses + 1);
+}
+
+TEST(Render_EvictsLeastRecentlyUsed) {
+    MarkdownRenderer renderer;
+    // 断片 1 個分程度しか入らない上限
+    BlockRenderCache cache(renderer, 200);
+    cache.Render({"# A\n"});
+    cache.Render({"# B\n"});
+    ASSERT_TRUE(cache.MemoryUsage() <= 200);
+    ASSERT_EQ(static_cast<int>(cache.EntryCount()), 1);
+    ASSERT_TRUE(cache.GetStats().evictions >= 1);
+
+    // 最近使った B は残っている
+    const size_t hits = cache.GetStats().hits;
+    cache.Render({"# B\n"});
+    ASSERT_EQ(cache.GetStats().hits, hits + 1);
+}
+
+TEST(Render_ParallelMatchesSerial) {
+    MarkdownRenderer renderer;
+    // 入れ子のフェンスを含む文書でも、並列の結果は直列の結果とも文書全体を 1 回でレンダリングした結果とも同じ
+    std::string doc;
+    for (int i = 0; i < 200; ++i) {
+        doc += kDocument;
+        doc += "\n";
+        doc += kNestedFences;
+        doc += "\n";
+    }
+    auto lines = SplitLines(doc);
+    BlockModel bm(lines);
+    auto units = BuildUnits(lines, BlockRenderCache::SplitRenderUnits(lines, bm.GetBlocks()));
+
+    BlockRenderCache serial(renderer);
+    BlockRenderCache parallel(renderer);
+    ThreadPool pool(4);
+    const std::string expected = serial.Render(units);
+    ASSERT_EQ(parallel.Render(units, nullptr, &pool), expected);
+    // 同じ内容の単位は 1 回だけレンダリングされる
+    ASSERT_EQ(parallel.GetStats().misses, serial.GetStats().misses);
+    ASSERT_EQ(expected, renderer.RenderToHtml(doc));
+}
+
+TEST(Hash_DistinguishesContent) {
+    ASSERT_NE(BlockRenderCache::Hash("abc"), BlockRenderCache::Hash("abd"));
+    ASSERT_NE(BlockRenderCache::Hash("12345678a"), BlockRenderCache::Hash("12345678b"));
+    ASSERT_NE(BlockRenderCache::Hash(""), BlockRenderCache::Hash(std::string(1, '\0')));
+    ASSERT_EQ(BlockRenderCache::Hash("same"), BlockRenderCache::Hash("same"));
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,97 @@
+#include "test_framework.h"
+#include "column_index.h"
+
+using namespace ShinoEditor;
+
+TEST(ColumnSlice_Ascii) {
+    const std::string line = "0123456789";
+    ColumnIndex index;
+    index.Build(line);
+    ASSERT_EQ(index.TotalColumns(), 10);
+
+    auto slice = index.ColumnSlice(line, 3, 4);
+    ASSERT_EQ(line.substr(slice.begin, slice.end - slice.begin), std::string("3456"));
+    ASSERT_EQ(slice.lead_padding, 0);
+
+    // 行末を越える範囲は空
+    slice = index.ColumnSlice(line, 20, 4);
+    ASSERT_EQ(slice.begin, slice.end);
+}
+
+TEST(ColumnSlice_WideCharCut) {
+    // "あいう" は 6 桁。桁 1 から始めると「あ」の右半分は空白で補う
+    const std::string line = "あいう";
+    ColumnIndex index;
+    index.Build(line);
+    ASSERT_EQ(index.TotalColumns(), 6);
+
+    auto slice = index.ColumnSlice(line, 1, 4);
+    ASSERT_EQ(slice.lead_padding, 1);
+    ASSERT_EQ(line.substr(slice.begin, slice.end - slice.begin), std::string("い"));
+
+    // 右端で切れる全角文字は含めない
+    slice = index.ColumnSlice(line, 0, 3);
+    ASSERT_EQ(line.substr(slice.begin, slice.end - slice.begin), std::string("あ"));
+}
+
+TEST(ColumnOf_MixedWidth) {
+    const std::string line = "ab漢字c";
+    ColumnIndex index;
+    index.Build(line);
+    ASSERT_EQ(index.ColumnOf(line, 0), 0);
+    ASSERT_EQ(index.ColumnOf(line, 2), 2);
+    ASSERT_EQ(index.ColumnOf(line, 5), 4);  // 「字」
+    ASSERT_EQ(index.ColumnOf(line, 8), 6);  // "c"
+    ASSERT_EQ(index.ColumnOf(line, 100), 7);
+
+    // チェックポイントをまたぐ長い行
+    std::string long_line;
+    for (int i = 0; i < 10000; ++i) long_line += "漢a";
+    index.Build(long_line);
+    ASSERT_EQ(index.ColumnOf(long_line, 4 * 9000), 3 * 9000);
+}
+
+TEST(ColumnSlice_LongLineUsesCheckpoints) {
+    // チェックポイント間隔を何度もまたぐ長い行（ASCII と全角の混在）
+    std::string line;
+    for (int i = 0; i < 20000; ++i) line += (i % 2 == 0) ? "ab" : "漢";
+    ColumnIndex index;
+    index.Build(line);
+    ASSERT_EQ(index.TotalColumns(), 20000 * 2);
+
+    // 桁 30000 は 7500 組目（"ab漢" = 4 桁 / 5 バイト）の先頭
+    auto slice = index.ColumnSlice(line, 30000, 8);
+    ASSERT_EQ(slice.begin, static_cast<size_t>(7500 * 5));
+    ASSERT_EQ(line.substr(slice.begin, slice.end - slice.begin), std::string("ab漢ab漢"));
+}
+
+TEST(TailSlice_FitsWidth) {
+    const std::string line = "abcあい_";
+    auto slice = ColumnIndex::TailSlice(line, 5);
+    ASSERT_EQ(line.substr(slice.begin), std::string("あい_"));
+    slice = ColumnIndex::TailSlice(line, 100);
+    ASSERT_EQ(slice.begin, static_cast<size_t>(0));
+}
+
+TEST(Cache_EditNotifications) {
+    std::vector<std::string> lines = {"abc", "あいう"};
+    ColumnIndexCache cache(lines);
+    ASSERT_EQ(cache.Get(1).TotalColumns(), 6);
+
+    lines.insert(lines.begin(), "0123456789");
+    cache.InsertLines(0, 1);
+    ASSERT_EQ(cache.Get(0).TotalColumns(), 10);
+    ASSERT_EQ(cache.Get(2).TotalColumns(), 6);
+
+    lines[2] = "x";
+    cache.InvalidateLine(2);
+    ASSERT_EQ(cache.Get(2).TotalColumns(), 1);
+
+    lines.erase(lines.begin());
+    cache.EraseLines(0, 1);
+    ASSERT_EQ(cache.Get(0).TotalColumns(), 3);
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,188 @@
+#include "test_framework.h"
+#include "deflate.h"
+#include <vector>
+
+using namespace ShinoEditor;
+
+namespace {
+std::string FromHex(std::string_view hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) out += static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16));
+    return out;
+}
+
+// 展開結果と、on_output に渡された回数
+bool InflateAll(std::string_view input, std::string& out, size_t* calls = nullptr) {
+    out.clear();
+    return Inflater::Inflate(input, [&](std::string_view chunk) {
+        out.append(chunk);
+        if (calls) ++*calls;
+        return true;
+    });
+}
+
+// 固定ハフマンのブロックを組み立てる（符号は上位ビットから、追加ビットは下位ビットから詰める）
+class FixedBlockWriter {
+public:
+    FixedBlockWriter() {
+        Bits(1, 1); // 最後のブロック
+        Bits(1, 2); // 固定ハフマン
+    }
+    // 0..143 の値だけ（8 ビットの符号）
+    void Literal(int value) { Code(0x30 + value, 8); }
+    void Match258(int distance_extra_13bits) {
+        Code(0xC0 + (285 - 280), 8); // 長さ 258
+        Code(29, 5);                 // 距離 24577 + 13 ビット
+        Bits(static_cast<uint32_t>(distance_extra_13bits), 13);
+    }
+    std::string Finish() {
+        Code(0, 7); // ブロックの終わり
+        if (used_ > 0) out_ += static_cast<char>(current_);
+        return out_;
+    }
+
+private:
+    std::string out_;
+    uint32_t current_ = 0;
+    int used_ = 0;
+
+    void Bit(uint32_t bit) {
+        current_ |= bit << used_;
+        if (++used_ == 8) {
+            out_ += static_cast<char>(current_);
+            current_ = 0;
+            used_ = 0;
+        }
+    }
+    void Bits(uint32_t value, int n) {
+        for (int i = 0; i < n; ++i) Bit((value >> i) & 1);
+    }
+    void Code(uint32_t code, int n) {
+        for (int i = n - 1; i >= 0; --i) Bit((code >> i) & 1);
+    }
+};
+}
+
+TEST(Inflate_StoredFixedAndDynamicBlocks) {
+    std::string out;
+    // 格納ブロック
+    ASSERT_TRUE(InflateAll(FromHex("011100eeff73746f72656420626c6f636b2064617461"), out));
+    ASSERT_EQ(out, std::string("stored block data"));
+    // 固定ハフマン（重なる写しを含む）
+    ASSERT_TRUE(InflateAll(FromHex("cb48cdc9c9d751c840a214caf38b725200"), out));
+    ASSERT_EQ(out, std::string("hello, hello, hello world"));
+    // 動的ハフマン（zlib の最大圧縮）
+    const std::string compressed = FromHex(
+        "d5d24b4a03411006e0bda7e813c8f4a3baa7056f910b441d351a331a4d7cac320988e001b21117829b60dc0bdea631780c85"
+        "a9fa47fa062eeb4f77f55795e91d57ea6232d83f557be3fa7aa40eeb1b7532393bbf54f5b41aababdf9f87fdbb5b75501f6d"
+        "abcdf275f3f4f6bd7a4ecd7b5adca7f93acd3fd2e221cd9ad43ca666b5f97cf95a2fd36cbed5fb677d878351a58a1d35ed0f"
+        "27d56ed1d65a6addd6466ad7d656ead8d60ee77d1b900486dac04b60f944404bee514ae0f9912841c90a0da6e5004ec37774"
+        "270d9cc01a0c27d04a00ad9597c0f57206dec8136980ad70200ebc4703b1e63e0664e25b06e4c8ab31203b1ecb801ce51f81"
+        "d9491f98a3dc8299c40373c901c89ec7b2201bdea005b9e45b1664920f0264c3835a904bfe832dc89e87b0dd5721af83ace5"
+        "4c47e6f5d8cecc8983d9b1d0c16cd9e360d672066669d36d9977ea402e19e8400ef2ed831ce40cc841fac43ca122bf453aef"
+        "4c267f9d6c2e24970d4194cf493edf05857c5f54e63ba5f867ef3f");
+    std::string expected;
+    for (int i = 0; i < 3; ++i) expected += "The quick brown fox jumps over the lazy dog. 日本語のテキスト、かな漢字。\n";
+    for (int i = 0; i < 60; ++i) expected += "line " + std::to_string(i) + ": value=" + std::to_string(i * i % 97) + "\n";
+    ASSERT_TRUE(InflateAll(compressed, out));
+    ASSERT_TRUE(out == expected);
+    ASSERT_EQ(Crc32(out), 0x1343c5c8u);
+}
+
+TEST(Inflate_FarMatchesAcrossFlushes) {
+    // 32KB のリテラルのあと、距離 32768（窓の端）の写しを続けて 1MB ほどにする
+    FixedBlockWriter writer;
+    std::string expected;
+    for (int i = 0; i < 32768; ++i) {
+        const int value = (i * 7919 + (i >> 3)) % 144;
+        writer.Literal(value);
+        expected += static_cast<char>(value);
+    }
+    for (int i = 0; i < 4000; ++i) {
+        writer.Match258(32768 - 24577);
+        for (int k = 0; k < 258; ++k) expected += expected[expected.size() - 32768];
+    }
+    std::string out;
+    size_t calls = 0;
+    ASSERT_TRUE(InflateAll(writer.Finish(), out, &calls));
+    ASSERT_EQ(out.size(), expected.size());
+    ASSERT_TRUE(out == expected);
+    // 溜めた分ずつ渡す
+    ASSERT_TRUE(calls >= expected.size() / (Inflater::kFlushBytes + Inflater::kWindowBytes));
+
+    // on_output が false なら止める
+    size_t seen = 0;
+    ASSERT_FALSE(Inflater::Inflate(writer.Finish(), [&](std::string_view chunk) {
+        seen += chunk.size();
+        return false;
+    }));
+    ASSERT_TRUE(seen > 0 && seen < expected.size());
+}
+
+TEST(Inflate_RejectsCorruptData) {
+    std::string out;
+    const std::string good = FromHex("cb48cdc9c9d751c840a214caf38b725200");
+    // 途中で切れている
+    ASSERT_FALSE(InflateAll(good.substr(0, good.size() / 2), out));
+    // ブロックの種類 3
+    ASSERT_FALSE(InflateAll(std::string(1, '\x07'), out));
+    // 格納ブロックの長さの補数が合わない
+    ASSERT_FALSE(InflateAll(FromHex("0111000000"), out));
+    // 出力の前を指す距離
+    FixedBlockWriter writer;
+    writer.Literal(1);
+    writer.Match258(0);
+    ASSERT_FALSE(InflateAll(writer.Finish(), out));
+    // 空の入力
+    ASSERT_FALSE(InflateAll("", out));
+}
+
+TEST(Deflater_RoundTripsThroughInflater) {
+    std::string text;
+    for (int i = 0; i < 5000; ++i) text += "<w:p><w:r><w:t>line " + std::to_string(i % 97) + "</w:t></w:r></w:p>\n";
+    // 乱数は再現できるように xorshift で作る
+    std::string noise(200000, '\0');
+    uint32_t state = 2463534242u;
+    for (auto& c : noise) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        c = static_cast<char>(state);
+    }
+    // ウィンドウの端をまたぐ一致
+    std::string far = noise.substr(0, 1000) + std::string(Deflater::kWindowBytes - 1200, 'z') + noise.substr(0, 1000);
+    const std::vector<std::string> inputs = {"", "a", std::string(100000, 'a'), text, noise, far};
+    for (const auto& input : inputs) {
+        for (size_t chunk : {size_t(1), size_t(4093), size_t(1) << 20}) {
+            if (chunk == 1 && input.size() > 100000) continue;
+            std::string compressed;
+            size_t calls = 0;
+            Deflater deflater([&](std::string_view data) { compressed.append(data); ++calls; });
+            for (size_t i = 0; i < input.size(); i += chunk) deflater.Write(std::string_view(input).substr(i, chunk));
+            deflater.Finish();
+            ASSERT_EQ(deflater.BytesIn(), input.size());
+            std::string out;
+            ASSERT_TRUE(InflateAll(compressed, out));
+            ASSERT_TRUE(out == input);
+            if (input == noise) {
+                // 縮まないデータは格納ブロックになり、ほとんど大きくならない
+                ASSERT_TRUE(compressed.size() < input.size() + input.size() / 1000 + 16);
+                ASSERT_TRUE(calls > 1);
+            } else if (input.size() > 1000) {
+                ASSERT_TRUE(compressed.size() < input.size() / 5);
+            }
+        }
+    }
+}
+
+TEST(Crc32_MatchesKnownValues) {
+    ASSERT_EQ(Crc32(""), 0u);
+    ASSERT_EQ(Crc32("The quick brown fox jumps over the lazy dog"), 0x414fa339u);
+    // 分けて計算しても同じ
+    const std::string text = "The quick brown fox jumps over the lazy dog";
+    ASSERT_EQ(Crc32(text.substr(13), Crc32(text.substr(0, 13))), 0x414fa339u);
+}
+
+int main() {
+    return run_all_tests();
+}
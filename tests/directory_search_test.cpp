@@ -0,0 +1,167 @@
+#include "test_framework.h"
+#include "directory_search.h"
+#include "error_handler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <tuple>
+
+using namespace ShinoEditor;
+namespace fs = std::filesystem;
+
+namespace {
+void WriteAll(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+struct Found {
+    std::string file;
+    int line;
+    size_t offset;
+    size_t length;
+    std::string preview;
+    bool operator<(const Found& o) const {
+        return std::tie(file, line, offset) < std::tie(o.file, o.line, o.offset);
+    }
+};
+
+// 終わるまで待って、結果を (ファイル, 行, オフセット) の順に並べて返す
+std::vector<Found> RunToEnd(DirectorySearch& search, const DirectorySearch::Options& options) {
+    search.Start(options);
+    std::vector<DirectorySearch::Match> matches;
+    std::vector<std::string> files;
+    while (!search.GetProgress().done) {
+        search.Poll(matches, files);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    search.Poll(matches, files);
+    std::vector<Found> out;
+    for (const auto& m : matches) out.push_back({files[m.file], m.line, m.offset, m.length, m.preview});
+    std::sort(out.begin(), out.end());
+    return out;
+}
+}
+
+TEST(DirectorySearch_LooksBinary) {
+    ASSERT_FALSE(DirectorySearch::LooksBinary("# 見出し\nplain text\n"));
+    ASSERT_TRUE(DirectorySearch::LooksBinary(std::string("PK\x03\x04\0\0", 6)));
+    // 先頭の量で切れた文字は不正として数えない
+    const std::string japanese = "日本語のテキスト";
+    ASSERT_FALSE(DirectorySearch::LooksBinary(std::string_view(japanese).substr(0, japanese.size() - 1)));
+    // Latin-1 など UTF-8 でないテキストはバイナリとして扱う
+    ASSERT_TRUE(DirectorySearch::LooksBinary("caf\xe9 na\xefve \xe0 la cr\xe8me"));
+}
+
+TEST(DirectorySearch_FindsAcrossTreeAndSkipsBinaryHugeAndHidden) {
+    auto dir = test_utils::create_temp_dir("dir_search");
+    WriteAll(dir / "a.md", "foo\nbar foo\n");
+    WriteAll(dir / "sub" / "b.txt", "xx\r\nfoo\r\n");
+    WriteAll(dir / "sub" / "none.md", "nothing here\n");
+    WriteAll(dir / ".git" / "objects" / "c", "foo\n");
+    WriteAll(dir / "image.png", std::string("foo\0\x89PNG", 8));
+    WriteAll(dir / "huge.md", std::string(200, 'x') + "foo\n");
+
+    DirectorySearch search;
+    DirectorySearch::Options options;
+    options.root = dir;
+    options.query = "foo";
+    options.workers = 2;
+    options.max_file_bytes = 100;
+    auto found = RunToEnd(search, options);
+    ASSERT_EQ(found.size(), size_t(3));
+    ASSERT_EQ(found[0].file, std::string("a.md"));
+    ASSERT_EQ(found[0].line, 0);
+    ASSERT_EQ(found[1].line, 1);
+    ASSERT_EQ(found[1].offset, size_t(4));
+    ASSERT_EQ(found[1].preview, std::string("bar foo"));
+    ASSERT_EQ(found[2].file, std::string("sub/b.txt"));
+    ASSERT_EQ(found[2].line, 1);
+    // 行末の \r は抜き出しに含めない
+    ASSERT_EQ(found[2].preview, std::string("foo"));
+
+    const auto progress = search.GetProgress();
+    ASSERT_TRUE(progress.done);
+    ASSERT_FALSE(progress.truncated);
+    ASSERT_EQ(progress.files_scanned, size_t(3));
+    ASSERT_EQ(progress.files_skipped, size_t(2));
+    ASSERT_EQ(progress.files_matched, size_t(2));
+    ASSERT_EQ(progress.matches, size_t(3));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DirectorySearch_RegexAndLongLinePreview) {
+    auto dir = test_utils::create_temp_dir("dir_search");
+    std::string row;
+    for (int i = 0; i < 300; ++i) row += "あ";
+    WriteAll(dir / "long.md", "head\n" + row + "color=12" + row + "\nx colour=7\n");
+
+    DirectorySearch search;
+    DirectorySearch::Options options;
+    options.root = dir;
+    options.query = "colou?r=[0-9]+";
+    options.regex = true;
+    auto found = RunToEnd(search, options);
+    ASSERT_EQ(found.size(), size_t(2));
+    ASSERT_EQ(found[0].line, 1);
+    ASSERT_EQ(found[0].offset, row.size());
+    ASSERT_EQ(found[0].length, size_t(8));
+    // 長い行は一致のまわりだけを、文字の途中で切らずに出す
+    const auto& preview = found[0].preview;
+    ASSERT_TRUE(preview.size() <= 8 + 2 * (DirectorySearch::kPreviewContext + 3));
+    ASSERT_TRUE(preview.find("color=12") != std::string::npos);
+    ASSERT_EQ(preview.substr(0, 3), std::string("あ"));
+    ASSERT_EQ(preview.substr(preview.size() - 3), std::string("あ"));
+    ASSERT_EQ(found[1].line, 2);
+    ASSERT_EQ(found[1].offset, size_t(2));
+
+    // 構文エラーと、ないディレクトリは Start() で投げる
+    options.query = "(";
+    bool thrown = false;
+    try {
+        search.Start(options);
+    } catch (const ShinoError&) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    options.query = "x";
+    options.root = dir / "missing";
+    thrown = false;
+    try {
+        search.Start(options);
+    } catch (const ShinoError& e) {
+        thrown = e.category() == ShinoError::Category::File;
+    }
+    ASSERT_TRUE(thrown);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DirectorySearch_StopsAtMaxMatchesAndCancels) {
+    auto dir = test_utils::create_temp_dir("dir_search");
+    for (int i = 0; i < 50; ++i) WriteAll(dir / ("f" + std::to_string(i) + ".md"), "hit hit\nhit\n");
+
+    DirectorySearch search;
+    DirectorySearch::Options options;
+    options.root = dir;
+    options.query = "hit";
+    options.workers = 3;
+    options.max_matches = 10;
+    auto found = RunToEnd(search, options);
+    ASSERT_EQ(found.size(), size_t(10));
+    ASSERT_TRUE(search.GetProgress().truncated);
+
+    // 取り消したあとは結果が増えず、もう一度始められる
+    options.max_matches = DirectorySearch::kDefaultMaxMatches;
+    search.Start(options);
+    search.Cancel();
+    ASSERT_FALSE(search.Running());
+    found = RunToEnd(search, options);
+    ASSERT_EQ(found.size(), size_t(150));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+int main() {
+    return run_all_tests();
+}
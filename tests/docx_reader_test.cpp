@@ -0,0 +1,151 @@
+#include "test_framework.h"
+#include "docx_reader.h"
+#include "docx_test_helper.h"
+#include "error_handler.h"
+
+using namespace ShinoEditor;
+using test_docx::Paragraph;
+using test_docx::Run;
+
+namespace {
+struct Converted {
+    std::string markdown;
+    DocxReader::Result result;
+    size_t calls = 0;
+};
+
+Converted Convert(const std::filesystem::path& dir, std::string_view body, std::string_view relationships = "") {
+    const auto path = dir / "t.docx";
+    test_docx::WriteFile(path, test_docx::BuildDocx(body, relationships));
+    Converted converted;
+    converted.result = DocxReader::Convert(path.string(), [&converted](std::string_view chunk) {
+        converted.markdown += chunk;
+        ++converted.calls;
+    });
+    return converted;
+}
+
+std::string Numbered(int num_id, int level) {
+    return "<w:numPr><w:ilvl w:val=\"" + std::to_string(level) + "\"/><w:numId w:val=\"" + std::to_string(num_id) +
+           "\"/></w:numPr>";
+}
+
+std::string Cell(std::string_view text) {
+    return "<w:tc><w:tcPr/>" + Paragraph(Run(text)) + "</w:tc>";
+}
+}
+
+TEST(DocxReader_HeadingsParagraphsAndInlineFormatting) {
+    auto dir = test_utils::create_temp_dir("docx_inline");
+    const auto converted = Convert(dir,
+        Paragraph(Run("Title"), "Heading1") +
+        Paragraph(Run("Sub"), "Chapter") + // basedOn で見出し 2
+        Paragraph(Run("Outline"), "", "<w:outlineLvl w:val=\"2\"/>") +
+        Paragraph(Run("plain ") + Run("bold", "<w:b/>") + Run(" and ") + Run("both ", "<w:rStyle w:val=\"Loud\"/>") +
+                  Run("a`b", "<w:rStyle w:val=\"VerbatimChar\"/>") + Run(" *x* ") + Run("gone", "<w:strike/>")) +
+        Paragraph(Run("1. not a list")) +
+        Paragraph("") +
+        Paragraph(Run("mono", "<w:rFonts w:ascii=\"Courier New\" w:hAnsi=\"Courier New\"/>") + Run(" &lt;tag&gt;")));
+    ASSERT_TRUE(converted.result.Complete());
+    ASSERT_EQ(converted.markdown, std::string(
+        "# Title\n\n## Sub\n\n### Outline\n\n"
+        "plain **bold** and ***both*** ``a`b`` \\*x\\* ~~gone~~\n\n"
+        "1\\. not a list\n\n"
+        "`mono` \\<tag>\n"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DocxReader_ListsCodeQuotesAndTables) {
+    auto dir = test_utils::create_temp_dir("docx_blocks");
+    const auto converted = Convert(dir,
+        Paragraph(Run("a"), "", Numbered(1, 0)) +
+        Paragraph(Run("b"), "", Numbered(1, 1)) +
+        Paragraph(Run("c"), "", Numbered(1, 0)) +
+        Paragraph(Run("para")) +
+        Paragraph(Run("one"), "", Numbered(2, 0)) +
+        Paragraph(Run("two"), "", Numbered(2, 0)) +
+        Paragraph(Run("sub"), "", Numbered(2, 1)) +
+        Paragraph(Run("int x;"), "SourceCode") +
+        Paragraph(Run("  ```"), "SourceCode") +
+        Paragraph(Run("q1"), "BlockText") +
+        Paragraph(Run("q2"), "BlockText") +
+        "<w:tbl><w:tblPr/><w:tr>" + Cell("h1") + Cell("h2") + "</w:tr><w:tr>" + Cell("a|b") + "</w:tr></w:tbl>");
+    ASSERT_TRUE(converted.result.Complete());
+    ASSERT_EQ(converted.markdown, std::string(
+        "- a\n  - b\n- c\n\npara\n\n3. one\n4. two\n   1. sub\n\n"
+        "````\nint x;\n  ```\n````\n\n"
+        "> q1\n>\n> q2\n\n"
+        "| h1 | h2 |\n| --- | --- |\n| a\\|b |  |\n"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DocxReader_LinksBreaksRevisionsAndUnsupportedContent) {
+    auto dir = test_utils::create_temp_dir("docx_links");
+    const std::string link =
+        "<Relationship Id=\"rIdLink\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/hyperlink\" "
+        "Target=\"https://example.com/a b\" TargetMode=\"External\"/>";
+    auto converted = Convert(dir,
+        Paragraph(Run("see ") + "<w:hyperlink r:id=\"rIdLink\">" + Run("site", "<w:b/>") + "</w:hyperlink>" +
+                  "<w:r><w:br/></w:r>" + Run("# not heading") +
+                  "<w:del><w:r><w:delText>gone</w:delText></w:r></w:del>" +
+                  "<w:ins>" + Run(" kept") + "</w:ins>" + Run("hidden", "<w:vanish/>")) +
+        // pandoc の水平線
+        Paragraph("<w:r><w:pict><v:rect o:hr=\"t\"/></w:pict></w:r>"), link);
+    ASSERT_TRUE(converted.result.Complete());
+    ASSERT_EQ(converted.markdown, std::string("see [**site**](<https://example.com/a b>)\\\n\\# not heading kept\n\n---\n"));
+
+    // 画像は落として続け、記録する
+    converted = Convert(dir,
+        Paragraph(Run("before") + "<w:r><w:drawing><wp:inline><a:t>alt</a:t></wp:inline></w:drawing></w:r>" + Run(" after")) +
+        Paragraph(Run("next")));
+    ASSERT_EQ(converted.result.unsupported, std::string("w:drawing"));
+    ASSERT_EQ(converted.markdown, std::string("before after\n\nnext\n"));
+
+    converted = Convert(dir, Paragraph(Run("note") + "<w:r><w:footnoteReference w:id=\"1\"/></w:r>"));
+    ASSERT_EQ(converted.result.unsupported, std::string("w:footnoteReference"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DocxReader_StreamsLargeDocumentsAndReportsErrors) {
+    auto dir = test_utils::create_temp_dir("docx_stream");
+    std::string body;
+    std::string expected;
+    for (int i = 0; i < 20000; ++i) {
+        body += Paragraph(Run("paragraph " + std::to_string(i)));
+        expected += (i ? "\n" : "") + std::string("paragraph ") + std::to_string(i) + "\n";
+    }
+    const auto converted = Convert(dir, body);
+    ASSERT_TRUE(converted.markdown == expected);
+    ASSERT_TRUE(converted.calls > 1);
+
+    // 止められる
+    std::atomic<bool> cancel{true};
+    bool cancelled = false;
+    try {
+        DocxReader::Convert((dir / "t.docx").string(), [](std::string_view) {}, &cancel);
+    } catch (const ShinoError& e) {
+        cancelled = e.category() == ShinoError::Category::Convert;
+    }
+    ASSERT_TRUE(cancelled);
+
+    // ZIP でない、本文がない、XML が壊れている
+    auto category = [&](std::string_view data) {
+        test_docx::WriteFile(dir / "bad.docx", data);
+        try {
+            DocxReader::Convert((dir / "bad.docx").string(), [](std::string_view) {});
+        } catch (const ShinoError& e) {
+            return e.category();
+        }
+        return ShinoError::Category::UI;
+    };
+    ASSERT_TRUE(category("PK") == ShinoError::Category::Parser);
+    test_docx::ZipBuilder empty;
+    empty.Add("word/styles.xml", test_docx::DefaultStyles());
+    ASSERT_TRUE(category(empty.Finish()) == ShinoError::Category::Parser);
+    ASSERT_TRUE(category(test_docx::BuildDocx("<w:p w:rsidR=\"1></w:p>")) == ShinoError::Category::Parser);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include "deflate.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// テスト用に ZIP（格納のみ）と最小限の DOCX を組み立てる
+namespace test_docx {
+
+class ZipBuilder {
+public:
+    void Add(std::string_view name, std::string_view data) {
+        AddRaw(name, data, 0, static_cast<uint32_t>(data.size()), ShinoEditor::Crc32(data));
+    }
+    // method 8 のときは data を DEFLATE 済みのデータとして扱い、size/crc には展開後のものを渡す
+    void AddRaw(std::string_view name, std::string_view data, uint16_t method, uint32_t size, uint32_t crc) {
+        const uint32_t offset = static_cast<uint32_t>(out_.size());
+        Header(0x04034b50, name, data.size(), method, size, crc, false, 0);
+        out_.append(name);
+        out_.append(data);
+        std::string entry;
+        std::swap(entry, out_);
+        Header(0x02014b50, name, data.size(), method, size, crc, true, offset);
+        out_.append(name);
+        std::swap(entry, out_);
+        central_ += entry;
+        ++count_;
+    }
+
+    std::string Finish() {
+        std::string zip = out_;
+        const uint32_t directory_offset = static_cast<uint32_t>(zip.size());
+        zip += central_;
+        auto put16 = [&zip](uint32_t v) { zip += static_cast<char>(v & 0xFF); zip += static_cast<char>(v >> 8 & 0xFF); };
+        auto put32 = [&](uint32_t v) { put16(v & 0xFFFF); put16(v >> 16); };
+        put32(0x06054b50);
+        put16(0); put16(0);
+        put16(count_); put16(count_);
+        put32(static_cast<uint32_t>(central_.size()));
+        put32(directory_offset);
+        put16(0);
+        return zip;
+    }
+
+private:
+    std::string out_;
+    std::string central_;
+    uint16_t count_ = 0;
+
+    void Header(uint32_t signature, std::string_view name, size_t compressed, uint16_t method, uint32_t size,
+                uint32_t crc, bool central, uint32_t offset) {
+        auto put16 = [this](uint32_t v) { out_ += static_cast<char>(v & 0xFF); out_ += static_cast<char>(v >> 8 & 0xFF); };
+        auto put32 = [&](uint32_t v) { put16(v & 0xFFFF); put16(v >> 16); };
+        put32(signature);
+        if (central) put16(20);
+        put16(20); put16(0); put16(method);
+        put16(0); put16(0); // 時刻
+        put32(crc);
+        put32(static_cast<uint32_t>(compressed));
+        put32(size);
+        put16(static_cast<uint32_t>(name.size()));
+        put16(0);
+        if (central) {
+            put16(0); put16(0); put16(0); put32(0);
+            put32(offset);
+        }
+    }
+};
+
+constexpr const char* kNamespaces =
+    "xmlns:w=\"http://schemas.openxmlformats.org/wordprocessingml/2006/main\" "
+    "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\"";
+
+// pandoc の出力と同じ名前のスタイル（見出し・コード・引用・等幅の文字）
+inline std::string DefaultStyles() {
+    auto style = [](const char* type, const char* id, const char* name, const char* extra = "") {
+        return std::string("<w:style w:type=\"") + type + "\" w:styleId=\"" + id + "\"><w:name w:val=\"" + name +
+               "\"/>" + extra + "</w:style>";
+    };
+    std::string headings;
+    for (int level = 1; level <= 6; ++level) {
+        const std::string n = std::to_string(level);
+        headings += style("paragraph", ("Heading" + n).c_str(), ("heading " + n).c_str(), "<w:basedOn w:val=\"Normal\"/>");
+    }
+    return std::string("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n<w:styles ") + kNamespaces + ">" +
+           style("paragraph", "Normal", "Normal") + headings +
+           style("paragraph", "Chapter", "Chapter", "<w:basedOn w:val=\"Heading2\"/>") +
+           style("paragraph", "SourceCode", "Source Code") +
+           style("paragraph", "BlockText", "Block Text") +
+           style("character", "VerbatimChar", "Verbatim Char") +
+           style("character", "Loud", "Loud", "<w:rPr><w:b/><w:i/></w:rPr>") + "</w:styles>";
+}
+
+// numId 1 は箇条書き（2 階層目も）、numId 2 は 3 から始まる番号付き
+inline std::string DefaultNumbering() {
+    return std::string("<w:numbering ") + kNamespaces + ">"
+           "<w:abstractNum w:abstractNumId=\"10\">"
+           "<w:lvl w:ilvl=\"0\"><w:start w:val=\"1\"/><w:numFmt w:val=\"bullet\"/></w:lvl>"
+           "<w:lvl w:ilvl=\"1\"><w:start w:val=\"1\"/><w:numFmt w:val=\"bullet\"/></w:lvl></w:abstractNum>"
+           "<w:abstractNum w:abstractNumId=\"20\">"
+           "<w:lvl w:ilvl=\"0\"><w:start w:val=\"3\"/><w:numFmt w:val=\"decimal\"/></w:lvl>"
+           "<w:lvl w:ilvl=\"1\"><w:start w:val=\"1\"/><w:numFmt w:val=\"lowerLetter\"/></w:lvl></w:abstractNum>"
+           "<w:num w:numId=\"1\"><w:abstractNumId w:val=\"10\"/></w:num>"
+           "<w:num w:numId=\"2\"><w:abstractNumId w:val=\"20\"/></w:num>"
+           "</w:numbering>";
+}
+
+// body は <w:body> の中身。extra_relationships は document.xml.rels の <Relationship> を足す
+inline std::string BuildDocx(std::string_view body, std::string_view extra_relationships = "") {
+    ZipBuilder zip;
+    zip.Add("[Content_Types].xml",
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+            "<Default Extension=\"xml\" ContentType=\"application/xml\"/></Types>");
+    zip.Add("_rels/.rels",
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+            "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+            "Target=\"word/document.xml\"/></Relationships>");
+    zip.Add("word/_rels/document.xml.rels",
+            std::string("<?xml version=\"1.0\" encoding=\"UTF-8\"?><Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+                        "<Relationship Id=\"rIdStyles\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles\" Target=\"styles.xml\"/>"
+                        "<Relationship Id=\"rIdNumbering\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/numbering\" Target=\"numbering.xml\"/>") +
+                std::string(extra_relationships) + "</Relationships>");
+    zip.Add("word/styles.xml", DefaultStyles());
+    zip.Add("word/numbering.xml", DefaultNumbering());
+    zip.Add("word/document.xml", std::string("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n<w:document ") +
+                                     kNamespaces + "><w:body>" + std::string(body) + "<w:sectPr/></w:body></w:document>");
+    return zip.Finish();
+}
+
+inline void WriteFile(const std::filesystem::path& path, std::string_view data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+// 段落 1 つ（style が空なら既定）。runs は <w:r> などをそのまま並べたもの
+inline std::string Paragraph(std::string_view runs, std::string_view style = "", std::string_view properties = "") {
+    std::string p = "<w:p>";
+    if (!style.empty() || !properties.empty()) {
+        p += "<w:pPr>";
+        if (!style.empty()) p += "<w:pStyle w:val=\"" + std::string(style) + "\"/>";
+        p += properties;
+        p += "</w:pPr>";
+    }
+    p += runs;
+    p += "</w:p>";
+    return p;
+}
+
+inline std::string Run(std::string_view text, std::string_view properties = "") {
+    std::string r = "<w:r>";
+    if (!properties.empty()) r += "<w:rPr>" + std::string(properties) + "</w:rPr>";
+    r += "<w:t xml:space=\"preserve\">" + std::string(text) + "</w:t></w:r>";
+    return r;
+}
+
+}
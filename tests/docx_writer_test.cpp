@@ -0,0 +1,168 @@
+#include "test_framework.h"
+#include "docx_reader.h"
+#include "docx_test_helper.h"
+#include "docx_writer.h"
+#include "error_handler.h"
+#include "markdown_renderer.h"
+#include "zip_archive.h"
+
+using namespace ShinoEditor;
+
+namespace {
+// 書き出した DOCX を DocxReader で Markdown に戻す
+std::string ReadBack(const std::filesystem::path& path) {
+    std::string markdown;
+    DocxReader::Convert(path.string(), [&markdown](std::string_view chunk) { markdown += chunk; });
+    return markdown;
+}
+
+std::string ReadPart(const std::filesystem::path& path, std::string_view name) {
+    ZipReader zip;
+    zip.Open(path.string());
+    const auto* entry = zip.Find(name);
+    if (!entry) return "";
+    std::string data;
+    zip.ReadAll(*entry, data);
+    return data;
+}
+}
+
+TEST(DocxWriter_RoundTripsThroughDocxReader) {
+    auto dir = test_utils::create_temp_dir("docx_write_round");
+    std::string markdown =
+        "# Title\n\n"
+        "### Sub\n\n"
+        "plain **bold** *it* ~~gone~~ `a<b` and [site](https://example.com/?a=1&b=2)\n"
+        "next  \nbroken\n\n"
+        "- a\n  - b\n- c\n\n"
+        "3. one\n4. two\n\n"
+        "```\nint x = 1 < 2;\n\n  return;\n```\n\n"
+        "> quoted\n\n"
+        "---\n";
+    std::string expected =
+        "# Title\n\n"
+        "### Sub\n\n"
+        "plain **bold** *it* ~~gone~~ `a<b` and [site](https://example.com/?a=1&b=2) next\\\nbroken\n\n"
+        "- a\n  - b\n- c\n\n"
+        "3. one\n4. two\n\n"
+        "```\nint x = 1 < 2;\n\n  return;\n```\n\n"
+        "> quoted\n\n"
+        "---\n";
+    // 表は md4c があるときだけ（フォールバックパーサーは表に対応しない）
+    const std::string table = "| h1 | h2 |\n| --- | --- |\n| x | y |\n";
+    if (MarkdownRenderer::IsAvailable()) {
+        markdown += "\n" + table;
+        expected += "\n" + table;
+    }
+    for (bool compress : {true, false}) {
+        const auto path = dir / (compress ? "deflated.docx" : "stored.docx");
+        const auto result = DocxWriter::Write(markdown, path.string(), nullptr, compress);
+        ASSERT_TRUE(result.Complete());
+        ASSERT_EQ(result.output_bytes, static_cast<uint64_t>(std::filesystem::file_size(path)));
+        ASSERT_EQ(ReadBack(path), expected);
+    }
+    // 格納より DEFLATE の方が小さい
+    ASSERT_TRUE(std::filesystem::file_size(dir / "deflated.docx") < std::filesystem::file_size(dir / "stored.docx"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DocxWriter_WritesPackagePartsAndRecordsDroppedImages) {
+    auto dir = test_utils::create_temp_dir("docx_write_parts");
+    const auto path = dir / "t.docx";
+    const auto result = DocxWriter::Write(
+        "see ![alt text](img.png) and [a](https://x.test/\"q\") [b](https://x.test/\"q\") [top](#intro)\n\n"
+        "1. x\n2. y\n", path.string());
+    ASSERT_EQ(result.unsupported, std::string("image"));
+
+    ZipReader zip;
+    zip.Open(path.string());
+    for (const char* name : {"[Content_Types].xml", "_rels/.rels", "word/document.xml",
+                             "word/_rels/document.xml.rels", "word/styles.xml", "word/numbering.xml"}) {
+        ASSERT_TRUE(zip.Find(name) != nullptr);
+    }
+    const std::string document = ReadPart(path, "word/document.xml");
+    ASSERT_TRUE(document.find("alt text") != std::string::npos);
+    ASSERT_TRUE(document.find("<w:hyperlink w:anchor=\"intro\">") != std::string::npos);
+    // 同じリンク先は 1 つの関係にまとめる
+    const std::string relationships = ReadPart(path, "word/_rels/document.xml.rels");
+    ASSERT_TRUE(relationships.find("Target=\"https://x.test/&quot;q&quot;\"") != std::string::npos);
+    ASSERT_TRUE(relationships.find("rIdLink2") == std::string::npos);
+    // 番号付きリストごとに開始番号を上書きする
+    ASSERT_TRUE(ReadPart(path, "word/numbering.xml").find("<w:startOverride w:val=\"1\"/>") != std::string::npos);
+    ASSERT_EQ(ReadBack(path), std::string("see alt text and [a](https://x.test/\"q\") [b](https://x.test/\"q\") [top](#intro)\n\n"
+                                          "1. x\n2. y\n"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DocxWriter_BookmarksHeadingsForFragmentLinks) {
+    auto dir = test_utils::create_temp_dir("docx_write_bookmarks");
+    const auto path = dir / "t.docx";
+    DocxWriter::Write("# Getting *Started*!\n\n## Getting Started\n\n# 日本語 A.B\n\n"
+                      "[go](#getting-started-1) [ja](#日本語-ab)\n", path.string());
+    const std::string document = ReadPart(path, "word/document.xml");
+    ASSERT_TRUE(document.find("<w:pStyle w:val=\"Heading1\"/></w:pPr><w:bookmarkStart w:id=\"0\" "
+                              "w:name=\"getting-started\"/>") != std::string::npos);
+    ASSERT_TRUE(document.find("<w:bookmarkStart w:id=\"1\" w:name=\"getting-started-1\"/>") != std::string::npos);
+    ASSERT_TRUE(document.find("<w:bookmarkStart w:id=\"2\" w:name=\"日本語-ab\"/>") != std::string::npos);
+    ASSERT_TRUE(document.find("<w:bookmarkEnd w:id=\"2\"/></w:p>") != std::string::npos);
+    ASSERT_TRUE(document.find("<w:hyperlink w:anchor=\"getting-started-1\">") != std::string::npos);
+    // ブックマークは読み戻しの文字に影響しない
+    ASSERT_EQ(ReadBack(path), std::string("# Getting *Started*!\n\n## Getting Started\n\n# 日本語 A.B\n\n"
+                                          "[go](#getting-started-1) [ja](#日本語-ab)\n"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DocxWriter_ReportsTablesWithoutMd4c) {
+    ASSERT_TRUE(DocxWriter::HasPipeTable("a | b\n--- | :-:\n1 | 2\n"));
+    ASSERT_TRUE(DocxWriter::HasPipeTable("text\n\n| a |\n|---|\n"));
+    ASSERT_FALSE(DocxWriter::HasPipeTable("a | b\n\n---\n"));
+    ASSERT_FALSE(DocxWriter::HasPipeTable("```\na | b\n--|--\n```\n"));
+    ASSERT_FALSE(DocxWriter::HasPipeTable("a - b\n- c\n"));
+
+    // md4c がなければ表は段落に崩れるので、書けなかったものとして pandoc に回す
+    auto dir = test_utils::create_temp_dir("docx_write_table");
+    const auto path = dir / "t.docx";
+    const auto result = DocxWriter::Write("| a | b |\n|---|---|\n| 1 | 2 |\n", path.string());
+    ASSERT_EQ(result.unsupported, std::string(MarkdownRenderer::IsAvailable() ? "" : "table"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DocxWriter_StreamsLargeDocumentsAndReportsErrors) {
+    auto dir = test_utils::create_temp_dir("docx_write_stream");
+    std::string markdown;
+    for (int i = 0; i < 20000; ++i) markdown += "paragraph " + std::to_string(i) + " with *some* text\n\n";
+    const auto path = dir / "large.docx";
+    DocxWriter::Write(markdown, path.string());
+    std::string expected = markdown;
+    expected.pop_back();
+    ASSERT_TRUE(ReadBack(path) == expected);
+    // 2 回書いても同じファイル（時刻を入れない）
+    auto contents = [&path]() {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), {});
+    };
+    const std::string first = contents();
+    DocxWriter::Write(markdown, path.string());
+    ASSERT_TRUE(contents() == first);
+
+    // 止めたら ShinoError（Convert）で、既存のファイルは残る
+    std::atomic<bool> cancel{true};
+    auto category = [&](const std::string& target) {
+        try {
+            DocxWriter::Write(markdown, target, &cancel);
+        } catch (const ShinoError& e) {
+            return e.category();
+        }
+        return ShinoError::Category::UI;
+    };
+    ASSERT_TRUE(category(path.string()) == ShinoError::Category::Convert);
+    ASSERT_TRUE(ReadBack(path) == expected);
+    ASSERT_EQ(std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()), 1);
+    cancel = false;
+    ASSERT_TRUE(category((dir / "missing" / "x.docx").string()) == ShinoError::Category::File);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,166 @@
+#include "test_framework.h"
+#include "error_handler.h"
+#include "html_export.h"
+#include <fstream>
+#include <sstream>
+
+using namespace ShinoEditor;
+namespace fs = std::filesystem;
+
+namespace {
+std::string ReadAll(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void WriteAll(const fs::path& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) lines.push_back(line);
+    return lines;
+}
+
+// ExportFile の出力として期待する内容（文書全体を 1 回でレンダリングしたもの）
+std::string Expected(const MarkdownRenderer& renderer, const std::string& md, const std::string& title) {
+    std::string out;
+    StringSink sink(out);
+    HtmlExport::WriteHeader(sink, title);
+    out += renderer.RenderToHtml(md);
+    HtmlExport::WriteFooter(sink);
+    return out;
+}
+
+std::string MixedDocument() {
+    std::string md;
+    for (int i = 0; i < 200; ++i) {
+        md += "# Heading " + std::to_string(i) + "\n\n";
+        md += "Paragraph *" + std::to_string(i) + "* with <b> & text.\n\n";
+        md += "> quote\nlazy continuation\n\n";
+        md += "```\ncode " + std::to_string(i) + "\n\n# not a heading\n```\n\n";
+        md += "- a\n- b\n\n    indented code\n\n";
+        // Markdown の中のコードフェンスの例（~~~ の中の ```）は 1 つのコードブロック
+        md += "Example:\n\n~~~markdown\n```cpp\nint x = " + std::to_string(i) + ";\n```\n~~~\n\nAfter.\n\n";
+    }
+    return md;
+}
+}
+
+TEST(ExportFile_MatchesWholeDocumentRender) {
+    auto dir = test_utils::create_temp_dir("html_export");
+    const auto input = dir / "doc.md";
+    const auto output = dir / "doc.html";
+    const std::string md = MixedDocument();
+    WriteAll(input, md);
+
+    MarkdownRenderer renderer;
+    // 小さな窓で何度も分けて書き出しても、全体を 1 回でレンダリングした結果と同じ
+    const auto stats = HtmlExport::ExportFile(renderer, input.string(), output.string(), 512);
+    ASSERT_TRUE(stats.chunks > 10);
+    ASSERT_EQ(stats.input_bytes, md.size());
+    const std::string html = ReadAll(output);
+    ASSERT_EQ(html, Expected(renderer, md, "doc"));
+    ASSERT_EQ(stats.output_bytes, html.size());
+    // 一時ファイルは残らない
+    ASSERT_EQ(std::distance(fs::directory_iterator(dir), fs::directory_iterator()), 2);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ExportFile_LinkReferencesRenderWhole) {
+    auto dir = test_utils::create_temp_dir("html_export");
+    const auto input = dir / "refs.md";
+    const auto output = dir / "refs.html";
+    std::string md;
+    for (int i = 0; i < 100; ++i) md += "# H" + std::to_string(i) + "\n\nsee [x]\n\n";
+    md += "[x]: https://example.com\n";
+    WriteAll(input, md);
+
+    MarkdownRenderer renderer;
+    const auto stats = HtmlExport::ExportFile(renderer, input.string(), output.string(), 64);
+    ASSERT_EQ(stats.chunks, static_cast<size_t>(1));
+    ASSERT_EQ(ReadAll(output), Expected(renderer, md, "refs"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ExportFile_MissingInputThrows) {
+    auto dir = test_utils::create_temp_dir("html_export");
+    MarkdownRenderer renderer;
+    bool thrown = false;
+    try {
+        HtmlExport::ExportFile(renderer, (dir / "missing.md").string(), (dir / "out.html").string());
+    } catch (const ShinoError& e) {
+        thrown = e.category() == ShinoError::Category::File;
+    }
+    ASSERT_TRUE(thrown);
+    ASSERT_TRUE(!fs::exists(dir / "out.html"));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ExportLines_WritesUnitsInOrder) {
+    auto dir = test_utils::create_temp_dir("html_export");
+    const auto output = dir / "lines.html";
+    const std::string md = MixedDocument();
+    auto lines = SplitLines(md);
+    BlockModel model(lines);
+
+    MarkdownRenderer renderer;
+    const auto stats = HtmlExport::ExportLines(renderer, lines, model.GetBlocks(),
+                                               output.string(), "a <title>");
+    ASSERT_TRUE(stats.chunks > 1);
+    ASSERT_EQ(ReadAll(output), Expected(renderer, md, "a <title>"));
+    ASSERT_TRUE(ReadAll(output).find("<title>a &lt;title&gt;</title>") != std::string::npos);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ExportLines_ReplacesExistingFile) {
+    auto dir = test_utils::create_temp_dir("html_export");
+    const auto output = dir / "old.html";
+    WriteAll(output, "old contents");
+    std::vector<std::string> lines = {"# New"};
+    BlockModel model(lines);
+    MarkdownRenderer renderer;
+    HtmlExport::ExportLines(renderer, lines, model.GetBlocks(), output.string(), "t");
+    ASSERT_TRUE(ReadAll(output).find("<h1>New</h1>") != std::string::npos);
+
+#ifndef _WIN32
+    // 決まった名前の一時ファイルを使わないので、先に置かれたリンクをたどって別のファイルを書き換えない
+    const auto victim = dir / "victim";
+    WriteAll(victim, "keep");
+    fs::create_symlink(victim, dir / "old.html.tmp");
+    HtmlExport::ExportLines(renderer, lines, model.GetBlocks(), output.string(), "t");
+    ASSERT_EQ(ReadAll(victim), std::string("keep"));
+    ASSERT_TRUE(fs::is_symlink(dir / "old.html.tmp"));
+    ASSERT_EQ(std::distance(fs::directory_iterator(dir), fs::directory_iterator()), 3);
+
+    // 置き換えても既存のファイルの権限は変わらない
+    fs::permissions(output, fs::perms::owner_read | fs::perms::owner_write);
+    HtmlExport::ExportLines(renderer, lines, model.GetBlocks(), output.string(), "t");
+    ASSERT_TRUE(fs::status(output).permissions() == (fs::perms::owner_read | fs::perms::owner_write));
+
+    // シンボリックリンクへの書き出しはリンク先を置き換え、リンクは残す
+    fs::create_symlink("old.html", dir / "link.html");
+    WriteAll(output, "old contents");
+    HtmlExport::ExportLines(renderer, lines, model.GetBlocks(), (dir / "link.html").string(), "t");
+    ASSERT_TRUE(fs::is_symlink(dir / "link.html"));
+    ASSERT_TRUE(ReadAll(output).find("<h1>New</h1>") != std::string::npos);
+    ASSERT_TRUE(fs::status(output).permissions() == (fs::perms::owner_read | fs::perms::owner_write));
+#endif
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(DefaultOutputPath_ReplacesExtension) {
+    ASSERT_EQ(HtmlExport::DefaultOutputPath("notes.md"), std::string("notes.html"));
+    ASSERT_EQ(HtmlExport::DefaultOutputPath("dir/readme"), std::string("dir/readme.html"));
+    ASSERT_EQ(HtmlExport::DefaultOutputPath(""), std::string("document.html"));
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,189 @@
+#include "test_framework.h"
+#include "incremental_search.h"
+#include <algorithm>
+#include <random>
+
+using namespace ShinoEditor;
+
+namespace {
+// 比較用: 一度に全体を探した結果
+std::vector<SearchMatch> FindAllAtOnce(const std::vector<std::string>& lines, const std::string& query) {
+    std::vector<SearchMatch> out;
+    SubstringSearcher(query).FindInLines(lines, out);
+    return out;
+}
+
+void RunToEnd(IncrementalSearch& search, size_t budget = IncrementalSearch::kDefaultStepBytes) {
+    while (!search.Step(budget)) {}
+}
+}
+
+TEST(IncrementalSearch_RefinesAsQueryGrows) {
+    const std::vector<std::string> lines = {"foo bar", "", "bar baz", "barn", "nothing"};
+    IncrementalSearch search(lines);
+    search.SetQuery("ba", 1);
+    RunToEnd(search);
+    ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "ba"));
+
+    // 伸ばした結果は、一度に探したものと同じ
+    for (const std::string query : {"bar", "barn", "barn!"}) {
+        search.SetQuery(query, 1);
+        ASSERT_TRUE(search.Done());
+        ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, query));
+    }
+}
+
+TEST(IncrementalSearch_OverlappingPrefixMatches) {
+    // "aa" の重ならない一致（0 と 2）からは "aab"（1 から）を絞り込めないので、重なりも覚えておく
+    const std::vector<std::string> lines = {"aaab", "aaaa"};
+    IncrementalSearch search(lines);
+    search.SetQuery("aa", 1);
+    RunToEnd(search);
+    const std::vector<SearchMatch> aa = {{0, 0, 2}, {1, 0, 2}, {1, 2, 2}};
+    ASSERT_TRUE(search.Matches() == aa);
+
+    search.SetQuery("aab", 1);
+    const std::vector<SearchMatch> aab = {{0, 1, 3}};
+    ASSERT_TRUE(search.Matches() == aab);
+}
+
+TEST(IncrementalSearch_ShorteningReusesCachedResults) {
+    const std::vector<std::string> lines = {"alpha beta", "alphabet", "gamma"};
+    IncrementalSearch search(lines);
+    search.SetQuery("al", 1);
+    RunToEnd(search);
+    search.SetQuery("alp", 1);
+    search.SetQuery("alph", 1);
+    const auto& alph = search.Matches();
+    ASSERT_EQ(alph.size(), size_t(2));
+
+    // 縮めても打ち直しても走査は要らない（Step せずに完了している）
+    search.SetQuery("alp", 1);
+    ASSERT_TRUE(search.Done());
+    ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "alp"));
+    search.SetQuery("alph", 1);
+    ASSERT_TRUE(search.Done());
+    ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "alph"));
+
+    // 別の文字を打てば、それより先の結果は捨てて絞り込み直す
+    search.SetQuery("alpx", 1);
+    ASSERT_TRUE(search.Done());
+    ASSERT_TRUE(search.Matches().empty());
+    search.SetQuery("", 1);
+    ASSERT_TRUE(search.Done());
+    ASSERT_TRUE(search.Matches().empty());
+}
+
+TEST(IncrementalSearch_ChunkedStepsMatchOneShot) {
+    std::mt19937 rng(7);
+    std::vector<std::string> lines(300);
+    for (auto& line : lines) {
+        const size_t len = rng() % 120;
+        for (size_t i = 0; i < len; ++i) line += "ab c"[rng() % 4];
+    }
+    // 1 行だけ長い行（行の途中で区切って走査する）
+    lines[150] = std::string(5000, 'a') + "b";
+
+    for (size_t budget : {1u, 7u, 64u, 1000u}) {
+        IncrementalSearch search(lines);
+        const std::string query = "ab";
+        search.SetQuery(query, 1);
+        size_t steps = 0;
+        size_t last = 0;
+        while (!search.Step(budget)) {
+            ++steps;
+            // 途中の一致は最終結果の先頭部分
+            ASSERT_TRUE(search.Matches().size() >= last);
+            last = search.Matches().size();
+        }
+        ASSERT_TRUE(steps > 0);
+        ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, query));
+
+        // 走査の途中で伸ばしても、残りは続きから探す
+        IncrementalSearch partial(lines);
+        partial.SetQuery("a", 1);
+        for (int i = 0; i < 20; ++i) partial.Step(budget);
+        partial.SetQuery("ab", 1);
+        partial.SetQuery("ab ", 1);
+        RunToEnd(partial, budget);
+        ASSERT_TRUE(partial.Matches() == FindAllAtOnce(lines, "ab "));
+        partial.SetQuery("ab", 1);
+        RunToEnd(partial, budget);
+        ASSERT_TRUE(partial.Matches() == FindAllAtOnce(lines, "ab"));
+    }
+}
+
+TEST(IncrementalSearch_ParallelStepsMatchSerial) {
+    std::mt19937 rng(11);
+    std::vector<std::string> lines(2000);
+    for (auto& line : lines) {
+        const size_t len = rng() % 80;
+        for (size_t i = 0; i < len; ++i) line += "ab c"[rng() % 4];
+    }
+    // 区間に入れずに 1 スレッドで区切りながら調べる長い行
+    lines[10] = std::string(3000, 'a') + "b";
+    lines[1500] = std::string(900, 'b') + "ab";
+
+    ThreadPool pool(3);
+    for (size_t budget : {1u, 7u, 64u, 1000u, 100000u}) {
+        IncrementalSearch search(lines, &pool);
+        search.SetQuery("ab", 1);
+        size_t last = 0;
+        while (!search.Step(budget)) {
+            // 区間の結果は文書の順に繋がるので、途中の一致も最終結果の先頭部分
+            const auto& partial = search.Matches();
+            ASSERT_TRUE(partial.size() >= last);
+            ASSERT_TRUE(std::is_sorted(partial.begin(), partial.end()));
+            last = partial.size();
+        }
+        ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "ab"));
+        ASSERT_EQ(search.ScannedLines(), lines.size());
+
+        // 並列に走査した出現位置からの絞り込みも同じ
+        search.SetQuery("ab ", 1);
+        ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "ab "));
+
+        // 途中まで並列に走査してから伸ばす
+        IncrementalSearch partial(lines, &pool);
+        partial.SetQuery("b", 1);
+        for (int i = 0; i < 3; ++i) partial.Step(budget);
+        partial.SetQuery("bb", 1);
+        RunToEnd(partial, budget);
+        ASSERT_TRUE(partial.Matches() == FindAllAtOnce(lines, "bb"));
+    }
+}
+
+TEST(IncrementalSearch_RevisionChangeDropsCache) {
+    std::vector<std::string> lines = {"needle", "hay"};
+    IncrementalSearch search(lines);
+    search.SetQuery("ne", 1);
+    RunToEnd(search);
+    search.SetQuery("nee", 1);
+    ASSERT_EQ(search.Matches().size(), size_t(1));
+
+    // 文書が変わったら積んだ結果は使えない
+    lines.push_back("needle again");
+    search.SetQuery("ne", 2);
+    ASSERT_TRUE(!search.Done());
+    RunToEnd(search);
+    ASSERT_EQ(search.Revision(), uint64_t(2));
+    ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "ne"));
+}
+
+TEST(IncrementalSearch_ReportsProgress) {
+    const std::vector<std::string> lines(10, "x needle");
+    IncrementalSearch search(lines);
+    search.SetQuery("needle", 1);
+    ASSERT_EQ(search.ScannedLines(), size_t(0));
+    search.Step(20);
+    ASSERT_TRUE(search.ScannedLines() > 0);
+    ASSERT_TRUE(search.ScannedLines() < lines.size());
+    ASSERT_TRUE(!search.Matches().empty());
+    RunToEnd(search);
+    ASSERT_EQ(search.ScannedLines(), lines.size());
+    ASSERT_EQ(search.Matches().size(), lines.size());
+}
+
+int main() {
+    return run_all_tests();
+}
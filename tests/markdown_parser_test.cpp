@@ -0,0 +1,140 @@
+#include "test_framework.h"
+#include "markdown_parser.h"
+#include <string>
+
+using namespace ShinoEditor;
+
+namespace {
+// イベントを 1 本の文字列に記録する
+class Recorder : public MarkdownHandler {
+public:
+    std::string log;
+
+    void EnterBlock(MarkdownBlock type, int detail) override {
+        log.append("<").append(Name(type));
+        if (detail) log.append(":").append(std::to_string(detail));
+        log += ">";
+    }
+    void LeaveBlock(MarkdownBlock type) override { log.append("</").append(Name(type)).append(">"); }
+    void EnterSpan(MarkdownSpan type, std::string_view url) override {
+        log.append("{").append(Name(type));
+        if (!url.empty()) log.append("=").append(url);
+        log += "}";
+    }
+    void LeaveSpan(MarkdownSpan type) override { log.append("{/").append(Name(type)).append("}"); }
+    void Text(std::string_view text) override { log += text; }
+    void SoftBreak() override { log += "~"; }
+    void HardBreak() override { log += "|"; }
+
+private:
+    static std::string Name(MarkdownBlock type) {
+        switch (type) {
+        case MarkdownBlock::DOCUMENT: return "doc";
+        case MarkdownBlock::QUOTE: return "q";
+        case MarkdownBlock::UNORDERED_LIST: return "ul";
+        case MarkdownBlock::ORDERED_LIST: return "ol";
+        case MarkdownBlock::LIST_ITEM: return "li";
+        case MarkdownBlock::RULE: return "hr";
+        case MarkdownBlock::HEADER: return "h";
+        case MarkdownBlock::CODE: return "code";
+        case MarkdownBlock::PARAGRAPH: return "p";
+        default: return "?";
+        }
+    }
+    static std::string Name(MarkdownSpan type) {
+        switch (type) {
+        case MarkdownSpan::EMPHASIS: return "em";
+        case MarkdownSpan::STRONG: return "strong";
+        case MarkdownSpan::CODE: return "code";
+        case MarkdownSpan::LINK: return "a";
+        case MarkdownSpan::IMAGE: return "img";
+        case MarkdownSpan::STRIKE: return "del";
+        }
+        return "?";
+    }
+};
+
+std::string Events(const std::string& markdown) {
+    Recorder recorder;
+    MarkdownParser::Parse(markdown, recorder);
+    return recorder.log;
+}
+}
+
+TEST(Parse_HeadersAndParagraphs) {
+    ASSERT_EQ(std::string("<doc><h:2>Title</h><p>one~two</p></doc>"), Events("## Title ##\none\ntwo\n"));
+    ASSERT_EQ(std::string("<doc><p>#nospace</p></doc>"), Events("#nospace\n"));
+}
+
+TEST(Parse_NestedEmphasis) {
+    ASSERT_EQ(std::string("<doc><p>{strong}a {em}b{/em} c{/strong}</p></doc>"), Events("**a *b* c**"));
+    ASSERT_EQ(std::string("<doc><p>{em}a {strong}b{/strong} c{/em}</p></doc>"), Events("*a **b** c*"));
+    ASSERT_EQ(std::string("<doc><p>{em}{strong}x{/strong}{/em}</p></doc>"), Events("***x***"));
+    ASSERT_EQ(std::string("<doc><p>{strong}a {em}b{/em}{/strong}</p></doc>"), Events("**a *b***"));
+    ASSERT_EQ(std::string("<doc><p>{em}a**b{/em}</p></doc>"), Events("*a**b*"));
+    // 閉じのない区切りは文字のまま
+    ASSERT_EQ(std::string("<doc><p>**a</p></doc>"), Events("**a"));
+    // 単語の中の _ は強調にしない
+    ASSERT_EQ(std::string("<doc><p>snake_case_name</p></doc>"), Events("snake_case_name"));
+}
+
+TEST(Parse_CodeSpans) {
+    // コードスパンの中の記号は解釈しない
+    ASSERT_EQ(std::string("<doc><p>{code}*a*{/code}</p></doc>"), Events("`*a*`"));
+    ASSERT_EQ(std::string("<doc><p>{code}a ` b{/code}</p></doc>"), Events("`` a ` b ``"));
+    // 強調の閉じ区切りを探すときもコードスパンは飛ばす
+    ASSERT_EQ(std::string("<doc><p>{em}a {code}*{/code} b{/em}</p></doc>"), Events("*a `*` b*"));
+}
+
+TEST(Parse_LinksEscapesEntities) {
+    ASSERT_EQ(std::string("<doc><p>{a=http://x}{strong}t{/strong}{/a}</p></doc>"), Events("[**t**](http://x \"title\")"));
+    ASSERT_EQ(std::string("<doc><p>{img=i.png}alt{/img}</p></doc>"), Events("![alt](i.png)"));
+    ASSERT_EQ(std::string("<doc><p>*x* & <</p></doc>"), Events("\\*x\\* &amp; &lt;"));
+}
+
+TEST(Parse_ListsAndQuotes) {
+    ASSERT_EQ(std::string("<doc><ul><li>a<ul><li>b</li></ul></li><li>c</li></ul><ol:3><li>x</li></ol></doc>"),
+              Events("- a\n  - b\n- c\n\n3. x\n"));
+    ASSERT_EQ(std::string("<doc><q><p>a~lazy</p><q><p>b</p></q></q></doc>"), Events("> a\nlazy\n> > b\n"));
+    // 新しいブロックを始める行は遅延継続行にならず、引用を閉じてから読む
+    ASSERT_EQ(std::string("<doc><q><p>note</p></q><h:1>Next</h></doc>"), Events("> note\n# Next\n"));
+    ASSERT_EQ(std::string("<doc><q><p>note</p></q><ul><li>item</li></ul></doc>"), Events("> note\n- item\n"));
+    ASSERT_EQ(std::string("<doc><q><p>note</p></q><ol:1><li>one</li></ol></doc>"), Events("> note\n1. one\n"));
+    ASSERT_EQ(std::string("<doc><q><p>note</p></q><hr></hr></doc>"), Events("> note\n***\n"));
+    ASSERT_EQ(std::string("<doc><q><p>note</p></q><code>x\n</code></doc>"), Events("> note\n```\nx\n```\n"));
+    ASSERT_EQ(std::string("<doc><q><q><p>a</p></q><h:2>b</h></q></doc>"), Events("> > a\n> ## b\n"));
+    // 段落を中断できないリスト（1 以外から始まる番号付き）は続きの文字
+    ASSERT_EQ(std::string("<doc><q><p>note~2. two</p></q></doc>"), Events("> note\n2. two\n"));
+}
+
+TEST(Parse_FencesAndRules) {
+    ASSERT_EQ(std::string("<doc><code>*x*\n\n</code><hr></hr></doc>"), Events("```c\n*x*\n\n```\n---\n"));
+    // 閉じていないフェンスは文書の終わりまで
+    ASSERT_EQ(std::string("<doc><code>a\n</code></doc>"), Events("~~~\na\n"));
+    // 引用の中のフェンスは、引用の記号を取り除いた行で読む
+    ASSERT_EQ(std::string("<doc><q><code>a\n> b\n</code><p>after</p></q></doc>"),
+              Events("> ```\n> a\n> > b\n> ```\n> after\n"));
+    // 引用が終われば閉じていないフェンスも終わる
+    ASSERT_EQ(std::string("<doc><q><code>a\n</code></q><p>out</p></doc>"), Events("> ```\n> a\nout\n"));
+}
+
+TEST(Parse_HardBreak) {
+    ASSERT_EQ(std::string("<doc><p>a|b</p></doc>"), Events("a  \nb\n"));
+}
+
+TEST(Parse_Cancel) {
+    std::atomic<bool> cancel{true};
+    Recorder recorder;
+    ASSERT_TRUE(!MarkdownParser::Parse("a\nb\n", recorder, &cancel));
+    ASSERT_EQ(std::string("<doc></doc>"), recorder.log);
+}
+
+TEST(DecodeEntity_Numeric) {
+    ASSERT_EQ(std::string("あ"), MarkdownParser::DecodeEntity("&#x3042;"));
+    ASSERT_EQ(std::string("A"), MarkdownParser::DecodeEntity("&#65;"));
+    ASSERT_EQ(std::string("&unknown;"), MarkdownParser::DecodeEntity("&unknown;"));
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -76,6 +76,121 @@ TEST(RenderToHtml_Empty) {
     ASSERT_TRUE(result.empty());
 }
 
+TEST(RenderToText_StripsMarkup) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto result = renderer->RenderToText("# Title\n\n> **a** *b* [c](http://x)\n\n- one\n- two\n");
+    ASSERT_EQ(std::string("Title\n\na b c\n\n- one\n- two"), result);
+}
+
+TEST(RenderToHtml_EscapesAndNests) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto result = renderer->RenderToHtml("a < b & **c *d***\n");
+    ASSERT_TRUE(result.find("a &lt; b &amp; ") != std::string::npos);
+    ASSERT_TRUE(result.find("<strong>c <em>d</em></strong>") != std::string::npos);
+    result = renderer->RenderToHtml("```\n<tag>\n```\n");
+    ASSERT_TRUE(result.find("<pre><code>&lt;tag&gt;\n</code></pre>") != std::string::npos);
+}
+
+TEST(RenderToHtml_LinksAndOrderedLists) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto result = renderer->RenderToHtml("2. [x](http://a?b=1&c=2)\n3. y\n");
+    ASSERT_TRUE(result.find("<a href=\"http://a?b=1&amp;c=2\">x</a>") != std::string::npos);
+    if (!MarkdownRenderer::IsAvailable()) {
+        ASSERT_EQ(std::string("<ol start=\"2\">\n<li><a href=\"http://a?b=1&amp;c=2\">x</a></li>\n<li>y</li>\n</ol>\n"),
+                  result);
+    }
+}
+
+TEST(RenderToPreview_Headers) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto lines = renderer->RenderToPreview("## 見出し ##\n本文\n");
+    ASSERT_TRUE(lines.size() >= 3);
+    ASSERT_TRUE(lines[0].kind == PreviewLineKind::HEADER);
+    ASSERT_EQ(2, lines[0].level);
+    ASSERT_EQ(std::string("見出し"), lines[0].PlainText());
+    ASSERT_TRUE(lines[1].kind == PreviewLineKind::BLANK);
+    ASSERT_EQ(std::string("本文"), lines[2].PlainText());
+}
+
+TEST(RenderToPreview_InlineStyles) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto lines = renderer->RenderToPreview("a **b** *c* `d` [e](http://x) ~~f~~ &amp;\n");
+    ASSERT_TRUE(!lines.empty());
+    ASSERT_EQ(std::string("a b c d e f &"), lines[0].PlainText());
+    uint8_t seen = 0;
+    for (const auto& run : lines[0].runs) {
+        if (run.text == "b") ASSERT_EQ(PREVIEW_STRONG, static_cast<int>(run.style));
+        if (run.text == "c") ASSERT_EQ(PREVIEW_EMPHASIS, static_cast<int>(run.style));
+        if (run.text == "d") ASSERT_EQ(PREVIEW_CODE, static_cast<int>(run.style));
+        if (run.text == "e") ASSERT_EQ(PREVIEW_LINK, static_cast<int>(run.style));
+        if (run.text == "f") ASSERT_EQ(PREVIEW_STRIKE, static_cast<int>(run.style));
+        seen |= run.style;
+    }
+    ASSERT_EQ(PREVIEW_STRONG | PREVIEW_EMPHASIS | PREVIEW_CODE | PREVIEW_LINK | PREVIEW_STRIKE,
+              static_cast<int>(seen));
+}
+
+TEST(RenderToPreview_ListsAndQuotes) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto lines = renderer->RenderToPreview("- one\n  - nested\n- two\n\n3. x\n4. y\n\n> quoted\n");
+    std::vector<std::string> texts;
+    for (const auto& line : lines) {
+        if (line.kind != PreviewLineKind::BLANK) texts.push_back(line.prefix + line.PlainText());
+    }
+    ASSERT_EQ(6u, texts.size());
+    ASSERT_EQ(std::string("• one"), texts[0]);
+    ASSERT_EQ(std::string("  • nested"), texts[1]);
+    ASSERT_EQ(std::string("• two"), texts[2]);
+    ASSERT_EQ(std::string("3. x"), texts[3]);
+    ASSERT_EQ(std::string("4. y"), texts[4]);
+    ASSERT_EQ(std::string("quoted"), texts[5]);
+    ASSERT_EQ(1, lines.back().quote_depth);
+}
+
+TEST(RenderToPreview_CodeBlockKeepsLines) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto lines = renderer->RenderToPreview("```\nint a;\n\n*b*\n```\n");
+    ASSERT_TRUE(lines.size() >= 3);
+    ASSERT_TRUE(lines[0].kind == PreviewLineKind::CODE);
+    ASSERT_EQ(std::string("int a;"), lines[0].PlainText());
+    ASSERT_EQ(std::string(""), lines[1].PlainText());
+    ASSERT_EQ(std::string("*b*"), lines[2].PlainText());
+    ASSERT_TRUE(lines[2].kind == PreviewLineKind::CODE);
+}
+
+TEST(RenderToPreview_Rule) {
+    auto renderer = std::make_unique<MarkdownRenderer>();
+    auto lines = renderer->RenderToPreview("a\n\n---\n\nb\n");
+    bool has_rule = false;
+    for (const auto& line : lines) has_rule = has_rule || line.kind == PreviewLineKind::RULE;
+    ASSERT_TRUE(has_rule);
+}
+
+TEST(PreviewScrollMap_Interpolates) {
+    PreviewScrollMap map;
+    ASSERT_TRUE(map.Empty());
+    ASSERT_EQ(0, map.RowForLine(10));
+
+    // 順不同に追加してよい
+    map.AddAnchor(20, 30);
+    map.AddAnchor(0, -5);
+    map.AddAnchor(10, 10);
+    ASSERT_EQ(-5, map.RowForLine(0));
+    ASSERT_EQ(10, map.RowForLine(10));
+    ASSERT_EQ(20, map.RowForLine(15));
+    ASSERT_EQ(10, map.LineForRow(10));
+    ASSERT_EQ(15, map.LineForRow(20));
+    // 範囲外は端の目印に揃える
+    ASSERT_EQ(30, map.RowForLine(100));
+    ASSERT_EQ(0, map.LineForRow(-50));
+
+    // 同じ行は置き換え
+    map.AddAnchor(10, 12);
+    ASSERT_EQ(12, map.RowForLine(10));
+    map.Clear();
+    ASSERT_TRUE(map.Empty());
+}
+
 int main() {
     return run_all_tests();
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "test_framework.h"
 #include "pandoc_io.h"
+#include "docx_test_helper.h"
+#include "error_handler.h"
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
 
 using namespace ShinoEditor;
 namespace fs = std::filesystem;
@@ -25,6 +29,23 @@ TEST(ExportDocx_InvalidPath) {
     ASSERT_FALSE(result);
 }
 
+TEST(ExportDocx_PandocEngineRequiresPandoc) {
+    if (PandocIO::GetCapabilities().SupportsOutput("docx")) return;
+    // pandoc を指定したのに使えなければ、組み込みで書かずに ShinoError（Convert）
+    auto dir = test_utils::create_temp_dir("pandoc_engine");
+    const auto path = (dir / "t.docx").string();
+    bool threw = false;
+    try {
+        PandocIO::ExportDocx("# Title\n", path, nullptr, DocxEngine::PANDOC);
+    } catch (const ShinoError& e) {
+        threw = e.category() == ShinoError::Category::Convert;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_FALSE(fs::exists(path));
+    ASSERT_TRUE(PandocIO::ExportDocx("# Title\n", path));
+    test_utils::cleanup_temp_dir(dir);
+}
+
 TEST(ExportImport_RoundTrip) {
     // Only run if pandoc is available
     if (!PandocIO::IsPandocAvailable()) {
@@ -83,6 +104,186 @@ TEST(ExportImport_RoundTrip) {
     test_utils::cleanup_temp_dir(temp_dir);
 }
 
+#ifndef _WIN32
+namespace {
+// 起動されるたびに log に 1 行足す偽の pandoc
+void WriteFakePandoc(const fs::path& dir, const std::string& version) {
+    const auto path = dir / "pandoc";
+    {
+        std::ofstream out(path);
+        out << "#!/bin/sh\n"
+            << "echo \"$1\" >> '" << (dir / "log").string() << "'\n"
+            << "case \"$1\" in\n"
+            << "  --version) echo 'pandoc " << version << "'; echo 'Features: +server +lua' ;;\n"
+            << "  --list-input-formats) printf 'commonmark\\ndocx\\nmarkdown\\n' ;;\n"
+            << "  --list-output-formats) printf 'html\\nmarkdown\\n' ;;\n"
+            << "  --list-extensions=markdown) printf '+smart\\n-emoji\\n+footnotes\\n' ;;\n"
+            << "esac\n";
+    }
+    fs::permissions(path, fs::perms::owner_all, fs::perm_options::add);
+}
+
+size_t CountLines(const fs::path& path) {
+    std::ifstream in(path);
+    size_t count = 0;
+    for (std::string line; std::getline(in, line);) ++count;
+    return count;
+}
+}
+
+TEST(Capabilities_ProbedOnceAndRevalidatedOnChange) {
+    auto dir = test_utils::create_temp_dir("pandoc_probe");
+    const std::string old_path = std::getenv("PATH") ? std::getenv("PATH") : "";
+    WriteFakePandoc(dir, "9.1");
+    setenv("PATH", (dir.string() + ":" + old_path).c_str(), 1);
+
+    PandocIO::StartCapabilityProbe();
+    auto caps = PandocIO::GetCapabilities();
+    ASSERT_TRUE(caps.available);
+    ASSERT_EQ(caps.path, (dir / "pandoc").string());
+    ASSERT_EQ(caps.version, std::string("pandoc 9.1"));
+    ASSERT_TRUE(caps.SupportsInput("docx"));
+    ASSERT_FALSE(caps.SupportsOutput("docx"));
+    ASSERT_TRUE(caps.HasExtension("smart"));
+    ASSERT_FALSE(caps.HasExtension("emoji"));
+    const size_t probes = CountLines(dir / "log");
+    ASSERT_EQ(probes, size_t(4));
+
+    // 実行ファイルが変わらなければ起動しない
+    for (int i = 0; i < 10; ++i) ASSERT_TRUE(PandocIO::IsPandocAvailable());
+    ASSERT_EQ(PandocIO::GetPandocVersion(), std::string("pandoc 9.1"));
+    // 出力に docx がなければ pandoc は起動せず、組み込みの変換で書く
+    ASSERT_TRUE(PandocIO::ExportDocx("# x\n\n![img](a.png)\n", (dir / "out.docx").string()));
+    ASSERT_EQ(CountLines(dir / "log"), probes);
+
+    // 更新時刻が変われば（更新された）調べ直す
+    WriteFakePandoc(dir, "9.2");
+    fs::last_write_time(dir / "pandoc", fs::last_write_time(dir / "pandoc") + std::chrono::seconds(10));
+    ASSERT_EQ(PandocIO::GetCapabilities().version, std::string("pandoc 9.2"));
+    ASSERT_EQ(CountLines(dir / "log"), probes * 2);
+
+    // PATH から消えれば使えない（PATH を戻すと元の pandoc を調べ直す）
+    setenv("PATH", old_path.c_str(), 1);
+    fs::remove(dir / "pandoc");
+    ASSERT_TRUE(PandocIO::GetCapabilities().path != (dir / "pandoc").string());
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ImportExport_StreamsThroughPandocAndReportsFailure) {
+    auto dir = test_utils::create_temp_dir("pandoc_convert");
+    const std::string old_path = std::getenv("PATH") ? std::getenv("PATH") : "";
+    // 読み込みは決まった Markdown を返し（broken.docx は失敗）、書き出しは stdin を -o のファイルにそのまま書く
+    // （FAIL を含めば書きかけで失敗する）
+    {
+        std::ofstream out(dir / "pandoc");
+        out << "#!/bin/sh\n"
+            << "case \"$1\" in\n"
+            << "  --version) echo 'pandoc 9.3' ;;\n"
+            << "  --list-input-formats) echo docx ;;\n"
+            << "  --list-output-formats) echo docx ;;\n"
+            << "  -f)\n"
+            << "    if [ \"$2\" = markdown ]; then cat > \"$6\"; ! grep -q FAIL \"$6\"; exit; fi\n"
+            << "    case \"$5\" in *broken*) echo \"pandoc: couldn't unpack docx container\" >&2; exit 64 ;; esac\n"
+            << "    printf '# Title\\n\\nBody text\\n' ;;\n"
+            << "esac\n";
+    }
+    fs::permissions(dir / "pandoc", fs::perms::owner_all, fs::perm_options::add);
+    setenv("PATH", (dir.string() + ":" + old_path).c_str(), 1);
+    std::ofstream(dir / "in.docx") << "PK";
+    std::ofstream(dir / "broken.docx") << "PK";
+
+    std::vector<std::string> lines;
+    ASSERT_TRUE(PandocIO::ImportDocx((dir / "in.docx").string(), lines));
+    const std::vector<std::string> expected = {"# Title", "", "Body text"};
+    ASSERT_TRUE(lines == expected);
+    ASSERT_EQ(*PandocIO::ImportDocx((dir / "in.docx").string()), std::string("# Title\n\nBody text\n"));
+
+    // 終了状態と stderr を添えて投げる
+    std::string detail;
+    try {
+        PandocIO::ImportDocx((dir / "broken.docx").string());
+    } catch (const ShinoError& e) {
+        if (e.category() == ShinoError::Category::Convert) detail = e.detail();
+    }
+    ASSERT_EQ(detail, std::string("pandoc exit status 64: pandoc: couldn't unpack docx container"));
+
+    // 組み込みの変換で書けるものは pandoc を使わない（読み戻しも組み込みの変換）
+    ASSERT_TRUE(PandocIO::ExportDocx("# 見出し\n\n本文\n", (dir / "native.docx").string()));
+    ASSERT_EQ(*PandocIO::ImportDocx((dir / "native.docx").string()), std::string("# 見出し\n\n本文\n"));
+
+    // 画像があれば pandoc で書き直す。一時ファイルを作らずに stdin に流す
+    const std::string markdown = "# 見出し\n\n![図](figure.png)\n\n" + std::string(1 << 20, 'x') + "\n";
+    ASSERT_TRUE(PandocIO::ExportDocx(markdown, (dir / "out.docx").string()));
+    std::ifstream in(dir / "out.docx", std::ios::binary);
+    const std::string written((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_TRUE(written == markdown);
+
+    // PANDOC なら組み込みの変換で書けるものも pandoc で書く
+    ASSERT_TRUE(PandocIO::ExportDocx("# 見出し\n", (dir / "native.docx").string(), nullptr, DocxEngine::PANDOC));
+    std::ifstream native(dir / "native.docx", std::ios::binary);
+    ASSERT_EQ(std::string((std::istreambuf_iterator<char>(native)), std::istreambuf_iterator<char>()),
+              std::string("# 見出し\n"));
+
+    // pandoc は一時ファイルに書くので、失敗しても既存のファイルはそのまま残り、一時ファイルも残らない
+    const auto entries = std::distance(fs::directory_iterator(dir), fs::directory_iterator());
+    bool failed = false;
+    try {
+        PandocIO::ExportDocx("![図](a.png) FAIL\n", (dir / "out.docx").string());
+    } catch (const ShinoError& e) {
+        failed = e.category() == ShinoError::Category::Convert;
+    }
+    ASSERT_TRUE(failed);
+    std::ifstream kept(dir / "out.docx", std::ios::binary);
+    ASSERT_TRUE(std::string((std::istreambuf_iterator<char>(kept)), std::istreambuf_iterator<char>()) == markdown);
+    ASSERT_EQ(std::distance(fs::directory_iterator(dir), fs::directory_iterator()), entries);
+
+    setenv("PATH", old_path.c_str(), 1);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ImportDocx_NativeFastPathFallsBackToPandocForUnsupportedContent) {
+    auto dir = test_utils::create_temp_dir("pandoc_native");
+    const std::string old_path = std::getenv("PATH") ? std::getenv("PATH") : "";
+    {
+        std::ofstream out(dir / "pandoc");
+        out << "#!/bin/sh\n"
+            << "echo \"$1\" >> '" << (dir / "log").string() << "'\n"
+            << "case \"$1\" in\n"
+            << "  --version) echo 'pandoc 9.4' ;;\n"
+            << "  --list-input-formats) echo docx ;;\n"
+            << "  -f) printf 'from pandoc\\n' ;;\n"
+            << "esac\n";
+    }
+    fs::permissions(dir / "pandoc", fs::perms::owner_all, fs::perm_options::add);
+    setenv("PATH", (dir.string() + ":" + old_path).c_str(), 1);
+    const auto text = test_docx::Paragraph(test_docx::Run("native"));
+    test_docx::WriteFile(dir / "plain.docx", test_docx::BuildDocx(text));
+    test_docx::WriteFile(dir / "image.docx", test_docx::BuildDocx(text + "<w:p><w:r><w:drawing/></w:r></w:p>"));
+
+    // 組み込みの変換で読めれば pandoc は起動しない
+    std::vector<std::string> lines = {"keep"};
+    ASSERT_TRUE(PandocIO::ImportDocx((dir / "plain.docx").string(), lines));
+    ASSERT_TRUE(lines == (std::vector<std::string>{"keep", "native"}));
+    ASSERT_FALSE(fs::exists(dir / "log"));
+
+    // 落とした内容があれば、書いた行を戻して pandoc で読み直す
+    ASSERT_TRUE(PandocIO::ImportDocx((dir / "image.docx").string(), lines));
+    ASSERT_TRUE(lines == (std::vector<std::string>{"keep", "native", "from pandoc"}));
+    ASSERT_EQ(*PandocIO::ImportDocx((dir / "image.docx").string()), std::string("from pandoc\n"));
+    std::ifstream log(dir / "log");
+    size_t conversions = 0;
+    for (std::string line; std::getline(log, line);) conversions += line == "-f";
+    ASSERT_EQ(conversions, size_t(2));
+
+    // pandoc がなければ組み込みの結果（画像は落ちる）を使う
+    setenv("PATH", (dir / "none").string().c_str(), 1);
+    ASSERT_EQ(*PandocIO::ImportDocx((dir / "image.docx").string()), std::string("native\n"));
+
+    setenv("PATH", old_path.c_str(), 1);
+    test_utils::cleanup_temp_dir(dir);
+}
+#endif
+
 int main() {
     return run_all_tests();
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "test_framework.h"
+#include "preview_worker.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ShinoEditor;
+using namespace std::chrono_literals;
+
+namespace {
+struct Collector {
+    std::mutex mutex;
+    std::vector<std::pair<uint64_t, std::string>> results;
+
+    PreviewWorker::ResultCallback Callback() {
+        return [this](uint64_t revision, std::string content) {
+            std::lock_guard<std::mutex> lock(mutex);
+            results.emplace_back(revision, std::move(content));
+        };
+    }
+};
+
+void WaitIdle(const PreviewWorker& worker) {
+    for (int i = 0; i < 500 && worker.IsBusy(); ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+}
+}
+
+TEST(PreviewWorker_DebounceCoalescesRequests) {
+    Collector collector;
+    std::atomic<int> renders{0};
+    PreviewWorker worker(
+        [&](const PreviewSnapshot& snapshot, const std::atomic<bool>&) {
+            ++renders;
+            return "<p>" + snapshot[0] + "</p>";
+        },
+        collector.Callback(), 50ms);
+
+    // デバウンス期間内の連続した要求は最後の 1 回だけ描画される
+    for (int rev = 1; rev <= 5; ++rev) {
+        worker.Request(rev, {"v" + std::to_string(rev)});
+    }
+    WaitIdle(worker);
+
+    ASSERT_EQ(renders.load(), 1);
+    ASSERT_EQ(static_cast<int>(collector.results.size()), 1);
+    ASSERT_EQ(collector.results[0].first, static_cast<uint64_t>(5));
+    ASSERT_EQ(collector.results[0].second, std::string("<p>v5</p>"));
+}
+
+TEST(PreviewWorker_CancelsObsoleteRender) {
+    Collector collector;
+    std::atomic<bool> slow_started{false};
+    PreviewWorker worker(
+        [&](const PreviewSnapshot& snapshot, const std::atomic<bool>& cancel) {
+            if (snapshot[0] == "slow") {
+                slow_started = true;
+                // 中断されるまで（最長 5 秒）走り続ける
+                for (int i = 0; i < 500 && !cancel; ++i) {
+                    std::this_thread::sleep_for(10ms);
+                }
+            }
+            return snapshot[0];
+        },
+        collector.Callback(), 0ms);
+
+    worker.Request(1, {"slow"});
+    for (int i = 0; i < 500 && !slow_started; ++i) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_TRUE(slow_started.load());
+
+    worker.Request(2, {"fast"});
+    WaitIdle(worker);
+
+    // 中断された描画の結果は通知されない
+    ASSERT_EQ(static_cast<int>(collector.results.size()), 1);
+    ASSERT_EQ(collector.results[0].first, static_cast<uint64_t>(2));
+    ASSERT_EQ(collector.results[0].second, std::string("fast"));
+}
+
+TEST(PreviewWorker_DestructorStopsPendingWork) {
+    Collector collector;
+    {
+        PreviewWorker worker(
+            [](const PreviewSnapshot& snapshot, const std::atomic<bool>&) { return snapshot[0]; },
+            collector.Callback(), 10s);
+        worker.Request(1, {"never"});
+    }
+    ASSERT_TRUE(collector.results.empty());
+}
+
+int main() {
+    return run_all_tests();
+}
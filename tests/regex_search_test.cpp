@@ -0,0 +1,211 @@
+#include "test_framework.h"
+#include "regex_search.h"
+#include "error_handler.h"
+#include <chrono>
+#include <random>
+#include <regex>
+
+using namespace ShinoEditor;
+
+namespace {
+std::vector<SearchMatch> Find(const std::string& pattern, const std::string& line) {
+    std::vector<SearchMatch> out;
+    RegexSearcher(pattern).FindInLine(line, 0, out);
+    return out;
+}
+
+// 比較用: 各開始位置から長い順に std::regex_match で確かめる（最左最長、重ならない、空は除く）
+std::vector<SearchMatch> ReferenceFind(const std::string& pattern, const std::string& line) {
+    const std::regex re(pattern);
+    std::vector<SearchMatch> out;
+    size_t s = 0;
+    while (s < line.size()) {
+        bool found = false;
+        for (size_t e = line.size(); e > s; --e) {
+            auto flags = std::regex_constants::match_default;
+            if (s > 0) flags |= std::regex_constants::match_not_bol;
+            if (e < line.size()) flags |= std::regex_constants::match_not_eol;
+            if (std::regex_match(line.begin() + static_cast<std::ptrdiff_t>(s),
+                                 line.begin() + static_cast<std::ptrdiff_t>(e), re, flags)) {
+                out.push_back({0, s, e - s});
+                s = e;
+                found = true;
+                break;
+            }
+        }
+        if (!found) ++s;
+    }
+    return out;
+}
+
+bool Throws(const std::string& pattern) {
+    try {
+        RegexSearcher searcher(pattern);
+    } catch (const ShinoError& e) {
+        return e.category() == ShinoError::Category::Parser;
+    }
+    return false;
+}
+}
+
+TEST(RegexSearcher_Basics) {
+    const std::vector<SearchMatch> digits = {{0, 4, 3}, {0, 11, 1}};
+    ASSERT_TRUE(Find("\\d+", "abc 123 de 4") == digits);
+    // 最左最長
+    const std::vector<SearchMatch> longest = {{0, 0, 4}};
+    ASSERT_TRUE(Find("ab|abcd|abc", "abcd") == longest);
+    // 空の一致は返さない
+    const std::vector<SearchMatch> stars = {{0, 1, 2}};
+    ASSERT_TRUE(Find("a*", "baab") == stars);
+    // ^ と $ は行頭と行末
+    ASSERT_EQ(Find("^ab", "abab").size(), size_t(1));
+    const std::vector<SearchMatch> tail = {{0, 2, 2}};
+    ASSERT_TRUE(Find("ab$", "abab") == tail);
+    ASSERT_TRUE(Find("^$", "").empty());
+    // 繰り返しの回数
+    const std::vector<SearchMatch> braces = {{0, 0, 3}, {0, 3, 2}};
+    ASSERT_TRUE(Find("a{2,3}", "aaaaa") == braces);
+    ASSERT_TRUE(Find("x{2}", "x").empty());
+    // 数字で始まらない { はリテラル
+    ASSERT_EQ(Find("a{b", "a{b").size(), size_t(1));
+    // エスケープ
+    ASSERT_EQ(Find("\\[x\\]\\.", "[x].").size(), size_t(1));
+    ASSERT_EQ(Find("\\x41", "A").size(), size_t(1));
+}
+
+TEST(RegexSearcher_MatchesReferenceOnRandomLines) {
+    const std::vector<std::string> patterns = {
+        "a*b", "(ab|a)c?", "[ab]+c", "a{2,3}", "^a+", "b$", "(a|b)*c", "a.c", "[^a]b",
+        "(?:ab)+", "c|ab*", "a?b?c?", "^(a|b)+$", "(a|ab)(c|bcd)", "[a-b]{2}c*", "\\w\\s",
+    };
+    std::mt19937 rng(1);
+    for (const auto& pattern : patterns) {
+        RegexSearcher searcher(pattern);
+        for (int trial = 0; trial < 200; ++trial) {
+            std::string line;
+            const size_t len = rng() % 16;
+            for (size_t i = 0; i < len; ++i) line += "abc "[rng() % 4];
+            std::vector<SearchMatch> ours;
+            searcher.FindInLine(line, 0, ours);
+            ASSERT_TRUE(ours == ReferenceFind(pattern, line));
+        }
+    }
+}
+
+TEST(RegexSearcher_Utf8) {
+    // . と文字クラスは UTF-8 の 1 文字に一致する
+    const std::string line = "日本語のテキスト";
+    const std::vector<SearchMatch> dot = {{0, 0, 9}};
+    ASSERT_TRUE(Find("日.語", line) == dot);
+    const std::vector<SearchMatch> katakana = {{0, 12, 12}};
+    ASSERT_TRUE(Find("[ァ-ヶー]+", line) == katakana);
+    const std::vector<SearchMatch> negated = {{0, 1, 2}};
+    ASSERT_TRUE(Find("[^a]", "aé") == negated);
+    // 4 バイトの文字と、符号化の長さをまたぐ範囲
+    ASSERT_EQ(Find("[a-😀]", "😀").size(), size_t(1));
+    ASSERT_EQ(Find("[~-ア]+", "~éアa").size(), size_t(1));
+    ASSERT_EQ(Find("[~-ア]+", "~éアa")[0].length, std::string("~éア").size());
+}
+
+TEST(RegexSearcher_SyntaxErrors) {
+    for (const std::string pattern : {"(", "a)", "[a", "*a", "a{3,1}", "\\q", "a{2000}", "^*", "(?=a)", "\\"}) {
+        ASSERT_TRUE(Throws(pattern));
+    }
+    // 展開すると大きすぎるパターン
+    ASSERT_TRUE(Throws("((a{1000}){1000}){10}"));
+}
+
+TEST(RegexSearcher_LiteralPrefix) {
+    ASSERT_EQ(RegexSearcher("foo\\d+").LiteralPrefix(), std::string("foo"));
+    ASSERT_EQ(RegexSearcher("^abc").LiteralPrefix(), std::string("abc"));
+    ASSERT_EQ(RegexSearcher("(?:ab)+c").LiteralPrefix(), std::string("ab"));
+    ASSERT_EQ(RegexSearcher("foo|bar").LiteralPrefix(), std::string(""));
+    ASSERT_EQ(RegexSearcher("a*b").LiteralPrefix(), std::string(""));
+
+    // 候補から読み進めても一致しない行が続くと、終わりを持つ NFA シミュレーションに切り替えても結果は同じ
+    std::string line(20000, 'a');
+    line += "az";
+    const std::vector<SearchMatch> expected = {{0, 0, line.size()}};
+    ASSERT_TRUE(Find("a.*z", line) == expected);
+    line.back() = 'y';
+    ASSERT_TRUE(Find("a.*z", line).empty());
+}
+
+TEST(RegexSearcher_LinearTimeOnPathologicalPatterns) {
+    // バックトラックする実装では指数時間になるパターン
+    const std::string line(100000, 'a');
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(Find("(a*)*b", line).empty());
+    ASSERT_TRUE(Find("(a|aa)+c", line).empty());
+    ASSERT_TRUE(Find("(x+x+)+y", std::string(5000, 'x')).empty());
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(elapsed < std::chrono::seconds(5));
+}
+
+TEST(RegexSearcher_LinearTimeWithManyShortMatches) {
+    // どの始まりからも前向きの DFA が行末まで生き残るのに、一致は 1 バイトずつ
+    // （始まりごとに読み進めると行の長さの 2 乗）
+    const std::string line(200000, 'a');
+    const auto start = std::chrono::steady_clock::now();
+    for (const std::string pattern : {"a(.*Z)?", "a|a.*Z"}) {
+        RegexSearcher searcher(pattern);
+        std::vector<SearchMatch> matches;
+        searcher.FindInLine("aaZ" + line, 0, matches);
+        ASSERT_EQ(matches.size(), line.size() + 1);
+        ASSERT_EQ(matches[0].offset, size_t(0));
+        ASSERT_EQ(matches[0].length, size_t(3));
+        ASSERT_EQ(matches.back().offset, line.size() + 2);
+        ASSERT_EQ(matches.back().length, size_t(1));
+        ASSERT_EQ(searcher.GetStats().end_tracking_lines, size_t(1));
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(elapsed < std::chrono::seconds(5));
+
+    // 切り替えた行でも結果は比較用の実装と同じ
+    const std::vector<std::string> patterns = {"a(.*Z)?", "[ab]+(.*Z)?", "^a|a(.*Z)?$", "(b|.*Z)?a"};
+    std::mt19937 rng(2);
+    for (const auto& pattern : patterns) {
+        RegexSearcher searcher(pattern);
+        for (int trial = 0; trial < 10; ++trial) {
+            std::string text;
+            for (int i = 0; i < 300; ++i) text += "aaab Z"[rng() % 6];
+            std::vector<SearchMatch> ours;
+            searcher.FindInLine(text, 0, ours);
+            ASSERT_TRUE(ours == ReferenceFind(pattern, text));
+        }
+    }
+}
+
+TEST(RegexSearcher_DfaCacheLimitFallsBackToNfa) {
+    // (a|b)*a(a|b){12} の DFA は 2^13 状態になる。小さなキャッシュでは作り直しが続いて NFA に切り替わるが、
+    // 結果は大きなキャッシュのときと同じ
+    std::mt19937 rng(3);
+    std::vector<std::string> lines(50);
+    for (auto& line : lines) {
+        for (int i = 0; i < 400; ++i) line += "ab"[rng() % 2];
+        line += "c";
+    }
+    const std::string pattern = "(a|b)*a(a|b){12}c";
+    RegexSearcher large(pattern, 64 << 20);
+    RegexSearcher small(pattern, 16 << 10);
+    std::vector<SearchMatch> expected, actual;
+    large.FindInLines(lines, expected);
+    small.FindInLines(lines, actual);
+    ASSERT_TRUE(!expected.empty());
+    ASSERT_TRUE(actual == expected);
+    ASSERT_TRUE(small.GetStats().cache_resets > 0);
+    ASSERT_TRUE(small.GetStats().nfa_fallback);
+    ASSERT_TRUE(!large.GetStats().nfa_fallback);
+}
+
+TEST(RegexSearcher_FindInLines) {
+    const std::vector<std::string> lines = {"# Title", "", "text #tag", "## Sub"};
+    std::vector<SearchMatch> matches;
+    RegexSearcher("^#+ ").FindInLines(lines, matches);
+    const std::vector<SearchMatch> expected = {{0, 0, 2}, {3, 0, 3}};
+    ASSERT_TRUE(matches == expected);
+}
+
+int main() {
+    return run_all_tests();
+}
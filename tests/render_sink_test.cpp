@@ -0,0 +1,107 @@
+#include "test_framework.h"
+#include "markdown_renderer.h"
+#include "render_sink.h"
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+
+using namespace ShinoEditor;
+
+namespace {
+std::string ReadAll(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// 塊に分けて流されるくらいの大きさの文書
+std::string LargeDocument() {
+    std::string md;
+    for (int i = 0; i < 3000; ++i) {
+        md += "## Section " + std::to_string(i) + "\n\n";
+        md += "Text with **bold**, `code` & <tags> in section " + std::to_string(i) + ".\n\n";
+        md += "- item\n  - nested\n\n";
+    }
+    return md;
+}
+}
+
+TEST(StringSink_Appends) {
+    std::string out = "x";
+    StringSink sink(out);
+    sink.Write("ab");
+    sink.Write("");
+    sink.Write("cd");
+    ASSERT_TRUE(sink.Flush());
+    ASSERT_EQ(out, std::string("xabcd"));
+}
+
+TEST(CallbackSink_ReceivesChunks) {
+    std::vector<std::string> chunks;
+    CallbackSink sink([&](std::string_view chunk) { chunks.emplace_back(chunk); });
+    sink.Write("one");
+    sink.Write("two");
+    ASSERT_EQ(static_cast<int>(chunks.size()), 2);
+    ASSERT_EQ(chunks[1], std::string("two"));
+}
+
+TEST(FdSink_BuffersAndWritesEverything) {
+    auto path = test_utils::create_temp_file("");
+    const int fd = ::open(path.string().c_str(), O_WRONLY | O_TRUNC);
+    ASSERT_TRUE(fd >= 0);
+    {
+        // バッファより小さい書き込みと大きい書き込みを混ぜる
+        FdSink sink(fd, 8);
+        sink.Write("abc");
+        sink.Write("defgh");
+        sink.Write("0123456789abcdef");
+        sink.Write("z");
+        ASSERT_TRUE(sink.Flush());
+        ASSERT_EQ(sink.BytesWritten(), static_cast<size_t>(25));
+    }
+    ::close(fd);
+    ASSERT_EQ(ReadAll(path), std::string("abcdefgh0123456789abcdefz"));
+    std::filesystem::remove(path);
+}
+
+TEST(FdSink_ReportsWriteError) {
+    FdSink sink(-1, 4);
+    sink.Write("too long for the buffer");
+    ASSERT_TRUE(sink.Failed());
+    ASSERT_TRUE(!sink.Flush());
+}
+
+TEST(RenderHtmlTo_MatchesRenderToHtml) {
+    MarkdownRenderer renderer;
+    const std::string md = LargeDocument();
+    std::vector<std::string> chunks;
+    CallbackSink sink([&](std::string_view chunk) { chunks.emplace_back(chunk); });
+    ASSERT_TRUE(renderer.RenderHtmlTo(md, sink));
+    // 全体を 1 回で渡さず、いくつかの塊に分かれている
+    ASSERT_TRUE(chunks.size() > 1);
+    std::string joined;
+    for (const auto& chunk : chunks) joined += chunk;
+    ASSERT_EQ(joined, renderer.RenderToHtml(md));
+}
+
+TEST(RenderTextTo_MatchesRenderToText) {
+    MarkdownRenderer renderer;
+    const std::string md = LargeDocument();
+    std::string out;
+    StringSink sink(out);
+    ASSERT_TRUE(renderer.RenderTextTo(md, sink));
+    ASSERT_EQ(out, renderer.RenderToText(md));
+}
+
+TEST(RenderHtmlTo_StopsWhenCancelled) {
+    MarkdownRenderer renderer;
+    std::atomic<bool> cancel{true};
+    std::string out;
+    StringSink sink(out);
+    ASSERT_TRUE(!renderer.RenderHtmlTo(LargeDocument(), sink, &cancel));
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,124 @@
+#include "test_framework.h"
+#include "subprocess.h"
+#include "error_handler.h"
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#include <sys/wait.h>
+#endif
+
+using namespace ShinoEditor;
+
+TEST(LineSplitter_MatchesGetline) {
+    std::vector<std::string> lines;
+    LineSplitter splitter(lines);
+    // 行の途中で区切られた断片を繋ぐ
+    for (std::string_view chunk : {"# ti", "tle\n\nbo", "dy", "\n", "last"}) splitter.Append(chunk);
+    const std::vector<std::string> expected = {"# title", "", "body", "last"};
+    ASSERT_TRUE(lines == expected);
+
+    // 末尾の改行のあとに空行は足さない。既にある行の後ろに足す
+    std::vector<std::string> more = {"keep"};
+    LineSplitter(more).Append("a\n\n");
+    const std::vector<std::string> expected_more = {"keep", "a", ""};
+    ASSERT_TRUE(more == expected_more);
+}
+
+#ifndef _WIN32
+TEST(Subprocess_StreamsLargeInputAndOutput) {
+    // stdin と stdout を同時に進めないと、パイプのバッファが詰まって止まる大きさ
+    std::string input;
+    for (int i = 0; input.size() < (8u << 20); ++i) input += "line " + std::to_string(i) + " 日本語\n";
+    std::string output;
+    size_t chunks = 0;
+    const auto result = Subprocess::Run({"/bin/cat"}, input, [&](std::string_view chunk) {
+        output += chunk;
+        ++chunks;
+    });
+    ASSERT_TRUE(result.Succeeded());
+    ASSERT_TRUE(output == input);
+    ASSERT_TRUE(chunks >= input.size() / Subprocess::kReadChunk);
+}
+
+TEST(Subprocess_ReportsExitStatusSignalAndStderr) {
+    // 引数は shell を通さずにそのまま渡る
+    std::string output;
+    auto result = Subprocess::Run({"/bin/sh", "-c", "printf '%s' \"$0\"; echo 'bad input' >&2; exit 3", "a b;$x"}, {},
+                                  [&](std::string_view chunk) { output += chunk; });
+    ASSERT_EQ(output, std::string("a b;$x"));
+    ASSERT_EQ(result.exit_code, 3);
+    ASSERT_FALSE(result.Succeeded());
+    ASSERT_EQ(result.stderr_text, std::string("bad input\n"));
+    ASSERT_EQ(result.Describe(), std::string("exit status 3: bad input"));
+
+    result = Subprocess::Run({"/bin/sh", "-c", "kill -9 $$"}, {}, nullptr);
+    ASSERT_EQ(result.signal, 9);
+    ASSERT_EQ(result.Describe(), std::string("killed by signal 9"));
+
+    bool thrown = false;
+    try {
+        Subprocess::Run({"/nonexistent/pandoc"}, {}, nullptr);
+    } catch (const ShinoError& e) {
+        thrown = e.category() == ShinoError::Category::System;
+    }
+    ASSERT_TRUE(thrown);
+}
+
+TEST(Subprocess_ChildClosingStdinDoesNotRaiseSigpipe) {
+    const std::string input(4u << 20, 'x');
+    std::string output;
+    const auto result = Subprocess::Run({"/usr/bin/head", "-c", "10"}, input,
+                                        [&](std::string_view chunk) { output += chunk; });
+    ASSERT_TRUE(result.Succeeded());
+    ASSERT_EQ(output, std::string(10, 'x'));
+}
+
+TEST(Subprocess_CancelKillsChildAndGrandchildren) {
+    std::atomic<bool> cancel{false};
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        cancel = true;
+    });
+    const auto start = std::chrono::steady_clock::now();
+    // sleep は sh の子として stdout を持ち続ける
+    const auto result = Subprocess::Run({"/bin/sh", "-c", "sleep 30; echo done"}, {}, nullptr, &cancel);
+    canceller.join();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(result.cancelled);
+    ASSERT_FALSE(result.Succeeded());
+    ASSERT_TRUE(elapsed < std::chrono::seconds(5));
+}
+
+TEST(Subprocess_ThrowingCallbackKillsAndReapsChild) {
+    auto open_fds = [] {
+        return std::distance(std::filesystem::directory_iterator("/proc/self/fd"), std::filesystem::directory_iterator());
+    };
+    const auto fds_before = open_fds();
+    const auto start = std::chrono::steady_clock::now();
+    bool thrown = false;
+    try {
+        // 最初の出力で投げる。子（と孫の sleep）は止めて回収し、fd とシグナルマスクを戻す
+        Subprocess::Run({"/bin/sh", "-c", "echo first; sleep 30"}, std::string(1u << 20, 'x'),
+                        [](std::string_view) { throw std::runtime_error("stop"); });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ASSERT_TRUE(thrown);
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    ASSERT_EQ(open_fds(), fds_before);
+    sigset_t mask;
+    pthread_sigmask(SIG_SETMASK, nullptr, &mask);
+    ASSERT_FALSE(sigismember(&mask, SIGPIPE));
+    // 子は回収済みなので、待つ子は残っていない
+    ASSERT_TRUE(waitpid(-1, nullptr, WNOHANG) < 0 && errno == ECHILD);
+}
+#endif
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,102 @@
+#include "test_framework.h"
+#include "syntax_highlighter.h"
+
+using namespace ShinoEditor;
+
+namespace {
+std::vector<HighlightSpan> Tokenize(const std::string& line, LineState state = {}) {
+    std::vector<HighlightSpan> spans;
+    SyntaxHighlighter::TokenizeLine(line, state, &spans);
+    return spans;
+}
+
+bool HasSpan(const std::vector<HighlightSpan>& spans, size_t begin, size_t end, HighlightStyle style) {
+    for (const auto& s : spans) {
+        if (s.begin == begin && s.end == end && s.style == style) return true;
+    }
+    return false;
+}
+}
+
+TEST(Tokenize_BlockElements) {
+    auto spans = Tokenize("## 見出し");
+    ASSERT_TRUE(HasSpan(spans, 0, std::string("## 見出し").size(), HighlightStyle::HEADER));
+
+    spans = Tokenize("- item");
+    ASSERT_TRUE(HasSpan(spans, 0, 2, HighlightStyle::LIST_MARKER));
+
+    spans = Tokenize("> quote `x`");
+    ASSERT_TRUE(HasSpan(spans, 0, 2, HighlightStyle::QUOTE));
+    ASSERT_TRUE(HasSpan(spans, 2, 8, HighlightStyle::QUOTE));
+    ASSERT_TRUE(HasSpan(spans, 8, 11, HighlightStyle::INLINE_CODE));
+
+    // "#tag" は見出しではない
+    ASSERT_TRUE(Tokenize("#tag").empty());
+}
+
+TEST(Tokenize_Inline) {
+    auto spans = Tokenize("a **b *c* d** e");
+    ASSERT_EQ(static_cast<int>(spans.size()), 1);
+    ASSERT_TRUE(HasSpan(spans, 2, 13, HighlightStyle::STRONG));
+
+    spans = Tokenize("*x* `**` [l](u)");
+    ASSERT_TRUE(HasSpan(spans, 0, 3, HighlightStyle::EMPHASIS));
+    ASSERT_TRUE(HasSpan(spans, 4, 8, HighlightStyle::INLINE_CODE));
+    ASSERT_TRUE(HasSpan(spans, 9, 15, HighlightStyle::LINK));
+
+    // 単語内の _ は強調にしない
+    ASSERT_TRUE(Tokenize("snake_case_name").empty());
+}
+
+TEST(Tokenize_FenceState) {
+    LineState state = SyntaxHighlighter::TokenizeLine("```cpp", {}, nullptr);
+    ASSERT_TRUE(state.in_fence);
+    auto spans = Tokenize("# not a header", state);
+    ASSERT_TRUE(HasSpan(spans, 0, 14, HighlightStyle::FENCE_BODY));
+    // 短いフェンスや別の文字では閉じない
+    ASSERT_TRUE(SyntaxHighlighter::TokenizeLine("~~~", state, nullptr).in_fence);
+    ASSERT_FALSE(SyntaxHighlighter::TokenizeLine("```", state, nullptr).in_fence);
+}
+
+TEST(Incremental_FenceEditPropagates) {
+    std::vector<std::string> lines = {"text", "# h", "**b**", "```", "code", "```", "# tail"};
+    SyntaxHighlighter hl(lines);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(6), 0, 6, HighlightStyle::HEADER));
+    ASSERT_TRUE(HasSpan(hl.GetSpans(4), 0, 4, HighlightStyle::FENCE_BODY));
+
+    // 先頭行をフェンス開始にすると後続の状態が反転する
+    lines[0] = "```";
+    hl.InvalidateLine(0);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(1), 0, 3, HighlightStyle::FENCE_BODY));
+    ASSERT_TRUE(hl.GetLineState(4).in_fence == false);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(4), 0, 4, HighlightStyle::INLINE_CODE) == false);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(6), 0, 6, HighlightStyle::FENCE_BODY));
+
+    // 元に戻すと収束して元のハイライトに戻る
+    lines[0] = "text";
+    hl.InvalidateLine(0);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(6), 0, 6, HighlightStyle::HEADER));
+    ASSERT_TRUE(HasSpan(hl.GetSpans(4), 0, 4, HighlightStyle::FENCE_BODY));
+}
+
+TEST(Incremental_InsertErase) {
+    std::vector<std::string> lines = {"a", "```", "x", "```", "# h"};
+    SyntaxHighlighter hl(lines);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(4), 0, 3, HighlightStyle::HEADER));
+
+    // フェンス内に閉じフェンスを挿入
+    lines.insert(lines.begin() + 2, "```");
+    hl.InsertLines(2, 1);
+    ASSERT_FALSE(hl.GetLineState(3).in_fence);
+    ASSERT_TRUE(hl.GetLineState(5).in_fence);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(5), 0, 3, HighlightStyle::FENCE_BODY));
+
+    lines.erase(lines.begin() + 2);
+    hl.EraseLines(2, 1);
+    ASSERT_TRUE(HasSpan(hl.GetSpans(2), 0, 1, HighlightStyle::FENCE_BODY));
+    ASSERT_TRUE(HasSpan(hl.GetSpans(4), 0, 3, HighlightStyle::HEADER));
+}
+
+int main() {
+    return run_all_tests();
+}
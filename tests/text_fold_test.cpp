@@ -0,0 +1,189 @@
+#include "test_framework.h"
+#include "text_fold.h"
+#include "incremental_search.h"
+#include <random>
+
+using namespace ShinoEditor;
+
+namespace {
+const FoldOptions kCaseWidth{true, true, false};
+const FoldOptions kAll{true, true, true};
+
+std::string Fold(std::string_view in, const FoldOptions& options) {
+    std::string out;
+    FoldText(in, options, out);
+    return out;
+}
+
+std::vector<SearchMatch> FindAllAtOnce(const std::vector<std::string>& lines, const std::string& query) {
+    std::vector<SearchMatch> out;
+    SubstringSearcher(query).FindInLines(lines, out);
+    return out;
+}
+}
+
+TEST(FoldText_CaseAndWidth) {
+    ASSERT_EQ(Fold("Hello World", kCaseWidth), std::string("hello world"));
+    // 全角英数記号と全角空白
+    ASSERT_EQ(Fold("ＡＢＣ１２３！　ｘ", kCaseWidth), std::string("abc123! x"));
+    // 大文字小文字だけなら幅は変えない
+    ASSERT_EQ(Fold("ＡＢＣ", FoldOptions{true, false, false}), std::string("ＡＢＣ"));
+    ASSERT_EQ(Fold("ABC", FoldOptions{false, true, false}), std::string("ABC"));
+    // 漢字やひらがなはそのまま
+    ASSERT_EQ(Fold("日本語のテキスト", kCaseWidth), std::string("日本語のテキスト"));
+}
+
+TEST(FoldText_HalfwidthKana) {
+    ASSERT_EQ(Fold("ｶﾀｶﾅ", kCaseWidth), std::string("カタカナ"));
+    // 濁点/半濁点は前の文字と合成する
+    ASSERT_EQ(Fold("ｶﾞｷﾞﾊﾟｳﾞ", kCaseWidth), std::string("ガギパヴ"));
+    ASSERT_EQ(Fold("ﾃﾞｰﾀﾍﾞｰｽ", kCaseWidth), std::string("データベース"));
+    // 結合用の濁点（U+3099）も合成する
+    ASSERT_EQ(Fold("が", kCaseWidth), std::string("が"));
+    // 合成できない濁点は全角の結合用濁点として残る
+    ASSERT_EQ(Fold("ｱﾞ", kCaseWidth), std::string("ア゙"));
+    ASSERT_EQ(Fold("｢ｺﾝﾆﾁﾊ｣", kCaseWidth), std::string("「コンニチハ」"));
+}
+
+TEST(FoldText_KanaFold) {
+    ASSERT_EQ(Fold("カタカナ", kAll), std::string("かたかな"));
+    ASSERT_EQ(Fold("ｶﾞｯｺｳ", kAll), std::string("がっこう"));
+    ASSERT_EQ(Fold("ヴ", kAll), std::string("ゔ"));
+    // 長音符はそのまま
+    ASSERT_EQ(Fold("データ", kAll), std::string("でーた"));
+}
+
+TEST(FoldText_InvalidUtf8PassesThrough) {
+    const std::string in = std::string("A\xff") + "Ｂ" + "\xe3\x81" + "C";
+    std::string out;
+    std::vector<uint32_t> offsets;
+    FoldText(in, kCaseWidth, out, &offsets);
+    ASSERT_EQ(out, std::string("a\xff") + "b" + "\xe3\x81" + "c");
+    ASSERT_EQ(offsets.size(), out.size() + 1);
+    // 本物の U+FFFD はそのまま
+    ASSERT_EQ(Fold("\xef\xbf\xbd", kCaseWidth), std::string("\xef\xbf\xbd"));
+}
+
+TEST(FoldText_Offsets) {
+    std::string out;
+    std::vector<uint32_t> offsets;
+    // バイト数が変わらなければ恒等写像（空）
+    FoldText("ABC 日本語", kCaseWidth, out, &offsets);
+    ASSERT_TRUE(offsets.empty());
+
+    // "aＢｶﾞc": a(0) Ｂ(1..3) ｶ(4..6) ﾞ(7..9) c(10)
+    FoldText("aＢｶﾞc", kCaseWidth, out, &offsets);
+    ASSERT_EQ(out, std::string("abガc"));
+    const std::vector<uint32_t> expected = {0, 1, 4, 4, 4, 10, 11};
+    ASSERT_TRUE(offsets == expected);
+
+    // 途中から対応が必要になる場合も、前の部分は 1 対 1
+    FoldText("日本Ａ", kCaseWidth, out, &offsets);
+    ASSERT_EQ(out, std::string("日本a"));
+    ASSERT_EQ(offsets.size(), size_t(8));
+    ASSERT_EQ(offsets[3], uint32_t(3));
+    ASSERT_EQ(offsets[6], uint32_t(6));
+    ASSERT_EQ(offsets[7], uint32_t(9));
+}
+
+TEST(FoldedLines_MapsMatchesToOriginal) {
+    std::vector<std::string> lines = {"ﾃﾞｰﾀﾍﾞｰｽ と ＤＡＴＡＢＡＳＥ", "plain Database", "データベース"};
+    FoldedLines folded(lines);
+    ASSERT_EQ(folded.Sync(kCaseWidth), size_t(3));
+    ASSERT_EQ(folded.Sync(kCaseWidth), size_t(0));
+
+    const auto kana = FindAllAtOnce(folded.Lines(), "データベース");
+    ASSERT_EQ(kana.size(), size_t(2));
+    // 半角の "ﾃﾞｰﾀﾍﾞｰｽ" は 8 文字 24 バイト
+    ASSERT_TRUE(folded.ToOriginal(kana[0]) == (SearchMatch{0, 0, 24}));
+    ASSERT_TRUE(folded.ToOriginal(kana[1]) == (SearchMatch{2, 0, lines[2].size()}));
+
+    const auto latin = FindAllAtOnce(folded.Lines(), "database");
+    ASSERT_EQ(latin.size(), size_t(2));
+    const size_t wide = lines[0].find("ＤＡＴＡＢＡＳＥ");
+    ASSERT_TRUE(folded.ToOriginal(latin[0]) == (SearchMatch{0, wide, 24}));
+    ASSERT_TRUE(folded.ToOriginal(latin[1]) == (SearchMatch{1, 6, 8}));
+
+    // 合成した文字の途中で始まる/終わる一致は、元の文字全体に広げる
+    std::vector<std::string> single = {"ｶﾞ"};
+    FoldedLines one(single);
+    one.Sync(kCaseWidth);
+    ASSERT_TRUE(one.ToOriginal(SearchMatch{0, 1, 1}) == (SearchMatch{0, 0, 6}));
+}
+
+TEST(FoldedLines_FollowsEdits) {
+    std::mt19937 rng(3);
+    const char* pieces[] = {"ｶﾀｶﾅ", "カタカナ", "ＡＢＣ", "abc", "Abc", "日本", " ", "ﾊﾟ"};
+    auto random_line = [&] {
+        std::string line;
+        const int n = static_cast<int>(rng() % 6);
+        for (int i = 0; i < n; ++i) line += pieces[rng() % 8];
+        return line;
+    };
+    std::vector<std::string> lines(200);
+    for (auto& line : lines) line = random_line();
+    FoldedLines folded(lines);
+    folded.Sync(kAll);
+
+    for (int round = 0; round < 300; ++round) {
+        const int op = static_cast<int>(rng() % 3);
+        const int pos = static_cast<int>(rng() % lines.size());
+        if (op == 0) {
+            lines[pos] = random_line();
+            folded.InvalidateLine(pos);
+        } else if (op == 1) {
+            const int count = 1 + static_cast<int>(rng() % 3);
+            lines.insert(lines.begin() + pos, count, random_line());
+            folded.InsertLines(pos, count);
+        } else if (lines.size() > 10) {
+            const int count = 1 + static_cast<int>(rng() % 3);
+            lines.erase(lines.begin() + pos, lines.begin() + std::min<int>(pos + count, static_cast<int>(lines.size())));
+            folded.EraseLines(pos, count);
+        }
+        if (round % 20 == 19) {
+            // 変わった行だけ作り直す
+            ASSERT_TRUE(folded.Sync(kAll) < lines.size());
+            ASSERT_EQ(folded.Lines().size(), lines.size());
+            for (size_t i = 0; i < lines.size(); ++i) ASSERT_EQ(folded.Lines()[i], Fold(lines[i], kAll));
+        }
+    }
+
+    // 一度にたくさんの行が変わっても揃う
+    lines.insert(lines.begin() + 3, 5000, "ＡＢＣ ｶﾀｶﾅ");
+    folded.InsertLines(3, 5000);
+    lines[1] = "Abc";
+    folded.InvalidateLine(1);
+    ASSERT_EQ(folded.Sync(kAll), size_t(5001));
+    for (size_t i = 0; i < lines.size(); ++i) ASSERT_EQ(folded.Lines()[i], Fold(lines[i], kAll));
+
+    // 設定を変えるとすべて作り直す
+    ASSERT_EQ(folded.Sync(kCaseWidth), lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) ASSERT_EQ(folded.Lines()[i], Fold(lines[i], kCaseWidth));
+    folded.Clear();
+    ASSERT_EQ(folded.MemoryUsage(), size_t(0));
+    // 捨てたあとの編集通知は無視し、次の Sync() で作り直す
+    folded.InsertLines(0, 1);
+    ASSERT_EQ(folded.Sync(kCaseWidth), lines.size());
+}
+
+TEST(FoldedLines_IncrementalSearchOnShadow) {
+    std::vector<std::string> lines;
+    for (int i = 0; i < 2000; ++i) lines.push_back(i % 97 == 0 ? "ｻｰﾊﾞｰ の ＳＥＲＶＥＲ" : "サーバー server");
+    FoldedLines folded(lines);
+    folded.Sync(kAll);
+    IncrementalSearch search(folded.Lines());
+    std::string query;
+    FoldText("サーバー", kAll, query);
+    search.SetQuery(query, 1);
+    while (!search.Step(4096)) {}
+    ASSERT_EQ(search.Matches().size(), lines.size());
+    for (const auto& match : search.Matches()) {
+        const SearchMatch original = folded.ToOriginal(match);
+        const std::string text = lines[original.line].substr(original.offset, original.length);
+        ASSERT_TRUE(text == "ｻｰﾊﾞｰ" || text == "サーバー");
+    }
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,94 @@
+#include "test_framework.h"
+#include "text_replace.h"
+#include <random>
+
+using namespace ShinoEditor;
+
+namespace {
+std::vector<SearchMatch> FindAll(const std::vector<std::string>& lines, const std::string& query) {
+    std::vector<SearchMatch> out;
+    SubstringSearcher(query).FindInLines(lines, out);
+    return out;
+}
+
+// 一致ごとに std::string::replace で置き換える（比較用）
+std::vector<std::string> ReplaceNaive(std::vector<std::string> lines, const std::string& query,
+                                      const std::string& replacement) {
+    for (auto& line : lines) {
+        for (size_t pos = line.find(query); pos != std::string::npos;
+             pos = line.find(query, pos + replacement.size())) {
+            line.replace(pos, query.size(), replacement);
+        }
+    }
+    return lines;
+}
+}
+
+TEST(BuildLineEdits_OneEditPerLine) {
+    std::vector<std::string> lines = {"foo bar foo", "nothing", "foofoo", "", "x foo"};
+    size_t replaced = 0;
+    auto edits = BuildLineEdits(lines, FindAll(lines, "foo"), "quux", &replaced);
+    ASSERT_EQ(replaced, size_t(5));
+    ASSERT_EQ(edits.size(), size_t(3));
+    ASSERT_EQ(edits[0].line, 0);
+    ASSERT_EQ(edits[0].text, std::string("quux bar quux"));
+    ASSERT_EQ(edits[1].line, 2);
+    ASSERT_EQ(edits[1].text, std::string("quuxquux"));
+    ASSERT_EQ(edits[2].line, 4);
+    ASSERT_EQ(edits[2].text, std::string("x quux"));
+
+    // 空文字列への置換（削除）
+    edits = BuildLineEdits(lines, FindAll(lines, "foo"), "");
+    ASSERT_EQ(edits[0].text, std::string(" bar "));
+    ASSERT_EQ(edits[1].text, std::string(""));
+
+    // 同じ文字列への置換では行は変わらない
+    edits = BuildLineEdits(lines, FindAll(lines, "foo"), "foo", &replaced);
+    ASSERT_TRUE(edits.empty());
+    ASSERT_EQ(replaced, size_t(5));
+}
+
+TEST(BuildLineEdits_SkipsOverlappingAndOutOfRange) {
+    std::vector<std::string> lines = {"aaaa", "abc"};
+    // 重なる一致（0-2 と 1-3）は前のものだけ、行の外は無視する
+    const std::vector<SearchMatch> matches = {{0, 0, 2}, {0, 1, 2}, {0, 2, 2}, {1, 2, 5}, {7, 0, 1}};
+    size_t replaced = 0;
+    auto edits = BuildLineEdits(lines, matches, "X", &replaced);
+    ASSERT_EQ(replaced, size_t(2));
+    ASSERT_EQ(edits.size(), size_t(1));
+    ASSERT_EQ(edits[0].text, std::string("XX"));
+}
+
+TEST(BuildLineEdits_MatchesNaiveReplace) {
+    std::mt19937 rng(11);
+    std::vector<std::string> lines(500);
+    for (auto& line : lines) {
+        const size_t len = rng() % 80;
+        for (size_t i = 0; i < len; ++i) line += "ab日 "[rng() % 4];
+    }
+    for (const std::string replacement : {"", "Z", "ab", "置換後"}) {
+        for (const std::string query : {"ab", "a", "b a", "bb"}) {
+            auto edits = BuildLineEdits(lines, FindAll(lines, query), replacement);
+            std::vector<std::string> replaced = lines;
+            SwapLineEdits(replaced, edits);
+            ASSERT_TRUE(replaced == ReplaceNaive(lines, query, replacement));
+        }
+    }
+}
+
+TEST(SwapLineEdits_UndoesItself) {
+    std::vector<std::string> lines = {"one two", "three", "two two"};
+    const auto original = lines;
+    auto edits = BuildLineEdits(lines, FindAll(lines, "two"), "2");
+    SwapLineEdits(lines, edits);
+    ASSERT_EQ(lines[0], std::string("one 2"));
+    ASSERT_EQ(lines[2], std::string("2 2"));
+    // 入れ替えたあとの edits は元の行を持つ
+    ASSERT_EQ(edits[0].text, std::string("one two"));
+    SwapLineEdits(lines, edits);
+    ASSERT_TRUE(lines == original);
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,126 @@
+#include "test_framework.h"
+#include "text_search.h"
+#include <random>
+
+using namespace ShinoEditor;
+
+namespace {
+// 比較用の素朴な実装（重ならない一致の位置）
+std::vector<size_t> NaiveFindAll(std::string_view text, std::string_view needle) {
+    std::vector<size_t> out;
+    if (needle.empty()) return out;
+    for (size_t pos = text.find(needle); pos != std::string_view::npos; pos = text.find(needle, pos + needle.size())) {
+        out.push_back(pos);
+    }
+    return out;
+}
+
+std::vector<size_t> FindAll(const SubstringSearcher& searcher, std::string_view text) {
+    std::vector<size_t> out;
+    const size_t n = searcher.Needle().size();
+    for (size_t pos = searcher.Find(text); pos != std::string_view::npos; pos = searcher.Find(text, pos + n)) {
+        out.push_back(pos);
+    }
+    return out;
+}
+}
+
+TEST(SubstringSearcher_Basic) {
+    SubstringSearcher searcher("abc");
+    ASSERT_EQ(searcher.Find("xxabcxxabc"), size_t(2));
+    ASSERT_EQ(searcher.Find("xxabcxxabc", 3), size_t(7));
+    ASSERT_EQ(searcher.Find("xxabcxxab", 3), std::string_view::npos);
+    ASSERT_EQ(searcher.Find("ab"), std::string_view::npos);
+    ASSERT_EQ(searcher.Find("abc", 4), std::string_view::npos);
+
+    // 1 バイトと空のパターン
+    ASSERT_EQ(SubstringSearcher("c").Find("abc"), size_t(2));
+    ASSERT_EQ(SubstringSearcher("").Find("abc"), std::string_view::npos);
+}
+
+TEST(SubstringSearcher_MatchesAcrossSimdBlocks) {
+    // SIMD の 16/32 バイト境界をまたぐ位置や末尾ぎりぎりの一致
+    std::string text(200, '.');
+    for (size_t at : {0u, 15u, 16u, 31u, 33u, 63u, 190u}) {
+        std::string t = text;
+        t.replace(at, 10, "0123456789");
+        SubstringSearcher searcher("0123456789");
+        ASSERT_EQ(searcher.Find(t), at);
+    }
+    std::string t = text;
+    t.replace(t.size() - 3, 3, "xyz");
+    ASSERT_EQ(SubstringSearcher("xyz").Find(t), t.size() - 3);
+}
+
+TEST(SubstringSearcher_MatchesNaiveOnRandomText) {
+    // 小さいアルファベットで候補を多くし、短い/長い（Horspool）パターンの両方を比べる
+    std::mt19937 rng(42);
+    std::string text;
+    for (int i = 0; i < 20000; ++i) text += "ab\n "[rng() % 4];
+    for (size_t len : {2u, 3u, 5u, 8u, 17u, 31u, 32u, 40u, 64u}) {
+        for (int trial = 0; trial < 5; ++trial) {
+            const size_t at = rng() % (text.size() - len);
+            const std::string needle = text.substr(at, len);
+            SubstringSearcher searcher(needle);
+            ASSERT_TRUE(FindAll(searcher, text) == NaiveFindAll(text, needle));
+        }
+    }
+}
+
+TEST(SubstringSearcher_FrequentRareByteFallsBackToPairFilter) {
+    // 珍しいはずの大文字が頻出しても、結果は変わらない（途中で 2 バイトの絞り込みに切り替わる）
+    std::string text;
+    for (int i = 0; i < 5000; ++i) text += "Xa Xb ";
+    text += "Xab Xc";
+    for (const std::string needle : {"Xab", "Xc", "Xa Xb Xab", "Q"}) {
+        SubstringSearcher searcher(needle);
+        ASSERT_TRUE(FindAll(searcher, text) == NaiveFindAll(text, needle));
+    }
+}
+
+TEST(SubstringSearcher_CountNewlines) {
+    std::string text;
+    for (int i = 0; i < 10000; ++i) text += (i % 3 == 0) ? "\n" : "abc";
+    size_t expected = 0;
+    for (char c : text) expected += c == '\n';
+    ASSERT_EQ(SubstringSearcher::CountNewlines(text), expected);
+    ASSERT_EQ(SubstringSearcher::CountNewlines(""), size_t(0));
+}
+
+TEST(SubstringSearcher_Japanese) {
+    const std::string line = "日本語の検索。検索は速い";
+    std::vector<SearchMatch> matches;
+    SubstringSearcher("検索").FindInLine(line, 3, matches);
+    ASSERT_EQ(matches.size(), size_t(2));
+    ASSERT_EQ(matches[0].line, 3);
+    ASSERT_EQ(matches[0].offset, std::string("日本語の").size());
+    ASSERT_EQ(matches[0].length, std::string("検索").size());
+    ASSERT_EQ(matches[1].offset, std::string("日本語の検索。").size());
+}
+
+TEST(SubstringSearcher_FindInLines) {
+    const std::vector<std::string> lines = {"foo bar", "", "bar", "no", "barbar"};
+    std::vector<SearchMatch> matches;
+    SubstringSearcher("bar").FindInLines(lines, matches);
+    const std::vector<SearchMatch> expected = {{0, 4, 3}, {2, 0, 3}, {4, 0, 3}, {4, 3, 3}};
+    ASSERT_TRUE(matches == expected);
+}
+
+TEST(SubstringSearcher_FindInTextReportsLinesAndOffsets) {
+    const std::string text = "foo bar\n\nbar\nno\nbarbar";
+    std::vector<SearchMatch> matches;
+    SubstringSearcher("bar").FindInText(text, matches);
+    const std::vector<SearchMatch> expected = {{0, 4, 3}, {2, 0, 3}, {4, 0, 3}, {4, 3, 3}};
+    ASSERT_TRUE(matches == expected);
+
+    // 行番号の起点を指定できる
+    matches.clear();
+    SubstringSearcher("no").FindInText(text, matches, 100);
+    ASSERT_EQ(matches.size(), size_t(1));
+    ASSERT_EQ(matches[0].line, 103);
+    ASSERT_EQ(matches[0].offset, size_t(0));
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,56 @@
+#include "test_framework.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <stdexcept>
+
+using namespace ShinoEditor;
+
+TEST(ParallelFor_VisitsEveryIndexOnce) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> visits(10000);
+    pool.ParallelFor(visits.size(), [&](size_t i) { ++visits[i]; });
+    int wrong = 0;
+    for (const auto& v : visits) {
+        if (v.load() != 1) ++wrong;
+    }
+    ASSERT_EQ(wrong, 0);
+
+    // 0 件・1 件でも動く
+    pool.ParallelFor(0, [](size_t) {});
+    int single = 0;
+    pool.ParallelFor(1, [&](size_t) { ++single; });
+    ASSERT_EQ(single, 1);
+}
+
+TEST(ParallelFor_RethrowsException) {
+    ThreadPool pool(2);
+    bool caught = false;
+    try {
+        pool.ParallelFor(100, [](size_t i) {
+            if (i == 42) throw std::runtime_error("boom");
+        });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    ASSERT_TRUE(caught);
+
+    // 例外の後もプールは使える
+    std::atomic<int> count{0};
+    pool.ParallelFor(10, [&](size_t) { ++count; });
+    ASSERT_EQ(count.load(), 10);
+}
+
+TEST(Submit_RunsBeforeDestruction) {
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 100; ++i) {
+            pool.Submit([&] { ++count; });
+        }
+    }
+    ASSERT_EQ(count.load(), 100);
+}
+
+int main() {
+    return run_all_tests();
+}
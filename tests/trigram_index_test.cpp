@@ -0,0 +1,225 @@
+#include "test_framework.h"
+#include "trigram_index.h"
+#include "incremental_search.h"
+#include <algorithm>
+#include <random>
+
+using namespace ShinoEditor;
+
+namespace {
+std::vector<std::string> RandomLines(std::mt19937& rng, size_t count) {
+    std::vector<std::string> lines(count);
+    for (auto& line : lines) {
+        const size_t len = rng() % 60;
+        for (size_t i = 0; i < len; ++i) line += "abcdefghijklmnopqrstuvwxyz "[rng() % 27];
+    }
+    return lines;
+}
+
+void BuildToEnd(TrigramIndex& index, size_t budget = TrigramIndex::kDefaultStepBytes) {
+    index.Build();
+    while (!index.Step(budget)) {}
+}
+
+// 候補は query を含む行をすべて含み、昇順
+bool CoversMatches(TrigramIndex& index, const std::vector<std::string>& lines, const std::string& query) {
+    std::vector<size_t> candidates;
+    if (!index.CandidateLines(query, candidates)) return false;
+    if (!std::is_sorted(candidates.begin(), candidates.end())) return false;
+    for (size_t line = 0; line < lines.size(); ++line) {
+        const bool contains = lines[line].find(query) != std::string::npos;
+        if (contains && !std::binary_search(candidates.begin(), candidates.end(), line)) return false;
+    }
+    return true;
+}
+
+std::vector<SearchMatch> FindAllAtOnce(const std::vector<std::string>& lines, const std::string& query) {
+    std::vector<SearchMatch> out;
+    SubstringSearcher(query).FindInLines(lines, out);
+    return out;
+}
+}
+
+TEST(TrigramIndex_CandidatesCoverMatches) {
+    std::mt19937 rng(5);
+    std::vector<std::string> lines = RandomLines(rng, 3000);
+    lines[1234] += " Quixotic";
+    TrigramIndex index(lines);
+    ASSERT_TRUE(index.GetState() == TrigramIndex::State::EMPTY);
+    BuildToEnd(index, 1000);
+    ASSERT_TRUE(index.Ready());
+    ASSERT_TRUE(index.MemoryUsage() > 0);
+
+    // 行の一部を切り出したクエリ
+    for (int trial = 0; trial < 200; ++trial) {
+        const std::string& line = lines[rng() % lines.size()];
+        if (line.size() < 10) continue;
+        ASSERT_TRUE(CoversMatches(index, lines, line.substr(rng() % (line.size() - 6), 4 + rng() % 3)));
+    }
+    // 珍しいクエリはそのブロックの行だけに絞れる
+    std::vector<size_t> candidates;
+    ASSERT_TRUE(index.CandidateLines("Quixotic", candidates));
+    ASSERT_TRUE(candidates.size() <= TrigramIndex::kLinesPerBlock);
+    ASSERT_TRUE(std::binary_search(candidates.begin(), candidates.end(), size_t(1234)));
+    // どの行にもない trigram があれば候補なし
+    ASSERT_TRUE(index.CandidateLines("XYZ", candidates));
+    ASSERT_TRUE(candidates.empty());
+    // 短いクエリは絞り込めない
+    ASSERT_TRUE(!index.CandidateLines("ab", candidates));
+}
+
+TEST(TrigramIndex_DenseQueryFallsBack) {
+    // 文書のほとんどの行にあるクエリは、索引で絞っても走査と変わらないので使わない
+    std::vector<std::string> lines(20000, "common words everywhere");
+    lines[500] = "rare words";
+    TrigramIndex index(lines);
+    BuildToEnd(index);
+    std::vector<size_t> candidates;
+    ASSERT_TRUE(!index.CandidateLines("common", candidates));
+    ASSERT_TRUE(index.CandidateLines("rare", candidates));
+    ASSERT_TRUE(std::binary_search(candidates.begin(), candidates.end(), size_t(500)));
+}
+
+TEST(TrigramIndex_FollowsEdits) {
+    std::mt19937 rng(9);
+    std::vector<std::string> lines = RandomLines(rng, 500);
+    TrigramIndex index(lines);
+    BuildToEnd(index);
+
+    // 編集ごとにその回だけの文字列を入れ、挿入/削除で行がずれても見つかることを確かめる
+    auto token = [](int round) { return "Tok" + std::to_string(round) + "X"; };
+    for (int round = 0; round < 300; ++round) {
+        const int op = static_cast<int>(rng() % 3);
+        const int pos = static_cast<int>(rng() % lines.size());
+        if (op == 0) {
+            lines[pos] = token(round) + lines[pos];
+            index.UpdateLine(pos);
+        } else if (op == 1) {
+            const int count = 1 + static_cast<int>(rng() % 3);
+            lines.insert(lines.begin() + pos, count, "inserted " + token(round));
+            index.InsertLines(pos, count);
+        } else if (lines.size() > 10) {
+            const int count = 1 + static_cast<int>(rng() % 3);
+            lines.erase(lines.begin() + pos, lines.begin() + std::min<int>(pos + count, static_cast<int>(lines.size())));
+            index.EraseLines(pos, count);
+        }
+        if (round % 10 == 9) {
+            for (int r = 0; r <= round; r += 7) ASSERT_TRUE(CoversMatches(index, lines, token(r)));
+        }
+    }
+    ASSERT_TRUE(index.Ready());
+
+    // 古い内容は候補に残っていても、確かめれば落ちる（行番号は範囲内）
+    std::vector<size_t> candidates;
+    index.CandidateLines(token(0), candidates);
+    for (size_t line : candidates) ASSERT_TRUE(line < lines.size());
+}
+
+TEST(TrigramIndex_EditsWhileBuilding) {
+    std::mt19937 rng(13);
+    std::vector<std::string> lines = RandomLines(rng, 2000);
+    TrigramIndex index(lines);
+    index.Build();
+    index.Step(2000);
+    ASSERT_TRUE(index.GetState() == TrigramIndex::State::BUILDING);
+    ASSERT_TRUE(index.Progress() > 0 && index.Progress() < 1);
+    // 作りかけのあいだは使えない
+    std::vector<size_t> candidates;
+    ASSERT_TRUE(!index.CandidateLines("ZZZ", candidates));
+
+    // 索引に入った行と、まだ入っていない行の両方を書き換える
+    lines[0] = "ZZZ marker";
+    index.UpdateLine(0);
+    lines[1999] = "ZZZ marker";
+    index.UpdateLine(1999);
+    lines.insert(lines.begin() + 5, "ZZZ inserted");
+    index.InsertLines(5, 1);
+    lines.erase(lines.begin() + 100, lines.begin() + 110);
+    index.EraseLines(100, 10);
+    while (!index.Step(2000)) {}
+    ASSERT_TRUE(index.Ready());
+    ASSERT_TRUE(CoversMatches(index, lines, "ZZZ"));
+}
+
+TEST(TrigramIndex_DisabledAboveMemoryLimit) {
+    std::mt19937 rng(17);
+    std::vector<std::string> lines(5000);
+    for (auto& line : lines) {
+        for (int i = 0; i < 80; ++i) line += static_cast<char>('!' + rng() % 90);
+    }
+    TrigramIndex index(lines, 256 << 10);
+    BuildToEnd(index);
+    ASSERT_TRUE(index.GetState() == TrigramIndex::State::DISABLED);
+    ASSERT_EQ(index.MemoryUsage(), size_t(0));
+    std::vector<size_t> candidates;
+    ASSERT_TRUE(!index.CandidateLines("abc", candidates));
+    // 無効のあいだは編集を無視する
+    lines[0] = "abc";
+    index.UpdateLine(0);
+    ASSERT_TRUE(index.GetState() == TrigramIndex::State::DISABLED);
+
+    // 上限に収まれば使える
+    TrigramIndex large(lines, 64 << 20);
+    BuildToEnd(large);
+    ASSERT_TRUE(large.Ready());
+    ASSERT_TRUE(large.MemoryUsage() > (256 << 10));
+    ASSERT_TRUE(CoversMatches(large, lines, lines[42].substr(10, 5)));
+}
+
+TEST(TrigramIndex_RebuildsAfterManyEdits) {
+    std::vector<std::string> lines(100, "some text here");
+    TrigramIndex index(lines);
+    BuildToEnd(index);
+    // 同じ行を何度も書き換えると使わない ID がたまるので、作り直しが始まる
+    bool rebuilt = false;
+    for (int i = 0; i < 10000 && !rebuilt; ++i) {
+        lines[7] = "edit " + std::to_string(i);
+        index.UpdateLine(7);
+        rebuilt = index.GetState() == TrigramIndex::State::BUILDING;
+    }
+    ASSERT_TRUE(rebuilt);
+    while (!index.Step()) {}
+    ASSERT_TRUE(index.Ready());
+    ASSERT_TRUE(CoversMatches(index, lines, "edit"));
+}
+
+TEST(TrigramIndex_IncrementalSearchUsesIndex) {
+    std::mt19937 rng(21);
+    std::vector<std::string> lines = RandomLines(rng, 4000);
+    lines[3000] = "the needle is here, needle";
+    TrigramIndex index(lines);
+    BuildToEnd(index);
+    IncrementalSearch search(lines);
+    search.SetIndex(&index);
+
+    // 索引で答えるので、Step() なしで完了している
+    search.SetQuery("needle", 1);
+    ASSERT_TRUE(search.Done());
+    ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "needle"));
+    for (int trial = 0; trial < 50; ++trial) {
+        const std::string& line = lines[rng() % lines.size()];
+        if (line.size() < 10) continue;
+        const std::string query = line.substr(rng() % (line.size() - 6), 5);
+        search.Clear();
+        search.SetQuery(query, 1);
+        ASSERT_TRUE(search.Done());
+        ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, query));
+    }
+    // 短いクエリは走査する
+    search.Clear();
+    search.SetQuery("ab", 1);
+    ASSERT_TRUE(!search.Done());
+    while (!search.Step()) {}
+    ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "ab"));
+
+    // 編集を反映した索引で探し直す
+    lines[10] = "needle";
+    index.UpdateLine(10);
+    search.SetQuery("needle", 2);
+    ASSERT_TRUE(search.Done());
+    ASSERT_TRUE(search.Matches() == FindAllAtOnce(lines, "needle"));
+}
+
+int main() {
+    return run_all_tests();
+}
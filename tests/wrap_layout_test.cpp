@@ -0,0 +1,103 @@
+#include "test_framework.h"
+#include "wrap_layout.h"
+#include "block_model.h"
+
+using namespace ShinoEditor;
+
+TEST(ComputeRowStarts_Ascii) {
+    auto starts = WrapLayout::ComputeRowStarts("abcdefghij", 4);
+    ASSERT_EQ(static_cast<int>(starts.size()), 3);
+    ASSERT_EQ(starts[1], static_cast<size_t>(4));
+    ASSERT_EQ(starts[2], static_cast<size_t>(8));
+
+    // 幅に収まる行は 1 段
+    ASSERT_EQ(static_cast<int>(WrapLayout::ComputeRowStarts("abcd", 4).size()), 1);
+    ASSERT_EQ(static_cast<int>(WrapLayout::ComputeRowStarts("", 4).size()), 1);
+}
+
+TEST(ComputeRowStarts_WideChars) {
+    // 全角は2桁。幅3では1文字ずつ折り返す
+    auto starts = WrapLayout::ComputeRowStarts("あいう", 3);
+    ASSERT_EQ(static_cast<int>(starts.size()), 3);
+    ASSERT_EQ(starts[1], static_cast<size_t>(3));
+    ASSERT_EQ(starts[2], static_cast<size_t>(6));
+}
+
+TEST(ComputeRowStarts_LineStartKinsoku) {
+    // 「。」は行頭に来ないので直前の文字ごと次の段へ送る
+    auto starts = WrapLayout::ComputeRowStarts("あいうえお。", 10);
+    ASSERT_EQ(static_cast<int>(starts.size()), 2);
+    ASSERT_EQ(starts[1], static_cast<size_t>(12)); // "お。" から次の段
+
+    // 連続する行頭禁則文字もまとめて送る
+    starts = WrapLayout::ComputeRowStarts("あいうえ」、かき", 8);
+    ASSERT_EQ(static_cast<int>(starts.size()), 3);
+    ASSERT_EQ(starts[1], static_cast<size_t>(9)); // "え」、" から次の段
+}
+
+TEST(ComputeRowStarts_LineEndKinsoku) {
+    // 「「」は行末に残さない
+    auto starts = WrapLayout::ComputeRowStarts("あいう「えお」", 8);
+    ASSERT_EQ(static_cast<int>(starts.size()), 2);
+    ASSERT_EQ(starts[1], static_cast<size_t>(9));
+}
+
+TEST(ComputeRowStarts_ForcedBreak) {
+    // 禁則文字だけの行は強制改行して必ず進む
+    auto starts = WrapLayout::ComputeRowStarts("。。。。。。", 4);
+    ASSERT_EQ(static_cast<int>(starts.size()), 3);
+}
+
+TEST(RowMapping_WithFolding) {
+    std::vector<std::string> lines = {
+        "# H1", "aaaaaaaaaa", "b", "```", "c", "```", "tail"
+    };
+    BlockModel bm(lines);
+    WrapLayout layout(lines);
+    layout.SetWidth(4);
+    layout.SetVisibleLines(bm.GetVisibleLineIndices(), bm.GetVisibleLines());
+
+    // "aaaaaaaaaa" は 3 段
+    ASSERT_EQ(layout.TotalRows(), 9);
+    ASSERT_EQ(layout.FirstRowOf(1), 1);
+    ASSERT_EQ(layout.FirstRowOf(2), 4);
+    int sub = -1;
+    ASSERT_EQ(layout.RowToVisible(3, &sub), 1);
+    ASSERT_EQ(sub, 2);
+    ASSERT_EQ(layout.RowToVisible(4, &sub), 2);
+    ASSERT_EQ(sub, 0);
+
+    // コードブロックを折り畳むと 3 行が "[コードブロック] [...]" の1行になる
+    bm.ToggleFold(4);
+    layout.SetVisibleLines(bm.GetVisibleLineIndices(), bm.GetVisibleLines());
+    ASSERT_EQ(static_cast<int>(bm.GetVisibleLineIndices().size()), 5);
+    const int folded_rows = static_cast<int>(layout.GetRowStarts(3).size());
+    ASSERT_EQ(layout.FirstRowOf(4), 4 + 1 + folded_rows);
+    ASSERT_EQ(layout.RowToVisible(layout.TotalRows() - 1), 4);
+}
+
+TEST(RowMapping_LazyResizeAndEdit) {
+    std::vector<std::string> lines = {"abcdefgh", "xy", "abcdefgh"};
+    BlockModel bm(lines);
+    WrapLayout layout(lines);
+    layout.SetWidth(4);
+    layout.SetVisibleLines(bm.GetVisibleLineIndices(), bm.GetVisibleLines());
+    ASSERT_EQ(layout.TotalRows(), 5);
+
+    // リサイズは段数の見積もりのみ更新し、行のレイアウトは参照時に再計算
+    layout.SetWidth(8);
+    ASSERT_EQ(layout.TotalRows(), 3);
+    ASSERT_EQ(static_cast<int>(layout.GetRowStarts(0).size()), 1);
+
+    // 行の挿入はキャッシュをずらすだけ
+    lines.insert(lines.begin() + 1, "0123456789abcdef");
+    layout.InsertLines(1, 1);
+    bm.UpdateLines();
+    layout.SetVisibleLines(bm.GetVisibleLineIndices(), bm.GetVisibleLines());
+    ASSERT_EQ(layout.TotalRows(), 5);
+    ASSERT_EQ(layout.FirstRowOf(3), 4);
+}
+
+int main() {
+    return run_all_tests();
+}
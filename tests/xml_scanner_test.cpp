@@ -0,0 +1,108 @@
+#include "test_framework.h"
+#include "xml_scanner.h"
+#include <chrono>
+
+using namespace ShinoEditor;
+
+namespace {
+// イベントを "<a x=1>" "</a>" "text" のような文字列に並べる（続けて届いたテキストは 1 つにまとめる）
+class Recorder : public XmlHandler {
+public:
+    std::vector<std::string> events;
+
+    void StartElement(std::string_view name, const XmlAttributes& attributes) override {
+        std::string event = "<" + std::string(name);
+        for (const auto& attribute : attributes.Items()) {
+            event += " " + std::string(attribute.name) + "=" + std::string(attribute.value);
+        }
+        events.push_back(event + ">");
+        text_open_ = false;
+    }
+    void EndElement(std::string_view name) override {
+        events.push_back("</" + std::string(name) + ">");
+        text_open_ = false;
+    }
+    void Text(std::string_view text) override {
+        if (text_open_) {
+            events.back() += text;
+        } else {
+            events.emplace_back(text);
+            text_open_ = true;
+        }
+    }
+
+private:
+    bool text_open_ = false;
+};
+
+std::vector<std::string> Scan(std::string_view xml, size_t chunk) {
+    Recorder recorder;
+    XmlScanner scanner(recorder);
+    for (size_t pos = 0; pos < xml.size(); pos += chunk) {
+        if (!scanner.Feed(xml.substr(pos, chunk))) return {"error"};
+    }
+    if (!scanner.Finish()) return {"error"};
+    return recorder.events;
+}
+}
+
+TEST(XmlScanner_ElementsAttributesAndText) {
+    const std::string xml =
+        "<?xml version=\"1.0\"?>\n<!-- comment <a> -->"
+        "<w:p a=\"1\" b='x &gt; y'><w:t>A &amp; B &#x3042;&#12356;</w:t><w:br/>"
+        "<![CDATA[<raw> & ]]><c d=\"q>r\" /></w:p>";
+    const std::vector<std::string> expected = {
+        "\n", "<w:p a=1 b=x > y>", "<w:t>", "A & B あい", "</w:t>", "<w:br>", "</w:br>",
+        "<raw> & ", "<c d=q>r>", "</c>", "</w:p>"};
+    ASSERT_TRUE(Scan(xml, xml.size()) == expected);
+
+    // どこで断片に切れても同じイベントになる
+    for (size_t chunk = 1; chunk < 12; ++chunk) {
+        ASSERT_TRUE(Scan(xml, chunk) == expected);
+    }
+}
+
+TEST(XmlScanner_DecodesReferencesAndKeepsUnknown) {
+    std::string out;
+    XmlScanner::AppendDecoded("&lt;a&gt; &quot;&apos; &unknown; & &#0; &#x1F600;", out);
+    ASSERT_EQ(out, std::string("<a> \"' &unknown; & &#0; \xF0\x9F\x98\x80"));
+}
+
+TEST(XmlScanner_RejectsBrokenMarkup) {
+    ASSERT_TRUE(Scan("<a b=c></a>", 4) == std::vector<std::string>{"error"});
+    ASSERT_TRUE(Scan("<a><b", 2) == std::vector<std::string>{"error"});
+    ASSERT_TRUE(Scan("<a></>", 3) == std::vector<std::string>{"error"});
+    // 閉じていない参照は最後にそのまま渡す
+    ASSERT_TRUE(Scan("<a>x &amp", 3) == (std::vector<std::string>{"<a>", "x &amp"}));
+}
+
+TEST(XmlScanner_LongPendingMarkupIsLinearAndCapped) {
+    // '>' を多く含む長いコメント・引用符の中の '>'・CDATA を小さな断片で渡しても、
+    // 持ち越した残りを先頭から読み直さない（読み直すと 2 乗の時間になる）
+    std::string filler;
+    for (int i = 0; i < 200000; ++i) filler += "x>";
+    const std::string xml = "<a><!--" + filler + "--><b v=\"" + filler + "\"/><![CDATA[" + filler + "]]>t &amp; u</a>";
+    const auto start = std::chrono::steady_clock::now();
+    const auto events = Scan(xml, 64);
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    const std::vector<std::string> expected = {"<a>", "<b v=" + filler + ">", "</b>", filler + "t & u", "</a>"};
+    ASSERT_TRUE(events == expected);
+
+    // 終わらないタグは上限で壊れているとみなす
+    Recorder recorder;
+    XmlScanner scanner(recorder);
+    ASSERT_TRUE(scanner.Feed("<a><!--"));
+    const std::string chunk(1 << 20, '>');
+    bool ok = true;
+    for (size_t total = 0; ok && total <= XmlScanner::kMaxPendingBytes + chunk.size(); total += chunk.size()) {
+        ok = scanner.Feed(chunk);
+    }
+    ASSERT_FALSE(ok);
+    // 閉じていない参照のあとの長いテキストは持ち越さずに渡す
+    ASSERT_TRUE(Scan("<a>x & " + std::string(100, 'y') + "</a>", 8) ==
+                (std::vector<std::string>{"<a>", "x & " + std::string(100, 'y'), "</a>"}));
+}
+
+int main() {
+    return run_all_tests();
+}
@@ -0,0 +1,147 @@
+#include "test_framework.h"
+#include "docx_test_helper.h"
+#include "error_handler.h"
+#include "zip_archive.h"
+
+using namespace ShinoEditor;
+
+namespace {
+std::string FromHex(std::string_view hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) out += static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16));
+    return out;
+}
+
+// 開けずに投げた ShinoError の分類（投げなければ UI）
+ShinoError::Category OpenError(const std::filesystem::path& path) {
+    try {
+        ZipReader zip;
+        zip.Open(path.string());
+    } catch (const ShinoError& e) {
+        return e.category();
+    }
+    return ShinoError::Category::UI;
+}
+}
+
+TEST(ZipReader_ReadsStoredAndDeflatedEntries) {
+    auto dir = test_utils::create_temp_dir("zip_read");
+    test_docx::ZipBuilder builder;
+    builder.Add("a.txt", "hello");
+    builder.Add("dir/empty", "");
+    // zlib で "hello hello hello" を DEFLATE したもの
+    builder.AddRaw("b.txt", FromHex("cb48cdc9c957c8409000"), ZipReader::kDeflated, 17,
+                   Crc32("hello hello hello"));
+    std::string archive = builder.Finish();
+    archive += "trailing data";
+    test_docx::WriteFile(dir / "t.zip", archive);
+
+    ZipReader zip;
+    zip.Open((dir / "t.zip").string());
+    ASSERT_EQ(zip.Entries().size(), size_t(3));
+    ASSERT_TRUE(zip.Find("missing") == nullptr);
+    std::string data;
+    zip.ReadAll(*zip.Find("a.txt"), data);
+    ASSERT_EQ(data, std::string("hello"));
+    zip.ReadAll(*zip.Find("dir/empty"), data);
+    ASSERT_TRUE(data.empty());
+    zip.ReadAll(*zip.Find("b.txt"), data);
+    ASSERT_EQ(data, std::string("hello hello hello"));
+
+    // 途中で止められる
+    ASSERT_FALSE(zip.Read(*zip.Find("b.txt"), [](std::string_view) { return false; }));
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ZipReader_RejectsBrokenArchives) {
+    auto dir = test_utils::create_temp_dir("zip_broken");
+    ASSERT_TRUE(OpenError(dir / "missing.zip") == ShinoError::Category::File);
+    test_docx::WriteFile(dir / "short.zip", "PK");
+    ASSERT_TRUE(OpenError(dir / "short.zip") == ShinoError::Category::Parser);
+    test_docx::WriteFile(dir / "text.zip", std::string(1000, 'x'));
+    ASSERT_TRUE(OpenError(dir / "text.zip") == ShinoError::Category::Parser);
+
+    // CRC が合わなければ読んだときに投げる
+    test_docx::ZipBuilder builder;
+    builder.AddRaw("a.txt", "hello", ZipReader::kStored, 5, Crc32("hellO"));
+    test_docx::WriteFile(dir / "crc.zip", builder.Finish());
+    ZipReader zip;
+    zip.Open((dir / "crc.zip").string());
+    bool thrown = false;
+    try {
+        std::string data;
+        zip.ReadAll(zip.Entries()[0], data);
+    } catch (const ShinoError& e) {
+        thrown = e.category() == ShinoError::Category::Parser;
+    }
+    ASSERT_TRUE(thrown);
+
+    // 書かれた大きさを超えて展開しない（小さな ZIP から巨大な中身を作らせない）
+    const std::string big(8 << 20, 'a');
+    std::string compressed;
+    Deflater deflater([&compressed](std::string_view chunk) { compressed.append(chunk); });
+    deflater.Write(big);
+    deflater.Finish();
+    test_docx::ZipBuilder bomb;
+    bomb.AddRaw("small.txt", compressed, ZipReader::kDeflated, 100, Crc32(big.substr(0, 100)));
+    bomb.AddRaw("huge.txt", compressed, ZipReader::kDeflated, 0xFFFFFFF0u, Crc32(big));
+    test_docx::WriteFile(dir / "bomb.zip", bomb.Finish());
+    ZipReader bombs;
+    bombs.Open((dir / "bomb.zip").string());
+    for (const auto& entry : bombs.Entries()) {
+        size_t received = 0;
+        bool rejected = false;
+        try {
+            bombs.Read(entry, [&received](std::string_view chunk) {
+                received += chunk.size();
+                return true;
+            });
+        } catch (const ShinoError& e) {
+            rejected = e.category() == ShinoError::Category::Parser;
+        }
+        ASSERT_TRUE(rejected);
+        ASSERT_TRUE(received <= 100);
+    }
+    test_utils::cleanup_temp_dir(dir);
+}
+
+TEST(ZipWriter_WritesArchivesZipReaderCanRead) {
+    auto dir = test_utils::create_temp_dir("zip_write");
+    std::string large;
+    for (int i = 0; i < 20000; ++i) large += "row " + std::to_string(i) + "\n";
+    std::string archive;
+    StringSink sink(archive);
+    ZipWriter writer(sink);
+    writer.Add("a.txt", "hello", ZipReader::kStored);
+    writer.Add("empty", "", ZipReader::kDeflated);
+    // 少しずつ書いても 1 つの項目になる
+    writer.Begin("dir/large.txt", ZipReader::kDeflated);
+    for (size_t i = 0; i < large.size(); i += 1000) writer.Write(std::string_view(large).substr(i, 1000));
+    writer.End();
+    writer.Add("stored.txt", large, ZipReader::kStored);
+    ASSERT_TRUE(writer.Finish());
+    ASSERT_EQ(writer.BytesWritten(), static_cast<uint64_t>(archive.size()));
+    test_docx::WriteFile(dir / "w.zip", archive);
+
+    ZipReader zip;
+    zip.Open((dir / "w.zip").string());
+    ASSERT_EQ(zip.Entries().size(), size_t(4));
+    std::string data;
+    zip.ReadAll(*zip.Find("a.txt"), data);
+    ASSERT_EQ(data, std::string("hello"));
+    zip.ReadAll(*zip.Find("empty"), data);
+    ASSERT_TRUE(data.empty());
+    const auto* deflated = zip.Find("dir/large.txt");
+    ASSERT_EQ(deflated->method, ZipReader::kDeflated);
+    ASSERT_TRUE(deflated->compressed_size < large.size() / 3);
+    zip.ReadAll(*deflated, data);
+    ASSERT_TRUE(data == large);
+    ASSERT_EQ(zip.Find("stored.txt")->method, ZipReader::kStored);
+    zip.ReadAll(*zip.Find("stored.txt"), data);
+    ASSERT_TRUE(data == large);
+    test_utils::cleanup_temp_dir(dir);
+}
+
+int main() {
+    return run_all_tests();
+}